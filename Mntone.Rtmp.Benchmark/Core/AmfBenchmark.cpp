@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "amf0.h"
+#include "amf0_reader.h"
+#include "amf0_writer.h"
+#include "amf3.h"
+#include "commands.h"
+#include "net_status.h"
+
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Benchmark {
+
+	namespace {
+
+		const size_t ITERATIONS = 200000;
+
+		// onStatus as a server sends it for NetStream.Play.Start
+		std::vector<uint8> on_status()
+		{
+			auto information = amf_value::create_object();
+			information.insert( "level", amf_value::create_string( "status" ) );
+			information.insert( "code", amf_value::create_string( "NetStream.Play.Start" ) );
+			information.insert( "description", amf_value::create_string( "Started playing live." ) );
+			information.insert( "details", amf_value::create_string( "live" ) );
+			information.insert( "clientid", amf_value::create_string( "ASAi4Vfr" ) );
+
+			std::vector<amf_value> values;
+			values.push_back( amf_value::create_string( "onStatus" ) );
+			values.push_back( amf_value::create_number( 0.0 ) );
+			values.push_back( amf_value() );
+			values.push_back( std::move( information ) );
+
+			std::vector<uint8> wire;
+			amf0::serialize( values, wire );
+			return wire;
+		}
+
+	}
+
+	// Finding the status code of an onStatus: the value tree against the pull reader
+	BENCHMARK( Amf_StatusDispatch )
+	{
+		const auto wire = on_status();
+		size_t found = 0;
+
+		stopwatch tree_watch;
+		for( auto i = 0u; i < ITERATIONS; ++i )
+		{
+			std::vector<amf_value> amf;
+			amf0::parse( wire.data(), wire.size(), amf );
+			const auto code = amf.size() >= 4 ? amf[3].find( "code" ) : nullptr;
+			found += code != nullptr && code->type() == amf_type::string ? code->as_string().size() : 0;
+		}
+		const auto tree_seconds = tree_watch.seconds();
+
+		stopwatch reader_watch;
+		for( auto i = 0u; i < ITERATIONS; ++i )
+		{
+			amf0::reader reader( wire.data(), wire.size() );
+			reader.next();
+			reader.next();
+			reader.next();
+			if( reader.next() == amf0::token::object_begin && reader.find( "code" ) && reader.current() == amf0::token::string )
+			{
+				found -= reader.string().size();
+			}
+		}
+		const auto reader_seconds = reader_watch.seconds();
+		if( found != 0 )
+		{
+			throw std::runtime_error( "code mismatch" );
+		}
+
+		report( "Amf_StatusDispatch/tree", "per message", tree_seconds * 1e9 / ITERATIONS, "ns" );
+		report( "Amf_StatusDispatch/reader", "per message", reader_seconds * 1e9 / ITERATIONS, "ns" );
+	}
+
+	// Status code classification of what a reconnecting player sees, known codes and unknown ones
+	BENCHMARK( NetStatus_Classify )
+	{
+		const char* const known[] =
+		{
+			"NetStream.Play.Reset",
+			"NetStream.Play.Start",
+			"NetStream.Play.PublishNotify",
+			"NetStream.Play.UnpublishNotify",
+			"NetStream.Play.InsufficientBW",
+			"NetStream.Play.NoSupportedTrackFound",
+			"NetStream.Buffer.Full",
+			"NetStream.Buffer.Empty",
+			"NetStream.Seek.Notify",
+			"NetStream.Record.DiskQuotaExceeded",
+			"NetStream.Failed",
+			"NetStream.Unpublish.Success",
+		};
+		const char* const unknown[] =
+		{
+			"NetStream.Play.Transitioned",
+			"NetStream.Video.DimensionChange",
+			"NetConnection.Connect.NetworkChange",
+			"Custom.Event",
+		};
+
+		const auto run = [&]( const char* name, const std::vector<string_ref>& codes )
+		{
+			uint32 checksum = 0;
+			stopwatch watch;
+			for( auto i = 0u; i < ITERATIONS; ++i )
+			{
+				for( const auto& code : codes )
+				{
+					checksum += static_cast<uint32>( parse_net_stream_code( code ) );
+				}
+			}
+			const auto seconds = watch.seconds();
+			if( checksum == 0 )
+			{
+				throw std::runtime_error( "no codes" );
+			}
+			report( std::string( "NetStatus_Classify/" ) + name, "per code", seconds * 1e9 / ( ITERATIONS * codes.size() ), "ns" );
+		};
+		run( "known", std::vector<string_ref>( std::begin( known ), std::end( known ) ) );
+		run( "unknown", std::vector<string_ref>( std::begin( unknown ), std::end( unknown ) ) );
+	}
+
+	// Encoding play and seek: a value tree serialized afterwards, the direct writer, and the
+	// per-connection templates
+	BENCHMARK( Amf_CommandEncode )
+	{
+		const std::string stream_name( "mp4:sample_1080p.mp4" );
+		size_t bytes = 0;
+
+		stopwatch tree_watch;
+		for( auto i = 0u; i < ITERATIONS; ++i )
+		{
+			std::vector<amf_value> command;
+			command.push_back( amf_value::create_string( "play" ) );
+			command.push_back( amf_value::create_number( 0.0 ) );
+			command.push_back( amf_value() );
+			command.push_back( amf_value::create_string( stream_name ) );
+			command.push_back( amf_value::create_number( 0.0 ) );
+			std::vector<uint8> out;
+			amf0::serialize( command, out );
+			bytes += out.size();
+		}
+		const auto tree_seconds = tree_watch.seconds();
+
+		stopwatch writer_watch;
+		for( auto i = 0u; i < ITERATIONS; ++i )
+		{
+			std::vector<uint8> out;
+			amf0::writer( out ).command( "play", 0.0 ).null().string( stream_name ).number( 0.0 );
+			bytes -= out.size();
+		}
+		const auto writer_seconds = writer_watch.seconds();
+
+		const commands::command_templates templates;
+		stopwatch template_watch;
+		for( auto i = 0u; i < ITERATIONS; ++i )
+		{
+			bytes += templates.play( stream_name, 0.0 ).size();
+		}
+		const auto template_seconds = template_watch.seconds();
+
+		size_t seek_bytes = 0;
+		stopwatch seek_writer_watch;
+		for( auto i = 0u; i < ITERATIONS; ++i )
+		{
+			std::vector<uint8> out;
+			amf0::writer( out ).command( "seek", 0.0 ).null().number( static_cast<float64>( i ) );
+			seek_bytes += out.size();
+		}
+		const auto seek_writer_seconds = seek_writer_watch.seconds();
+
+		stopwatch seek_template_watch;
+		for( auto i = 0u; i < ITERATIONS; ++i )
+		{
+			seek_bytes -= templates.seek( static_cast<float64>( i ) ).size();
+		}
+		const auto seek_template_seconds = seek_template_watch.seconds();
+
+		bytes -= templates.play( stream_name, 0.0 ).size() * ITERATIONS;
+		if( bytes != 0 || seek_bytes != 0 )
+		{
+			throw std::runtime_error( "length mismatch" );
+		}
+
+		report( "Amf_CommandEncode/tree", "per command", tree_seconds * 1e9 / ITERATIONS, "ns" );
+		report( "Amf_CommandEncode/writer", "per command", writer_seconds * 1e9 / ITERATIONS, "ns" );
+		report( "Amf_CommandEncode/template", "per command", template_seconds * 1e9 / ITERATIONS, "ns" );
+		report( "Amf_CommandEncode/seek writer", "per command", seek_writer_seconds * 1e9 / ITERATIONS, "ns" );
+		report( "Amf_CommandEncode/seek template", "per command", seek_template_seconds * 1e9 / ITERATIONS, "ns" );
+	}
+
+	// A data message of 20 same-shaped records (a telemetry or cue list) in AMF0 and in AMF3
+	BENCHMARK( Amf_Amf3DataMessage )
+	{
+		auto records = amf_value::create_strict_array();
+		for( auto i = 0; i < 20; ++i )
+		{
+			auto record = amf_value::create_object();
+			record.insert( "timestamp", amf_value::create_number( 1000.0 * i ) );
+			record.insert( "bitrate", amf_value::create_number( 4500.0 + i ) );
+			record.insert( "dropped", amf_value::create_number( 0.0 ) );
+			record.insert( "source", amf_value::create_string( "camera-1" ) );
+			records.append( std::move( record ) );
+		}
+
+		std::vector<uint8> amf0_body, amf3_body;
+		stopwatch amf0_watch;
+		for( auto i = 0u; i < ITERATIONS / 20; ++i )
+		{
+			amf0_body.clear();
+			amf0::serialize( records, amf0_body );
+		}
+		const auto amf0_seconds = amf0_watch.seconds();
+
+		stopwatch amf3_watch;
+		for( auto i = 0u; i < ITERATIONS / 20; ++i )
+		{
+			amf3_body.clear();
+			amf3::serialize( records, amf3_body );
+		}
+		const auto amf3_seconds = amf3_watch.seconds();
+
+		std::vector<amf_value> parsed;
+		stopwatch parse_watch;
+		for( auto i = 0u; i < ITERATIONS / 20; ++i )
+		{
+			parsed.clear();
+			amf3::parse( amf3_body.data(), amf3_body.size(), parsed );
+		}
+		const auto parse_seconds = parse_watch.seconds();
+
+		report( "Amf_Amf3DataMessage/amf0", "size", static_cast<float64>( amf0_body.size() ), "B" );
+		report( "Amf_Amf3DataMessage/amf0", "encode", amf0_seconds * 1e9 / ( ITERATIONS / 20 ), "ns" );
+		report( "Amf_Amf3DataMessage/amf3", "size", static_cast<float64>( amf3_body.size() ), "B" );
+		report( "Amf_Amf3DataMessage/amf3", "encode", amf3_seconds * 1e9 / ( ITERATIONS / 20 ), "ns" );
+		report( "Amf_Amf3DataMessage/amf3", "parse", parse_seconds * 1e9 / ( ITERATIONS / 20 ), "ns" );
+	}
+
+} } }
\ No newline at end of file
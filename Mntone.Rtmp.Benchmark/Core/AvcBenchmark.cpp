@@ -0,0 +1,125 @@
+#include "pch.h"
+#include <sstream>
+#include "annex_b.h"
+
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Benchmark {
+
+	namespace {
+
+		const size_t PASSES = 20;
+
+		// 1080p60 at 8 Mbit/s, 4-byte NAL lengths
+		const float64 STREAM_BYTES_PER_SECOND = 1000000.0;
+
+		void append_unit( std::vector<uint8>& frame, size_t length, uint8 header )
+		{
+			frame.push_back( static_cast<uint8>( length >> 24 ) );
+			frame.push_back( static_cast<uint8>( length >> 16 ) );
+			frame.push_back( static_cast<uint8>( length >> 8 ) );
+			frame.push_back( static_cast<uint8>( length ) );
+			frame.push_back( header );
+			frame.insert( frame.end(), length - 1, static_cast<uint8>( length ) );
+		}
+
+		// Ten seconds of NAL unit bodies as an x264 1080p60 stream carries them: an access unit
+		// delimiter and four slices per frame, SEI and 240 KB of slices on the key frame every two
+		// seconds, 14 KB on the others
+		std::vector<std::vector<uint8>> capture()
+		{
+			std::vector<std::vector<uint8>> frames;
+			for( auto i = 0u; i < 600; ++i )
+			{
+				const auto key_frame = i % 120 == 0;
+				std::vector<uint8> frame;
+				append_unit( frame, 2, 0x09 );
+				if( key_frame )
+				{
+					append_unit( frame, 700, 0x06 );
+				}
+				for( auto slice = 0u; slice < 4; ++slice )
+				{
+					append_unit( frame, key_frame ? 60 * 1024 : 3500, key_frame ? 0x65 : 0x41 );
+				}
+				frames.push_back( std::move( frame ) );
+			}
+			return frames;
+		}
+
+		// The conversion analysis_avc did before the rewrite, kept for comparison
+		byte_slice ostringstream_annex_b( const byte_slice& nal_units, body_pool& pool )
+		{
+			const uint8 start_code[3] = { 0x00, 0x00, 0x01 };
+			auto itr = nal_units.cbegin();
+			std::basic_ostringstream<uint8> st;
+			while( nal_units.cend() - itr >= 4 )
+			{
+				uint32 length( 0 );
+				utility::convert_big_endian( &itr[0], 4, &length );
+				itr += 4;
+				if( static_cast<size_t>( nal_units.cend() - itr ) < length )
+				{
+					break;
+				}
+
+				st.write( start_code, 3 );
+				st.write( &itr[0], length );
+				itr += length;
+			}
+
+			const auto& out = st.str();
+			auto buf = pool.acquire( static_cast<uint32>( out.size() ) );
+			std::copy_n( out.data(), out.size(), buf.begin() );
+			return byte_slice( std::move( buf ) );
+		}
+
+	}
+
+	// AVCC to Annex B over a 1080p60 capture. Every pass first copies each frame into a pooled
+	// body, as reassembly does, so the in-place row is that copy alone. The shared row keeps a
+	// second reference to the body, which forces the one-copy path.
+	BENCHMARK( Avc_AnnexB )
+	{
+		const auto frames = capture();
+		size_t capture_bytes = 0;
+		for( const auto& frame : frames )
+		{
+			capture_bytes += frame.size();
+		}
+		auto pool = std::make_shared<body_pool>();
+
+		const auto run = [&]( const char* name, const std::function<byte_slice( byte_slice body )>& convert )
+		{
+			size_t converted = 0;
+			stopwatch watch;
+			for( auto pass = 0u; pass < PASSES; ++pass )
+			{
+				for( const auto& frame : frames )
+				{
+					auto body = pool->acquire( static_cast<uint32>( frame.size() ) );
+					std::memcpy( body.data(), frame.data(), frame.size() );
+					converted += convert( byte_slice( std::move( body ) ) ).size();
+				}
+			}
+			const auto seconds = watch.seconds();
+			if( converted == 0 )
+			{
+				throw std::runtime_error( "nothing converted" );
+			}
+
+			const auto bytes_per_second = capture_bytes * PASSES / seconds;
+			const auto row = std::string( "Avc_AnnexB/" ) + name;
+			report( row, "throughput", bytes_per_second / ( 1024 * 1024 ), "MiB/s" );
+			report( row, "streams per core", bytes_per_second / STREAM_BYTES_PER_SECOND, "streams" );
+		};
+		run( "ostringstream", [&pool]( byte_slice body ) { return ostringstream_annex_b( body, *pool ); } );
+		run( "shared", [&pool]( byte_slice body )
+		{
+			const auto holder = body;
+			return avcc_to_annex_b( std::move( body ), 4, *pool );
+		} );
+		run( "in place", [&pool]( byte_slice body ) { return avcc_to_annex_b( std::move( body ), 4, *pool ); } );
+	}
+
+} } }
\ No newline at end of file
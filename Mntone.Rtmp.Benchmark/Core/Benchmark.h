@@ -0,0 +1,61 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Benchmarks register themselves like the unit tests do and print one line per metric.
+// They are not part of ctest; run mntone_rtmp_core_benchmark [filter] on a quiet machine.
+#define BENCHMARK( benchmark_name ) \
+	static void benchmark_name(); \
+	static ::Mntone::Rtmp::Benchmark::benchmark_registrar benchmark_name##_registrar_instance_( #benchmark_name, &benchmark_name ); \
+	static void benchmark_name()
+
+namespace Mntone { namespace Rtmp { namespace Benchmark {
+
+	struct benchmark_registry
+	{
+		struct entry
+		{
+			const char* name;
+			std::function<void()> method;
+		};
+
+		static std::vector<entry>& entries()
+		{
+			static std::vector<entry> instance;
+			return instance;
+		}
+	};
+
+	struct benchmark_registrar
+	{
+		benchmark_registrar( const char* name, std::function<void()> method )
+		{
+			benchmark_registry::entries().push_back( { name, std::move( method ) } );
+		}
+	};
+
+	inline void report( const std::string& name, const char* metric, double value, const char* unit )
+	{
+		std::printf( "%-40s %-20s %16.3f %s\n", name.c_str(), metric, value, unit );
+	}
+
+	class stopwatch final
+	{
+	public:
+		stopwatch()
+			: start_( std::chrono::steady_clock::now() )
+		{ }
+
+		double seconds() const
+		{
+			return std::chrono::duration<double>( std::chrono::steady_clock::now() - start_ ).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point start_;
+	};
+
+} } }
\ No newline at end of file
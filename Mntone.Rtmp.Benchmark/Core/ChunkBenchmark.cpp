@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "chunk_demuxer.h"
+#include "chunk_muxer.h"
+
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Benchmark {
+
+	namespace {
+
+		const uint32 CHUNK_SIZE = 128;
+		const size_t PASSES = 50;
+
+		struct captured_message
+		{
+			captured_message( uint16 chunk_stream_id, type_id_type type_id, uint32 stream_id, int64 timestamp, size_t length )
+				: header( chunk_stream_id )
+				, body( length, static_cast<uint8>( length ) )
+			{
+				header.type_id = type_id;
+				header.stream_id = stream_id;
+				header.timestamp = timestamp;
+			}
+
+			rtmp_header header;
+			std::vector<uint8> body;
+		};
+
+		// Ten seconds of a play session as a server emits it: 30 fps video with a key frame every
+		// two seconds, 44.1 kHz AAC, periodic pings and a data channel on a two-byte chunk stream id
+		std::vector<captured_message> capture()
+		{
+			std::vector<captured_message> messages;
+			for( int64 ms = 0; ms < 10000; ++ms )
+			{
+				if( ms % 1000 == 0 )
+				{
+					messages.emplace_back( 2, type_id_type::user_control_message, 0, ms, 6 );
+					messages.emplace_back( 70, type_id_type::data_message_amf0, 1, ms, 200 );
+				}
+				if( ms * 441 / 1024 != ( ms + 1 ) * 441 / 1024 )
+				{
+					messages.emplace_back( 4, type_id_type::audio_message, 1, ms, 370 );
+				}
+				if( ms % 33 == 0 )
+				{
+					messages.emplace_back( 6, type_id_type::video_message, 1, ms, ms % 2000 == 0 ? 60000 : 7000 );
+				}
+			}
+			return messages;
+		}
+
+		size_t chunk_count( const std::vector<captured_message>& messages )
+		{
+			size_t count = 0;
+			for( const auto& message : messages )
+			{
+				count += std::max<size_t>( 1, ( message.body.size() + CHUNK_SIZE - 1 ) / CHUNK_SIZE );
+			}
+			return count;
+		}
+
+		std::vector<uint8> mux( const std::vector<captured_message>& messages, uint32 chunk_size )
+		{
+			std::vector<uint8> wire;
+			chunk_muxer muxer;
+			muxer.set_chunk_size( chunk_size );
+			for( const auto& message : messages )
+			{
+				muxer.write( message.header, message.body.data(), message.body.size(), wire );
+			}
+			return wire;
+		}
+
+		// Seconds to parse wire PASSES times, fed in receive-sized blocks
+		float64 demux( const std::vector<uint8>& wire, uint32 chunk_size, size_t expected_messages )
+		{
+			chunk_demuxer demuxer;
+			demuxer.set_chunk_size( chunk_size );
+			size_t dispatched = 0;
+			const auto handler = [&dispatched]( rtmp_header, byte_slice ) { ++dispatched; };
+
+			const size_t block_size = chunk_demuxer::receive_block_size;
+			stopwatch watch;
+			for( auto pass = 0u; pass < PASSES; ++pass )
+			{
+				auto& buffer = demuxer.buffer();
+				for( size_t offset = 0; offset < wire.size(); )
+				{
+					const auto block = std::min( std::min( block_size, wire.size() - offset ), buffer.write_length() );
+					std::memcpy( buffer.write_pointer(), wire.data() + offset, block );
+					buffer.commit( block );
+					offset += block;
+					demuxer.parse( handler );
+				}
+			}
+			const auto seconds = watch.seconds();
+			if( dispatched != expected_messages * PASSES )
+			{
+				throw std::runtime_error( "lost messages" );
+			}
+			return seconds;
+		}
+
+	}
+
+	BENCHMARK( Chunk_MuxCapturedStream )
+	{
+		const auto messages = capture();
+		const auto chunks = chunk_count( messages ) * PASSES;
+
+		std::vector<uint8> wire;
+		chunk_muxer muxer;
+		muxer.set_chunk_size( CHUNK_SIZE );
+
+		size_t audio_messages = 0, audio_header_bytes = 0;
+		stopwatch watch;
+		for( auto pass = 0u; pass < PASSES; ++pass )
+		{
+			for( const auto& message : messages )
+			{
+				wire.clear();
+				const auto layout = muxer.write( message.header, message.body.data(), message.body.size(), wire );
+				if( message.header.type_id == type_id_type::audio_message )
+				{
+					++audio_messages;
+					audio_header_bytes += layout.wire_length() - layout.body_length;
+				}
+			}
+		}
+		const auto seconds = watch.seconds();
+		report( "Chunk_MuxCapturedStream", "per chunk", seconds * 1e9 / chunks, "ns" );
+		report( "Chunk_MuxCapturedStream", "throughput", chunks / seconds / 1e6, "Mchunk/s" );
+		report( "Chunk_MuxCapturedStream", "audio header", static_cast<float64>( audio_header_bytes ) / audio_messages, "B/msg" );
+	}
+
+	BENCHMARK( Chunk_DemuxCapturedStream )
+	{
+		const auto messages = capture();
+		const auto chunks = chunk_count( messages ) * PASSES;
+		const auto seconds = demux( mux( messages, CHUNK_SIZE ), CHUNK_SIZE, messages.size() );
+		report( "Chunk_DemuxCapturedStream", "per chunk", seconds * 1e9 / chunks, "ns" );
+		report( "Chunk_DemuxCapturedStream", "throughput", chunks / seconds / 1e6, "Mchunk/s" );
+	}
+
+	// Header overhead and parse cost of the same session at the default and at negotiated chunk sizes
+	BENCHMARK( Chunk_LargeChunkSize )
+	{
+		const auto messages = capture();
+		size_t body_bytes = 0;
+		for( const auto& message : messages )
+		{
+			body_bytes += message.body.size();
+		}
+
+		const uint32 chunk_sizes[] = { CHUNK_SIZE, 4096, 64 * 1024 };
+		for( const auto chunk_size : chunk_sizes )
+		{
+			const auto wire = mux( messages, chunk_size );
+			const auto seconds = demux( wire, chunk_size, messages.size() );
+			const auto name = "Chunk_LargeChunkSize/" + std::to_string( chunk_size );
+			report( name, "header overhead", 100.0 * ( wire.size() - body_bytes ) / wire.size(), "%" );
+			report( name, "parse", wire.size() * PASSES / seconds / 1e6, "MB/s" );
+		}
+	}
+
+} } }
\ No newline at end of file
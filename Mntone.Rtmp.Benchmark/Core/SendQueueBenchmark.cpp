@@ -0,0 +1,172 @@
+#include "pch.h"
+#include <deque>
+#include "chunk_muxer.h"
+#include "send_queue.h"
+
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Benchmark {
+
+	namespace {
+
+		// As net_connection flushes: one batch in flight, the next popped when it drains
+		const size_t BATCH_LENGTH = 64 * 1024;
+
+		// 6 Mbit/s uplink
+		const float64 LINK_BYTES_PER_MS = 750.0;
+		const int64 DURATION_MS = 60000;
+
+		struct latency_result
+		{
+			std::vector<float64> latencies;
+			size_t batches;
+		};
+
+		// A minute of publishing on a simulated link: 30 fps video with a 300 KB key frame every two
+		// seconds and 12 KB inter frames, 48 kHz AAC every 1024 samples. Returns each audio
+		// message's time from send to its last byte leaving the link.
+		latency_result simulate( const interleave_policy& policy, send_priority audio_priority )
+		{
+			const std::vector<uint8> key_frame( 300 * 1024, 0x17 ), inter_frame( 12 * 1024, 0x27 ), audio( 400, 0xaf );
+
+			chunk_muxer muxer;
+			send_queue queue;
+			queue.set_policy( policy );
+
+			// Messages of the audio class in queue order; video joins them when audio shares its class
+			struct pending_message
+			{
+				int64 sent;
+				size_t remaining;
+				bool audio;
+			};
+			std::deque<pending_message> pending;
+
+			latency_result result;
+			result.batches = 0;
+			auto in_flight = false;
+			float64 link_time = 0.0;
+
+			int64 audio_count = 0;
+			for( int64 ms = 0; ms < DURATION_MS || !queue.empty() || in_flight; ++ms )
+			{
+				if( ms < DURATION_MS )
+				{
+					if( ms % 33 == 0 )
+					{
+						rtmp_header header( 6 );
+						header.type_id = type_id_type::video_message;
+						header.stream_id = 1;
+						header.timestamp = ms;
+						const auto& frame = ms % 2000 == 0 ? key_frame : inter_frame;
+						gather_buffer message;
+						const auto layout = muxer.write( header, frame.data(), frame.size(), message );
+						if( audio_priority == send_priority::video )
+						{
+							pending.push_back( { ms, message.size(), false } );
+						}
+						queue.push( send_priority::video, std::move( message ), layout );
+					}
+					if( audio_count * 1024 * 1000 / 48000 == ms )
+					{
+						++audio_count;
+						rtmp_header header( 4 );
+						header.type_id = type_id_type::audio_message;
+						header.stream_id = 1;
+						header.timestamp = ms;
+						gather_buffer message;
+						const auto layout = muxer.write( header, audio.data(), audio.size(), message );
+						pending.push_back( { ms, message.size(), true } );
+						queue.push( audio_priority, std::move( message ), layout );
+					}
+				}
+
+				// Run the link to the end of this millisecond
+				for( ;; )
+				{
+					if( !in_flight )
+					{
+						if( queue.empty() )
+						{
+							break;
+						}
+						const auto audio_before = queue.size( audio_priority );
+						gather_buffer batch;
+						queue.pop( BATCH_LENGTH, batch );
+						const auto start = std::max( link_time, static_cast<float64>( ms ) );
+						link_time = start + batch.size() / LINK_BYTES_PER_MS;
+						in_flight = true;
+						++result.batches;
+
+						// Nothing outranks the audio class here, so its bytes lead the batch
+						auto audio_popped = audio_before - queue.size( audio_priority );
+						size_t offset = 0;
+						while( audio_popped != 0 )
+						{
+							auto& front = pending.front();
+							const auto taken = std::min( audio_popped, front.remaining );
+							front.remaining -= taken;
+							audio_popped -= taken;
+							offset += taken;
+							if( front.remaining != 0 )
+							{
+								break;
+							}
+							if( front.audio )
+							{
+								result.latencies.push_back( start + offset / LINK_BYTES_PER_MS - front.sent );
+							}
+							pending.pop_front();
+						}
+					}
+					if( link_time > ms + 1 )
+					{
+						break;
+					}
+					in_flight = false;
+				}
+			}
+			return result;
+		}
+
+		float64 percentile( std::vector<float64> values, float64 rank )
+		{
+			std::sort( values.begin(), values.end() );
+			return values[std::min( values.size() - 1, static_cast<size_t>( rank * values.size() ) )];
+		}
+
+	}
+
+	// Audio send latency behind key frames: message order (audio in the video class), priority
+	// classes with whole 64 KiB batches, and priority classes with video yielding to audio
+	BENCHMARK( Publish_AudioLatency )
+	{
+		struct configuration
+		{
+			const char* name;
+			size_t max_video_bytes_before_yield;
+			send_priority audio_priority;
+		};
+		const configuration configurations[] =
+		{
+			{ "fifo", 0, send_priority::video },
+			{ "priority", 0, send_priority::audio },
+			{ "yield 16K", 16 * 1024, send_priority::audio },
+			{ "yield 4K", 4 * 1024, send_priority::audio },
+		};
+
+		for( const auto& configuration : configurations )
+		{
+			interleave_policy policy;
+			policy.max_video_bytes_before_yield = configuration.max_video_bytes_before_yield;
+			const auto result = simulate( policy, configuration.audio_priority );
+
+			const auto name = std::string( "Publish_AudioLatency/" ) + configuration.name;
+			report( name, "p50", percentile( result.latencies, 0.50 ), "ms" );
+			report( name, "p99", percentile( result.latencies, 0.99 ), "ms" );
+			report( name, "max", percentile( result.latencies, 1.0 ), "ms" );
+			report( name, "batches", static_cast<float64>( result.batches ), "" );
+		}
+	}
+
+} } }
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "pch.h"
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "epoll_transport.h"
+#ifdef MNTONE_RTMP_HAS_IO_URING
+#include "uring_transport.h"
+#endif
+
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Benchmark {
+
+	namespace {
+
+		// Chunk muxer output for one 4 KiB video chunk with its header
+		const size_t MESSAGE_SIZE = 4096 + 12;
+		const size_t CONNECTIONS = 8;
+		const size_t MESSAGES_PER_CONNECTION = 20000;
+
+		double cpu_seconds( pthread_t thread )
+		{
+			clockid_t clock;
+			timespec time = {};
+			if( pthread_getcpuclockid( thread, &clock ) != 0 || clock_gettime( clock, &time ) != 0 )
+			{
+				return 0.0;
+			}
+			return time.tv_sec + time.tv_nsec / 1e9;
+		}
+
+		int listen_loopback( uint16& port )
+		{
+			const auto fd = socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+			sockaddr_in address = {};
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+			socklen_t length = sizeof( address );
+			if( bind( fd, reinterpret_cast<sockaddr*>( &address ), length ) != 0 || listen( fd, static_cast<int>( CONNECTIONS ) ) != 0 )
+			{
+				throw std::runtime_error( "listen failed" );
+			}
+			getsockname( fd, reinterpret_cast<sockaddr*>( &address ), &length );
+			port = ntohs( address.sin_port );
+			return fd;
+		}
+
+		// Blocking peer: swallows one direction, then produces the other
+		void serve( int fd, size_t total, std::atomic<size_t>& drained, const std::atomic<bool>& send_phase )
+		{
+			std::vector<uint8> data( 65536 );
+			size_t received = 0;
+			ssize_t length;
+			while( received < total && ( length = recv( fd, data.data(), data.size(), 0 ) ) > 0 )
+			{
+				received += static_cast<size_t>( length );
+			}
+			++drained;
+
+			while( !send_phase )
+			{
+				std::this_thread::yield();
+			}
+			for( size_t sent = 0; sent < total; )
+			{
+				length = send( fd, data.data(), std::min( data.size(), total - sent ), MSG_NOSIGNAL );
+				if( length <= 0 )
+				{
+					break;
+				}
+				sent += static_cast<size_t>( length );
+			}
+			::close( fd );
+		}
+
+		struct receiver
+		{
+			receiver()
+				: buffer( 2 * 65536 )
+				, received( 0 )
+			{ }
+
+			ring_buffer buffer;
+			std::atomic<size_t> received;
+		};
+
+		void print( const std::string& name, size_t messages, double seconds, double cpu )
+		{
+			const auto megabits = messages * MESSAGE_SIZE * 8 / 1e6;
+			report( name, "messages/sec", messages / seconds, "msg/s" );
+			report( name, "throughput", megabits / seconds, "Mbps" );
+			report( name, "cpu per Mbps", cpu / seconds * 100.0 / ( megabits / seconds ), "%cpu/Mbps" );
+		}
+
+		// Sends MESSAGES_PER_CONNECTION muxer-sized writes on every connection, then receives the same
+		// volume back. CPU is the loop thread plus the writing thread; the peer threads are excluded.
+		template<typename Loop, typename Transport, typename Report>
+		void run( const std::string& name, Loop& loop, Report report_loop )
+		{
+			uint16 port;
+			const auto listener = listen_loopback( port );
+			const auto total = MESSAGE_SIZE * MESSAGES_PER_CONNECTION;
+
+			std::atomic<size_t> drained( 0 );
+			std::atomic<bool> send_phase( false );
+			std::vector<std::thread> servers;
+			std::thread acceptor( [&]
+			{
+				for( size_t i = 0; i < CONNECTIONS; ++i )
+				{
+					const auto fd = accept( listener, nullptr, nullptr );
+					servers.emplace_back( serve, fd, total, std::ref( drained ), std::cref( send_phase ) );
+				}
+			} );
+
+			std::thread loop_thread( [&] { loop.run(); } );
+
+			std::vector<std::unique_ptr<Transport>> transports;
+			std::vector<std::unique_ptr<receiver>> receivers;
+			std::atomic<size_t> connected( 0 );
+			for( size_t i = 0; i < CONNECTIONS; ++i )
+			{
+				transports.emplace_back( new Transport( loop ) );
+				receivers.emplace_back( new receiver() );
+				transports.back()->connect( "127.0.0.1", port, [&]( bool succeeded ) { if( succeeded ) ++connected; } );
+			}
+			while( connected != CONNECTIONS )
+			{
+				std::this_thread::yield();
+			}
+			acceptor.join();
+
+			for( size_t i = 0; i < CONNECTIONS; ++i )
+			{
+				auto& r = *receivers[i];
+				transports[i]->start_receive( r.buffer, [&r]( size_t length )
+				{
+					r.received += length;
+					r.buffer.consume( r.buffer.size() );
+				} );
+			}
+
+			// Send
+			{
+				const auto cpu = cpu_seconds( loop_thread.native_handle() ) + cpu_seconds( pthread_self() );
+				const stopwatch watch;
+				const std::vector<uint8> message( MESSAGE_SIZE, 0x5a );
+				for( size_t m = 0; m < MESSAGES_PER_CONNECTION; ++m )
+				{
+					for( auto& transport : transports )
+					{
+						transport->write( message );
+					}
+				}
+				while( drained != CONNECTIONS )
+				{
+					std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+				}
+				const auto seconds = watch.seconds();
+				print( name + "/send", CONNECTIONS * MESSAGES_PER_CONNECTION, seconds, cpu_seconds( loop_thread.native_handle() ) + cpu_seconds( pthread_self() ) - cpu );
+			}
+			send_phase = true;
+
+			// Receive
+			{
+				const auto cpu = cpu_seconds( loop_thread.native_handle() );
+				const stopwatch watch;
+				for( auto& r : receivers )
+				{
+					while( r->received < total )
+					{
+						std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+					}
+				}
+				const auto seconds = watch.seconds();
+				print( name + "/receive", CONNECTIONS * MESSAGES_PER_CONNECTION, seconds, cpu_seconds( loop_thread.native_handle() ) - cpu );
+			}
+
+			for( auto& server : servers )
+			{
+				server.join();
+			}
+			for( auto& transport : transports )
+			{
+				transport->close();
+			}
+			loop.stop();
+			loop_thread.join();
+			::close( listener );
+
+			report_loop( name );
+		}
+
+	}
+
+	BENCHMARK( Transport_Epoll )
+	{
+		epoll_loop loop;
+		run<epoll_loop, epoll_transport>( "Transport_Epoll", loop, []( const std::string& ) { } );
+	}
+
+#ifdef MNTONE_RTMP_HAS_IO_URING
+	BENCHMARK( Transport_Uring )
+	{
+		uring_loop loop;
+		run<uring_loop, uring_transport>( "Transport_Uring", loop, [&loop]( const std::string& name )
+		{
+			const auto& stats = loop.stats();
+			const auto messages = 2.0 * CONNECTIONS * MESSAGES_PER_CONNECTION;
+			report( name, "enters/message", stats.enters / messages, "syscalls" );
+			report( name, "sqes/enter", static_cast<double>( stats.submissions ) / stats.enters, "sqes" );
+		} );
+	}
+#endif
+
+} } }
\ No newline at end of file
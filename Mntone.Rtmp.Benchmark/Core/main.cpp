@@ -0,0 +1,30 @@
+#include "pch.h"
+
+using namespace Mntone::Rtmp::Benchmark;
+
+// Runs every registered benchmark, or only those whose name contains argv[1].
+int main( int argc, char* argv[] )
+{
+	const std::string filter = argc > 1 ? argv[1] : "";
+
+	auto count = 0u;
+	for( const auto& entry : benchmark_registry::entries() )
+	{
+		if( !filter.empty() && std::string( entry.name ).find( filter ) == std::string::npos )
+		{
+			continue;
+		}
+
+		try
+		{
+			entry.method();
+			++count;
+		}
+		catch( const std::exception& ex )
+		{
+			std::fprintf( stderr, "FAILED %s: %s\n", entry.name, ex.what() );
+			return 1;
+		}
+	}
+	return count != 0 ? 0 : 1;
+}
\ No newline at end of file
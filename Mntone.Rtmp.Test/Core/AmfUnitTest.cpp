@@ -0,0 +1,468 @@
+#include "pch.h"
+#include "amf0.h"
+#include "amf0_reader.h"
+#include "amf0_writer.h"
+#include "amf3.h"
+#include "commands.h"
+#include "net_status.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Test {
+
+	TEST_CLASS( AmfUnitTest )
+	{
+	public:
+		TEST_METHOD( Amf0_1RoundTrip )
+		{
+			auto object = amf_value::create_object();
+			object.insert( "code", amf_value::create_string( "NetStream.Play.Start" ) );
+			object.insert( "level", amf_value::create_string( "status" ) );
+
+			auto array = amf_value::create_ecma_array();
+			array.insert( "width", amf_value::create_number( 1920.0 ) );
+			array.insert( "stereo", amf_value::create_boolean( true ) );
+			object.insert( "info", std::move( array ) );
+
+			auto list = amf_value::create_strict_array();
+			list.append( amf_value::create_number( 1.0 ) );
+			list.append( amf_value() );
+			list.append( amf_value::create_date( 1234567.0 ) );
+
+			std::vector<amf_value> values;
+			values.push_back( amf_value::create_string( "onStatus" ) );
+			values.push_back( amf_value::create_number( 0.0 ) );
+			values.push_back( amf_value() );
+			values.push_back( std::move( object ) );
+			values.push_back( std::move( list ) );
+
+			std::vector<uint8> wire;
+			amf0::serialize( values, wire );
+
+			std::vector<amf_value> parsed;
+			Assert::IsTrue( amf0::parse( wire.data(), wire.size(), parsed ) );
+			Assert::AreEqual( 5u, static_cast<uint32>( parsed.size() ) );
+			Assert::IsTrue( parsed[0].as_string() == "onStatus" );
+			Assert::IsTrue( parsed[2].is_null() );
+
+			const auto& info = parsed[3];
+			Assert::IsTrue( info.type() == amf_type::object );
+			Assert::IsTrue( info.find( "code" )->as_string() == "NetStream.Play.Start" );
+			Assert::AreEqual( 1920.0, info.find( "info" )->find( "width" )->as_number() );
+			Assert::IsTrue( info.find( "info" )->find( "stereo" )->as_boolean() );
+			Assert::IsTrue( info.find( "missing" ) == nullptr );
+
+			const auto& elements = parsed[4].elements();
+			Assert::AreEqual( 3u, static_cast<uint32>( elements.size() ) );
+			Assert::IsTrue( elements[1].is_null() );
+			Assert::IsTrue( elements[2].type() == amf_type::date );
+			Assert::AreEqual( 1234567.0, elements[2].as_number() );
+		}
+
+		TEST_METHOD( Amf0_2Truncated )
+		{
+			std::vector<amf_value> values;
+			values.push_back( amf_value::create_string( "_result" ) );
+			values.push_back( amf_value::create_number( 1.0 ) );
+
+			std::vector<uint8> wire;
+			amf0::serialize( values, wire );
+			wire.pop_back();
+
+			std::vector<amf_value> parsed;
+			Assert::IsFalse( amf0::parse( wire.data(), wire.size(), parsed ) );
+			Assert::AreEqual( 1u, static_cast<uint32>( parsed.size() ) );
+		}
+
+		TEST_METHOD( Amf0_3DeepNesting )
+		{
+			// Nested object markers without end markers must be rejected, not recursed forever
+			std::vector<uint8> wire;
+			for( auto i = 0u; i < 10000; ++i )
+			{
+				wire.push_back( 0x03 );
+				wire.push_back( 0x00 );
+				wire.push_back( 0x01 );
+				wire.push_back( 'a' );
+			}
+
+			std::vector<amf_value> parsed;
+			Assert::IsFalse( amf0::parse( wire.data(), wire.size(), parsed ) );
+
+			amf0::reader reader( wire.data(), wire.size() );
+			auto result = reader.next();
+			while( result == amf0::token::object_begin )
+			{
+				result = reader.next();
+			}
+			Assert::IsTrue( result == amf0::token::error );
+			Assert::IsTrue( reader.next() == amf0::token::error );
+		}
+
+		TEST_METHOD( Amf0_4Reader )
+		{
+			auto object = amf_value::create_object();
+			object.insert( "level", amf_value::create_string( "status" ) );
+			auto nested = amf_value::create_ecma_array();
+			nested.insert( "width", amf_value::create_number( 1920.0 ) );
+			object.insert( "info", std::move( nested ) );
+			object.insert( "code", amf_value::create_string( "NetStream.Play.Start" ) );
+
+			auto list = amf_value::create_strict_array();
+			list.append( amf_value::create_boolean( true ) );
+			list.append( amf_value::create_date( 42.0 ) );
+
+			std::vector<amf_value> values;
+			values.push_back( amf_value::create_string( "onStatus" ) );
+			values.push_back( amf_value::create_number( 0.0 ) );
+			values.push_back( amf_value() );
+			values.push_back( std::move( object ) );
+			values.push_back( std::move( list ) );
+
+			std::vector<uint8> wire;
+			amf0::serialize( values, wire );
+
+			amf0::reader reader( wire.data(), wire.size() );
+			Assert::IsTrue( reader.next() == amf0::token::string );
+			Assert::IsTrue( reader.string() == "onStatus" );
+			Assert::IsTrue( reader.next() == amf0::token::number );
+			Assert::AreEqual( 0.0, reader.number() );
+			Assert::IsTrue( reader.next() == amf0::token::null );
+
+			// A copy reads the object again after find() has consumed it
+			Assert::IsTrue( reader.next() == amf0::token::object_begin );
+			auto again = reader;
+			Assert::IsTrue( reader.find( "code" ) );
+			Assert::IsTrue( reader.current() == amf0::token::string );
+			Assert::IsTrue( reader.string() == "NetStream.Play.Start" );
+			Assert::IsTrue( reader.next() == amf0::token::object_end );
+
+			Assert::IsTrue( again.next() == amf0::token::string );
+			Assert::IsTrue( again.name() == "level" );
+			Assert::IsTrue( again.next() == amf0::token::ecma_array_begin );
+			Assert::IsTrue( again.name() == "info" );
+			Assert::AreEqual( 2u, static_cast<uint32>( again.depth() ) );
+			Assert::IsTrue( again.next() == amf0::token::number );
+			Assert::IsTrue( again.name() == "width" );
+			Assert::AreEqual( 1920.0, again.number() );
+			Assert::IsTrue( again.next() == amf0::token::object_end );
+			Assert::IsFalse( again.find( "missing" ) );
+			Assert::AreEqual( 0u, static_cast<uint32>( again.depth() ) );
+
+			Assert::IsTrue( reader.next() == amf0::token::strict_array_begin );
+			Assert::IsTrue( reader.next() == amf0::token::boolean );
+			Assert::IsTrue( reader.boolean() );
+			Assert::IsTrue( reader.next() == amf0::token::date );
+			Assert::AreEqual( 42.0, reader.number() );
+			Assert::IsTrue( reader.next() == amf0::token::array_end );
+			Assert::IsTrue( reader.next() == amf0::token::end );
+
+			// Truncated inside the object
+			amf0::reader truncated( wire.data(), wire.size() - 40 );
+			for( auto i = 0; i < 3; ++i )
+			{
+				truncated.next();
+			}
+			Assert::IsTrue( truncated.next() == amf0::token::object_begin );
+			Assert::IsFalse( truncated.skip() );
+			Assert::IsTrue( truncated.next() == amf0::token::error );
+		}
+
+		TEST_METHOD( Amf0_5Writer )
+		{
+			// The writer produces the same bytes as serializing the equivalent tree
+			auto object = amf_value::create_object();
+			object.insert( "level", amf_value::create_string( "status" ) );
+			auto nested = amf_value::create_ecma_array();
+			nested.insert( "width", amf_value::create_number( 1920.0 ) );
+			object.insert( "info", std::move( nested ) );
+
+			std::vector<amf_value> values;
+			values.push_back( amf_value::create_string( "call" ) );
+			values.push_back( amf_value::create_number( 3.0 ) );
+			values.push_back( amf_value() );
+			values.push_back( std::move( object ) );
+			values.push_back( amf_value::create_date( 42.0 ) );
+			values.push_back( amf_value::create_string( std::string( 0x10000, 'x' ) ) );
+			std::vector<uint8> expected;
+			amf0::serialize( values, expected );
+
+			std::vector<uint8> wire;
+			amf0::writer writer( wire );
+			writer.command( "call", 3.0 ).null()
+				.begin_object()
+					.property( "level" ).string( "status" )
+					.property( "info" ).begin_ecma_array( 1 )
+						.property( "width" ).number( 1920.0 )
+					.end_ecma_array()
+				.end_object()
+				.date( 42.0 )
+				.string( std::string( 0x10000, 'x' ) );
+			Assert::IsTrue( wire == expected );
+
+			// Connect with user arguments, read back
+			commands::connect_parameters parameters( "live", "rtmp://localhost/live" );
+			amf0::writer( parameters.arguments ).string( "token" );
+			const auto connect = commands::connect( parameters );
+
+			amf0::reader reader( connect.data(), connect.size() );
+			Assert::IsTrue( reader.next() == amf0::token::string );
+			Assert::IsTrue( reader.string() == "connect" );
+			Assert::IsTrue( reader.next() == amf0::token::number );
+			Assert::AreEqual( 1.0, reader.number() );
+			Assert::IsTrue( reader.next() == amf0::token::object_begin );
+			auto command_object = reader;
+			Assert::IsTrue( command_object.find( "tcUrl" ) );
+			Assert::IsTrue( command_object.string() == "rtmp://localhost/live" );
+			Assert::IsTrue( reader.skip() );
+			Assert::IsTrue( reader.next() == amf0::token::string );
+			Assert::IsTrue( reader.string() == "token" );
+			Assert::IsTrue( reader.next() == amf0::token::end );
+		}
+
+		TEST_METHOD( Amf0_6CommandTemplates )
+		{
+			const commands::command_templates templates;
+			const uint8 create_stream[] =
+			{
+				0x02, 0x00, 0x0c, 'c', 'r', 'e', 'a', 't', 'e', 'S', 't', 'r', 'e', 'a', 'm',
+				0x00, 0x40, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x05,
+			};
+			Assert::IsTrue( templates.create_stream( 3 ) == std::vector<uint8>( std::begin( create_stream ), std::end( create_stream ) ) );
+
+			// The rest against the value tree serializer, render after render
+			const auto command = []( const char* name, float64 transaction_id, std::vector<amf_value> arguments )
+			{
+				std::vector<amf_value> values;
+				values.push_back( amf_value::create_string( name ) );
+				values.push_back( amf_value::create_number( transaction_id ) );
+				values.push_back( amf_value() );
+				for( auto& argument : arguments )
+				{
+					values.push_back( std::move( argument ) );
+				}
+				std::vector<uint8> out;
+				amf0::serialize( values, out );
+				return out;
+			};
+			for( auto i = 0u; i < 2; ++i )
+			{
+				Assert::IsTrue( templates.create_stream( 3 + i ) == command( "createStream", 3.0 + i, {} ) );
+				Assert::IsTrue( templates.close_stream( 1 + i ) == command( "closeStream", 0.0, { amf_value::create_number( 1.0 + i ) } ) );
+				Assert::IsTrue( templates.pause( i == 0, 1.5 * i ) == command( "pause", 0.0, { amf_value::create_boolean( i == 0 ), amf_value::create_number( 1.5 * i ) } ) );
+				Assert::IsTrue( templates.seek( 30.0 * i ) == command( "seek", 0.0, { amf_value::create_number( 30.0 * i ) } ) );
+			}
+			Assert::IsTrue( templates.play( "live" ) == command( "play", 0.0, { amf_value::create_string( "live" ) } ) );
+			Assert::IsTrue( templates.play( "mp4:a.mp4", 10.0 ) == command( "play", 0.0, { amf_value::create_string( "mp4:a.mp4" ), amf_value::create_number( 10.0 ) } ) );
+			Assert::IsTrue( templates.play( "mp4:a.mp4", 10.0, 5.0, 0 ) == command( "play", 0.0,
+				{ amf_value::create_string( "mp4:a.mp4" ), amf_value::create_number( 10.0 ), amf_value::create_number( 5.0 ), amf_value::create_number( 0.0 ) } ) );
+		}
+
+		TEST_METHOD( Amf3_1RoundTrip )
+		{
+			std::vector<amf_value> values;
+			auto list = amf_value::create_strict_array();
+			for( auto i = 0; i < 3; ++i )
+			{
+				auto entry = amf_value::create_object();
+				entry.insert( "name", amf_value::create_string( "keyframe" ) );
+				entry.insert( "position", amf_value::create_number( 1000.0 * i ) );
+				list.append( std::move( entry ) );
+			}
+			values.push_back( std::move( list ) );
+
+			const float64 numbers[] = { 0.0, -1.0, 268435455.0, -268435456.0, 268435456.0, 1.5, -0.0 };
+			for( const auto number : numbers )
+			{
+				values.push_back( amf_value::create_number( number ) );
+			}
+			values.push_back( amf_value::create_string( "" ) );
+			values.push_back( amf_value::create_string( "keyframe" ) );
+			values.push_back( amf_value::create_boolean( true ) );
+			values.push_back( amf_value::create_undefined() );
+			values.push_back( amf_value() );
+			values.push_back( amf_value::create_date( 1234567.0 ) );
+			auto array = amf_value::create_ecma_array();
+			array.insert( "width", amf_value::create_number( 1920.0 ) );
+			values.push_back( std::move( array ) );
+
+			std::vector<uint8> wire;
+			amf3::serialize( values, wire );
+			std::vector<amf_value> parsed;
+			Assert::IsTrue( amf3::parse( wire.data(), wire.size(), parsed ) );
+
+			// Same tree, compared through its AMF0 form
+			std::vector<uint8> expected, actual;
+			amf0::serialize( values, expected );
+			amf0::serialize( parsed, actual );
+			Assert::IsTrue( expected == actual );
+
+			// Repeated names and shapes went out as references
+			Assert::IsTrue( wire.size() * 2 < expected.size() );
+		}
+
+		TEST_METHOD( Amf3_2References )
+		{
+			const std::vector<uint8> wire =
+			{
+				0x06, 0x05, 'a', 'b',							// "ab"
+				0x06, 0x00,										// string reference 0
+				0x0a, 0x13, 0x01, 0x03, 'x', 0x04, 0x7f,		// { x: 127 }, sealed traits
+				0x0a, 0x01, 0x04, 0xff, 0xff, 0xff, 0xff,		// { x: -1 }, traits reference 0
+				0x0a, 0x00,										// object reference 0
+				0x09, 0x05, 0x03, 'k', 0x01, 0x01, 0x02, 0x03,	// [ k: null, false, true ]
+				0x0a, 0x0b, 0x01, 0x09, 's', 'e', 'l', 'f', 0x0a, 0x06, 0x01,	// { self: <itself> }
+			};
+			std::vector<amf_value> values;
+			Assert::IsTrue( amf3::parse( wire.data(), wire.size(), values ) );
+			Assert::AreEqual( 7u, static_cast<uint32>( values.size() ) );
+			Assert::IsTrue( values[1].as_string() == "ab" );
+			Assert::AreEqual( 127.0, values[2].find( "x" )->as_number() );
+			Assert::AreEqual( -1.0, values[3].find( "x" )->as_number() );
+			Assert::AreEqual( 127.0, values[4].find( "x" )->as_number() );
+			Assert::IsTrue( values[5].type() == amf_type::ecma_array );
+			Assert::IsTrue( values[5].find( "k" )->is_null() );
+			Assert::IsTrue( values[5].find( "1" )->as_boolean() );
+			Assert::IsTrue( values[6].find( "self" )->is_null() );
+
+			// An AMF0 body switching to AMF3 for its second value
+			std::vector<uint8> amf0_wire = { 0x02, 0x00, 0x01, 'v', 0x11 };
+			amf0_wire.insert( amf0_wire.end(), wire.begin() + 6, wire.begin() + 13 );
+			std::vector<amf_value> switched;
+			Assert::IsTrue( amf0::parse( amf0_wire.data(), amf0_wire.size(), switched ) );
+			Assert::AreEqual( 2u, static_cast<uint32>( switched.size() ) );
+			Assert::AreEqual( 127.0, switched[1].find( "x" )->as_number() );
+
+			// Each array holds two references to the one before: the expansion is capped
+			std::vector<uint8> bomb = { 0x09, 0x05, 0x01, 0x04, 0x01, 0x04, 0x01 };
+			for( uint8 i = 0; i < 40; ++i )
+			{
+				const uint8 level[] = { 0x09, 0x05, 0x01, 0x09, static_cast<uint8>( i << 1 ), 0x09, static_cast<uint8>( i << 1 ) };
+				bomb.insert( bomb.end(), level, level + sizeof( level ) );
+			}
+			std::vector<amf_value> exploded;
+			Assert::IsFalse( amf3::parse( bomb.data(), bomb.size(), exploded ) );
+
+			// One 60 KB string, then a dense array of references to it: few values, many bytes
+			std::vector<uint8> strings = { 0x06, 0x87, 0xa9, 0x41 };
+			strings.insert( strings.end(), 60000, 'x' );
+			const uint8 array_header[] = { 0x09, 0x84, 0x80, 0x01, 0x01 };
+			strings.insert( strings.end(), array_header, array_header + sizeof( array_header ) );
+			for( auto i = 0; i < 0x8000; ++i )
+			{
+				strings.push_back( 0x06 );
+				strings.push_back( 0x00 );
+			}
+			std::vector<amf_value> copied;
+			Assert::IsFalse( amf3::parse( strings.data(), strings.size(), copied ) );
+
+			// The same string referenced a few times is fine
+			strings.resize( 4 + 60000 );
+			const uint8 few[] = { 0x09, 0x07, 0x01, 0x06, 0x00, 0x06, 0x00, 0x06, 0x00 };
+			strings.insert( strings.end(), few, few + sizeof( few ) );
+			std::vector<amf_value> referenced;
+			Assert::IsTrue( amf3::parse( strings.data(), strings.size(), referenced ) );
+			Assert::AreEqual( 2u, static_cast<uint32>( referenced.size() ) );
+			Assert::AreEqual( 60000u, static_cast<uint32>( referenced[1].elements()[2].as_string().size() ) );
+
+			// Truncated inside the traits
+			std::vector<amf_value> truncated;
+			Assert::IsFalse( amf3::parse( wire.data(), 10, truncated ) );
+		}
+
+		TEST_METHOD( NetStatus_1Codes )
+		{
+			Assert::IsTrue( net_status_code::net_connection_connect_success == parse_net_connection_connect_code( "NetConnection.Connect.Success" ) );
+			Assert::IsTrue( net_status_code::net_connection_connect_rejected == parse_net_connection_connect_code( "NetConnection.Connect.Rejected" ) );
+			Assert::IsTrue( net_status_code::net_connection_connect_other == parse_net_connection_connect_code( "NetConnection.Connect.Unknown" ) );
+			Assert::IsTrue( net_status_code::net_connection_connect_other == parse_net_connection_connect_code( "Net" ) );
+
+			Assert::IsTrue( net_status_code::net_stream_play_start == parse_net_stream_code( "NetStream.Play.Start" ) );
+			Assert::IsTrue( net_status_code::net_stream_play_stream_not_found == parse_net_stream_code( "NetStream.Play.StreamNotFound" ) );
+			Assert::IsTrue( net_status_code::net_stream_buffer_full == parse_net_stream_code( "NetStream.Buffer.Full" ) );
+			Assert::IsTrue( net_status_code::net_stream_seek_notify == parse_net_stream_code( "NetStream.Seek.Notify" ) );
+			Assert::IsTrue( net_status_code::net_stream_failed == parse_net_stream_code( "NetStream.Failed" ) );
+			Assert::IsTrue( net_status_code::net_stream_play == ( parse_net_stream_code( "NetStream.Play.Whatever" ) & net_status_code::level2_mask ) );
+			Assert::IsTrue( net_status_code::net_stream == ( parse_net_stream_code( "NetStream" ) & net_status_code::level1_mask ) );
+		}
+
+		TEST_METHOD( NetStatus_2Vocabulary )
+		{
+			// Every named code hashes to a slot of its own
+			const struct
+			{
+				const char* name;
+				net_status_code code;
+			} codes[] =
+			{
+				{ "NetConnection.Connect.Success", net_status_code::net_connection_connect_success },
+				{ "NetConnection.Connect.Closed", net_status_code::net_connection_connect_closed },
+				{ "NetConnection.Connect.Failed", net_status_code::net_connection_connect_failed },
+				{ "NetConnection.Connect.Rejected", net_status_code::net_connection_connect_rejected },
+				{ "NetConnection.Connect.InvalidApp", net_status_code::net_connection_connect_invalid_app },
+				{ "NetConnection.Connect.AppShutdown", net_status_code::net_connection_connect_app_shutdown },
+				{ "NetConnection.Call.Failed", net_status_code::net_connection_call_failed },
+				{ "NetConnection.Call.Prohibited", net_status_code::net_connection_call_prohibited },
+				{ "NetConnection.Call.BadVersion", net_status_code::net_connection_call_bad_version },
+				{ "NetStream.Play.Start", net_status_code::net_stream_play_start },
+				{ "NetStream.Play.Stop", net_status_code::net_stream_play_stop },
+				{ "NetStream.Play.Reset", net_status_code::net_stream_play_reset },
+				{ "NetStream.Play.PublishNotify", net_status_code::net_stream_play_publish_notify },
+				{ "NetStream.Play.UnpublishNotify", net_status_code::net_stream_play_unpublish_notify },
+				{ "NetStream.Play.Transition", net_status_code::net_stream_play_transition },
+				{ "NetStream.Play.Switch", net_status_code::net_stream_play_switch },
+				{ "NetStream.Play.Complete", net_status_code::net_stream_play_complete },
+				{ "NetStream.Play.TransitionComplete", net_status_code::net_stream_play_transition_complete },
+				{ "NetStream.Play.InsufficientBW", net_status_code::net_stream_play_insufficient_bandwidth },
+				{ "NetStream.Play.Failed", net_status_code::net_stream_play_failed },
+				{ "NetStream.Play.StreamNotFound", net_status_code::net_stream_play_stream_not_found },
+				{ "NetStream.Play.FileStructureInvalid", net_status_code::net_stream_play_file_structure_invalid },
+				{ "NetStream.Play.NoSupportedTrackFound", net_status_code::net_stream_play_no_supported_track_found },
+				{ "NetStream.Pause.Notify", net_status_code::net_stream_pause_notify },
+				{ "NetStream.Unpause.Notify", net_status_code::net_stream_unpause_notify },
+				{ "NetStream.Seek.Notify", net_status_code::net_stream_seek_notify },
+				{ "NetStream.Seek.Failed", net_status_code::net_stream_seek_failed },
+				{ "NetStream.Seek.InvalidTime", net_status_code::net_stream_seek_invalid_time },
+				{ "NetStream.Publish.Start", net_status_code::net_stream_publish_start },
+				{ "NetStream.Publish.Idle", net_status_code::net_stream_publish_idle },
+				{ "NetStream.Publish.BadName", net_status_code::net_stream_publish_bad_name },
+				{ "NetStream.Unpublish.Success", net_status_code::net_stream_unpublish_success },
+				{ "NetStream.Record.Start", net_status_code::net_stream_record_start },
+				{ "NetStream.Record.Stop", net_status_code::net_stream_record_stop },
+				{ "NetStream.Record.NoAccess", net_status_code::net_stream_record_no_access },
+				{ "NetStream.Record.Failed", net_status_code::net_stream_record_failed },
+				{ "NetStream.Record.DiskQuotaExceeded", net_status_code::net_stream_record_disk_quota_exceeded },
+				{ "NetStream.Buffer.Empty", net_status_code::net_stream_buffer_empty },
+				{ "NetStream.Buffer.Full", net_status_code::net_stream_buffer_full },
+				{ "NetStream.Buffer.Flush", net_status_code::net_stream_buffer_flush },
+				{ "NetStream.MulticastStream.Reset", net_status_code::net_stream_multicast_stream_reset },
+				{ "NetStream.Failed", net_status_code::net_stream_failed },
+				{ "SharedObject.Flush.Success", net_status_code::shared_object_flush_success },
+				{ "SharedObject.Flush.Failed", net_status_code::shared_object_flush_failed },
+				{ "SharedObject.BadPersistence", net_status_code::shared_object_bad_persistence },
+				{ "SharedObject.UriMismatch", net_status_code::shared_object_uri_mismatch },
+			};
+			for( const auto& code : codes )
+			{
+				Assert::IsTrue( code.code == parse_net_status_code( code.name ) );
+			}
+
+			// Unknown codes fall back to the deepest category they name
+			Assert::IsTrue( net_status_code::net_connection_connect_other == parse_net_status_code( "NetConnection.Connect.NetworkChange" ) );
+			Assert::IsTrue( net_status_code::net_connection_other == parse_net_status_code( "NetConnection.Proxy.NotResponding" ) );
+			Assert::IsTrue( net_status_code::net_stream_play_other == parse_net_status_code( "NetStream.Play.Unknown" ) );
+			Assert::IsTrue( net_status_code::net_stream_other == parse_net_status_code( "NetStream.Video.DimensionChange" ) );
+			Assert::IsTrue( net_status_code::net_stream_other == parse_net_status_code( "NetStream.Play" ) );
+			Assert::IsTrue( net_status_code::net_stream_other == parse_net_status_code( "NetStream.Failed.Again" ) );
+			Assert::IsTrue( net_status_code::shared_object_flush_other == parse_net_status_code( "SharedObject.Flush.Pending" ) );
+			Assert::IsTrue( net_status_code::shared_object_other == parse_net_status_code( "SharedObject.Other" ) );
+			Assert::IsTrue( net_status_code::other == parse_net_status_code( "Custom.Event" ) );
+			Assert::IsTrue( net_status_code::other == parse_net_status_code( "" ) );
+			Assert::IsTrue( net_status_code::net_stream_play_other == parse_net_status_code( "NetStream.Play.Start" + std::string( 1, '\0' ) ) );
+			Assert::IsTrue( net_status_code::net_stream_other == parse_net_stream_code( "NetConnection.Call.Failed" ) );
+		}
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,544 @@
+#include "pch.h"
+#include "annex_b.h"
+#include "chunk_demuxer.h"
+#include "chunk_muxer.h"
+#include "send_queue.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Test {
+
+	TEST_CLASS( ChunkStreamUnitTest )
+	{
+	public:
+		TEST_METHOD( RingBuffer_1Wrap )
+		{
+			ring_buffer buffer( 10 );
+			Assert::AreEqual( 16u, static_cast<uint32>( buffer.capacity() ) );
+
+			uint8 data[12];
+			for( auto i = 0u; i < 3; ++i )
+			{
+				Fill( buffer, 12, static_cast<uint8>( i ) );
+				buffer.read( data, 12 );
+				Assert::AreEqual( static_cast<uint8>( i ), data[0] );
+				Assert::AreEqual( static_cast<uint8>( i + 11 ), data[11] );
+			}
+			Assert::IsTrue( buffer.empty() );
+		}
+
+		TEST_METHOD( BodyPool_1Reuse )
+		{
+			auto pool = std::make_shared<body_pool>();
+			{
+				auto buffer = pool->acquire( 100 );
+				Assert::AreEqual( 100u, static_cast<uint32>( buffer.size() ) );
+			}
+			{
+				auto buffer = pool->acquire( 200 );
+			}
+			Assert::AreEqual( static_cast<uint64>( 1 ), pool->allocation_count() );
+		}
+
+		TEST_METHOD( BodyPool_2Reserve )
+		{
+			auto pool = std::make_shared<body_pool>();
+			pool->reserve( 200 * 1024, 2 );
+			pool->reserve( 200 * 1024, 1 );
+			pool->reserve( 64 * 1024 * 1024, 1 );
+			Assert::AreEqual( static_cast<uint64>( 2 ), pool->allocation_count() );
+			{
+				auto first = pool->acquire( 100 * 1024 );
+				auto second = pool->acquire( 900 * 1024 );
+			}
+			Assert::AreEqual( static_cast<uint64>( 2 ), pool->allocation_count() );
+		}
+
+		TEST_METHOD( ByteSlice_1SharedBlock )
+		{
+			auto pool = std::make_shared<body_pool>();
+			auto buffer = pool->acquire( 8 );
+			for( auto i = 0u; i < 8; ++i )
+			{
+				buffer[i] = static_cast<uint8>( i );
+			}
+
+			byte_slice slice;
+			{
+				byte_slice whole( std::move( buffer ) );
+				slice = whole.slice( 2, 4 );
+			}
+			Assert::AreEqual( 4u, static_cast<uint32>( slice.size() ) );
+			Assert::AreEqual( static_cast<uint8>( 2 ), slice[0] );
+			Assert::AreEqual( static_cast<uint8>( 5 ), slice.slice( 3 )[0] );
+
+			// The block is still referenced by the slice, so a new body needs a fresh allocation
+			auto other = pool->acquire( 8 );
+			Assert::AreEqual( static_cast<uint64>( 2 ), pool->allocation_count() );
+		}
+
+		TEST_METHOD( ByteSlice_2AnnexBInPlace )
+		{
+			auto pool = std::make_shared<body_pool>();
+			const auto to_slice = [&pool]( const std::vector<uint8>& bytes )
+			{
+				auto buffer = pool->acquire( static_cast<uint32>( bytes.size() ) );
+				std::copy( bytes.begin(), bytes.end(), buffer.begin() );
+				return byte_slice( std::move( buffer ) );
+			};
+			const auto bytes_of = []( const byte_slice& slice ) { return std::vector<uint8>( slice.begin(), slice.end() ); };
+
+			// FLV video header, then 4-byte lengths; the last unit is truncated
+			auto message = to_slice( {
+				0x27, 0x01, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x02, 0x41, 0x9a, 0x00, 0x00, 0x00, 0x01, 0x06, 0x00, 0x00, 0x00, 0x09, 0xff } );
+			const std::vector<uint8> expected( { 0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x00, 0x00, 0x00, 0x01, 0x06 } );
+			auto units = message.slice( 5 );
+
+			// Shared with the message, so copied and the message left alone
+			const auto copied = avcc_to_annex_b( units, 4, *pool );
+			Assert::IsTrue( bytes_of( copied ) == expected );
+			Assert::IsTrue( copied.data() != units.data() );
+			Assert::AreEqual( static_cast<uint8>( 0x02 ), message[8] );
+
+			// The only reference, so rewritten where it lies
+			const auto original = units.data();
+			message.reset();
+			const auto rewritten = avcc_to_annex_b( std::move( units ), 4, *pool );
+			Assert::IsTrue( bytes_of( rewritten ) == expected );
+			Assert::IsTrue( rewritten.data() == original );
+
+			Assert::IsTrue( bytes_of( avcc_to_annex_b( to_slice( { 0x00, 0x00, 0x02, 0x41, 0x9a } ), 3, *pool ) ) == std::vector<uint8>( { 0x00, 0x00, 0x01, 0x41, 0x9a } ) );
+			Assert::IsTrue( bytes_of( avcc_to_annex_b( to_slice( { 0x00, 0x02, 0x41, 0x9a, 0x00, 0x01, 0x06 } ), 2, *pool ) ) == std::vector<uint8>( { 0x00, 0x00, 0x01, 0x41, 0x9a, 0x00, 0x00, 0x01, 0x06 } ) );
+			Assert::IsTrue( bytes_of( avcc_to_annex_b( to_slice( { 0x02, 0x41, 0x9a, 0x05 } ), 1, *pool ) ) == std::vector<uint8>( { 0x00, 0x00, 0x01, 0x41, 0x9a } ) );
+		}
+
+		TEST_METHOD( Chunk_1RoundTrip )
+		{
+			chunk_muxer muxer;
+			std::vector<uint8> wire;
+
+			// Interleaved streams, the largest 3-byte basic header, a large body and an extended timestamp
+			const uint32 chunk_stream_ids[] = { 3, 4, 65599 };
+			const uint32 lengths[] = { 20, 1000, 300 };
+			const int64 timestamps[] = { 0, 40, 0x1000000 };
+			for( auto i = 0u; i < 3; ++i )
+			{
+				for( auto j = 0u; j < 3; ++j )
+				{
+					rtmp_header header( chunk_stream_ids[j] );
+					header.timestamp = timestamps[j] + 40 * i;
+					header.type_id = type_id_type::video_message;
+					header.stream_id = 1;
+					const auto body = CreateBody( lengths[j], static_cast<uint8>( i * 3 + j ) );
+					muxer.write( std::move( header ), body.data(), body.size(), wire );
+				}
+			}
+
+			chunk_demuxer demuxer;
+			std::vector<std::pair<rtmp_header, byte_slice>> messages;
+			Deliver( demuxer, wire, 7, messages );
+
+			Assert::AreEqual( 9u, static_cast<uint32>( messages.size() ) );
+			for( auto i = 0u; i < 3; ++i )
+			{
+				for( auto j = 0u; j < 3; ++j )
+				{
+					const auto& message = messages[i * 3 + j];
+					Assert::AreEqual( chunk_stream_ids[j], message.first.chunk_stream_id );
+					Assert::AreEqual( timestamps[j] + 40 * i, message.first.timestamp );
+					Assert::AreEqual( 1u, message.first.stream_id );
+					Assert::IsTrue( CreateBody( lengths[j], static_cast<uint8>( i * 3 + j ) ) == std::vector<uint8>( message.second.begin(), message.second.end() ) );
+				}
+			}
+		}
+
+		TEST_METHOD( Chunk_2Format3OnRepeatedDelta )
+		{
+			chunk_muxer muxer;
+			std::vector<uint8> wire;
+			const auto body = CreateBody( 10, 0 );
+			for( auto i = 0u; i < 3; ++i )
+			{
+				rtmp_header header( 6 );
+				header.timestamp = 100 + 23 * i;
+				header.length = 10;
+				header.type_id = type_id_type::audio_message;
+				header.stream_id = 1;
+				muxer.write( std::move( header ), body.data(), body.size(), wire );
+			}
+
+			// fmt0 (1 + 11 + 10), fmt2 (1 + 3 + 10), fmt3 (1 + 10)
+			Assert::AreEqual( 47u, static_cast<uint32>( wire.size() ) );
+			Assert::AreEqual( static_cast<uint8>( 0xc6 ), wire[36] );
+		}
+
+		TEST_METHOD( Chunk_3SetChunkSize )
+		{
+			chunk_muxer muxer;
+			muxer.set_chunk_size( 4096 );
+
+			std::vector<uint8> wire;
+			const auto body = CreateBody( 5000, 1 );
+			rtmp_header header( 4 );
+			header.type_id = type_id_type::video_message;
+			header.stream_id = 1;
+			muxer.write( std::move( header ), body.data(), body.size(), wire );
+
+			// One continuation chunk
+			Assert::AreEqual( 5000u + 12u + 1u, static_cast<uint32>( wire.size() ) );
+
+			chunk_demuxer demuxer;
+			demuxer.set_chunk_size( 4096 );
+			std::vector<std::pair<rtmp_header, byte_slice>> messages;
+			Deliver( demuxer, wire, 1500, messages );
+			Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( body == std::vector<uint8>( messages[0].second.begin(), messages[0].second.end() ) );
+		}
+
+		TEST_METHOD( Chunk_4AbortMessage )
+		{
+			chunk_muxer muxer;
+			std::vector<uint8> aborted, wire;
+			const auto first = CreateBody( 1000, 2 ), second = CreateBody( 200, 3 );
+			rtmp_header header( 4 );
+			header.type_id = type_id_type::video_message;
+			header.stream_id = 1;
+			muxer.write( header, first.data(), first.size(), aborted );
+			muxer.write( header, second.data(), second.size(), wire );
+
+			// Two chunks of the first message, then the server gives up on it
+			chunk_demuxer demuxer;
+			std::vector<std::pair<rtmp_header, byte_slice>> messages;
+			aborted.resize( 12 + 128 + 1 + 128 );
+			Deliver( demuxer, aborted, 64, messages );
+			Assert::AreEqual( 1000u, static_cast<uint32>( demuxer.reassembly_bytes() ) );
+
+			demuxer.abort( 4 );
+			Assert::AreEqual( 0u, static_cast<uint32>( demuxer.reassembly_bytes() ) );
+
+			Deliver( demuxer, wire, 64, messages );
+			Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( second == std::vector<uint8>( messages[0].second.begin(), messages[0].second.end() ) );
+		}
+
+		TEST_METHOD( Chunk_5ReassemblyLimit )
+		{
+			chunk_muxer muxer;
+			std::vector<uint8> first_wire, second_wire, third_wire;
+			const auto first = CreateBody( 1000, 4 ), second = CreateBody( 1000, 5 ), third = CreateBody( 100, 6 );
+			rtmp_header first_header( 4 ), second_header( 5 );
+			first_header.type_id = second_header.type_id = type_id_type::video_message;
+			first_header.stream_id = second_header.stream_id = 1;
+			muxer.write( first_header, first.data(), first.size(), first_wire );
+			muxer.write( second_header, second.data(), second.size(), second_wire );
+			muxer.write( second_header, third.data(), third.size(), third_wire );
+
+			// The second message starts while the first is in flight and would exceed the cap
+			chunk_demuxer demuxer;
+			demuxer.set_reassembly_limit( 1500 );
+			std::vector<std::pair<rtmp_header, byte_slice>> messages;
+			Deliver( demuxer, std::vector<uint8>( first_wire.begin(), first_wire.begin() + 12 + 128 ), 64, messages );
+			Deliver( demuxer, second_wire, 64, messages );
+			Assert::AreEqual( 1ull, static_cast<unsigned long long>( demuxer.reassembly_limit_hits() ) );
+			Deliver( demuxer, std::vector<uint8>( first_wire.begin() + 12 + 128, first_wire.end() ), 64, messages );
+			Deliver( demuxer, third_wire, 64, messages );
+
+			// The skipped message leaves both chunk streams in sync
+			Assert::AreEqual( 2u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( first == std::vector<uint8>( messages[0].second.begin(), messages[0].second.end() ) );
+			Assert::IsTrue( third == std::vector<uint8>( messages[1].second.begin(), messages[1].second.end() ) );
+			Assert::AreEqual( 0u, static_cast<uint32>( demuxer.reassembly_bytes() ) );
+		}
+
+		TEST_METHOD( Chunk_6GatheredWrite )
+		{
+			const auto body = CreateBody( 1000, 7 );
+			auto pool = std::make_shared<body_pool>();
+			auto pooled = pool->acquire( static_cast<uint32>( body.size() ) );
+			std::copy( body.begin(), body.end(), pooled.data() );
+			const byte_slice payload( std::move( pooled ) );
+
+			rtmp_header header( 6 );
+			header.type_id = type_id_type::video_message;
+			header.stream_id = 1;
+			chunk_muxer contiguous_muxer, gathered_muxer;
+			std::vector<uint8> contiguous;
+			gather_buffer gathered;
+			contiguous_muxer.write( header, body.data(), body.size(), contiguous );
+			gathered_muxer.write( header, payload, gathered );
+			Assert::IsTrue( contiguous == gathered.flatten() );
+
+			// Headers alternate with body ranges that point into the payload itself
+			Assert::AreEqual( 16u, static_cast<uint32>( gathered.segment_count() ) );
+			for( auto i = 1u; i < gathered.segment_count(); i += 2 )
+			{
+				Assert::IsTrue( gathered.segment_data( i ) == payload.data() + ( i / 2 ) * 128 );
+			}
+
+			// A partial send resumes mid-segment
+			gathered.consume( 12 + 100 );
+			Assert::IsTrue( gathered.segment_data( 0 ) == payload.data() + 100 );
+			Assert::IsTrue( std::vector<uint8>( contiguous.begin() + 112, contiguous.end() ) == gathered.flatten() );
+		}
+
+		TEST_METHOD( Chunk_7HeaderVariants )
+		{
+			const uint32 chunk_stream_ids[] = { 5, 100, 1000 };
+			const uint32 start_timestamps[] = { 1000, 0x1000000 };
+			for( const auto chunk_stream_id : chunk_stream_ids )
+			{
+				for( const auto start_timestamp : start_timestamps )
+				{
+					chunk_muxer muxer;
+					std::vector<uint8> wire;
+					std::vector<chunk_layout> layouts;
+					const auto body = CreateBody( 300, static_cast<uint8>( chunk_stream_id ) );
+					for( auto i = 0u; i < 4; ++i )
+					{
+						rtmp_header header( chunk_stream_id );
+						header.timestamp = start_timestamp + 40 * i;
+						header.type_id = type_id_type::audio_message;
+						header.stream_id = 1;
+						layouts.push_back( muxer.write( std::move( header ), body.data(), body.size(), wire ) );
+					}
+
+					// fmt0, fmt2 establishing the delta, then fmt3 for every repeat of it
+					const auto basic_header_length = chunk_stream_id < 64 ? 1u : chunk_stream_id < 320 ? 2u : 3u;
+					const auto extended_timestamp_length = start_timestamp >= 0xffffff ? 4u : 0u;
+					Assert::AreEqual( basic_header_length + 11 + extended_timestamp_length, layouts[0].first_header_length );
+					Assert::AreEqual( basic_header_length + extended_timestamp_length, layouts[0].continuation_header_length );
+					Assert::AreEqual( basic_header_length + 3, layouts[1].first_header_length );
+					Assert::AreEqual( basic_header_length, layouts[2].first_header_length );
+					Assert::AreEqual( basic_header_length, layouts[3].first_header_length );
+
+					chunk_demuxer demuxer;
+					std::vector<std::pair<rtmp_header, byte_slice>> messages;
+					Deliver( demuxer, wire, 64, messages );
+					Assert::AreEqual( 4u, static_cast<uint32>( messages.size() ) );
+					for( auto i = 0u; i < 4; ++i )
+					{
+						Assert::AreEqual( chunk_stream_id, messages[i].first.chunk_stream_id );
+						Assert::AreEqual( start_timestamp + 40 * i, static_cast<uint32>( messages[i].first.timestamp ) );
+						Assert::IsTrue( body == std::vector<uint8>( messages[i].second.begin(), messages[i].second.end() ) );
+					}
+				}
+			}
+		}
+
+		TEST_METHOD( Chunk_8LengthChangeMidMessage )
+		{
+			const auto partial = CreateBody( 1000, 8 ), longer = CreateBody( 5000, 9 ), shorter = CreateBody( 300, 10 );
+			rtmp_header header( 4 );
+			header.type_id = type_id_type::video_message;
+			header.stream_id = 1;
+
+			// Each fmt 0 header arrives while 256 bytes of the 1000-byte message are reassembled
+			for( const auto& next : { longer, shorter } )
+			{
+				std::vector<uint8> first_wire, next_wire;
+				chunk_muxer first_muxer, next_muxer;
+				first_muxer.write( header, partial.data(), partial.size(), first_wire );
+				next_muxer.write( header, next.data(), next.size(), next_wire );
+				first_wire.resize( 12 + 128 + 1 + 128 );
+
+				chunk_demuxer demuxer;
+				std::vector<std::pair<rtmp_header, byte_slice>> messages;
+				Deliver( demuxer, first_wire, 64, messages );
+				Deliver( demuxer, next_wire, 64, messages );
+				Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+				Assert::IsTrue( next == std::vector<uint8>( messages[0].second.begin(), messages[0].second.end() ) );
+				Assert::AreEqual( 0u, static_cast<uint32>( demuxer.reassembly_bytes() ) );
+			}
+		}
+
+		TEST_METHOD( Chunk_9Reset )
+		{
+			const auto partial = CreateBody( 1000, 11 ), body = CreateBody( 10, 12 );
+			rtmp_header header( 4 );
+			header.type_id = type_id_type::audio_message;
+			header.stream_id = 1;
+
+			// After a reset the next message starts over with a fmt 0 header
+			chunk_muxer muxer;
+			muxer.set_chunk_size( 4096 );
+			std::vector<uint8> first_wire, wire;
+			muxer.write( header, partial.data(), partial.size(), first_wire );
+			muxer.reset();
+			Assert::AreEqual( 128u, muxer.chunk_size() );
+			muxer.write( header, body.data(), body.size(), wire );
+			Assert::AreEqual( 12u + 10u, static_cast<uint32>( wire.size() ) );
+			Assert::AreEqual( static_cast<uint8>( 0x04 ), wire[0] );
+
+			// A half-read message and unread bytes are dropped, not spliced into the next one
+			chunk_demuxer demuxer;
+			demuxer.set_chunk_size( 4096 );
+			std::vector<std::pair<rtmp_header, byte_slice>> messages;
+			first_wire.resize( 12 + 500 );
+			Deliver( demuxer, first_wire, 64, messages );
+			std::memcpy( demuxer.buffer().write_pointer(), first_wire.data(), 5 );
+			demuxer.buffer().commit( 5 );
+			demuxer.reset();
+			Assert::AreEqual( 0u, static_cast<uint32>( demuxer.reassembly_bytes() ) );
+			Assert::AreEqual( 128u, demuxer.chunk_size() );
+
+			Deliver( demuxer, wire, 64, messages );
+			Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( body == std::vector<uint8>( messages[0].second.begin(), messages[0].second.end() ) );
+		}
+
+		TEST_METHOD( SendQueue_1WholeChunks )
+		{
+			const auto video = CreateBody( 1000, 8 ), ping = CreateBody( 6, 9 );
+			rtmp_header video_header( 6 ), ping_header( 2 );
+			video_header.type_id = type_id_type::video_message;
+			video_header.stream_id = 1;
+			ping_header.type_id = type_id_type::user_control_message;
+
+			chunk_muxer muxer;
+			send_queue queue;
+			gather_buffer video_message, ping_message;
+			const auto video_layout = muxer.write( video_header, video.data(), video.size(), video_message );
+			Assert::AreEqual( static_cast<uint32>( video_message.size() ), static_cast<uint32>( video_layout.wire_length() ) );
+			queue.push( send_priority::video, std::move( video_message ), video_layout );
+
+			// 12 + 128 bytes; the next chunk would not fit
+			std::vector<gather_buffer> batches( 4 );
+			queue.pop( 200, batches[0] );
+			Assert::AreEqual( 140u, static_cast<uint32>( batches[0].size() ) );
+
+			// The control message goes ahead of the rest of the video message
+			const auto ping_layout = muxer.write( ping_header, ping.data(), ping.size(), ping_message );
+			queue.push( send_priority::control, std::move( ping_message ), ping_layout );
+			queue.pop( 100, batches[1] );
+			Assert::AreEqual( 18u, static_cast<uint32>( batches[1].size() ) );
+
+			// One chunk even when it exceeds the limit
+			queue.pop( 1, batches[2] );
+			Assert::AreEqual( 129u, static_cast<uint32>( batches[2].size() ) );
+			queue.pop( 10000, batches[3] );
+			Assert::IsTrue( queue.empty() );
+
+			std::vector<uint8> wire;
+			for( const auto& batch : batches )
+			{
+				const auto data = batch.flatten();
+				wire.insert( wire.end(), data.begin(), data.end() );
+			}
+			chunk_demuxer demuxer;
+			std::vector<std::pair<rtmp_header, byte_slice>> messages;
+			Deliver( demuxer, wire, 64, messages );
+			Assert::AreEqual( 2u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( messages[0].first.type_id == type_id_type::user_control_message );
+			Assert::IsTrue( ping == std::vector<uint8>( messages[0].second.begin(), messages[0].second.end() ) );
+			Assert::IsTrue( video == std::vector<uint8>( messages[1].second.begin(), messages[1].second.end() ) );
+		}
+
+		TEST_METHOD( SendQueue_2VideoYield )
+		{
+			const auto video = CreateBody( 40000, 8 ), audio = CreateBody( 200, 9 );
+			rtmp_header video_header( 6 ), audio_header( 4 );
+			video_header.type_id = type_id_type::video_message;
+			video_header.stream_id = 1;
+			audio_header.type_id = type_id_type::audio_message;
+			audio_header.stream_id = 1;
+
+			chunk_muxer muxer;
+			send_queue queue;
+			gather_buffer video_message, audio_message;
+			const auto video_layout = muxer.write( video_header, video.data(), video.size(), video_message );
+			queue.push( send_priority::video, std::move( video_message ), video_layout );
+
+			// 12 + 128 bytes, then 125 chunks of 1 + 128 up to the default 16 KiB
+			std::vector<gather_buffer> batches( 3 );
+			queue.pop( 64 * 1024, batches[0] );
+			Assert::AreEqual( 16265u, static_cast<uint32>( batches[0].size() ) );
+
+			// Audio queued meanwhile leads the next batch, which again holds 16 KiB of video at most
+			const auto audio_layout = muxer.write( audio_header, audio.data(), audio.size(), audio_message );
+			queue.push( send_priority::audio, std::move( audio_message ), audio_layout );
+			Assert::AreEqual( static_cast<uint32>( audio_layout.wire_length() ), static_cast<uint32>( queue.size( send_priority::audio ) ) );
+			queue.pop( 64 * 1024, batches[1] );
+			Assert::AreEqual( 0u, static_cast<uint32>( queue.size( send_priority::audio ) ) );
+			Assert::AreEqual( static_cast<uint32>( audio_layout.wire_length() + 127 * 129 ), static_cast<uint32>( batches[1].size() ) );
+
+			interleave_policy unbounded;
+			unbounded.max_video_bytes_before_yield = 0;
+			queue.set_policy( unbounded );
+			queue.pop( 64 * 1024, batches[2] );
+			Assert::IsTrue( queue.empty() );
+			Assert::AreEqual( 0u, static_cast<uint32>( queue.size( send_priority::video ) ) );
+
+			std::vector<uint8> wire;
+			for( const auto& batch : batches )
+			{
+				const auto data = batch.flatten();
+				wire.insert( wire.end(), data.begin(), data.end() );
+			}
+			chunk_demuxer demuxer;
+			std::vector<std::pair<rtmp_header, byte_slice>> messages;
+			Deliver( demuxer, wire, 64, messages );
+			Assert::AreEqual( 2u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( audio == std::vector<uint8>( messages[0].second.begin(), messages[0].second.end() ) );
+			Assert::IsTrue( video == std::vector<uint8>( messages[1].second.begin(), messages[1].second.end() ) );
+		}
+
+		TEST_METHOD( ChunkStreamTable_1Overflow )
+		{
+			chunk_stream_table<uint32> table;
+			table[2] = 2;
+			for( uint32 id = 64; id <= chunk_stream_table<uint32>::max_id; id += 97 )
+			{
+				table[id] = id;
+			}
+
+			// Survives every rehash of the overflow table
+			Assert::AreEqual( 2u, *table.find( 2 ) );
+			for( uint32 id = 64; id <= chunk_stream_table<uint32>::max_id; id += 97 )
+			{
+				Assert::AreEqual( id, *table.find( id ) );
+			}
+			Assert::IsTrue( table.find( 65 ) == nullptr );
+			Assert::AreEqual( 0u, table[65] );
+		}
+
+	private:
+		static std::vector<uint8> CreateBody( size_t length, uint8 seed )
+		{
+			std::vector<uint8> body( length );
+			for( auto i = 0u; i < length; ++i )
+			{
+				body[i] = static_cast<uint8>( seed + i );
+			}
+			return body;
+		}
+
+		static void Fill( ring_buffer& buffer, size_t length, uint8 seed )
+		{
+			for( auto i = 0u; i < length; ++i )
+			{
+				*buffer.write_pointer() = static_cast<uint8>( seed + i );
+				buffer.commit( 1 );
+			}
+		}
+
+		static void Deliver( chunk_demuxer& demuxer, const std::vector<uint8>& wire, size_t block_size, std::vector<std::pair<rtmp_header, byte_slice>>& messages )
+		{
+			for( size_t offset = 0; offset < wire.size(); )
+			{
+				auto& buffer = demuxer.buffer();
+				const auto block = std::min( std::min( block_size, wire.size() - offset ), buffer.write_length() );
+				std::memcpy( buffer.write_pointer(), wire.data() + offset, block );
+				buffer.commit( block );
+				offset += block;
+
+				demuxer.parse( [&]( rtmp_header header, byte_slice data )
+				{
+					messages.emplace_back( std::move( header ), std::move( data ) );
+				} );
+			}
+		}
+	};
+
+} } }
\ No newline at end of file
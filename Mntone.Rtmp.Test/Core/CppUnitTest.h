@@ -0,0 +1,136 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Minimal stand-in for the Visual Studio CppUnitTestFramework so the core tests can be
+// written the same way as the WinRT ones and run by ctest on any platform.
+#define TEST_CLASS( class_name ) \
+	class class_name; \
+	inline const char* test_class_name_of( const class_name* ) { return #class_name; } \
+	class class_name \
+		: public ::Microsoft::VisualStudio::CppUnitTestFramework::test_class<class_name>
+
+#define TEST_METHOD( method_name ) \
+	struct method_name##_registrar \
+	{ \
+		method_name##_registrar() \
+		{ \
+			::Microsoft::VisualStudio::CppUnitTestFramework::test_registrar( \
+				test_class_name_of( static_cast<const self_type*>( nullptr ) ), #method_name, [] { self_type().method_name(); } ); \
+		} \
+	}; \
+	static inline method_name##_registrar method_name##_registrar_instance_; \
+	void method_name()
+
+namespace Microsoft { namespace VisualStudio { namespace CppUnitTestFramework {
+
+	struct test_failure
+		: public std::runtime_error
+	{
+		explicit test_failure( const std::string& message )
+			: std::runtime_error( message )
+		{ }
+	};
+
+	struct test_registry
+	{
+		struct entry
+		{
+			const char* class_name;
+			const char* method_name;
+			std::function<void()> method;
+		};
+
+		static std::vector<entry>& entries()
+		{
+			static std::vector<entry> instance;
+			return instance;
+		}
+	};
+
+	struct test_registrar
+	{
+		test_registrar( const char* class_name, const char* method_name, std::function<void()> method )
+		{
+			test_registry::entries().push_back( { class_name, method_name, std::move( method ) } );
+		}
+	};
+
+	template<typename T>
+	class test_class
+	{
+	protected:
+		typedef T self_type;
+	};
+
+	class Assert final
+	{
+	public:
+		template<typename T, typename U>
+		static void AreEqual( const T& expected, const U& actual, const char* message = nullptr )
+		{
+			if( !( expected == actual ) )
+			{
+				std::ostringstream st;
+				st << "AreEqual failed: expected <" << printable( expected ) << "> actual <" << printable( actual ) << ">";
+				fail( st.str(), message );
+			}
+		}
+
+		static void AreEqual( double expected, double actual, double tolerance, const char* message = nullptr )
+		{
+			if( std::abs( expected - actual ) > tolerance )
+			{
+				std::ostringstream st;
+				st << "AreEqual failed: expected <" << expected << "> actual <" << actual << ">";
+				fail( st.str(), message );
+			}
+		}
+
+		static void IsTrue( bool condition, const char* message = nullptr )
+		{
+			if( !condition )
+			{
+				fail( "IsTrue failed", message );
+			}
+		}
+
+		static void IsFalse( bool condition, const char* message = nullptr )
+		{
+			if( condition )
+			{
+				fail( "IsFalse failed", message );
+			}
+		}
+
+		static void Fail( const char* message = nullptr )
+		{
+			fail( "Fail", message );
+		}
+
+	private:
+		template<typename T>
+		static auto printable( const T& value ) -> decltype( std::declval<std::ostream&>() << value, std::string() )
+		{
+			std::ostringstream st;
+			st << +value;
+			return st.str();
+		}
+
+		static std::string printable( ... )
+		{
+			return "?";
+		}
+
+		static void fail( const std::string& what, const char* message )
+		{
+			throw test_failure( message != nullptr ? what + ": " + message : what );
+		}
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "epoll_transport.h"
+#include "loopback_scenarios.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Test {
+
+	TEST_CLASS( EpollTransportUnitTest )
+	{
+	public:
+		TEST_METHOD( EpollTransport_1EchoInOrder )
+		{
+			scenarios_.echo_in_order();
+		}
+
+		TEST_METHOD( EpollTransport_2LargeWriteQueuesUntilWritable )
+		{
+			scenarios_.large_write();
+		}
+
+		TEST_METHOD( EpollTransport_3ClosedByPeer )
+		{
+			scenarios_.closed_by_peer();
+		}
+
+		TEST_METHOD( EpollTransport_4ConnectRefused )
+		{
+			scenarios_.connect_refused();
+		}
+
+		TEST_METHOD( EpollTransport_5GatheredWrite )
+		{
+			scenarios_.gathered_write();
+		}
+
+		TEST_METHOD( EpollTransport_6Reconnect )
+		{
+			scenarios_.reconnect();
+		}
+
+	private:
+		loopback_scenarios<epoll_loop, epoll_transport> scenarios_;
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,663 @@
+#include "pch.h"
+#include "amf0.h"
+#include "amf0_writer.h"
+#include "commands.h"
+#include "frame_dropper.h"
+#include "net_connection.h"
+#include "net_stream.h"
+#include "mock_transport.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Test {
+
+	TEST_CLASS( NetConnectionUnitTest )
+	{
+	public:
+		TEST_METHOD( NetConnection_1HandshakeAndConnect )
+		{
+			Connect();
+			Assert::IsTrue( statuses_.size() == 1 && statuses_[0] == net_status_code::net_connection_connect_success );
+		}
+
+		TEST_METHOD( NetConnection_2PlayAndReceive )
+		{
+			Connect();
+
+			auto attached = false;
+			std::vector<net_status_code> stream_statuses;
+			std::vector<std::vector<uint8>> audio, video;
+			auto audio_started = false, video_started = false;
+			media::video_info started_video_info;
+
+			auto stream = std::make_shared<net_stream>();
+			stream->set_attached_handler( [&] { attached = true; } );
+			stream->set_status_handler( [&]( net_status_code code ) { stream_statuses.push_back( code ); } );
+			stream->set_audio_started_handler( [&]( bool, const media::audio_info& ) { audio_started = true; } );
+			stream->set_audio_handler( [&]( const audio_sample& sample ) { audio.emplace_back( sample.data.begin(), sample.data.end() ); } );
+			stream->set_video_started_handler( [&]( bool, const media::video_info& info ) { video_started = true; started_video_info = info; } );
+			stream->set_video_handler( [&]( const video_sample& sample ) { video.emplace_back( sample.data.begin(), sample.data.end() ); } );
+			connection_->attach( stream );
+
+			// createStream (transaction id 2) -> _result with stream id 1
+			auto command = ReadCommands();
+			Assert::AreEqual( 1u, static_cast<uint32>( command.size() ) );
+			Assert::IsTrue( command[0][0].as_string() == "createStream" );
+			Assert::AreEqual( 2.0, command[0][1].as_number() );
+			SendCommand( 0, { amf_value::create_string( "_result" ), amf_value::create_number( 2.0 ), amf_value(), amf_value::create_number( 1.0 ) } );
+			Assert::IsTrue( attached );
+			Assert::AreEqual( 1u, stream->stream_id() );
+
+			stream->play( "test" );
+			command = ReadCommands();
+			Assert::AreEqual( 1u, static_cast<uint32>( command.size() ) );
+			Assert::IsTrue( command[0][0].as_string() == "play" );
+			Assert::IsTrue( command[0][3].as_string() == "test" );
+
+			auto info = amf_value::create_object();
+			info.insert( "level", amf_value::create_string( "status" ) );
+			info.insert( "code", amf_value::create_string( "NetStream.Play.Start" ) );
+			SendCommand( 1, { amf_value::create_string( "onStatus" ), amf_value::create_number( 0.0 ), amf_value(), std::move( info ) } );
+			Assert::IsTrue( stream_statuses.size() == 1 && stream_statuses[0] == net_status_code::net_stream_play_start );
+
+			// MP3, 44 kHz, 16 bit, stereo
+			SendMessage( 4, 1, type_id_type::audio_message, 0, { 0x2f, 0x11, 0x22, 0x33 } );
+			Assert::IsTrue( audio_started );
+			Assert::AreEqual( 1u, static_cast<uint32>( audio.size() ) );
+			Assert::IsTrue( audio[0] == std::vector<uint8>( { 0x11, 0x22, 0x33 } ) );
+
+			// AVC sequence header: one SPS, one PPS, 4-byte NAL lengths
+			SendMessage( 5, 1, type_id_type::video_message, 0, {
+				0x17, 0x00, 0x00, 0x00, 0x00,
+				0x01, 0x64, 0x00, 0x1f, 0xff, 0xe1, 0x00, 0x02, 0x67, 0x64, 0x01, 0x00, 0x01, 0x68 } );
+			Assert::IsTrue( video_started );
+			Assert::AreEqual( static_cast<uint8>( 0x64 ), started_video_info.profile_indication );
+
+			SendMessage( 5, 1, type_id_type::video_message, 40, {
+				0x27, 0x01, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x02, 0x41, 0x9a, 0x00, 0x00, 0x00, 0x01, 0x06 } );
+			Assert::AreEqual( 2u, static_cast<uint32>( video.size() ) );
+			Assert::IsTrue( video[0] == std::vector<uint8>( { 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x00, 0x01, 0x68 } ) );
+			Assert::IsTrue( video[1] == std::vector<uint8>( { 0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x00, 0x00, 0x00, 0x01, 0x06 } ) );
+
+			stream->close();
+			command = ReadCommands();
+			Assert::AreEqual( 1u, static_cast<uint32>( command.size() ) );
+			Assert::IsTrue( command[0][0].as_string() == "closeStream" );
+			Assert::IsFalse( stream->attached() );
+		}
+
+		TEST_METHOD( NetConnection_3ClosedByPeer )
+		{
+			Connect();
+
+			auto closed = false;
+			connection_->set_closed_handler( [&] { closed = true; } );
+			transport_->handler( 0 );
+			Assert::IsTrue( closed );
+			Assert::IsTrue( transport_->closed );
+		}
+
+		TEST_METHOD( NetConnection_4ThrottleByBytes )
+		{
+			Connect();
+
+			buffer_watermarks watermarks;
+			watermarks.high_bytes = 8;
+			watermarks.low_bytes = 4;
+			auto stream = AttachStream();
+			stream->set_buffer_watermarks( watermarks );
+
+			// 3-byte MP3 samples: the third reaches the high mark
+			SendMessage( 4, 1, type_id_type::audio_message, 0, { 0x2f, 0x11, 0x22, 0x33 } );
+			SendMessage( 4, 1, type_id_type::audio_message, 26, { 0x2f, 0x11, 0x22, 0x33 } );
+			Assert::IsFalse( transport_->paused );
+			SendMessage( 4, 1, type_id_type::audio_message, 52, { 0x2f, 0x11, 0x22, 0x33 } );
+			Assert::IsTrue( transport_->paused );
+
+			stream->consumed( 3, 0 );
+			Assert::IsTrue( transport_->paused );
+			stream->consumed( 3, 26 );
+			Assert::IsFalse( transport_->paused );
+
+			Assert::AreEqual( 1ull, static_cast<unsigned long long>( stream->throttle_statistics().throttle_count ) );
+			Assert::AreEqual( 1ull, static_cast<unsigned long long>( connection_->receive_throttle_statistics().throttle_count ) );
+		}
+
+		TEST_METHOD( NetConnection_5ThrottleByDuration )
+		{
+			Connect();
+
+			buffer_watermarks watermarks;
+			watermarks.high_milliseconds = 1000;
+			watermarks.low_milliseconds = 500;
+			auto stream = AttachStream();
+			stream->set_buffer_watermarks( watermarks );
+
+			SendMessage( 4, 1, type_id_type::audio_message, 0, { 0x2f, 0x11 } );
+			SendMessage( 4, 1, type_id_type::audio_message, 500, { 0x2f, 0x11 } );
+			Assert::IsFalse( transport_->paused );
+			SendMessage( 4, 1, type_id_type::audio_message, 1000, { 0x2f, 0x11 } );
+			Assert::IsTrue( transport_->paused );
+
+			stream->consumed( 1, 0 );
+			Assert::IsTrue( transport_->paused );
+			stream->consumed( 1, 500 );
+			Assert::IsFalse( transport_->paused );
+
+			// Closing the stream releases its hold on the connection
+			SendMessage( 4, 1, type_id_type::audio_message, 2400, { 0x2f, 0x11 } );
+			Assert::IsTrue( transport_->paused );
+			stream->close();
+			Assert::IsFalse( transport_->paused );
+			Assert::AreEqual( 2ull, static_cast<unsigned long long>( connection_->receive_throttle_statistics().throttle_count ) );
+		}
+
+		TEST_METHOD( NetConnection_6Acknowledgement )
+		{
+			Connect();
+			auto stream = AttachStream();
+			ReadMessages();
+
+			// Window acknowledgement size 4096
+			SendMessage( 2, 0, type_id_type::window_acknowledgement_size, 0, { 0x00, 0x00, 0x10, 0x00 } );
+			Assert::AreEqual( 0u, static_cast<uint32>( ReadMessages().size() ) );
+
+			std::vector<uint8> audio( 1001, 0x11 );
+			audio[0] = 0x2f;
+			while( connection_->acknowledgements_sent() == 0 )
+			{
+				SendMessage( 4, 1, type_id_type::audio_message, 0, audio );
+			}
+
+			// The window counts every byte since connect, handshake and chunk headers included;
+			// the acknowledgement goes out with the read that crosses it
+			const auto messages = ReadMessages();
+			Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( messages[0].first.type_id == type_id_type::acknowledgement );
+			Assert::AreEqual( 4u, static_cast<uint32>( messages[0].second.size() ) );
+			uint32 sequence_number;
+			utility::convert_big_endian( messages[0].second.data(), 4, &sequence_number );
+			Assert::IsTrue( sequence_number >= 4096 && sequence_number < 4096 + 7 );
+			Assert::IsTrue( connection_->bytes_received() >= sequence_number );
+
+			// The next one is due a full window after the acknowledged position
+			while( connection_->bytes_received() + 1100 < sequence_number + 4096 )
+			{
+				SendMessage( 4, 1, type_id_type::audio_message, 0, audio );
+			}
+			Assert::AreEqual( 1ull, static_cast<unsigned long long>( connection_->acknowledgements_sent() ) );
+			SendMessage( 4, 1, type_id_type::audio_message, 0, audio );
+			SendMessage( 4, 1, type_id_type::audio_message, 0, audio );
+			Assert::AreEqual( 2ull, static_cast<unsigned long long>( connection_->acknowledgements_sent() ) );
+		}
+
+		TEST_METHOD( NetConnection_7SendPriority )
+		{
+			Connect();
+			auto stream = AttachStream();
+			ReadMessages();
+
+			// The first 64 KiB of the large command go to the transport at once; the rest waits for it to drain
+			const auto writes = transport_->write_count;
+			connection_->send_command( 1, std::vector<uint8>( 200 * 1024, 0x05 ) );
+			connection_->send_command( 1, std::vector<uint8>( 100, 0x06 ) );
+			Assert::AreEqual( writes + 1, transport_->write_count );
+
+			// Ping request
+			SendMessage( 2, 0, type_id_type::user_control_message, 0, { 0x00, 0x06, 0x00, 0x00, 0x00, 0x2a } );
+			Assert::AreEqual( writes + 1, transport_->write_count );
+
+			// The ping response overtakes the rest of the large command between two of its chunks,
+			// and the small command rides along with its tail
+			const auto messages = ReadMessages();
+			Assert::AreEqual( 3u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( messages[0].first.type_id == type_id_type::user_control_message );
+			Assert::IsTrue( messages[0].second == std::vector<uint8>( { 0x00, 0x07, 0x00, 0x00, 0x00, 0x2a } ) );
+			Assert::AreEqual( 200u * 1024, static_cast<uint32>( messages[1].second.size() ) );
+			Assert::AreEqual( 100u, static_cast<uint32>( messages[2].second.size() ) );
+			Assert::AreEqual( writes + 4, transport_->write_count );
+		}
+
+		TEST_METHOD( NetConnection_8ChunkSizeAtConnect )
+		{
+			Connect( 64 * 1024 );
+			auto stream = AttachStream();
+			ReadMessages();
+
+			const auto before = connection_->outbound_chunk_statistics();
+			connection_->send_command( 1, std::vector<uint8>( 200 * 1024, 0x05 ) );
+			const auto messages = ReadMessages();
+			Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+			Assert::AreEqual( 200u * 1024, static_cast<uint32>( messages[0].second.size() ) );
+
+			// One fmt 0 header and three type 3 continuations instead of 1600 chunks
+			const auto after = connection_->outbound_chunk_statistics();
+			Assert::AreEqual( 4ull, static_cast<unsigned long long>( after.chunk_count - before.chunk_count ) );
+			Assert::AreEqual( 15ull, static_cast<unsigned long long>( after.header_bytes - before.header_bytes ) );
+			Assert::IsTrue( after.header_overhead() < 0.001 );
+
+			// Every byte after the handshake is either a chunk header or a message body
+			const auto inbound = connection_->inbound_chunk_statistics();
+			Assert::AreEqual( static_cast<unsigned long long>( connection_->bytes_received() - 1 - 2 * 1536 ), static_cast<unsigned long long>( inbound.header_bytes + inbound.body_bytes ) );
+
+			try
+			{
+				connection_->set_chunk_size( 0x1000000 );
+				Assert::Fail();
+			}
+			catch( const std::invalid_argument& )
+			{ }
+		}
+
+		TEST_METHOD( NetConnection_9Publish )
+		{
+			Connect();
+			auto stream = AttachStream();
+			ReadMessages();
+
+			stream->publish( "live1" );
+			const auto commands = ReadCommands();
+			Assert::AreEqual( 1u, static_cast<uint32>( commands.size() ) );
+			Assert::IsTrue( commands[0].size() == 5 && commands[0][0].as_string() == "publish" && commands[0][2].type() == amf_type::null );
+			Assert::IsTrue( commands[0][3].as_string() == "live1" && commands[0][4].as_string() == "live" );
+
+			auto metadata = amf_value::create_object();
+			metadata.insert( "width", amf_value::create_number( 1280.0 ) );
+			stream->send_metadata( metadata );
+
+			audio_frame audio;
+			audio.info.format = media::audio_format::aac;
+			audio.info.sample_rate = 48000;
+			audio.info.channel_count = 2;
+			audio.info.bits_per_sample = 16;
+			audio.sequence_header = true;
+			audio.timestamp = 20;
+			audio.data = Payload( 2, 0x11 );
+			stream->send_audio( audio );
+
+			// Spans three chunks; the tag header is cut from nothing but the first
+			video_frame video;
+			video.type = media::video_type::keyframe;
+			video.decode_timestamp = 40;
+			video.presentation_timestamp = 106;
+			video.data = Payload( 300, 0x22 );
+			stream->send_video( video );
+
+			const auto messages = ReadMessages();
+			Assert::AreEqual( 3u, static_cast<uint32>( messages.size() ) );
+
+			Assert::AreEqual( 5u, messages[0].first.chunk_stream_id );
+			Assert::IsTrue( messages[0].first.type_id == type_id_type::data_message_amf0 );
+			std::vector<amf_value> data;
+			Assert::IsTrue( amf0::parse( messages[0].second.data(), messages[0].second.size(), data ) );
+			Assert::IsTrue( data.size() == 3 && data[0].as_string() == "@setDataFrame" && data[1].as_string() == "onMetaData" );
+			Assert::AreEqual( 1280.0, data[2].find( "width" )->as_number() );
+
+			// AAC, 44 kHz, 16 bit, stereo / sequence header
+			Assert::AreEqual( 4u, messages[1].first.chunk_stream_id );
+			Assert::AreEqual( 1u, messages[1].first.stream_id );
+			Assert::AreEqual( 20ll, static_cast<long long>( messages[1].first.timestamp ) );
+			Assert::IsTrue( messages[1].second == std::vector<uint8>( { 0xaf, 0x00, 0x11, 0x11 } ) );
+
+			// Keyframe, AVC / NAL units / composition time 66
+			Assert::AreEqual( 6u, messages[2].first.chunk_stream_id );
+			Assert::AreEqual( 40ll, static_cast<long long>( messages[2].first.timestamp ) );
+			Assert::AreEqual( 305u, static_cast<uint32>( messages[2].second.size() ) );
+			Assert::IsTrue( std::equal( messages[2].second.begin(), messages[2].second.begin() + 5, std::vector<uint8>( { 0x17, 0x01, 0x00, 0x00, 0x42 } ).begin() ) );
+			Assert::IsTrue( std::all_of( messages[2].second.begin() + 5, messages[2].second.end(), []( uint8 b ) { return b == 0x22; } ) );
+		}
+
+		TEST_METHOD( NetConnection_10PeerBandwidthWindow )
+		{
+			Connect();
+			auto stream = AttachStream();
+			ReadMessages();
+
+			// 4000 bytes, hard; answered with Window Acknowledgement Size
+			SendMessage( 2, 0, type_id_type::set_peer_bandwidth, 0, { 0x00, 0x00, 0x0f, 0xa0, 0x00 } );
+			auto messages = ReadMessages();
+			Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( messages[0].first.type_id == type_id_type::window_acknowledgement_size );
+
+			AcknowledgeAll();
+			Assert::AreEqual( 0ull, static_cast<unsigned long long>( connection_->backlog().unacknowledged_bytes ) );
+
+			// Stops at the window
+			connection_->send_command( 1, std::vector<uint8>( 10000, 0x05 ) );
+			Assert::AreEqual( 0u, static_cast<uint32>( ReadMessages().size() ) );
+			auto backlog = connection_->backlog();
+			Assert::IsTrue( backlog.unacknowledged_bytes >= 4000 && backlog.unacknowledged_bytes < 4000 + 129 );
+			Assert::IsTrue( backlog.queued_bytes > 5000 );
+			Assert::AreEqual( 4000u, backlog.window_size );
+			Assert::AreEqual( 1ull, static_cast<unsigned long long>( backlog.window_stall_count ) );
+
+			// The ping response does not wait for the window
+			SendMessage( 2, 0, type_id_type::user_control_message, 0, { 0x00, 0x06, 0x00, 0x00, 0x00, 0x2a } );
+			messages = ReadMessages();
+			Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( messages[0].first.type_id == type_id_type::user_control_message );
+
+			// Each acknowledgement lets another window go
+			for( auto i = 0; i < 2; ++i )
+			{
+				AcknowledgeAll();
+				messages = ReadMessages();
+				Assert::AreEqual( i < 1 ? 0u : 1u, static_cast<uint32>( messages.size() ) );
+			}
+			Assert::AreEqual( 10000u, static_cast<uint32>( messages[0].second.size() ) );
+			backlog = connection_->backlog();
+			Assert::AreEqual( 0u, static_cast<uint32>( backlog.queued_bytes ) );
+			Assert::AreEqual( 2ull, static_cast<unsigned long long>( backlog.window_stall_count ) );
+		}
+
+		TEST_METHOD( NetConnection_11Amf3 )
+		{
+			// The server agrees to objectEncoding 3 in an AMF3 _result
+			Connect( 128, object_encoding::amf3 );
+			Assert::IsTrue( statuses_.size() == 1 && statuses_[0] == net_status_code::net_connection_connect_success );
+			Assert::IsTrue( connection_->encoding() == object_encoding::amf3 );
+
+			std::string callback_name;
+			std::vector<amf_value> callback;
+			connection_->set_callback_handler( [&]( const std::string& name, const byte_slice& data )
+			{
+				callback_name = name;
+				amf0::parse( data.data(), data.size(), callback );
+			} );
+			auto bandwidth = amf_value::create_object();
+			bandwidth.insert( "kbps", amf_value::create_number( 5000.0 ) );
+			SendAmf3Command( 0, "onBWDone", bandwidth );
+			Assert::IsTrue( callback_name == "onBWDone" );
+			Assert::AreEqual( 4u, static_cast<uint32>( callback.size() ) );
+			Assert::AreEqual( 5000.0, callback[3].find( "kbps" )->as_number() );
+
+			auto stream = AttachStream();
+			std::vector<net_status_code> stream_statuses;
+			stream->set_status_handler( [&]( net_status_code code ) { stream_statuses.push_back( code ); } );
+			auto info = amf_value::create_object();
+			info.insert( "level", amf_value::create_string( "status" ) );
+			info.insert( "code", amf_value::create_string( "NetStream.Play.Start" ) );
+			SendAmf3Command( 1, "onStatus", info );
+			Assert::IsTrue( stream_statuses.size() == 1 && stream_statuses[0] == net_status_code::net_stream_play_start );
+			ReadMessages();
+
+			// Data goes out as type 15: format selector, AMF0 handler name, AMF3 arguments
+			auto cue = amf_value::create_object();
+			cue.insert( "name", amf_value::create_string( "cue1" ) );
+			cue.insert( "time", amf_value::create_number( 12.0 ) );
+			stream->send_data( "onCuePoint", { cue, cue } );
+			const auto messages = ReadMessages();
+			Assert::AreEqual( 1u, static_cast<uint32>( messages.size() ) );
+			Assert::IsTrue( messages[0].first.type_id == type_id_type::data_message_amf3 );
+			const auto& body = messages[0].second;
+			Assert::AreEqual( static_cast<uint8>( 0 ), body[0] );
+			std::vector<amf_value> data;
+			Assert::IsTrue( amf0::parse( body.data() + 1, body.size() - 1, data ) );
+			Assert::AreEqual( 3u, static_cast<uint32>( data.size() ) );
+			Assert::IsTrue( data[0].as_string() == "onCuePoint" );
+			Assert::IsTrue( data[2].find( "name" )->as_string() == "cue1" );
+			Assert::AreEqual( 12.0, data[2].find( "time" )->as_number() );
+		}
+
+		TEST_METHOD( NetConnection_12Metadata )
+		{
+			Connect();
+			auto stream = AttachStream();
+			std::vector<media::stream_metadata> metadata;
+			media::video_info started_video_info;
+			stream->set_metadata_handler( [&]( const media::stream_metadata& value ) { metadata.push_back( value ); } );
+			stream->set_video_started_handler( [&]( bool, const media::video_info& info ) { started_video_info = info; } );
+			stream->set_video_handler( []( const video_sample& ) { } );
+
+			// A recorded 1080p60 file as FLV injectors write it; unknown properties are skipped
+			std::vector<uint8> body;
+			amf0::writer writer( body );
+			writer.string( "onMetaData" ).begin_ecma_array( 15 );
+			writer.property( "duration" ).number( 60.5 ).property( "filesize" ).number( 45000000.0 );
+			writer.property( "width" ).number( 1920.0 ).property( "height" ).number( 1080.0 );
+			writer.property( "videodatarate" ).number( 6000.0 ).property( "framerate" ).number( 60.0 ).property( "videocodecid" ).number( 7.0 );
+			writer.property( "audiodatarate" ).number( 160.0 ).property( "audiosamplerate" ).number( 48000.0 ).property( "audiosamplesize" ).number( 16.0 );
+			writer.property( "stereo" ).boolean( true ).property( "audiocodecid" ).string( "mp4a" );
+			writer.property( "encoder" ).string( "Lavf58.29.100" );
+			writer.property( "custom" ).begin_object().property( "nested" ).begin_strict_array( 1 ).number( 1.0 ).end_object();
+			writer.property( "keyframes" ).begin_object();
+			writer.property( "times" ).begin_strict_array( 2 ).number( 0.0 ).number( 2.0 );
+			writer.property( "filepositions" ).begin_strict_array( 2 ).number( 13.0 ).number( 750000.0 );
+			writer.end_object().end_ecma_array();
+			SendMessage( 5, 1, type_id_type::data_message_amf0, 0, std::move( body ) );
+
+			Assert::AreEqual( 1u, static_cast<uint32>( metadata.size() ) );
+			const auto& m = metadata[0];
+			Assert::AreEqual( 60.5, m.duration );
+			Assert::AreEqual( 45000000.0, m.file_size );
+			Assert::IsTrue( m.has_video && m.video_codec_id == 7 );
+			Assert::IsTrue( m.width == 1920 && m.height == 1080 );
+			Assert::AreEqual( 6000.0, m.video_data_rate );
+			Assert::AreEqual( 60.0, m.frame_rate );
+			Assert::IsTrue( m.has_audio && m.audio_codec_id == 0 );
+			Assert::AreEqual( 160.0, m.audio_data_rate );
+			Assert::AreEqual( 48000u, m.audio_sample_rate );
+			Assert::IsTrue( m.audio_sample_size == 16 && m.stereo );
+			Assert::IsTrue( m.encoder == "Lavf58.29.100" );
+			Assert::IsTrue( m.keyframe_times == std::vector<float64>( { 0.0, 2.0 } ) );
+			Assert::IsTrue( m.keyframe_positions == std::vector<float64>( { 13.0, 750000.0 } ) );
+
+			SendMessage( 6, 1, type_id_type::video_message, 0, {
+				0x17, 0x00, 0x00, 0x00, 0x00,
+				0x01, 0x64, 0x00, 0x2a, 0xff, 0xe1, 0x00, 0x02, 0x67, 0x64, 0x01, 0x00, 0x01, 0x68 } );
+			Assert::IsTrue( started_video_info.width == 1920 && started_video_info.height == 1080 && started_video_info.bitrate == 6000 );
+
+			// 12.5 KB average frames: the key frame, reassembled and rewritten, finds both blocks reserved
+			const auto allocations = connection_->pool().allocation_count();
+			std::vector<uint8> key_frame( 5 + 4 + 90000, 0x88 );
+			const uint8 prefix[] = { 0x17, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x5f, 0x90, 0x65 };
+			std::copy( std::begin( prefix ), std::end( prefix ), key_frame.begin() );
+			SendMessage( 6, 1, type_id_type::video_message, 16, std::move( key_frame ) );
+			Assert::AreEqual( allocations, connection_->pool().allocation_count() );
+		}
+
+		TEST_METHOD( FrameDropper_1NonReferenceThenGop )
+		{
+			const auto pool = std::make_shared<body_pool>();
+			const auto slice = [&]( std::vector<uint8> bytes )
+			{
+				auto buffer = pool->acquire( static_cast<uint32>( bytes.size() ) );
+				std::copy( bytes.begin(), bytes.end(), buffer.begin() );
+				return byte_slice( std::move( buffer ) );
+			};
+
+			// avcC with 4-byte NAL unit lengths; IDR, reference and non-reference slices
+			const auto config = slice( { 0x01, 0x64, 0x00, 0x1f, 0xff, 0xe1 } );
+			const auto idr = slice( { 0x00, 0x00, 0x00, 0x02, 0x65, 0x88 } );
+			const auto reference = slice( { 0x00, 0x00, 0x00, 0x02, 0x41, 0x9a } );
+			const auto non_reference = slice( { 0x00, 0x00, 0x00, 0x02, 0x09, 0xf0, 0x00, 0x00, 0x00, 0x02, 0x01, 0x9e } );
+
+			frame_dropper dropper;
+			const auto avc = media::video_format::avc;
+			const auto key = media::video_type::keyframe, inter = media::video_type::interframe;
+			Assert::IsTrue( dropper.admit( avc, inter, false, non_reference, 100000 ) );
+
+			dropper.set_latency_budget( 100 );
+			Assert::IsTrue( dropper.admit( avc, key, true, config, 0 ) );
+			Assert::IsTrue( dropper.admit( avc, key, false, idr, 0 ) );
+
+			// Over the budget: frames nothing refers to
+			Assert::IsFalse( dropper.admit( avc, inter, false, non_reference, 150 ) );
+			Assert::IsTrue( dropper.admit( avc, inter, false, reference, 150 ) );
+			Assert::IsFalse( dropper.admit( avc, media::video_type::disposable_interframe, false, reference, 150 ) );
+			Assert::AreEqual( 2ull, static_cast<unsigned long long>( dropper.counters().non_reference_frames ) );
+
+			// Past twice the budget: the rest of the GOP, and the next one while still that far behind
+			Assert::IsFalse( dropper.admit( avc, inter, false, reference, 250 ) );
+			Assert::IsFalse( dropper.admit( avc, inter, false, reference, 50 ) );
+			Assert::IsFalse( dropper.admit( avc, key, false, idr, 250 ) );
+			Assert::IsTrue( dropper.admit( avc, key, true, config, 250 ) );
+			Assert::IsFalse( dropper.admit( avc, inter, false, reference, 50 ) );
+			Assert::IsTrue( dropper.admit( avc, key, false, idr, 150 ) );
+			Assert::IsTrue( dropper.admit( avc, inter, false, reference, 150 ) );
+
+			const auto counters = dropper.counters();
+			Assert::AreEqual( 1ull, static_cast<unsigned long long>( counters.gops ) );
+			Assert::AreEqual( 4ull, static_cast<unsigned long long>( counters.gop_frames ) );
+			Assert::AreEqual( 12ull + 6 + 4 * 6, static_cast<unsigned long long>( counters.bytes ) );
+		}
+
+	private:
+		void Connect( uint32 chunk_size = 128, object_encoding encoding = object_encoding::amf0 )
+		{
+			transport_ = std::make_shared<mock_transport::state>();
+			connection_ = std::make_shared<net_connection>( std::unique_ptr<transport>( new mock_transport( transport_ ) ) );
+			connection_->set_status_handler( [this]( net_status_code code ) { statuses_.push_back( code ); } );
+			connection_->set_chunk_size( chunk_size );
+
+			auto connected = false;
+			commands::connect_parameters parameters( "app", "rtmp://localhost/app" );
+			parameters.encoding = encoding;
+			connection_->connect( "localhost", 1935, commands::connect( parameters ), [&]( bool succeeded ) { connected = succeeded; } );
+			Assert::IsTrue( connected );
+			Assert::AreEqual( static_cast<uint32>( handshake::c0c1_size ), static_cast<uint32>( transport_->written.size() ) );
+
+			// S0+S1, then S2 echoing C1
+			std::vector<uint8> server( 1 + 1536 + 1536, 0x5a );
+			server[0] = 0x03;
+			std::copy_n( transport_->written.begin() + 1, 1536, server.begin() + 1537 );
+			mock_transport::deliver( *transport_, server.data(), server.size(), 1000 );
+			Assert::AreEqual( static_cast<uint32>( handshake::c0c1_size + handshake::c2_size ), static_cast<uint32>( std::min<size_t>( transport_->written.size(), handshake::c0c1_size + handshake::c2_size ) ) );
+			read_offset_ = handshake::c0c1_size + handshake::c2_size;
+
+			// Set Chunk Size, when announced, goes ahead of the connect command
+			const auto messages = ReadMessages();
+			Assert::AreEqual( chunk_size != 128 ? 2u : 1u, static_cast<uint32>( messages.size() ) );
+			if( chunk_size != 128 )
+			{
+				Assert::IsTrue( messages[0].first.type_id == type_id_type::set_chunk_size );
+				Assert::AreEqual( chunk_size, server_demuxer_.chunk_size() );
+			}
+			std::vector<amf_value> command;
+			Assert::IsTrue( amf0::parse( messages.back().second.data(), messages.back().second.size(), command ) );
+			Assert::IsTrue( command[0].as_string() == "connect" );
+			Assert::AreEqual( 1.0, command[1].as_number() );
+			Assert::AreEqual( static_cast<float64>( encoding ), command[2].find( "objectEncoding" )->as_number() );
+
+			auto info = amf_value::create_object();
+			info.insert( "level", amf_value::create_string( "status" ) );
+			info.insert( "code", amf_value::create_string( "NetConnection.Connect.Success" ) );
+			if( encoding == object_encoding::amf3 )
+			{
+				info.insert( "objectEncoding", amf_value::create_number( 3.0 ) );
+				SendAmf3Command( 0, "_result", info, 1.0 );
+				return;
+			}
+			SendCommand( 0, { amf_value::create_string( "_result" ), amf_value::create_number( 1.0 ), amf_value::create_object(), std::move( info ) } );
+		}
+
+		std::shared_ptr<net_stream> AttachStream()
+		{
+			auto stream = std::make_shared<net_stream>();
+			stream->set_audio_handler( []( const audio_sample& ) { } );
+			connection_->attach( stream );
+			ReadCommands();
+			SendCommand( 0, { amf_value::create_string( "_result" ), amf_value::create_number( 2.0 ), amf_value(), amf_value::create_number( 1.0 ) } );
+			Assert::IsTrue( stream->attached() );
+			return stream;
+		}
+
+		byte_slice Payload( uint32 length, uint8 value )
+		{
+			auto buffer = connection_->pool().acquire( length );
+			std::fill( buffer.begin(), buffer.end(), value );
+			return byte_slice( std::move( buffer ) );
+		}
+
+		// Acknowledges every byte written since the handshake
+		void AcknowledgeAll()
+		{
+			const auto sent = static_cast<uint32>( transport_->written.size() - handshake::c0c1_size - handshake::c2_size );
+			std::vector<uint8> body( 4 );
+			utility::convert_big_endian( &sent, 4, &body[0] );
+			SendMessage( 2, 0, type_id_type::acknowledgement, 0, std::move( body ) );
+		}
+
+		// Decodes the client writes since the last call
+		std::vector<std::pair<rtmp_header, std::vector<uint8>>> ReadMessages()
+		{
+			mock_transport::drain( *transport_ );
+			auto& buffer = server_demuxer_.buffer();
+			std::vector<std::pair<rtmp_header, std::vector<uint8>>> messages;
+			while( read_offset_ != transport_->written.size() )
+			{
+				const auto length = std::min( transport_->written.size() - read_offset_, buffer.write_length() );
+				std::memcpy( buffer.write_pointer(), transport_->written.data() + read_offset_, length );
+				buffer.commit( length );
+				read_offset_ += length;
+
+				server_demuxer_.parse( [&]( rtmp_header header, byte_slice data )
+				{
+					if( header.type_id == type_id_type::set_chunk_size )
+					{
+						uint32 chunk_size;
+						utility::convert_big_endian( data.data(), 4, &chunk_size );
+						server_demuxer_.set_chunk_size( chunk_size );
+					}
+					messages.emplace_back( std::move( header ), std::vector<uint8>( data.begin(), data.end() ) );
+				} );
+			}
+			return messages;
+		}
+
+		// Decodes the client writes since the last call and returns its command messages
+		std::vector<std::vector<amf_value>> ReadCommands()
+		{
+			std::vector<std::vector<amf_value>> commands;
+			for( const auto& message : ReadMessages() )
+			{
+				if( message.first.type_id == type_id_type::command_message_amf0 )
+				{
+					std::vector<amf_value> values;
+					Assert::IsTrue( amf0::parse( message.second.data(), message.second.size(), values ) );
+					commands.push_back( std::move( values ) );
+				}
+			}
+			return commands;
+		}
+
+		void SendCommand( uint32 stream_id, std::vector<amf_value> values )
+		{
+			std::vector<uint8> body;
+			amf0::serialize( values, body );
+			SendMessage( 3, stream_id, type_id_type::command_message_amf0, 0, std::move( body ) );
+		}
+
+		// Type 17: format selector, name and transaction id in AMF0, then the argument switched to AMF3
+		void SendAmf3Command( uint32 stream_id, const char* name, const amf_value& argument, float64 transaction_id = 0.0 )
+		{
+			std::vector<uint8> body( 1, 0 );
+			amf0::writer( body ).command( name, transaction_id ).null().amf3( argument );
+			SendMessage( 3, stream_id, type_id_type::command_message_amf3, 0, std::move( body ) );
+		}
+
+		void SendMessage( uint32 chunk_stream_id, uint32 stream_id, type_id_type type, int64 timestamp, std::vector<uint8> body )
+		{
+			rtmp_header header( chunk_stream_id );
+			header.timestamp = timestamp;
+			header.type_id = type;
+			header.stream_id = stream_id;
+
+			std::vector<uint8> wire;
+			server_muxer_.write( std::move( header ), body.data(), body.size(), wire );
+			mock_transport::deliver( *transport_, wire.data(), wire.size(), 7 );
+		}
+
+	private:
+		std::shared_ptr<mock_transport::state> transport_;
+		std::shared_ptr<net_connection> connection_;
+		std::vector<net_status_code> statuses_;
+
+		chunk_demuxer server_demuxer_;
+		chunk_muxer server_muxer_;
+		size_t read_offset_ = 0;
+	};
+
+} } }
\ No newline at end of file
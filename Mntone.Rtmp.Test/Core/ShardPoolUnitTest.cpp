@@ -0,0 +1,111 @@
+#include "pch.h"
+#include <condition_variable>
+#include <thread>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "epoll_transport.h"
+#include "shard_pool.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Test {
+
+	TEST_CLASS( ShardPoolUnitTest )
+	{
+	public:
+		TEST_METHOD( ShardPool_1RoundRobinPlacement )
+		{
+			round_robin_placement policy;
+			const std::vector<shard_load> loads( 3, shard_load{ 0, 0.0 } );
+			for( size_t i = 0; i < 6; ++i )
+			{
+				Assert::AreEqual( static_cast<uint32>( i % 3 ), static_cast<uint32>( policy.place( loads ) ) );
+			}
+		}
+
+		TEST_METHOD( ShardPool_2LeastLoadedPlacement )
+		{
+			least_loaded_placement policy;
+			Assert::AreEqual( 2u, static_cast<uint32>( policy.place( { { 1, 300.0 }, { 5, 100.0 }, { 2, 100.0 } } ) ) );
+			Assert::AreEqual( 1u, static_cast<uint32>( policy.place( { { 2, 0.0 }, { 1, 0.0 }, { 1, 0.0 } } ) ) );
+			Assert::AreEqual( 0u, static_cast<uint32>( policy.place( { { 9, 10.0 }, { 1, 20.0 } } ) ) );
+		}
+
+		TEST_METHOD( ShardPool_3ConnectionsStayOnTheirShard )
+		{
+			const size_t count = 4;
+			const auto listener = socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+			sockaddr_in address = {};
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+			socklen_t length = sizeof( address );
+			Assert::IsTrue( bind( listener, reinterpret_cast<sockaddr*>( &address ), length ) == 0 && listen( listener, count ) == 0 );
+			getsockname( listener, reinterpret_cast<sockaddr*>( &address ), &length );
+
+			std::thread server( [&]
+			{
+				for( size_t i = 0; i < count; ++i )
+				{
+					const auto fd = accept( listener, nullptr, nullptr );
+					send( fd, "x", 1, MSG_NOSIGNAL );
+					::close( fd );
+				}
+			} );
+
+			std::mutex mutex;
+			std::condition_variable condition;
+			std::vector<std::thread::id> threads( count );
+			size_t closed = 0;
+			{
+				shard_pool<epoll_loop, epoll_transport> pool( 2, std::unique_ptr<placement_policy>( new round_robin_placement() ), false );
+				std::vector<std::unique_ptr<transport>> transports;
+				std::vector<std::unique_ptr<ring_buffer>> buffers;
+				for( size_t i = 0; i < count; ++i )
+				{
+					transports.push_back( pool.create_transport() );
+					buffers.emplace_back( new ring_buffer( 4096 ) );
+
+					auto& t = *transports.back();
+					auto& buffer = *buffers.back();
+					t.connect( "127.0.0.1", ntohs( address.sin_port ), [&, i]( bool succeeded )
+					{
+						if( !succeeded )
+						{
+							return;
+						}
+						t.start_receive( buffer, [&, i]( size_t received )
+						{
+							std::lock_guard<std::mutex> lock( mutex );
+							buffer.consume( buffer.size() );
+							threads[i] = std::this_thread::get_id();
+							if( received == 0 )
+							{
+								++closed;
+								condition.notify_all();
+							}
+						} );
+					} );
+				}
+
+				const auto loads = pool.loads();
+				Assert::AreEqual( 2u, static_cast<uint32>( loads[0].connections ) );
+				Assert::AreEqual( 2u, static_cast<uint32>( loads[1].connections ) );
+
+				std::unique_lock<std::mutex> lock( mutex );
+				Assert::IsTrue( condition.wait_for( lock, std::chrono::seconds( 10 ), [&] { return closed == count; } ) );
+				lock.unlock();
+
+				transports.clear();
+				Assert::AreEqual( 0u, static_cast<uint32>( pool.loads()[0].connections ) );
+			}
+			server.join();
+			::close( listener );
+
+			Assert::IsTrue( threads[0] == threads[2] && threads[1] == threads[3] );
+			Assert::IsTrue( threads[0] != threads[1] );
+		}
+	};
+
+} } }
\ No newline at end of file
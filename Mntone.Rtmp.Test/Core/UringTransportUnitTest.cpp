@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "uring_transport.h"
+#include "loopback_scenarios.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace mntone::rtmp;
+
+namespace Mntone { namespace Rtmp { namespace Test {
+
+	TEST_CLASS( UringTransportUnitTest )
+	{
+	public:
+		TEST_METHOD( UringTransport_1EchoInOrder )
+		{
+			scenarios_.echo_in_order();
+		}
+
+		TEST_METHOD( UringTransport_2LargeWriteSpansLinkedSends )
+		{
+			scenarios_.large_write();
+		}
+
+		TEST_METHOD( UringTransport_3ClosedByPeer )
+		{
+			scenarios_.closed_by_peer();
+		}
+
+		TEST_METHOD( UringTransport_4ConnectRefused )
+		{
+			scenarios_.connect_refused();
+		}
+
+		TEST_METHOD( UringTransport_5GatheredWrite )
+		{
+			scenarios_.gathered_write();
+		}
+
+		TEST_METHOD( UringTransport_6Reconnect )
+		{
+			scenarios_.reconnect();
+		}
+
+	private:
+		loopback_scenarios<uring_loop, uring_transport> scenarios_;
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,383 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <system_error>
+#include <thread>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "chunk_muxer.h"
+#include "handshake.h"
+
+namespace Mntone { namespace Rtmp { namespace Test {
+
+	// Transport behaviour every socket backend has to share, played against a blocking loopback
+	// server on 127.0.0.1. Each scenario builds its own loop and returns without asserting when
+	// the kernel refuses to create one.
+	template<typename Loop, typename Transport>
+	class loopback_scenarios final
+	{
+		typedef ::Microsoft::VisualStudio::CppUnitTestFramework::Assert Assert;
+
+	public:
+		void echo_in_order()
+		{
+			if( !start_loop() )
+			{
+				return;
+			}
+
+			const auto listener = listen_loopback();
+			std::thread server( [&]
+			{
+				const auto fd = accept( listener, nullptr, nullptr );
+				uint8 data[4096];
+				ssize_t length;
+				while( ( length = recv( fd, data, sizeof( data ), 0 ) ) > 0 )
+				{
+					send( fd, data, static_cast<size_t>( length ), MSG_NOSIGNAL );
+				}
+				::close( fd );
+			} );
+
+			Transport transport( *loop_ );
+			Assert::IsTrue( connect( transport, port_of( listener ) ) );
+			start_receive( transport );
+
+			std::vector<uint8> expected;
+			for( auto i = 0; i < 64; ++i )
+			{
+				std::vector<uint8> data( 1 + i * 37, static_cast<uint8>( i ) );
+				expected.insert( expected.end(), data.begin(), data.end() );
+				transport.write( std::move( data ) );
+			}
+			Assert::IsTrue( wait_for( [&] { return received_.size() >= expected.size(); } ) );
+			Assert::IsTrue( received_ == expected );
+
+			transport.close();
+			server.join();
+			::close( listener );
+			stop_loop();
+		}
+
+		void large_write()
+		{
+			if( !start_loop() )
+			{
+				return;
+			}
+
+			const size_t total = 8 * 1024 * 1024;
+			const auto listener = listen_loopback();
+			auto matched = true;
+			size_t server_received = 0;
+			std::thread server( [&]
+			{
+				const auto fd = accept( listener, nullptr, nullptr );
+
+				// Let the socket buffers fill so the client has to wait for room
+				std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+
+				uint8 data[65536];
+				ssize_t length;
+				while( server_received < total && ( length = recv( fd, data, sizeof( data ), 0 ) ) > 0 )
+				{
+					for( ssize_t i = 0; i < length; ++i )
+					{
+						matched &= data[i] == static_cast<uint8>( ( server_received + i ) % 251 );
+					}
+					server_received += static_cast<size_t>( length );
+				}
+				::close( fd );
+			} );
+
+			Transport transport( *loop_ );
+			Assert::IsTrue( connect( transport, port_of( listener ) ) );
+
+			std::vector<uint8> data( total );
+			for( size_t i = 0; i < total; ++i )
+			{
+				data[i] = static_cast<uint8>( i % 251 );
+			}
+			transport.write( std::vector<uint8>( data.begin(), data.begin() + total / 2 ) );
+			transport.write( std::vector<uint8>( data.begin() + total / 2, data.end() ) );
+
+			server.join();
+			Assert::AreEqual( static_cast<uint32>( total ), static_cast<uint32>( server_received ) );
+			Assert::IsTrue( matched );
+
+			transport.close();
+			::close( listener );
+			stop_loop();
+		}
+
+		// A message chunked into more segments than one vectored send (or one linked chain) can carry
+		// arrives intact and ahead of the write queued after it
+		void gathered_write()
+		{
+			if( !start_loop() )
+			{
+				return;
+			}
+
+			const size_t length = 4 * 1024 * 1024;
+			auto pool = std::make_shared<mntone::rtmp::body_pool>();
+			auto body = pool->acquire( static_cast<uint32>( length ) );
+			for( size_t i = 0; i < length; ++i )
+			{
+				body[i] = static_cast<uint8>( i % 251 );
+			}
+
+			mntone::rtmp::gather_buffer data;
+			mntone::rtmp::chunk_muxer muxer;
+			mntone::rtmp::rtmp_header header( 6 );
+			header.type_id = mntone::rtmp::type_id_type::video_message;
+			header.stream_id = 1;
+			muxer.write( header, mntone::rtmp::byte_slice( std::move( body ) ), data );
+			const auto expected = data.flatten();
+
+			const auto listener = listen_loopback();
+			std::vector<uint8> server_received;
+			std::thread server( [&]
+			{
+				const auto fd = accept( listener, nullptr, nullptr );
+				std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+
+				uint8 buffer[65536];
+				ssize_t received;
+				while( server_received.size() < expected.size() && ( received = recv( fd, buffer, sizeof( buffer ), 0 ) ) > 0 )
+				{
+					server_received.insert( server_received.end(), buffer, buffer + received );
+				}
+				::close( fd );
+			} );
+
+			Transport transport( *loop_ );
+			Assert::IsTrue( connect( transport, port_of( listener ) ) );
+			transport.write( std::move( data ) );
+			transport.write( std::vector<uint8>( { 0xc6 } ) );
+
+			server.join();
+			Assert::AreEqual( static_cast<uint32>( expected.size() + 1 ), static_cast<uint32>( server_received.size() ) );
+			Assert::IsTrue( std::equal( expected.begin(), expected.end(), server_received.begin() ) );
+			Assert::AreEqual( static_cast<uint8>( 0xc6 ), server_received.back() );
+
+			transport.close();
+			::close( listener );
+			stop_loop();
+		}
+
+		void closed_by_peer()
+		{
+			if( !start_loop() )
+			{
+				return;
+			}
+
+			const auto listener = listen_loopback();
+			std::thread server( [&]
+			{
+				const auto fd = accept( listener, nullptr, nullptr );
+				send( fd, "bye", 3, MSG_NOSIGNAL );
+				::close( fd );
+			} );
+
+			Transport transport( *loop_ );
+			Assert::IsTrue( connect( transport, port_of( listener ) ) );
+			server.join();
+
+			// Data and FIN arrived before start_receive; both must still be reported
+			start_receive( transport );
+			Assert::IsTrue( wait_for( [&] { return closed_; } ) );
+			Assert::IsTrue( received_ == std::vector<uint8>( { 'b', 'y', 'e' } ) );
+
+			transport.close();
+			::close( listener );
+			stop_loop();
+		}
+
+		void connect_refused()
+		{
+			if( !start_loop() )
+			{
+				return;
+			}
+
+			const auto listener = listen_loopback();
+			const auto port = port_of( listener );
+			::close( listener );
+
+			Transport transport( *loop_ );
+			Assert::IsFalse( connect( transport, port ) );
+			stop_loop();
+		}
+
+		// The same transport connects again after a refused connect and after close(), and each
+		// connection carries a full handshake
+		void reconnect()
+		{
+			using mntone::rtmp::handshake;
+
+			if( !start_loop() )
+			{
+				return;
+			}
+
+			const auto refused = listen_loopback();
+			const auto refused_port = port_of( refused );
+			::close( refused );
+
+			const auto listener = listen_loopback();
+			auto handshakes = 0;
+			std::thread server( [&]
+			{
+				for( auto i = 0; i < 2; ++i )
+				{
+					const auto fd = accept( listener, nullptr, nullptr );
+
+					// C1 goes back as both S1 and S2, so C2 has to echo its random data
+					std::vector<uint8> c0c1( handshake::c0c1_size ), c2( handshake::c2_size );
+					const auto received = recv( fd, c0c1.data(), c0c1.size(), MSG_WAITALL ) == static_cast<ssize_t>( c0c1.size() );
+					std::vector<uint8> s0s1s2( c0c1 );
+					s0s1s2.insert( s0s1s2.end(), c0c1.begin() + 1, c0c1.end() );
+					send( fd, s0s1s2.data(), s0s1s2.size(), MSG_NOSIGNAL );
+					if( received
+						&& recv( fd, c2.data(), c2.size(), MSG_WAITALL ) == static_cast<ssize_t>( c2.size() )
+						&& std::equal( c2.begin() + 8, c2.end(), c0c1.begin() + 9 ) )
+					{
+						std::lock_guard<std::mutex> lock( mutex_ );
+						++handshakes;
+						condition_.notify_all();
+					}
+
+					uint8 data[256];
+					while( recv( fd, data, sizeof( data ), 0 ) > 0 ) { }
+					::close( fd );
+				}
+			} );
+
+			Transport transport( *loop_ );
+			Assert::IsFalse( connect( transport, refused_port ) );
+			for( auto i = 0; i < 2; ++i )
+			{
+				{
+					std::lock_guard<std::mutex> lock( mutex_ );
+					received_.clear();
+				}
+				Assert::IsTrue( connect( transport, port_of( listener ) ) );
+				start_receive( transport );
+
+				handshake client;
+				std::vector<uint8> c0c1;
+				client.create_c0c1( static_cast<uint32>( i ), c0c1 );
+				transport.write( std::move( c0c1 ) );
+				Assert::IsTrue( wait_for( [&] { return received_.size() >= handshake::s0s1_size + handshake::s2_size; } ) );
+
+				std::vector<uint8> c2;
+				Assert::IsTrue( client.read_s0s1( received_.data(), c2 ) );
+				Assert::IsTrue( client.read_s2( received_.data() + handshake::s0s1_size ) );
+				transport.write( std::move( c2 ) );
+				Assert::IsTrue( wait_for( [&] { return handshakes == i + 1; } ) );
+
+				transport.close();
+			}
+
+			server.join();
+			::close( listener );
+			stop_loop();
+		}
+
+	private:
+		static int listen_loopback()
+		{
+			const auto fd = socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+			sockaddr_in address = {};
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+			address.sin_port = 0;
+			if( bind( fd, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) != 0 || listen( fd, 4 ) != 0 )
+			{
+				Assert::Fail( "listen failed" );
+			}
+			return fd;
+		}
+
+		static uint16 port_of( int fd )
+		{
+			sockaddr_in address = {};
+			socklen_t length = sizeof( address );
+			getsockname( fd, reinterpret_cast<sockaddr*>( &address ), &length );
+			return ntohs( address.sin_port );
+		}
+
+		bool start_loop()
+		{
+			try
+			{
+				loop_.reset( new Loop() );
+			}
+			catch( const std::system_error& ex )
+			{
+				std::fprintf( stderr, "skipped: %s\n", ex.what() );
+				return false;
+			}
+			loop_thread_ = std::thread( [this] { loop_->run(); } );
+			return true;
+		}
+
+		void stop_loop()
+		{
+			loop_->stop();
+			loop_thread_.join();
+		}
+
+		bool connect( Transport& transport, uint16 port )
+		{
+			auto done = false, succeeded = false;
+			transport.connect( "127.0.0.1", port, [&]( bool result )
+			{
+				std::lock_guard<std::mutex> lock( mutex_ );
+				succeeded = result;
+				done = true;
+				condition_.notify_all();
+			} );
+			return wait_for( [&] { return done; } ) && succeeded;
+		}
+
+		void start_receive( Transport& transport )
+		{
+			transport.start_receive( buffer_, [this]( size_t length )
+			{
+				std::lock_guard<std::mutex> lock( mutex_ );
+				if( length == 0 )
+				{
+					closed_ = true;
+				}
+				while( !buffer_.empty() )
+				{
+					received_.insert( received_.end(), buffer_.read_pointer(), buffer_.read_pointer() + buffer_.read_length() );
+					buffer_.consume( buffer_.read_length() );
+				}
+				condition_.notify_all();
+			} );
+		}
+
+		template<typename Predicate>
+		bool wait_for( Predicate predicate )
+		{
+			std::unique_lock<std::mutex> lock( mutex_ );
+			return condition_.wait_for( lock, std::chrono::seconds( 10 ), predicate );
+		}
+
+	private:
+		std::unique_ptr<Loop> loop_;
+		std::thread loop_thread_;
+
+		std::mutex mutex_;
+		std::condition_variable condition_;
+		mntone::rtmp::ring_buffer buffer_ { 4096 };
+		std::vector<uint8> received_;
+		bool closed_ = false;
+	};
+
+} } }
\ No newline at end of file
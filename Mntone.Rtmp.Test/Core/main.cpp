@@ -0,0 +1,33 @@
+#include "pch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Runs every registered test method, or only those whose "Class::Method" name contains argv[1].
+int main( int argc, char* argv[] )
+{
+	const std::string filter = argc > 1 ? argv[1] : "";
+
+	auto passed = 0u, failed = 0u;
+	for( const auto& entry : test_registry::entries() )
+	{
+		const auto name = std::string( entry.class_name ) + "::" + entry.method_name;
+		if( !filter.empty() && name.find( filter ) == std::string::npos )
+		{
+			continue;
+		}
+
+		try
+		{
+			entry.method();
+			++passed;
+		}
+		catch( const std::exception& ex )
+		{
+			std::fprintf( stderr, "FAILED %s: %s\n", name.c_str(), ex.what() );
+			++failed;
+		}
+	}
+
+	std::printf( "%u passed, %u failed\n", passed, failed );
+	return failed == 0 && passed != 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+#include "transport.h"
+
+namespace Mntone { namespace Rtmp { namespace Test {
+
+	// In-memory transport: records what the client writes and lets a test play the server side.
+	class mock_transport final
+		: public mntone::rtmp::transport
+	{
+	public:
+		struct state
+		{
+			state()
+				: buffer( nullptr )
+				, closed( false )
+				, paused( false )
+				, write_count( 0 )
+				, drain_pending( false )
+			{ }
+
+			mntone::rtmp::ring_buffer* buffer;
+			receive_handler handler;
+			drained_handler drained;
+			std::vector<uint8> written;
+			bool closed, paused;
+			size_t write_count;
+
+			// Set by write(); the drained handler only runs when a test calls drain()
+			bool drain_pending;
+		};
+
+		explicit mock_transport( std::shared_ptr<state> state )
+			: state_( std::move( state ) )
+		{ }
+
+		virtual void connect( const std::string& /*host*/, uint16 /*port*/, connect_handler handler ) override
+		{
+			handler( true );
+		}
+
+		virtual void start_receive( mntone::rtmp::ring_buffer& buffer, receive_handler handler ) override
+		{
+			state_->buffer = &buffer;
+			state_->handler = std::move( handler );
+		}
+
+		virtual void pause_receive() override
+		{
+			state_->paused = true;
+		}
+
+		virtual void resume_receive() override
+		{
+			state_->paused = false;
+		}
+
+		using mntone::rtmp::transport::write;
+		virtual void write( mntone::rtmp::gather_buffer data ) override
+		{
+			++state_->write_count;
+			state_->drain_pending = true;
+			for( size_t i = 0; i < data.segment_count(); ++i )
+			{
+				state_->written.insert( state_->written.end(), data.segment_data( i ), data.segment_data( i ) + data.segment_length( i ) );
+			}
+		}
+
+		virtual void set_drained_handler( drained_handler handler ) override
+		{
+			state_->drained = std::move( handler );
+		}
+
+		virtual void close() override
+		{
+			state_->closed = true;
+		}
+
+		// Lets the client hand over everything it has queued, as a socket that is always writable would
+		static void drain( state& state )
+		{
+			while( state.drain_pending && state.drained )
+			{
+				state.drain_pending = false;
+				state.drained();
+			}
+		}
+
+		// Delivers server bytes to the client in blocks of at most block_size
+		static void deliver( state& state, const uint8* data, size_t length, size_t block_size = 4096 )
+		{
+			while( length != 0 )
+			{
+				const auto block = std::min( std::min( length, block_size ), state.buffer->write_length() );
+				std::memcpy( state.buffer->write_pointer(), data, block );
+				state.buffer->commit( block );
+				state.handler( block );
+				data += block;
+				length -= block;
+			}
+		}
+
+	private:
+		std::shared_ptr<state> state_;
+	};
+
+} } }
\ No newline at end of file
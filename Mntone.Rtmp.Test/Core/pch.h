@@ -0,0 +1,3 @@
+#pragma once
+#include "../../Mntone.Rtmp/Mntone.Rtmp.Core/pch.h"
+#include "CppUnitTest.h"
\ No newline at end of file
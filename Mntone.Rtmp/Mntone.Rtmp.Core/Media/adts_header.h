@@ -54,7 +54,7 @@ namespace mntone { namespace rtmp { namespace media {
 			case aac_sampling_frequency::f11025: sampling_frequency = 11025; break;
 			case aac_sampling_frequency::f8000: sampling_frequency = 8000; break;
 			case aac_sampling_frequency::f7350: sampling_frequency = 7350; break;
-			default: throw ref new Platform::InvalidArgumentException();
+			default: throw std::invalid_argument( "sampling_frequency" );
 			}
 			return sampling_frequency;
 		}
@@ -75,7 +75,7 @@ namespace mntone { namespace rtmp { namespace media {
 			case 11025: sampling_frequency_index_ = aac_sampling_frequency::f11025; break;
 			case 8000: sampling_frequency_index_ = aac_sampling_frequency::f8000; break;
 			case 7350: sampling_frequency_index_ = aac_sampling_frequency::f7350; break;
-			default: throw ref new Platform::InvalidArgumentException();
+			default: throw std::invalid_argument( "sampling_frequency" );
 			}
 		}
 
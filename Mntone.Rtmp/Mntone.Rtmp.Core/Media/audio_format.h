@@ -0,0 +1,19 @@
+#pragma once
+
+namespace mntone { namespace rtmp { namespace media {
+
+	// Same values as Mntone::Rtmp::Media::AudioFormat
+	enum class audio_format: uint8
+	{
+		lpcm = 1,
+		adpcm,
+		mp3,
+		lpcm_le,
+		nellymoser,
+		g711_alaw,
+		g711_mulaw,
+		aac,
+		speex,
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "audio_info.h"
+
+using namespace mntone::rtmp::media;
+
+void audio_info::set_info( const sound_info& sound_info )
+{
+	switch( sound_info.rate )
+	{
+	case sound_rate::r5_5khz: sample_rate = 5513; break;
+	case sound_rate::r11khz: sample_rate = 11025; break;
+	case sound_rate::r22khz: sample_rate = 22050; break;
+	case sound_rate::r44khz: sample_rate = 44100; break;
+	default: throw std::invalid_argument( "sound_info" );
+	}
+
+	switch( sound_info.format )
+	{
+	case sound_format::linear_pcm: format = audio_format::lpcm; break;
+	case sound_format::adaptive_differential_pcm: format = audio_format::adpcm; break;
+	case sound_format::mp3: format = audio_format::mp3; break;
+	case sound_format::linear_pcm_little_endian: format = audio_format::lpcm_le; break;
+	case sound_format::nellymoser_16khz_mono:
+		format = audio_format::nellymoser;
+		sample_rate = 16000;
+		break;
+	case sound_format::nellymoser_8khz_mono:
+		format = audio_format::nellymoser;
+		sample_rate = 8000;
+		break;
+	case sound_format::nellymoser: format = audio_format::nellymoser; break;
+	case sound_format::g711_alaw_logarithmic_pcm: format = audio_format::g711_alaw; break;
+	case sound_format::g711_mulaw_logarithmic_pcm: format = audio_format::g711_mulaw; break;
+	case sound_format::speex: format = audio_format::speex; break;
+	case sound_format::mp3_8khz:
+		format = audio_format::mp3;
+		sample_rate = 8000;
+		break;
+	default: throw std::invalid_argument( "sound_info" );
+	}
+
+	channel_count = sound_info.type == sound_type::stereo ? 2 : 1;
+	bits_per_sample = sound_info.size == sound_size::s16bit ? 16 : 8;
+}
+
+sound_info audio_info::get_info() const
+{
+	sound_info info;
+	info.type = channel_count >= 2 ? sound_type::stereo : sound_type::mono;
+	info.size = bits_per_sample == 8 ? sound_size::s8bit : sound_size::s16bit;
+	info.rate = sample_rate >= 44100 ? sound_rate::r44khz
+		: sample_rate >= 22050 ? sound_rate::r22khz
+		: sample_rate >= 11025 ? sound_rate::r11khz
+		: sound_rate::r5_5khz;
+
+	switch( format )
+	{
+	case audio_format::lpcm: info.format = sound_format::linear_pcm; break;
+	case audio_format::adpcm: info.format = sound_format::adaptive_differential_pcm; break;
+	case audio_format::mp3: info.format = sample_rate == 8000 ? sound_format::mp3_8khz : sound_format::mp3; break;
+	case audio_format::lpcm_le: info.format = sound_format::linear_pcm_little_endian; break;
+	case audio_format::nellymoser:
+		info.format = sample_rate == 16000 ? sound_format::nellymoser_16khz_mono
+			: sample_rate == 8000 ? sound_format::nellymoser_8khz_mono
+			: sound_format::nellymoser;
+		break;
+	case audio_format::g711_alaw: info.format = sound_format::g711_alaw_logarithmic_pcm; break;
+	case audio_format::g711_mulaw: info.format = sound_format::g711_mulaw_logarithmic_pcm; break;
+	case audio_format::aac:
+		info.format = sound_format::aac;
+		info.type = sound_type::stereo;
+		info.rate = sound_rate::r44khz;
+		break;
+	case audio_format::speex: info.format = sound_format::speex; break;
+	default: throw std::invalid_argument( "audio_info" );
+	}
+	return info;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include "sound_info.h"
+#include "audio_format.h"
+
+namespace mntone { namespace rtmp { namespace media {
+
+	struct audio_info
+	{
+		audio_info()
+			: format( audio_format::lpcm )
+			, sample_rate( 0 )
+			, channel_count( 0 )
+			, bitrate( 0 )
+			, bits_per_sample( 0 )
+		{ }
+
+		void set_info( const sound_info& sound_info );
+
+		// FLV sound flags for sending. Rates round down to the nearest FLV rate; AAC is always
+		// flagged 44 kHz stereo, the real configuration travels in the AudioSpecificConfig.
+		sound_info get_info() const;
+
+		audio_format format;
+		uint32 sample_rate;
+		uint16 channel_count, bitrate, bits_per_sample;
+	};
+
+} } }
\ No newline at end of file
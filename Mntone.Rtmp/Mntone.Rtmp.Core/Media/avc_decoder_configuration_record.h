@@ -8,10 +8,10 @@ namespace mntone { namespace rtmp { namespace media {
 		uint8 avc_profile_indication;
 		uint8 profile_compatibility;
 		uint8 avc_level_indication;
-		unsigned length_size_minus_one : 2;
-		unsigned : 6;
-		unsigned numOfSeqeuenceParameterSets : 5;
-		unsigned : 3;
+		uint8 length_size_minus_one : 2;
+		uint8 : 6;
+		uint8 numOfSeqeuenceParameterSets : 5;
+		uint8 : 3;
 	};
 
 	//   uint16 sequenceParameterSetLength;
@@ -14,7 +14,7 @@ void flv_tag::set_data_size( uint32 value )
 {
 	if( value > 281474976710655 )
 	{
-		throw ref new Platform::InvalidArgumentException();
+		throw std::invalid_argument( "data_size" );
 	}
 
 	utility::convert_big_endian( &value, 3, &data_size_[0] );
@@ -43,7 +43,7 @@ void flv_tag::set_stream_id( uint32 value )
 {
 	if( value > 281474976710655 )
 	{
-		throw ref new Platform::InvalidArgumentException();
+		throw std::invalid_argument( "stream_id" );
 	}
 
 	utility::convert_big_endian( &value, 3, &stream_id_[0] );
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace mntone { namespace rtmp { namespace media {
+
+	// onMetaData as the encoder declared it; values it left out stay 0
+	struct stream_metadata
+	{
+		stream_metadata()
+			: duration( 0.0 )
+			, file_size( 0.0 )
+			, has_video( false )
+			, video_codec_id( 0 )
+			, width( 0 )
+			, height( 0 )
+			, video_data_rate( 0.0 )
+			, frame_rate( 0.0 )
+			, has_audio( false )
+			, audio_codec_id( 0 )
+			, audio_data_rate( 0.0 )
+			, audio_sample_rate( 0 )
+			, audio_sample_size( 0 )
+			, stereo( false )
+		{ }
+
+		// Seconds and bytes; 0 for live streams
+		float64 duration, file_size;
+
+		// A track is present when its codec id is declared. Data rates are in kbit/s.
+		bool has_video;
+		uint8 video_codec_id;
+		uint16 width, height;
+		float64 video_data_rate, frame_rate;
+
+		bool has_audio;
+		uint8 audio_codec_id;
+		float64 audio_data_rate;
+		uint32 audio_sample_rate;
+		uint16 audio_sample_size;
+		bool stereo;
+
+		std::string encoder;
+
+		// keyframes.times (seconds) and keyframes.filepositions (bytes), pairwise; recorded files only
+		std::vector<float64> keyframe_times, keyframe_positions;
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace mntone { namespace rtmp { namespace media {
+
+	// FLV codec id; same values as Mntone::Rtmp::Media::VideoFormat
+	enum class video_format: uint8
+	{
+		jpeg = 1,
+		sorenson_h263 = 2,
+		screen_video = 3,
+		on2_vp6 = 4,
+		on2_vp6_with_alpha_channel = 5,
+		screen_video_version2 = 6,
+		avc = 7,
+	};
+
+} } }
\ No newline at end of file
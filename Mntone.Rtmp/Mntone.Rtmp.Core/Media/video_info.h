@@ -0,0 +1,21 @@
+#pragma once
+#include "video_format.h"
+
+namespace mntone { namespace rtmp { namespace media {
+
+	struct video_info
+	{
+		video_info()
+			: format( video_format::avc )
+			, profile_indication( 0 )
+			, bitrate( 0 )
+			, height( 0 )
+			, width( 0 )
+		{ }
+
+		video_format format;
+		uint8 profile_indication;
+		uint16 bitrate, height, width;
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "pch.h"
+#include "amf0.h"
+#include "amf0_writer.h"
+#include "amf3.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	enum class marker: uint8
+	{
+		number = 0x00,
+		boolean = 0x01,
+		string = 0x02,
+		object = 0x03,
+		movieclip = 0x04,
+		null = 0x05,
+		undefined = 0x06,
+		reference = 0x07,
+		ecma_array = 0x08,
+		object_end = 0x09,
+		strict_array = 0x0a,
+		date = 0x0b,
+		long_string = 0x0c,
+		unsupported = 0x0d,
+		recordset = 0x0e,
+		xml_document = 0x0f,
+		typed_object = 0x10,
+		avmplus_object = 0x11,
+	};
+
+	// Nesting guard against hostile input
+	const size_t MAX_DEPTH = 64;
+
+	class reader final
+	{
+	public:
+		reader( const uint8* data, size_t length )
+			: itr_( data )
+			, end_( data + length )
+		{ }
+
+		bool empty() const noexcept { return itr_ == end_; }
+
+		bool read_value( amf_value& value, size_t depth )
+		{
+			if( depth > MAX_DEPTH || !has( 1 ) )
+			{
+				return false;
+			}
+
+			const auto type = static_cast<marker>( *itr_++ );
+			switch( type )
+			{
+			case marker::number:
+				{
+					float64 number;
+					if( !read_double( number ) )
+					{
+						return false;
+					}
+					value = amf_value::create_number( number );
+					return true;
+				}
+
+			case marker::boolean:
+				if( !has( 1 ) )
+				{
+					return false;
+				}
+				value = amf_value::create_boolean( *itr_++ != 0 );
+				return true;
+
+			case marker::string:
+				{
+					std::string string;
+					if( !read_string( string, 2 ) )
+					{
+						return false;
+					}
+					value = amf_value::create_string( std::move( string ) );
+					return true;
+				}
+
+			case marker::long_string:
+			case marker::xml_document:
+				{
+					std::string string;
+					if( !read_string( string, 4 ) )
+					{
+						return false;
+					}
+					value = amf_value::create_string( std::move( string ) );
+					return true;
+				}
+
+			case marker::object:
+				value = amf_value::create_object();
+				return read_properties( value, depth );
+
+			case marker::typed_object:
+				{
+					std::string class_name;
+					if( !read_string( class_name, 2 ) )
+					{
+						return false;
+					}
+					value = amf_value::create_object();
+					return read_properties( value, depth );
+				}
+
+			case marker::ecma_array:
+				// The associative count is only a hint; the list is terminated by an object end marker
+				if( !has( 4 ) )
+				{
+					return false;
+				}
+				itr_ += 4;
+				value = amf_value::create_ecma_array();
+				return read_properties( value, depth );
+
+			case marker::strict_array:
+				{
+					uint32 count;
+					if( !read_uint32( count ) )
+					{
+						return false;
+					}
+					value = amf_value::create_strict_array();
+					for( auto i = 0u; i < count; ++i )
+					{
+						amf_value element;
+						if( !read_value( element, depth + 1 ) )
+						{
+							return false;
+						}
+						value.append( std::move( element ) );
+					}
+					return true;
+				}
+
+			case marker::date:
+				{
+					float64 date;
+					if( !read_double( date ) || !has( 2 ) )
+					{
+						return false;
+					}
+					itr_ += 2; // time-zone: reserved, should be 0
+					value = amf_value::create_date( date );
+					return true;
+				}
+
+			case marker::null:
+				value = amf_value();
+				return true;
+
+			case marker::undefined:
+			case marker::unsupported:
+				value = amf_value::create_undefined();
+				return true;
+
+			case marker::reference:
+				// Object references are not resolved; the referenced value is reported as undefined
+				if( !has( 2 ) )
+				{
+					return false;
+				}
+				itr_ += 2;
+				value = amf_value::create_undefined();
+				return true;
+
+			case marker::avmplus_object:
+				// The value continues in AMF3
+				return amf3::parse_value( itr_, end_, value );
+
+			default:
+				return false;
+			}
+		}
+
+	private:
+		bool has( size_t length ) const noexcept { return static_cast<size_t>( end_ - itr_ ) >= length; }
+
+		bool read_uint32( uint32& value )
+		{
+			if( !has( 4 ) )
+			{
+				return false;
+			}
+			utility::convert_big_endian( itr_, 4, &value );
+			itr_ += 4;
+			return true;
+		}
+
+		bool read_double( float64& value )
+		{
+			if( !has( 8 ) )
+			{
+				return false;
+			}
+			utility::convert_big_endian( itr_, 8, &value );
+			itr_ += 8;
+			return true;
+		}
+
+		bool read_string( std::string& value, size_t length_size )
+		{
+			if( !has( length_size ) )
+			{
+				return false;
+			}
+
+			uint32 length = 0;
+			utility::convert_big_endian( itr_, length_size, &length );
+			itr_ += length_size;
+			if( !has( length ) )
+			{
+				return false;
+			}
+			value.assign( reinterpret_cast<const char*>( itr_ ), length );
+			itr_ += length;
+			return true;
+		}
+
+		bool read_properties( amf_value& value, size_t depth )
+		{
+			for( ;; )
+			{
+				std::string name;
+				if( !read_string( name, 2 ) )
+				{
+					return false;
+				}
+
+				if( name.empty() )
+				{
+					if( !has( 1 ) )
+					{
+						return false;
+					}
+					if( static_cast<marker>( *itr_ ) == marker::object_end )
+					{
+						++itr_;
+						return true;
+					}
+				}
+
+				amf_value property;
+				if( !read_value( property, depth + 1 ) )
+				{
+					return false;
+				}
+				value.insert( std::move( name ), std::move( property ) );
+			}
+		}
+
+	private:
+		const uint8* itr_;
+		const uint8* const end_;
+	};
+
+}
+
+bool amf0::parse( const uint8* data, size_t length, std::vector<amf_value>& values )
+{
+	reader r( data, length );
+	while( !r.empty() )
+	{
+		amf_value value;
+		if( !r.read_value( value, 0 ) )
+		{
+			return false;
+		}
+		values.push_back( std::move( value ) );
+	}
+	return true;
+}
+
+void amf0::serialize( const amf_value& value, std::vector<uint8>& out )
+{
+	writer( out ).value( value );
+}
+
+void amf0::serialize( const std::vector<amf_value>& values, std::vector<uint8>& out )
+{
+	writer w( out );
+	for( const auto& value : values )
+	{
+		w.value( value );
+	}
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+#include "amf_value.h"
+
+namespace mntone { namespace rtmp { namespace amf0 {
+
+	// Parses consecutive AMF0 values (e.g. the body of a command message) until the data runs out.
+	// Returns false when the data is malformed; values parsed before the error are kept.
+	// Values behind the AVM+ marker are read as AMF3.
+	bool parse( const uint8* data, size_t length, std::vector<amf_value>& values );
+
+	void serialize( const amf_value& value, std::vector<uint8>& out );
+	void serialize( const std::vector<amf_value>& values, std::vector<uint8>& out );
+
+} } }
\ No newline at end of file
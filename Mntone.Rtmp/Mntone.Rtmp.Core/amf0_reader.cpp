@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "amf0_reader.h"
+
+using namespace mntone::rtmp;
+using namespace mntone::rtmp::amf0;
+
+namespace {
+
+	const uint8 OBJECT_FRAME = 0;
+	const uint8 STRICT_ARRAY_FRAME = 1;
+
+	const uint8 OBJECT_END_MARKER = 0x09;
+
+}
+
+reader::reader( const uint8* data, size_t length ) noexcept
+	: itr_( data )
+	, end_( data + length )
+	, current_( token::end )
+	, number_( 0.0 )
+	, depth_( 0 )
+{ }
+
+token reader::next() noexcept
+{
+	if( current_ == token::error )
+	{
+		return token::error;
+	}
+	string_ = string_ref();
+	name_ = string_ref();
+	number_ = 0.0;
+
+	if( depth_ == 0 )
+	{
+		if( itr_ == end_ )
+		{
+			return current_ = token::end;
+		}
+		return current_ = read_value();
+	}
+
+	auto& top = stack_[depth_ - 1];
+	if( top.kind == STRICT_ARRAY_FRAME )
+	{
+		if( top.remaining == 0 )
+		{
+			--depth_;
+			return current_ = token::array_end;
+		}
+		--top.remaining;
+		return current_ = read_value();
+	}
+
+	// Property name, or the empty name and end marker closing the object
+	if( has( 3 ) && itr_[0] == 0 && itr_[1] == 0 && itr_[2] == OBJECT_END_MARKER )
+	{
+		itr_ += 3;
+		--depth_;
+		return current_ = token::object_end;
+	}
+	string_ref name;
+	if( !read_string( 2, name ) )
+	{
+		return fail();
+	}
+	current_ = read_value();
+	name_ = name;
+	return current_;
+}
+
+bool reader::skip() noexcept
+{
+	if( current_ != token::object_begin && current_ != token::ecma_array_begin && current_ != token::strict_array_begin )
+	{
+		return current_ != token::error;
+	}
+
+	const auto target = depth_ - 1;
+	while( depth_ > target )
+	{
+		const auto result = next();
+		if( result == token::error || result == token::end )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool reader::find( string_ref name ) noexcept
+{
+	if( depth_ == 0 || stack_[depth_ - 1].kind != OBJECT_FRAME )
+	{
+		return false;
+	}
+
+	const auto target = depth_;
+	for( ;; )
+	{
+		const auto result = next();
+		if( result == token::error || depth_ < target )
+		{
+			return false;
+		}
+		if( name_ == name )
+		{
+			return true;
+		}
+		if( !skip() )
+		{
+			return false;
+		}
+	}
+}
+
+token reader::read_value() noexcept
+{
+	if( !has( 1 ) )
+	{
+		return fail();
+	}
+
+	switch( *itr_++ )
+	{
+	case 0x00: // number
+	case 0x0b: // date
+		{
+			const auto date = itr_[-1] == 0x0b;
+			if( !has( date ? 10 : 8 ) )
+			{
+				return fail();
+			}
+			utility::convert_big_endian( itr_, 8, &number_ );
+			itr_ += date ? 10 : 8; // date: time-zone, reserved
+			return date ? token::date : token::number;
+		}
+
+	case 0x01: // boolean
+		if( !has( 1 ) )
+		{
+			return fail();
+		}
+		number_ = *itr_++ != 0 ? 1.0 : 0.0;
+		return token::boolean;
+
+	case 0x02: // string
+		return read_string( 2, string_ ) ? token::string : fail();
+
+	case 0x0c: // long string
+	case 0x0f: // xml document
+		return read_string( 4, string_ ) ? token::string : fail();
+
+	case 0x03: // object
+		return begin( OBJECT_FRAME, 0, token::object_begin );
+
+	case 0x10: // typed object
+		{
+			string_ref class_name;
+			if( !read_string( 2, class_name ) )
+			{
+				return fail();
+			}
+			return begin( OBJECT_FRAME, 0, token::object_begin );
+		}
+
+	case 0x08: // ECMA array: the associative count is only a hint, the end marker decides
+		if( !has( 4 ) )
+		{
+			return fail();
+		}
+		itr_ += 4;
+		return begin( OBJECT_FRAME, 0, token::ecma_array_begin );
+
+	case 0x0a: // strict array
+		{
+			if( !has( 4 ) )
+			{
+				return fail();
+			}
+			uint32 count;
+			utility::convert_big_endian( itr_, 4, &count );
+			itr_ += 4;
+			return begin( STRICT_ARRAY_FRAME, count, token::strict_array_begin );
+		}
+
+	case 0x05: // null
+		return token::null;
+
+	case 0x06: // undefined
+	case 0x0d: // unsupported
+		return token::undefined;
+
+	case 0x07: // reference: not resolved, reported as undefined
+		if( !has( 2 ) )
+		{
+			return fail();
+		}
+		itr_ += 2;
+		return token::undefined;
+
+	default:
+		return fail();
+	}
+}
+
+token reader::begin( uint8 kind, uint32 count, token result ) noexcept
+{
+	if( depth_ == max_depth )
+	{
+		return fail();
+	}
+	stack_[depth_].kind = kind;
+	stack_[depth_].remaining = count;
+	++depth_;
+	return result;
+}
+
+bool reader::read_string( size_t length_size, string_ref& value ) noexcept
+{
+	if( !has( length_size ) )
+	{
+		return false;
+	}
+
+	uint32 length = 0;
+	utility::convert_big_endian( itr_, length_size, &length );
+	itr_ += length_size;
+	if( !has( length ) )
+	{
+		return false;
+	}
+	value = string_ref( reinterpret_cast<const char*>( itr_ ), length );
+	itr_ += length;
+	return true;
+}
+
+token reader::fail() noexcept
+{
+	current_ = token::error;
+	return token::error;
+}
\ No newline at end of file
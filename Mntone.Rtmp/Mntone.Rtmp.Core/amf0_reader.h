@@ -0,0 +1,90 @@
+#pragma once
+#include "string_ref.h"
+
+namespace mntone { namespace rtmp { namespace amf0 {
+
+	enum class token: uint8
+	{
+		// The data ran out between two top-level values
+		end,
+		// Malformed or truncated data; every later next() returns error too
+		error,
+
+		number,
+		boolean,
+		string,
+		null,
+		undefined,
+		date,
+
+		// Objects (typed objects included) and ECMA arrays: named values, then object_end
+		object_begin,
+		ecma_array_begin,
+		object_end,
+
+		// Strict arrays: unnamed values, then array_end
+		strict_array_begin,
+		array_end,
+	};
+
+	// Forward-only AMF0 reader over a message body.
+	// next() steps through the values one token at a time; strings and property names are
+	// string_refs into the body, and nesting is tracked in a fixed stack, so reading allocates
+	// nothing. The reader is a plain value: copy it to come back to a position.
+	// Values switched to AMF3 read as error; net_connection rewrites AMF3 messages as AMF0 before
+	// any handler sees them.
+	class reader final
+	{
+	public:
+		reader( const uint8* data, size_t length ) noexcept;
+
+		token next() noexcept;
+
+		// After a *_begin token: consumes the container up to its end token. After anything else: nothing.
+		bool skip() noexcept;
+
+		// Inside an object or ECMA array: advances to the property called name, skipping the
+		// others, and leaves its value as the current token. Returns false, with the container
+		// consumed, when the end comes first.
+		bool find( string_ref name ) noexcept;
+
+		token current() const noexcept { return current_; }
+
+		// Value of the current number or date, boolean or string token
+		float64 number() const noexcept { return number_; }
+		bool boolean() const noexcept { return number_ != 0.0; }
+		string_ref string() const noexcept { return string_; }
+
+		// Property name of the current value; empty outside objects and ECMA arrays
+		string_ref name() const noexcept { return name_; }
+
+		// Containers entered and not yet left
+		size_t depth() const noexcept { return depth_; }
+
+	private:
+		token read_value() noexcept;
+		token begin( uint8 kind, uint32 count, token result ) noexcept;
+		bool read_string( size_t length_size, string_ref& value ) noexcept;
+		bool has( size_t length ) const noexcept { return static_cast<size_t>( end_ - itr_ ) >= length; }
+		token fail() noexcept;
+
+	private:
+		static const size_t max_depth = 64;
+
+		struct frame
+		{
+			uint8 kind;
+			uint32 remaining;
+		};
+
+		const uint8* itr_;
+		const uint8* end_;
+		token current_;
+		float64 number_;
+		string_ref string_, name_;
+
+		frame stack_[max_depth];
+		size_t depth_;
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "amf0_writer.h"
+#include "amf3.h"
+
+using namespace mntone::rtmp;
+using namespace mntone::rtmp::amf0;
+
+namespace {
+
+	const uint8 NUMBER_MARKER = 0x00;
+	const uint8 BOOLEAN_MARKER = 0x01;
+	const uint8 STRING_MARKER = 0x02;
+	const uint8 OBJECT_MARKER = 0x03;
+	const uint8 NULL_MARKER = 0x05;
+	const uint8 UNDEFINED_MARKER = 0x06;
+	const uint8 ECMA_ARRAY_MARKER = 0x08;
+	const uint8 OBJECT_END_MARKER = 0x09;
+	const uint8 STRICT_ARRAY_MARKER = 0x0a;
+	const uint8 DATE_MARKER = 0x0b;
+	const uint8 LONG_STRING_MARKER = 0x0c;
+	const uint8 AVMPLUS_OBJECT_MARKER = 0x11;
+
+}
+
+writer& writer::number( float64 value )
+{
+	const auto offset = out_.size();
+	out_.resize( offset + 9 );
+	out_[offset] = NUMBER_MARKER;
+	utility::convert_big_endian( &value, 8, &out_[offset + 1] );
+	return *this;
+}
+
+writer& writer::boolean( bool value )
+{
+	out_.push_back( BOOLEAN_MARKER );
+	out_.push_back( value ? 1 : 0 );
+	return *this;
+}
+
+writer& writer::string( string_ref value )
+{
+	if( value.size() <= 0xffff )
+	{
+		out_.push_back( STRING_MARKER );
+		write_utf8( value );
+	}
+	else
+	{
+		out_.push_back( LONG_STRING_MARKER );
+		write_uint( static_cast<uint32>( value.size() ), 4 );
+		out_.insert( out_.end(), value.data(), value.data() + value.size() );
+	}
+	return *this;
+}
+
+writer& writer::null()
+{
+	out_.push_back( NULL_MARKER );
+	return *this;
+}
+
+writer& writer::undefined()
+{
+	out_.push_back( UNDEFINED_MARKER );
+	return *this;
+}
+
+writer& writer::date( float64 milliseconds )
+{
+	const auto offset = out_.size();
+	out_.resize( offset + 11 );
+	out_[offset] = DATE_MARKER;
+	utility::convert_big_endian( &milliseconds, 8, &out_[offset + 1] );
+
+	// Time zone, which AMF0 readers ignore
+	out_[offset + 9] = out_[offset + 10] = 0;
+	return *this;
+}
+
+writer& writer::begin_object()
+{
+	out_.push_back( OBJECT_MARKER );
+	return *this;
+}
+
+writer& writer::end_object()
+{
+	out_.push_back( 0 );
+	out_.push_back( 0 );
+	out_.push_back( OBJECT_END_MARKER );
+	return *this;
+}
+
+writer& writer::begin_ecma_array( uint32 count )
+{
+	out_.push_back( ECMA_ARRAY_MARKER );
+	write_uint( count, 4 );
+	return *this;
+}
+
+writer& writer::begin_strict_array( uint32 count )
+{
+	out_.push_back( STRICT_ARRAY_MARKER );
+	write_uint( count, 4 );
+	return *this;
+}
+
+writer& writer::property( string_ref name )
+{
+	if( name.size() > 0xffff )
+	{
+		throw std::invalid_argument( "name" );
+	}
+	write_utf8( name );
+	return *this;
+}
+
+writer& writer::value( const amf_value& value )
+{
+	switch( value.type() )
+	{
+	case amf_type::number:
+		return number( value.as_number() );
+
+	case amf_type::boolean:
+		return boolean( value.as_boolean() );
+
+	case amf_type::string:
+		return string( value.as_string() );
+
+	case amf_type::object:
+	case amf_type::ecma_array:
+		if( value.type() == amf_type::object )
+		{
+			begin_object();
+		}
+		else
+		{
+			begin_ecma_array( static_cast<uint32>( value.properties().size() ) );
+		}
+		for( const auto& property : value.properties() )
+		{
+			this->property( property.first );
+			this->value( property.second );
+		}
+		return end_object();
+
+	case amf_type::null:
+		return null();
+
+	case amf_type::undefined:
+		return undefined();
+
+	case amf_type::strict_array:
+		begin_strict_array( static_cast<uint32>( value.elements().size() ) );
+		for( const auto& element : value.elements() )
+		{
+			this->value( element );
+		}
+		return *this;
+
+	case amf_type::date:
+		return date( value.as_number() );
+	}
+	return *this;
+}
+
+writer& writer::amf3( const amf_value& value )
+{
+	out_.push_back( AVMPLUS_OBJECT_MARKER );
+	amf3::serialize( value, out_ );
+	return *this;
+}
+
+writer& writer::raw( const uint8* data, size_t length )
+{
+	out_.insert( out_.end(), data, data + length );
+	return *this;
+}
+
+void writer::write_uint( uint32 value, size_t size )
+{
+	const auto offset = out_.size();
+	out_.resize( offset + size );
+	utility::convert_big_endian( &value, size, &out_[offset] );
+}
+
+void writer::write_utf8( string_ref value )
+{
+	write_uint( static_cast<uint32>( value.size() ), 2 );
+	out_.insert( out_.end(), value.data(), value.data() + value.size() );
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#include "amf_value.h"
+#include "string_ref.h"
+
+namespace mntone { namespace rtmp { namespace amf0 {
+
+	// Appends AMF0 values straight to a message body.
+	// The counterpart of amf0::reader: commands are written field by field, without building an
+	// amf_value tree first. Containers are not checked; every begin_* needs its end_*, and
+	// property() comes before each value inside an object or ECMA array.
+	class writer final
+	{
+	public:
+		explicit writer( std::vector<uint8>& out ) noexcept
+			: out_( out )
+		{ }
+
+		writer& number( float64 value );
+		writer& boolean( bool value );
+		// Strings over 0xffff bytes are written as long strings
+		writer& string( string_ref value );
+		writer& null();
+		writer& undefined();
+		writer& date( float64 milliseconds );
+
+		writer& begin_object();
+		writer& end_object();
+		writer& begin_ecma_array( uint32 count );
+		writer& end_ecma_array() { return end_object(); }
+		writer& begin_strict_array( uint32 count );
+
+		// Name of the next value in an object or ECMA array. Throws std::invalid_argument over 0xffff bytes.
+		writer& property( string_ref name );
+
+		// A whole value tree, e.g. user supplied metadata
+		writer& value( const amf_value& value );
+
+		// A value switched to AMF3 behind the AVM+ marker, with tables of its own (see amf3::serialize)
+		writer& amf3( const amf_value& value );
+
+		// Bytes already in AMF0, written as they are
+		writer& raw( const uint8* data, size_t length );
+
+		// Command name and transaction id, the start of every command message
+		writer& command( string_ref name, float64 transaction_id ) { return string( name ).number( transaction_id ); }
+
+	private:
+		void write_uint( uint32 value, size_t size );
+		void write_utf8( string_ref value );
+
+	private:
+		std::vector<uint8>& out_;
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,685 @@
+#include "pch.h"
+#include <cmath>
+#include "amf3.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	enum class marker: uint8
+	{
+		undefined = 0x00,
+		null = 0x01,
+		false_value = 0x02,
+		true_value = 0x03,
+		integer = 0x04,
+		double_value = 0x05,
+		string = 0x06,
+		xml_document = 0x07,
+		date = 0x08,
+		array = 0x09,
+		object = 0x0a,
+		xml = 0x0b,
+		byte_array = 0x0c,
+	};
+
+	const uint32 U29_MAX = 0x1fffffff;
+	const int32 INTEGER_MIN = -0x10000000;
+	const int32 INTEGER_MAX = 0x0fffffff;
+
+	// Nesting guard against hostile input
+	const size_t MAX_DEPTH = 64;
+
+	// References expand to copies, so a few bytes can name a huge tree; this caps the values one
+	// message may produce, references read again included
+	const size_t MAX_VALUES = 1 << 18;
+
+	// A string reference copies the whole string, so few values can still hold a lot of bytes.
+	// The string, XML and byte array bytes one message may produce, references included, are
+	// capped at this multiple of its length, with a floor for short messages.
+	const size_t MAX_EXPANSION = 16;
+	const size_t MIN_MATERIALIZED_BYTES = 64 * 1024;
+
+	class reader final
+	{
+	public:
+		reader( const uint8* data, const uint8* end )
+			: itr_( data )
+			, end_( end )
+			, values_( 0 )
+			, materialized_bytes_( 0 )
+			, max_materialized_bytes_( std::max( MIN_MATERIALIZED_BYTES, MAX_EXPANSION * static_cast<size_t>( end - data ) ) )
+			, replaying_( 0 )
+		{ }
+
+		bool empty() const noexcept { return itr_ == end_; }
+		const uint8* position() const noexcept { return itr_; }
+
+		bool read_value( amf_value& value, size_t depth )
+		{
+			if( depth > MAX_DEPTH || !has( 1 ) || ++values_ > MAX_VALUES )
+			{
+				return false;
+			}
+
+			const auto begin = itr_;
+			const auto type = static_cast<marker>( *itr_++ );
+			switch( type )
+			{
+			case marker::undefined:
+				value = amf_value::create_undefined();
+				return true;
+
+			case marker::null:
+				value = amf_value();
+				return true;
+
+			case marker::false_value:
+			case marker::true_value:
+				value = amf_value::create_boolean( type == marker::true_value );
+				return true;
+
+			case marker::integer:
+				{
+					uint32 u29;
+					if( !read_u29( u29 ) )
+					{
+						return false;
+					}
+
+					// 29-bit two's complement
+					const auto integer = static_cast<int32>( u29 << 3 ) >> 3;
+					value = amf_value::create_number( static_cast<float64>( integer ) );
+					return true;
+				}
+
+			case marker::double_value:
+				{
+					float64 number;
+					if( !read_double( number ) )
+					{
+						return false;
+					}
+					value = amf_value::create_number( number );
+					return true;
+				}
+
+			case marker::string:
+				{
+					std::string string;
+					if( !read_string( string ) )
+					{
+						return false;
+					}
+					value = amf_value::create_string( std::move( string ) );
+					return true;
+				}
+
+			case marker::xml_document:
+			case marker::xml:
+			case marker::byte_array:
+				// Kept as their bytes; amf_value has no type of its own for them
+				return read_referenced( begin, value, depth, [this]( uint32 length, amf_value& value )
+				{
+					if( !has( length ) || !materialize( length ) )
+					{
+						return false;
+					}
+					value = amf_value::create_string( std::string( reinterpret_cast<const char*>( itr_ ), length ) );
+					itr_ += length;
+					return true;
+				} );
+
+			case marker::date:
+				return read_referenced( begin, value, depth, [this]( uint32, amf_value& value )
+				{
+					float64 date;
+					if( !read_double( date ) )
+					{
+						return false;
+					}
+					value = amf_value::create_date( date );
+					return true;
+				} );
+
+			case marker::array:
+				return read_referenced( begin, value, depth, [this, depth]( uint32 dense_count, amf_value& value ) { return read_array( dense_count, value, depth ); } );
+
+			case marker::object:
+				return read_referenced( begin, value, depth, [this, depth]( uint32 header, amf_value& value ) { return read_object( header, value, depth ); } );
+
+			default:
+				return false;
+			}
+		}
+
+	private:
+		struct traits
+		{
+			std::vector<std::string> members;
+			bool dynamic;
+		};
+
+		enum class entry_state: uint8
+		{
+			reading,
+			complete,
+			replaying,
+		};
+
+		struct object_entry
+		{
+			const uint8* begin;
+			entry_state state;
+		};
+
+		bool has( size_t length ) const noexcept { return static_cast<size_t>( end_ - itr_ ) >= length; }
+
+		// Counts length bytes against the message's budget; false once it is spent
+		bool materialize( size_t length ) noexcept
+		{
+			materialized_bytes_ += length;
+			return materialized_bytes_ <= max_materialized_bytes_;
+		}
+
+		bool read_u29( uint32& value )
+		{
+			value = 0;
+			for( auto i = 0; i < 3; ++i )
+			{
+				if( !has( 1 ) )
+				{
+					return false;
+				}
+				const auto byte = *itr_++;
+				value = value << 7 | ( byte & 0x7f );
+				if( ( byte & 0x80 ) == 0 )
+				{
+					return true;
+				}
+			}
+
+			// The fourth byte carries all eight bits
+			if( !has( 1 ) )
+			{
+				return false;
+			}
+			value = value << 8 | *itr_++;
+			return true;
+		}
+
+		bool read_double( float64& value )
+		{
+			if( !has( 8 ) )
+			{
+				return false;
+			}
+			utility::convert_big_endian( itr_, 8, &value );
+			itr_ += 8;
+			return true;
+		}
+
+		// UTF-8-vr: a reference into the string table, or an inline string that joins it unless empty
+		bool read_string( std::string& value )
+		{
+			uint32 header;
+			if( !read_u29( header ) )
+			{
+				return false;
+			}
+
+			if( ( header & 1 ) == 0 )
+			{
+				const auto index = header >> 1;
+				if( index >= strings_.size() || !materialize( strings_[index].size() ) )
+				{
+					return false;
+				}
+				value = strings_[index];
+				return true;
+			}
+
+			const auto length = header >> 1;
+			if( !has( length ) || !materialize( length ) )
+			{
+				return false;
+			}
+			value.assign( reinterpret_cast<const char*>( itr_ ), length );
+			itr_ += length;
+			if( length != 0 && replaying_ == 0 )
+			{
+				strings_.push_back( value );
+			}
+			return true;
+		}
+
+		// Values in the object table: a reference, or an inline value that joins the table before
+		// its children are read, so they may refer back to it. The table keeps where each value
+		// starts rather than a copy; a reference reads it again from there, with the tables already
+		// holding everything inside it, so only referenced values cost a second read.
+		template<typename ReadInline>
+		bool read_referenced( const uint8* begin, amf_value& value, size_t depth, const ReadInline& read_inline )
+		{
+			uint32 header;
+			if( !read_u29( header ) )
+			{
+				return false;
+			}
+
+			if( ( header & 1 ) == 0 )
+			{
+				const auto index = header >> 1;
+				if( index >= objects_.size() )
+				{
+					return false;
+				}
+
+				// A reference back into a value still being read
+				auto& entry = objects_[index];
+				if( entry.state != entry_state::complete )
+				{
+					value = amf_value();
+					return true;
+				}
+
+				const auto position = itr_;
+				itr_ = entry.begin;
+				entry.state = entry_state::replaying;
+				++replaying_;
+				const auto result = read_value( value, depth );
+				--replaying_;
+				objects_[index].state = entry_state::complete;
+				itr_ = position;
+				return result;
+			}
+
+			if( replaying_ != 0 )
+			{
+				return read_inline( header >> 1, value );
+			}
+
+			const auto index = objects_.size();
+			object_entry entry = { begin, entry_state::reading };
+			objects_.push_back( entry );
+			if( !read_inline( header >> 1, value ) )
+			{
+				return false;
+			}
+			objects_[index].state = entry_state::complete;
+			return true;
+		}
+
+		// Associative part first, up to an empty name, then the dense part
+		bool read_array( uint32 dense_count, amf_value& value, size_t depth )
+		{
+			std::vector<amf_value::property> associative;
+			for( ;; )
+			{
+				std::string name;
+				if( !read_string( name ) )
+				{
+					return false;
+				}
+				if( name.empty() )
+				{
+					break;
+				}
+
+				amf_value element;
+				if( !read_value( element, depth + 1 ) )
+				{
+					return false;
+				}
+				associative.emplace_back( std::move( name ), std::move( element ) );
+			}
+
+			// Purely dense arrays are strict arrays; mixed ones become ECMA arrays keyed by index
+			value = associative.empty() ? amf_value::create_strict_array() : amf_value::create_ecma_array();
+			for( auto&& property : associative )
+			{
+				value.insert( std::move( property.first ), std::move( property.second ) );
+			}
+			for( auto i = 0u; i < dense_count; ++i )
+			{
+				amf_value element;
+				if( !read_value( element, depth + 1 ) )
+				{
+					return false;
+				}
+				if( associative.empty() )
+				{
+					value.append( std::move( element ) );
+				}
+				else
+				{
+					value.insert( std::to_string( i ), std::move( element ) );
+				}
+			}
+			return true;
+		}
+
+		// header is U29O without its low bit: traits reference, or inline traits with their flags
+		bool read_object( uint32 header, amf_value& value, size_t depth )
+		{
+			// Traits stay in the table and are looked up by index, since reading the values may add
+			// traits and move it; inline traits met while replaying are already there and use a local
+			traits inline_traits;
+			auto index = traits_.size();
+			if( ( header & 1 ) == 0 )
+			{
+				index = header >> 1;
+				if( index >= traits_.size() )
+				{
+					return false;
+				}
+			}
+			else
+			{
+				// Externalizable objects carry a class-specific encoding
+				if( ( header & 2 ) != 0 )
+				{
+					return false;
+				}
+
+				// The class name is dropped, as for AMF0 typed objects
+				inline_traits.dynamic = ( header & 4 ) != 0;
+				std::string class_name;
+				if( !read_string( class_name ) )
+				{
+					return false;
+				}
+				const auto sealed_count = header >> 3;
+				for( auto i = 0u; i < sealed_count; ++i )
+				{
+					std::string member;
+					if( !read_string( member ) )
+					{
+						return false;
+					}
+					inline_traits.members.push_back( std::move( member ) );
+				}
+				if( replaying_ == 0 )
+				{
+					traits_.push_back( std::move( inline_traits ) );
+				}
+				else
+				{
+					index = static_cast<size_t>( -1 );
+				}
+			}
+
+			const auto object_traits = [&]() -> const traits& { return index < traits_.size() ? traits_[index] : inline_traits; };
+			const auto member_count = object_traits().members.size();
+			const auto dynamic = object_traits().dynamic;
+			value = amf_value::create_object();
+			for( size_t i = 0; i < member_count; ++i )
+			{
+				amf_value property;
+				if( !read_value( property, depth + 1 ) )
+				{
+					return false;
+				}
+				value.insert( object_traits().members[i], std::move( property ) );
+			}
+
+			if( dynamic )
+			{
+				for( ;; )
+				{
+					std::string name;
+					if( !read_string( name ) )
+					{
+						return false;
+					}
+					if( name.empty() )
+					{
+						break;
+					}
+
+					amf_value property;
+					if( !read_value( property, depth + 1 ) )
+					{
+						return false;
+					}
+					value.insert( std::move( name ), std::move( property ) );
+				}
+			}
+			return true;
+		}
+
+	private:
+		const uint8* itr_;
+		const uint8* const end_;
+		size_t values_;
+		size_t materialized_bytes_, max_materialized_bytes_;
+		uint32 replaying_;
+		std::vector<std::string> strings_;
+		std::vector<traits> traits_;
+		std::vector<object_entry> objects_;
+	};
+
+	class writer final
+	{
+	public:
+		explicit writer( std::vector<uint8>& out )
+			: out_( out )
+		{ }
+
+		void write_value( const amf_value& value )
+		{
+			switch( value.type() )
+			{
+			case amf_type::number:
+				{
+					const auto number = value.as_number();
+					if( number >= INTEGER_MIN && number <= INTEGER_MAX && std::floor( number ) == number && !( number == 0.0 && std::signbit( number ) ) )
+					{
+						write_marker( marker::integer );
+						write_u29( static_cast<uint32>( static_cast<int32>( number ) ) & U29_MAX );
+					}
+					else
+					{
+						write_marker( marker::double_value );
+						write_double( number );
+					}
+					break;
+				}
+
+			case amf_type::boolean:
+				write_marker( value.as_boolean() ? marker::true_value : marker::false_value );
+				break;
+
+			case amf_type::string:
+				write_marker( marker::string );
+				write_string( value.as_string() );
+				break;
+
+			case amf_type::null:
+				write_marker( marker::null );
+				break;
+
+			case amf_type::undefined:
+				write_marker( marker::undefined );
+				break;
+
+			case amf_type::date:
+				write_marker( marker::date );
+				write_u29( 1 );
+				write_double( value.as_number() );
+				break;
+
+			case amf_type::strict_array:
+				write_marker( marker::array );
+				write_u29( static_cast<uint32>( value.elements().size() ) << 1 | 1 );
+				write_string( std::string() );
+				for( const auto& element : value.elements() )
+				{
+					write_value( element );
+				}
+				break;
+
+			case amf_type::ecma_array:
+				write_marker( marker::array );
+				write_u29( 1 );
+				for( const auto& property : value.properties() )
+				{
+					write_string( property.first );
+					write_value( property.second );
+				}
+				write_string( std::string() );
+				break;
+
+			case amf_type::object:
+				write_marker( marker::object );
+				write_object( value );
+				break;
+			}
+		}
+
+	private:
+		void write_marker( marker type )
+		{
+			out_.push_back( static_cast<uint8>( type ) );
+		}
+
+		void write_u29( uint32 value )
+		{
+			if( value > U29_MAX )
+			{
+				throw std::invalid_argument( "value" );
+			}
+
+			if( value < 0x80 )
+			{
+				out_.push_back( static_cast<uint8>( value ) );
+			}
+			else if( value < 0x4000 )
+			{
+				out_.push_back( static_cast<uint8>( value >> 7 | 0x80 ) );
+				out_.push_back( static_cast<uint8>( value & 0x7f ) );
+			}
+			else if( value < 0x200000 )
+			{
+				out_.push_back( static_cast<uint8>( value >> 14 | 0x80 ) );
+				out_.push_back( static_cast<uint8>( value >> 7 | 0x80 ) );
+				out_.push_back( static_cast<uint8>( value & 0x7f ) );
+			}
+			else
+			{
+				out_.push_back( static_cast<uint8>( value >> 22 | 0x80 ) );
+				out_.push_back( static_cast<uint8>( value >> 15 | 0x80 ) );
+				out_.push_back( static_cast<uint8>( value >> 8 | 0x80 ) );
+				out_.push_back( static_cast<uint8>( value ) );
+			}
+		}
+
+		void write_double( float64 value )
+		{
+			const auto offset = out_.size();
+			out_.resize( offset + 8 );
+			utility::convert_big_endian( &value, 8, &out_[offset] );
+		}
+
+		void write_string( const std::string& value )
+		{
+			if( value.empty() )
+			{
+				write_u29( 1 );
+				return;
+			}
+
+			const auto itr = strings_.find( value );
+			if( itr != strings_.end() )
+			{
+				write_u29( itr->second << 1 );
+				return;
+			}
+
+			const auto index = static_cast<uint32>( strings_.size() );
+			write_u29( static_cast<uint32>( value.size() ) << 1 | 1 );
+			out_.insert( out_.end(), value.cbegin(), value.cend() );
+			strings_.emplace( value, index );
+		}
+
+		// Anonymous objects with their property names as sealed members: the first object of a
+		// shape carries the names, later ones refer to its traits and carry only the values
+		void write_object( const amf_value& value )
+		{
+			const auto& properties = value.properties();
+			std::string shape;
+			for( const auto& property : properties )
+			{
+				shape.append( property.first );
+				shape.push_back( '\0' );
+			}
+
+			const auto itr = traits_.find( shape );
+			if( itr != traits_.end() )
+			{
+				write_u29( itr->second << 2 | 1 );
+			}
+			else
+			{
+				const auto index = static_cast<uint32>( traits_.size() );
+				write_u29( static_cast<uint32>( properties.size() ) << 4 | 3 );
+				write_string( std::string() );
+				for( const auto& property : properties )
+				{
+					write_string( property.first );
+				}
+				traits_.emplace( std::move( shape ), index );
+			}
+
+			for( const auto& property : properties )
+			{
+				write_value( property.second );
+			}
+		}
+
+	private:
+		std::vector<uint8>& out_;
+		std::unordered_map<std::string, uint32> strings_;
+		std::unordered_map<std::string, uint32> traits_;
+	};
+
+}
+
+bool amf3::parse( const uint8* data, size_t length, std::vector<amf_value>& values )
+{
+	reader r( data, data + length );
+	while( !r.empty() )
+	{
+		amf_value value;
+		if( !r.read_value( value, 0 ) )
+		{
+			return false;
+		}
+		values.push_back( std::move( value ) );
+	}
+	return true;
+}
+
+bool amf3::parse_value( const uint8*& data, const uint8* end, amf_value& value )
+{
+	reader r( data, end );
+	if( !r.read_value( value, 0 ) )
+	{
+		return false;
+	}
+	data = r.position();
+	return true;
+}
+
+void amf3::serialize( const amf_value& value, std::vector<uint8>& out )
+{
+	writer( out ).write_value( value );
+}
+
+void amf3::serialize( const std::vector<amf_value>& values, std::vector<uint8>& out )
+{
+	writer w( out );
+	for( const auto& value : values )
+	{
+		w.write_value( value );
+	}
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include "amf_value.h"
+
+namespace mntone { namespace rtmp { namespace amf3 {
+
+	// Parses consecutive AMF3 values sharing one set of string, object and trait reference tables.
+	// Returns false when the data is malformed or uses what amf_value cannot hold (vectors,
+	// dictionaries, externalizable objects); values parsed before the error are kept.
+	// Object references are resolved to copies, and a reference back into an object still being
+	// read, which a tree cannot hold, becomes null.
+	bool parse( const uint8* data, size_t length, std::vector<amf_value>& values );
+
+	// One value behind an AMF0 AVM+ marker (0x11); each such value starts with empty tables.
+	// Advances data past the value.
+	bool parse_value( const uint8*& data, const uint8* end, amf_value& value );
+
+	// Strings and object shapes written before are sent as references into the tables: repeated
+	// keys cost a byte or two, and objects with the same property names share one set of traits.
+	// Integral numbers within 29 bits go out as U29 integers.
+	void serialize( const amf_value& value, std::vector<uint8>& out );
+	void serialize( const std::vector<amf_value>& values, std::vector<uint8>& out );
+
+} } }
\ No newline at end of file
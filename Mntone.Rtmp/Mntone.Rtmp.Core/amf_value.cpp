@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "amf_value.h"
+
+using namespace mntone::rtmp;
+
+amf_value amf_value::create_number( float64 value )
+{
+	amf_value ret( amf_type::number );
+	ret.number_ = value;
+	return ret;
+}
+
+amf_value amf_value::create_boolean( bool value )
+{
+	amf_value ret( amf_type::boolean );
+	ret.boolean_ = value;
+	return ret;
+}
+
+amf_value amf_value::create_string( std::string value )
+{
+	amf_value ret( amf_type::string );
+	ret.string_ = std::move( value );
+	return ret;
+}
+
+amf_value amf_value::create_object()
+{
+	return amf_value( amf_type::object );
+}
+
+amf_value amf_value::create_undefined()
+{
+	return amf_value( amf_type::undefined );
+}
+
+amf_value amf_value::create_ecma_array()
+{
+	return amf_value( amf_type::ecma_array );
+}
+
+amf_value amf_value::create_strict_array()
+{
+	return amf_value( amf_type::strict_array );
+}
+
+amf_value amf_value::create_date( float64 value )
+{
+	amf_value ret( amf_type::date );
+	ret.number_ = value;
+	return ret;
+}
+
+void amf_value::insert( std::string name, amf_value value )
+{
+	properties_.emplace_back( std::move( name ), std::move( value ) );
+}
+
+const amf_value* amf_value::find( const std::string& name ) const noexcept
+{
+	for( const auto& property : properties_ )
+	{
+		if( property.first == name )
+		{
+			return &property.second;
+		}
+	}
+	return nullptr;
+}
+
+void amf_value::append( amf_value value )
+{
+	elements_.push_back( std::move( value ) );
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mntone { namespace rtmp {
+
+	enum class amf_type: uint8
+	{
+		number,
+		boolean,
+		string,
+		object,
+		null,
+		undefined,
+		ecma_array,
+		strict_array,
+		date,
+	};
+
+	// Portable AMF value tree used by the protocol core.
+	// Objects and ECMA arrays keep their properties in wire order.
+	class amf_value final
+	{
+	public:
+		typedef std::pair<std::string, amf_value> property;
+
+		amf_value() noexcept
+			: type_( amf_type::null )
+			, number_( 0.0 )
+			, boolean_( false )
+		{ }
+
+		static amf_value create_number( float64 value );
+		static amf_value create_boolean( bool value );
+		static amf_value create_string( std::string value );
+		static amf_value create_object();
+		static amf_value create_undefined();
+		static amf_value create_ecma_array();
+		static amf_value create_strict_array();
+		static amf_value create_date( float64 value );
+
+		amf_type type() const noexcept { return type_; }
+		bool is_null() const noexcept { return type_ == amf_type::null || type_ == amf_type::undefined; }
+
+		float64 as_number() const noexcept { return number_; }
+		bool as_boolean() const noexcept { return boolean_; }
+		const std::string& as_string() const noexcept { return string_; }
+
+		// object / ecma_array
+		const std::vector<property>& properties() const noexcept { return properties_; }
+		void insert( std::string name, amf_value value );
+		const amf_value* find( const std::string& name ) const noexcept;
+
+		// strict_array
+		const std::vector<amf_value>& elements() const noexcept { return elements_; }
+		void append( amf_value value );
+
+	private:
+		explicit amf_value( amf_type type ) noexcept
+			: type_( type )
+			, number_( 0.0 )
+			, boolean_( false )
+		{ }
+
+	private:
+		amf_type type_;
+		float64 number_;
+		bool boolean_;
+		std::string string_;
+		std::vector<property> properties_;
+		std::vector<amf_value> elements_;
+	};
+
+} }
\ No newline at end of file
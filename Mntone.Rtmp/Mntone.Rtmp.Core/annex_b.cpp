@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "annex_b.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	const size_t SHORT_START_CODE_LENGTH = 3;
+
+	inline uint32 read_length( const uint8* data, size_t length_size ) noexcept
+	{
+		uint32 length = 0;
+		for( size_t i = 0; i < length_size; ++i )
+		{
+			length = length << 8 | data[i];
+		}
+		return length;
+	}
+
+	// Bytes up to the end of the last complete unit; count receives the number of units
+	size_t complete_length( const uint8* data, size_t size, size_t length_size, size_t& count ) noexcept
+	{
+		size_t offset = 0;
+		count = 0;
+		while( size - offset >= length_size )
+		{
+			const auto length = read_length( data + offset, length_size );
+			if( size - offset - length_size < length )
+			{
+				break;
+			}
+			offset += length_size + length;
+			++count;
+		}
+		return offset;
+	}
+
+	// Overwrites every length with a start code of the same size
+	void replace_lengths( uint8* data, size_t size, size_t length_size ) noexcept
+	{
+		size_t offset = 0;
+		while( offset < size )
+		{
+			const auto length = read_length( data + offset, length_size );
+			std::memset( data + offset, 0, length_size - 1 );
+			data[offset + length_size - 1] = 0x01;
+			offset += length_size + length;
+		}
+	}
+
+}
+
+byte_slice mntone::rtmp::avcc_to_annex_b( byte_slice nal_units, size_t length_size, body_pool& pool )
+{
+	size_t count;
+	const auto length = complete_length( nal_units.data(), nal_units.size(), length_size, count );
+
+	if( length_size >= SHORT_START_CODE_LENGTH )
+	{
+		const auto data = nal_units.unique_data();
+		if( data != nullptr )
+		{
+			replace_lengths( data, length, length_size );
+			return nal_units.slice( 0, length );
+		}
+
+		auto buffer = pool.acquire( static_cast<uint32>( length ) );
+		std::memcpy( buffer.data(), nal_units.data(), length );
+		replace_lengths( buffer.data(), length, length_size );
+		return byte_slice( std::move( buffer ) );
+	}
+
+	// Every unit grows by the difference between its length and the start code
+	auto buffer = pool.acquire( static_cast<uint32>( length + count * ( SHORT_START_CODE_LENGTH - length_size ) ) );
+	auto out = buffer.data();
+	for( size_t offset = 0; offset < length; )
+	{
+		const auto unit_length = read_length( nal_units.data() + offset, length_size );
+		offset += length_size;
+		out[0] = 0x00;
+		out[1] = 0x00;
+		out[2] = 0x01;
+		std::memcpy( out + SHORT_START_CODE_LENGTH, nal_units.data() + offset, unit_length );
+		out += SHORT_START_CODE_LENGTH + unit_length;
+		offset += unit_length;
+	}
+	return byte_slice( std::move( buffer ) );
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include "byte_slice.h"
+
+namespace mntone { namespace rtmp {
+
+	// Rewrites AVCC NAL units (each prefixed with its length_size-byte big-endian length, as FLV
+	// carries them) as an Annex B byte stream. A truncated last unit is dropped.
+	// With 3- and 4-byte lengths the start code takes the length's place: a slice holding the only
+	// reference to its block is rewritten in place and returned, anything else is copied once.
+	// 1- and 2-byte lengths become 3-byte start codes in a buffer sized before anything is copied.
+	byte_slice avcc_to_annex_b( byte_slice nal_units, size_t length_size, body_pool& pool );
+
+} }
\ No newline at end of file
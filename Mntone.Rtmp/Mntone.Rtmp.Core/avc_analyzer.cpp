@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "net_stream.h"
+#include "net_connection.h"
+#include "annex_b.h"
+#include "Media/avc_decoder_configuration_record.h"
+
+using namespace mntone::rtmp;
+using namespace mntone::rtmp::media;
+
+namespace {
+
+	byte_slice copy_to_slice( body_pool& pool, const uint8* data, size_t length )
+	{
+		auto buf = pool.acquire( static_cast<uint32>( length ) );
+		std::copy_n( data, length, buf.begin() );
+		return byte_slice( std::move( buf ) );
+	}
+
+	// Calls visit( data, length ) for count 2-byte length prefixed parameter sets at itr, and
+	// leaves itr after them. False when one runs past end.
+	template<typename Visitor>
+	bool visit_parameter_sets( const uint8*& itr, const uint8* end, uint8 count, const Visitor& visit )
+	{
+		for( auto i = 0u; i < count && end - itr >= 2; ++i )
+		{
+			uint16 length;
+			utility::convert_big_endian( &itr[0], 2, &length );
+			itr += 2;
+			if( end - itr < length )
+			{
+				return false;
+			}
+
+			visit( itr, length );
+			itr += length;
+		}
+		return true;
+	}
+
+	// Calls visit for each SPS, then each PPS, of an AVCDecoderConfigurationRecord from its SPS count
+	template<typename Visitor>
+	bool visit_parameter_sets( const uint8* itr, const uint8* end, const Visitor& visit )
+	{
+		const uint8 sps_count = *itr++ & 0x1f;
+		if( !visit_parameter_sets( itr, end, sps_count, visit ) )
+		{
+			return false;
+		}
+
+		const uint8 pps_count = itr < end ? *itr++ : 0;
+		return visit_parameter_sets( itr, end, pps_count, visit );
+	}
+
+}
+
+void net_stream::analysis_avc( rtmp_header header, byte_slice data, video_sample& sample )
+{
+	if( data.size() < 5 || parent_ == nullptr )
+	{
+		return;
+	}
+
+	// AVC NALU
+	if( data[1] == 0x01 )
+	{
+		sample.info = video_info_;
+
+		int64 composition_time_offset( 0 );
+		utility::convert_big_endian( &data[2], 3, &composition_time_offset );
+		if( ( composition_time_offset & 0x800000 ) != 0 )
+			composition_time_offset |= 0xffffffffff000000;
+		sample.presentation_timestamp = header.timestamp + composition_time_offset;
+
+		// Dropping the FLV header first leaves the body with a single reference when nothing else
+		// holds the message, so 3- and 4-byte lengths become start codes in place
+		data = data.slice( 5 );
+		sample.data = avcc_to_annex_b( std::move( data ), static_cast<size_t>( length_size_minus_one_ ) + 1, parent_->pool() );
+
+		if( video_handler_ )
+		{
+			deliver( sample );
+		}
+		return;
+	}
+
+	sample.presentation_timestamp = header.timestamp;
+
+	// AVC sequence header (this is AVCDecoderConfigurationRecord)
+	if( data[1] == 0x00 )
+	{
+		if( data.size() < 11 )
+		{
+			return;
+		}
+
+		if( !video_info_enabled_ )
+		{
+			const auto& dcr = *reinterpret_cast<const avc_decoder_configuration_record*>( &data[5] );
+			length_size_minus_one_ = dcr.length_size_minus_one;
+			video_info_.format = video_format::avc;
+			video_info_.profile_indication = dcr.avc_profile_indication;
+			video_info_.bitrate = static_cast<uint16>( metadata_.video_data_rate );
+			video_info_.height = metadata_.height;
+			video_info_.width = metadata_.width;
+			video_info_enabled_ = true;
+			if( video_started_handler_ )
+			{
+				video_started_handler_( !audio_enabled_, video_info_ );
+			}
+		}
+
+		sample.info = video_info_;
+
+		// Sized on a first pass, so the parameter sets are copied once
+		size_t length = 0;
+		if( !visit_parameter_sets( data.cbegin() + 10, data.cend(), [&length]( const uint8*, size_t set_length ) { length += 3 + set_length; } ) )
+		{
+			return;
+		}
+
+		auto buf = parent_->pool().acquire( static_cast<uint32>( length ) );
+		auto out = buf.begin();
+		visit_parameter_sets( data.cbegin() + 10, data.cend(), [&out]( const uint8* set, size_t set_length )
+		{
+			out[0] = 0x00;
+			out[1] = 0x00;
+			out[2] = 0x01;
+			out = std::copy_n( set, set_length, out + 3 );
+		} );
+		sample.data = byte_slice( std::move( buf ) );
+	}
+	// AVC end of sequence (lower level NALU sequence ender is not required or supported)
+	else if( data[1] == 0x02 )
+	{
+		std::vector<uint8> buf( 4, 0 );
+		buf[2] = 0x01; // startCode
+		buf[3] = 0 /* fixed-pattern(1b) forbidden_zero_bit */
+			| 0x60 /* uint(2b) nal_ref_idc */
+			| 10 /* uint(5b) nal_unit_type */;
+
+		sample.info = video_info_;
+		sample.data = copy_to_slice( parent_->pool(), buf.data(), buf.size() );
+	}
+
+	if( video_handler_ )
+	{
+		deliver( sample );
+	}
+}
\ No newline at end of file
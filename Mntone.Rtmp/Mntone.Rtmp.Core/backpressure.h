@@ -0,0 +1,34 @@
+#pragma once
+
+namespace mntone { namespace rtmp {
+
+	// Per-stream limits on media the consumer has been handed but not yet consumed.
+	// Reading stops when either high mark is reached and resumes once both are back at or below
+	// their low marks. A zero high mark disables that dimension; all zero disables backpressure.
+	struct buffer_watermarks
+	{
+		buffer_watermarks()
+			: high_bytes( 0 ), low_bytes( 0 )
+			, high_milliseconds( 0 ), low_milliseconds( 0 )
+		{ }
+
+		size_t high_bytes, low_bytes;
+		uint32 high_milliseconds, low_milliseconds;
+
+		bool enabled() const noexcept { return high_bytes != 0 || high_milliseconds != 0; }
+	};
+
+	struct throttle_counters
+	{
+		throttle_counters()
+			: throttle_count( 0 )
+			, throttled_milliseconds( 0 )
+		{ }
+
+		// Number of times throttling began, and the time spent throttled including a period still
+		// in progress
+		uint64 throttle_count;
+		uint64 throttled_milliseconds;
+	};
+
+} }
\ No newline at end of file
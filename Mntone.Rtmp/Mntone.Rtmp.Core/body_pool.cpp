@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "body_pool.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	const uint32 SIZE_CLASS_CAPACITY[body_pool::size_class_count] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+	const size_t SIZE_CLASS_RETAIN[body_pool::size_class_count] = { 64, 16, 2 };
+	const uint8 OVERSIZE_CLASS = 0xff;
+
+}
+
+void body_block::release() noexcept
+{
+	if( ref_count.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+	{
+		// Keep the pool alive until release returns
+		auto owner = std::move( pool );
+		owner->release( this );
+	}
+}
+
+void pooled_buffer::reset() noexcept
+{
+	if( block_ != nullptr )
+	{
+		block_->release();
+		block_ = nullptr;
+		size_ = 0;
+	}
+}
+
+body_pool::body_pool()
+	: allocation_count_( 0 )
+{
+	std::fill_n( free_lists_, size_class_count, nullptr );
+	std::fill_n( free_counts_, size_class_count, 0 );
+}
+
+body_pool::~body_pool()
+{
+	for( auto i = 0u; i < size_class_count; ++i )
+	{
+		auto block = free_lists_[i];
+		while( block != nullptr )
+		{
+			const auto next = block->next;
+			destroy( block );
+			block = next;
+		}
+	}
+}
+
+pooled_buffer body_pool::acquire( uint32 size )
+{
+	const auto size_class = class_of( size );
+
+	body_block* block = nullptr;
+	if( size_class != size_class_count )
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		block = free_lists_[size_class];
+		if( block != nullptr )
+		{
+			free_lists_[size_class] = block->next;
+			--free_counts_[size_class];
+			block->next = nullptr;
+		}
+	}
+
+	if( block == nullptr )
+	{
+		const auto capacity = size_class != size_class_count ? SIZE_CLASS_CAPACITY[size_class] : size;
+		auto memory = ::operator new( sizeof( body_block ) + capacity );
+		block = new( memory ) body_block( capacity, size_class != size_class_count ? size_class : OVERSIZE_CLASS );
+		allocation_count_.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	block->pool = shared_from_this();
+	block->ref_count.store( 1, std::memory_order_relaxed );
+	return pooled_buffer( block, size );
+}
+
+void body_pool::reserve( uint32 size, size_t count )
+{
+	const auto size_class = class_of( size );
+	if( size_class == size_class_count )
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( mutex_ );
+	count = std::min( count, SIZE_CLASS_RETAIN[size_class] );
+	while( free_counts_[size_class] < count )
+	{
+		const auto capacity = SIZE_CLASS_CAPACITY[size_class];
+		auto memory = ::operator new( sizeof( body_block ) + capacity );
+		auto block = new( memory ) body_block( capacity, size_class );
+		block->next = free_lists_[size_class];
+		free_lists_[size_class] = block;
+		++free_counts_[size_class];
+		allocation_count_.fetch_add( 1, std::memory_order_relaxed );
+	}
+}
+
+void body_pool::release( body_block* block ) noexcept
+{
+	if( block->size_class != OVERSIZE_CLASS )
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		if( free_counts_[block->size_class] < SIZE_CLASS_RETAIN[block->size_class] )
+		{
+			block->next = free_lists_[block->size_class];
+			free_lists_[block->size_class] = block;
+			++free_counts_[block->size_class];
+			return;
+		}
+	}
+	destroy( block );
+}
+
+uint8 body_pool::class_of( uint32 size ) noexcept
+{
+	uint8 size_class = 0;
+	while( size_class < size_class_count && size > SIZE_CLASS_CAPACITY[size_class] )
+	{
+		++size_class;
+	}
+	return size_class;
+}
+
+void body_pool::destroy( body_block* block ) noexcept
+{
+	block->~body_block();
+	::operator delete( block );
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace mntone { namespace rtmp {
+
+	class body_pool;
+
+	// Header of a pooled allocation. The body bytes follow the header in the same allocation.
+	struct body_block
+	{
+		body_block( uint32 capacity, uint8 size_class )
+			: capacity( capacity )
+			, size_class( size_class )
+			, ref_count( 0 )
+			, next( nullptr )
+		{ }
+
+		uint8* data() noexcept { return reinterpret_cast<uint8*>( this + 1 ); }
+
+		void add_ref() noexcept { ref_count.fetch_add( 1, std::memory_order_relaxed ); }
+
+		// Returns the block to its pool when the last reference goes away
+		void release() noexcept;
+
+		uint32 capacity;
+		uint8 size_class;
+		std::atomic<uint32> ref_count;
+
+		// Owner while handed out; cleared while the block sits in a free list
+		std::shared_ptr<body_pool> pool;
+		body_block* next;
+	};
+
+	// Move-only handle to uninitialized message body storage. The block returns to its pool when the handle dies.
+	class pooled_buffer final
+	{
+	public:
+		typedef uint8* iterator;
+		typedef const uint8* const_iterator;
+
+		pooled_buffer() noexcept
+			: block_( nullptr )
+			, size_( 0 )
+		{ }
+
+		pooled_buffer( body_block* block, uint32 size ) noexcept
+			: block_( block )
+			, size_( size )
+		{ }
+
+		pooled_buffer( const pooled_buffer& ) = delete;
+		pooled_buffer( pooled_buffer&& rhs ) noexcept
+			: block_( rhs.block_ )
+			, size_( rhs.size_ )
+		{
+			rhs.block_ = nullptr;
+			rhs.size_ = 0;
+		}
+
+		~pooled_buffer() { reset(); }
+
+		pooled_buffer& operator=( const pooled_buffer& ) = delete;
+		pooled_buffer& operator=( pooled_buffer&& rhs ) noexcept
+		{
+			if( this != &rhs )
+			{
+				reset();
+				block_ = rhs.block_;
+				size_ = rhs.size_;
+				rhs.block_ = nullptr;
+				rhs.size_ = 0;
+			}
+			return *this;
+		}
+
+		void reset() noexcept;
+
+		// Gives up ownership of the block (and its reference) without releasing it
+		body_block* detach() noexcept
+		{
+			const auto block = block_;
+			block_ = nullptr;
+			size_ = 0;
+			return block;
+		}
+
+		uint8* data() noexcept { return block_ != nullptr ? block_->data() : nullptr; }
+		const uint8* data() const noexcept { return block_ != nullptr ? block_->data() : nullptr; }
+		size_t size() const noexcept { return size_; }
+		bool empty() const noexcept { return size_ == 0; }
+
+		uint8& operator[]( size_t index ) noexcept { return data()[index]; }
+		const uint8& operator[]( size_t index ) const noexcept { return data()[index]; }
+
+		iterator begin() noexcept { return data(); }
+		iterator end() noexcept { return data() + size_; }
+		const_iterator begin() const noexcept { return data(); }
+		const_iterator end() const noexcept { return data() + size_; }
+		const_iterator cbegin() const noexcept { return data(); }
+		const_iterator cend() const noexcept { return data() + size_; }
+
+	private:
+		body_block* block_;
+		uint32 size_;
+	};
+
+	// Size-classed free lists for reassembled message bodies.
+	// small: control, command and audio messages / medium: inter frames / large: key frames.
+	// Bodies above the large class are allocated exactly and freed on release.
+	// Release is thread-safe, so bodies may be dropped on whichever thread consumes them.
+	class body_pool final
+		: public std::enable_shared_from_this<body_pool>
+	{
+	public:
+		static const size_t size_class_count = 3;
+
+		body_pool( const body_pool& ) = delete;
+		body_pool& operator=( const body_pool& ) = delete;
+
+		body_pool();
+		~body_pool();
+
+		pooled_buffer acquire( uint32 size );
+
+		// Allocates up front until the free list of size's class holds count blocks, or as many as
+		// the class retains. Oversized bodies are never pooled, so nothing is reserved for them.
+		void reserve( uint32 size, size_t count );
+
+		uint64 allocation_count() const noexcept { return allocation_count_.load( std::memory_order_relaxed ); }
+
+	private:
+		friend struct body_block;
+		void release( body_block* block ) noexcept;
+
+		// size_class_count for bodies above the large class
+		static uint8 class_of( uint32 size ) noexcept;
+		static void destroy( body_block* block ) noexcept;
+
+	private:
+		std::mutex mutex_;
+		body_block* free_lists_[size_class_count];
+		size_t free_counts_[size_class_count];
+
+		// acquire() allocates outside mutex_
+		std::atomic<uint64> allocation_count_;
+	};
+
+} }
\ No newline at end of file
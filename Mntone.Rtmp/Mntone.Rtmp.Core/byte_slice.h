@@ -0,0 +1,104 @@
+#pragma once
+#include "body_pool.h"
+
+namespace mntone { namespace rtmp {
+
+	// Immutable, reference-counted view (owner + offset + length) of a pooled body.
+	// Copies share the block, and slice() only adjusts the offset, so stripping a media prefix or
+	// splitting an aggregate message never touches the payload bytes.
+	class byte_slice final
+	{
+	public:
+		typedef const uint8* const_iterator;
+
+		byte_slice() noexcept
+			: block_( nullptr )
+			, offset_( 0 )
+			, length_( 0 )
+		{ }
+
+		explicit byte_slice( pooled_buffer&& buffer ) noexcept
+			: offset_( 0 )
+			, length_( static_cast<uint32>( buffer.size() ) )
+		{
+			block_ = buffer.detach();
+		}
+
+		byte_slice( const byte_slice& rhs ) noexcept
+			: block_( rhs.block_ )
+			, offset_( rhs.offset_ )
+			, length_( rhs.length_ )
+		{
+			if( block_ != nullptr )
+			{
+				block_->add_ref();
+			}
+		}
+
+		byte_slice( byte_slice&& rhs ) noexcept
+			: block_( rhs.block_ )
+			, offset_( rhs.offset_ )
+			, length_( rhs.length_ )
+		{
+			rhs.block_ = nullptr;
+			rhs.offset_ = 0;
+			rhs.length_ = 0;
+		}
+
+		~byte_slice() { reset(); }
+
+		byte_slice& operator=( byte_slice rhs ) noexcept
+		{
+			std::swap( block_, rhs.block_ );
+			std::swap( offset_, rhs.offset_ );
+			std::swap( length_, rhs.length_ );
+			return *this;
+		}
+
+		void reset() noexcept
+		{
+			if( block_ != nullptr )
+			{
+				block_->release();
+				block_ = nullptr;
+				offset_ = 0;
+				length_ = 0;
+			}
+		}
+
+		// Sub-range sharing the same block. Out of range requests are clamped to the end.
+		byte_slice slice( size_t offset, size_t length ) const noexcept
+		{
+			byte_slice ret( *this );
+			offset = std::min<size_t>( offset, length_ );
+			ret.offset_ += static_cast<uint32>( offset );
+			ret.length_ = static_cast<uint32>( std::min<size_t>( length, length_ - offset ) );
+			return ret;
+		}
+
+		byte_slice slice( size_t offset ) const noexcept { return slice( offset, length_ ); }
+
+		const uint8* data() const noexcept { return block_ != nullptr ? block_->data() + offset_ : nullptr; }
+		size_t size() const noexcept { return length_; }
+		bool empty() const noexcept { return length_ == 0; }
+
+		const uint8& operator[]( size_t index ) const noexcept { return data()[index]; }
+
+		// Writable bytes when this slice holds the only reference to its block, nullptr otherwise.
+		// Nobody else can see the block then, so rewriting it in place is safe.
+		uint8* unique_data() noexcept
+		{
+			return block_ != nullptr && block_->ref_count.load( std::memory_order_acquire ) == 1 ? block_->data() + offset_ : nullptr;
+		}
+
+		const_iterator begin() const noexcept { return data(); }
+		const_iterator end() const noexcept { return data() + length_; }
+		const_iterator cbegin() const noexcept { return data(); }
+		const_iterator cend() const noexcept { return data() + length_; }
+
+	private:
+		body_block* block_;
+		uint32 offset_, length_;
+	};
+
+} }
\ No newline at end of file
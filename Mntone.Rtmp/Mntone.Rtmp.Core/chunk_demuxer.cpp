@@ -0,0 +1,278 @@
+#include "pch.h"
+#include "chunk_demuxer.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	const uint32 DEFAULT_CHUNK_SIZE = 128;
+
+	// Basic header (up to 3 bytes) + message header (up to 11 bytes) + extended timestamp (4 bytes)
+	const size_t MAX_HEADER_LENGTH = 18;
+	const size_t MESSAGE_HEADER_LENGTH[4] = { 11, 7, 3, 0 };
+
+	inline uint32 read_uint24( const uint8* data ) noexcept
+	{
+		return static_cast<uint32>( data[0] ) << 16 | static_cast<uint32>( data[1] ) << 8 | data[2];
+	}
+
+	inline uint32 read_uint32( const uint8* data ) noexcept
+	{
+		return static_cast<uint32>( data[0] ) << 24 | read_uint24( data + 1 );
+	}
+
+	inline uint32 read_uint32_le( const uint8* data ) noexcept
+	{
+		return static_cast<uint32>( data[3] ) << 24 | static_cast<uint32>( data[2] ) << 16 | static_cast<uint32>( data[1] ) << 8 | data[0];
+	}
+
+	// Single writer: a plain load and store instead of a locked read-modify-write
+	inline void add_relaxed( std::atomic<uint64>& counter, uint64 value ) noexcept
+	{
+		counter.store( counter.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+	}
+
+}
+
+chunk_demuxer::chunk_demuxer()
+	: buffer_( 2 * receive_block_size )
+	, pool_( std::make_shared<body_pool>() )
+	, chunk_size_( DEFAULT_CHUNK_SIZE )
+	, current_packet_( nullptr )
+	, chunk_remaining_( 0 )
+	, reassembly_limit_( 0 )
+	, reassembly_bytes_( 0 )
+	, reassembly_limit_hits_( 0 )
+	, chunk_count_( 0 ), header_bytes_( 0 ), body_bytes_( 0 )
+{ }
+
+void chunk_demuxer::parse( const message_handler& handler )
+{
+	for( ;; )
+	{
+		if( current_packet_ == nullptr )
+		{
+			if( !parse_header() )
+			{
+				break;
+			}
+
+			// Empty message: nothing to reassemble
+			if( current_packet_ == nullptr )
+			{
+				continue;
+			}
+		}
+
+		auto& packet = *current_packet_;
+		const auto length = static_cast<uint32>( std::min<size_t>( chunk_remaining_, buffer_.size() ) );
+		if( !packet.body_.empty() )
+		{
+			buffer_.read( packet.body_.data() + packet.temporary_length_, length );
+		}
+		else
+		{
+			// Skipped over the reassembly limit
+			buffer_.consume( length );
+		}
+		packet.temporary_length_ += length;
+		chunk_remaining_ -= length;
+		add_relaxed( body_bytes_, length );
+
+		// Chunk body is cut by the end of the block
+		if( chunk_remaining_ != 0 )
+		{
+			break;
+		}
+
+		current_packet_ = nullptr;
+		if( packet.temporary_length_ == packet.header_.length )
+		{
+			packet.temporary_length_ = 0;
+			if( !packet.body_.empty() )
+			{
+				reassembly_bytes_ -= packet.body_.size();
+				handler( packet.header_, byte_slice( std::move( packet.body_ ) ) );
+			}
+		}
+	}
+}
+
+void chunk_demuxer::reset()
+{
+	buffer_.clear();
+	packets_.clear();
+	current_packet_ = nullptr;
+	chunk_remaining_ = 0;
+	reassembly_bytes_ = 0;
+	chunk_size_ = DEFAULT_CHUNK_SIZE;
+}
+
+void chunk_demuxer::abort( uint32 chunk_stream_id )
+{
+	// Called from the message handler, so no chunk body of this stream is half read
+	if( const auto packet = packets_.find( chunk_stream_id ) )
+	{
+		release_body( *packet );
+	}
+}
+
+chunk_statistics chunk_demuxer::statistics() const noexcept
+{
+	chunk_statistics statistics;
+	statistics.chunk_count = chunk_count_.load( std::memory_order_relaxed );
+	statistics.header_bytes = header_bytes_.load( std::memory_order_relaxed );
+	statistics.body_bytes = body_bytes_.load( std::memory_order_relaxed );
+	return statistics;
+}
+
+void chunk_demuxer::release_body( rtmp_packet& packet ) noexcept
+{
+	reassembly_bytes_ -= packet.body_.size();
+	packet.body_.reset();
+	packet.temporary_length_ = 0;
+}
+
+bool chunk_demuxer::parse_header()
+{
+	const auto available = buffer_.size();
+	if( available == 0 )
+	{
+		return false;
+	}
+
+	uint8 header[MAX_HEADER_LENGTH];
+	buffer_.peek( header, std::min( available, MAX_HEADER_LENGTH ) );
+
+	// ---[ Chunk basic header ]----------
+	const uint8 format_type = ( header[0] >> 6 ) & 0x03;
+	uint32 chunk_stream_id = header[0] & 0x3f;
+	size_t basic_length = 1;
+	if( chunk_stream_id == 0 )
+	{
+		basic_length = 2;
+		if( available < basic_length )
+		{
+			return false;
+		}
+		chunk_stream_id = header[1] + 64;
+	}
+	else if( chunk_stream_id == 1 )
+	{
+		basic_length = 3;
+		if( available < basic_length )
+		{
+			return false;
+		}
+		chunk_stream_id = ( static_cast<uint32>( header[2] ) << 8 | header[1] ) + 64;
+	}
+
+	const auto message_length = MESSAGE_HEADER_LENGTH[format_type];
+	if( available < basic_length + message_length )
+	{
+		return false;
+	}
+
+	// ---[ Get object ]----------
+	auto& packet = packets_[chunk_stream_id];
+	packet.header_.chunk_stream_id = chunk_stream_id;
+
+	// ---[ Extended timestamp ]----------
+	const auto field = header + basic_length;
+	uint32 timestamp_field = 0;
+	bool extended_timestamp;
+	if( format_type != 3 )
+	{
+		timestamp_field = read_uint24( field );
+		extended_timestamp = timestamp_field == 0xffffff;
+	}
+	else
+	{
+		// Type 3 chunks repeat the extended timestamp whenever the preceding header carried one
+		extended_timestamp = packet.extended_timestamp_;
+	}
+
+	const auto header_length = basic_length + message_length + ( extended_timestamp ? 4 : 0 );
+	if( available < header_length )
+	{
+		return false;
+	}
+
+	if( extended_timestamp )
+	{
+		timestamp_field = read_uint32( field + message_length );
+	}
+
+	// ---[ Chunk message header ]----------
+	auto& message_header = packet.header_;
+	const auto previous_length = message_header.length;
+	auto new_message = packet.temporary_length_ == 0;
+	switch( format_type )
+	{
+	case 0:
+		message_header.timestamp = timestamp_field;
+		message_header.length = read_uint24( field + 3 );
+		message_header.type_id = static_cast<type_id_type>( field[6] );
+		message_header.stream_id = read_uint32_le( field + 7 );
+		break;
+
+	case 1:
+		message_header.timestamp_delta = timestamp_field;
+		message_header.length = read_uint24( field + 3 );
+		message_header.type_id = static_cast<type_id_type>( field[6] );
+		break;
+
+	case 2:
+		message_header.timestamp_delta = timestamp_field;
+		break;
+
+	case 3:
+		if( new_message && extended_timestamp )
+		{
+			message_header.timestamp_delta = timestamp_field;
+		}
+		break;
+	}
+	if( format_type != 3 )
+	{
+		packet.extended_timestamp_ = extended_timestamp;
+	}
+	buffer_.consume( header_length );
+	add_relaxed( chunk_count_, 1 );
+	add_relaxed( header_bytes_, header_length );
+
+	// A new length cannot continue the partly reassembled message: its body was sized for the old one
+	if( !new_message && message_header.length != previous_length )
+	{
+		release_body( packet );
+		new_message = true;
+	}
+	if( new_message && format_type != 0 )
+	{
+		message_header.timestamp += message_header.timestamp_delta;
+	}
+
+	if( message_header.length == 0 )
+	{
+		current_packet_ = nullptr;
+		return true;
+	}
+
+	if( new_message )
+	{
+		const auto limit = reassembly_limit_.load( std::memory_order_relaxed );
+		if( limit == 0 || reassembly_bytes_ + message_header.length <= limit )
+		{
+			packet.body_ = pool_->acquire( message_header.length );
+			reassembly_bytes_ += message_header.length;
+		}
+		else
+		{
+			packet.body_.reset();
+			reassembly_limit_hits_.fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+	chunk_remaining_ = std::min( chunk_size_, message_header.length - packet.temporary_length_ );
+	current_packet_ = &packet;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+#include <functional>
+#include "ring_buffer.h"
+#include "rtmp_packet.h"
+#include "byte_slice.h"
+#include "chunk_stream_table.h"
+#include "chunk_statistics.h"
+
+namespace mntone { namespace rtmp {
+
+	// Incremental chunk stream parser.
+	// The transport fills buffer() with whatever block the socket delivered, then parse() decodes
+	// every complete chunk header and copies body bytes into the reassembled messages. It stops only
+	// when a chunk header is cut by the end of the block, and resumes from there on the next call.
+	class chunk_demuxer final
+	{
+	public:
+		typedef std::function<void( rtmp_header, byte_slice )> message_handler;
+
+		chunk_demuxer( const chunk_demuxer& ) = delete;
+		chunk_demuxer& operator=( const chunk_demuxer& ) = delete;
+
+		chunk_demuxer();
+
+		// Messages are dispatched synchronously, so a set chunk size message handled by the callback
+		// applies to the very next chunk of the same pass.
+		void parse( const message_handler& handler );
+
+		ring_buffer& buffer() noexcept { return buffer_; }
+		body_pool& pool() noexcept { return *pool_; }
+
+		uint32 chunk_size() const noexcept { return chunk_size_; }
+		void set_chunk_size( uint32 value ) noexcept { chunk_size_ = value; }
+
+		// Drops unread bytes, every partially reassembled message and the chunk size, for a new
+		// connection. The reassembly limit and the statistics are kept.
+		void reset();
+
+		// Drops the partially reassembled message of a chunk stream (Abort Message).
+		// Call between chunks, i.e. from the message handler.
+		void abort( uint32 chunk_stream_id );
+
+		// Cap on body bytes held for messages still being reassembled, across all chunk streams.
+		// A message that would exceed it is skipped on the wire and counted. 0 means no cap.
+		void set_reassembly_limit( size_t bytes ) noexcept { reassembly_limit_.store( bytes, std::memory_order_relaxed ); }
+		size_t reassembly_bytes() const noexcept { return reassembly_bytes_; }
+		uint64 reassembly_limit_hits() const noexcept { return reassembly_limit_hits_.load( std::memory_order_relaxed ); }
+
+		// Chunks parsed so far and their header and body bytes. Thread-safe.
+		chunk_statistics statistics() const noexcept;
+
+	private:
+		bool parse_header();
+		void release_body( rtmp_packet& packet ) noexcept;
+
+	public:
+		static const size_t receive_block_size = 64 * 1024;
+
+	private:
+		ring_buffer buffer_;
+		std::shared_ptr<body_pool> pool_;
+		uint32 chunk_size_;
+		chunk_stream_table<rtmp_packet> packets_;
+
+		// Packet whose chunk body is being read, or nullptr while waiting for the next chunk header
+		rtmp_packet* current_packet_;
+		uint32 chunk_remaining_;
+
+		std::atomic<size_t> reassembly_limit_;
+		size_t reassembly_bytes_;
+		std::atomic<uint64> reassembly_limit_hits_;
+
+		// Written by parse() only; atomic so statistics() may read them from any thread
+		std::atomic<uint64> chunk_count_, header_bytes_, body_bytes_;
+	};
+
+} }
\ No newline at end of file
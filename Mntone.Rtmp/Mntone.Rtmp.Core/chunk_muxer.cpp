@@ -0,0 +1,271 @@
+#include "pch.h"
+#include "chunk_muxer.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	const uint32 DEFAULT_CHUNK_SIZE = 128;
+	const uint32 EXTENDED_TIMESTAMP = 0xffffff;
+
+	inline void write_uint24( uint32 value, uint8* out ) noexcept
+	{
+		out[0] = static_cast<uint8>( value >> 16 );
+		out[1] = static_cast<uint8>( value >> 8 );
+		out[2] = static_cast<uint8>( value );
+	}
+
+	inline void write_uint32( uint32 value, uint8* out ) noexcept
+	{
+		out[0] = static_cast<uint8>( value >> 24 );
+		write_uint24( value, out + 1 );
+	}
+
+	inline void write_uint32_le( uint32 value, uint8* out ) noexcept
+	{
+		out[0] = static_cast<uint8>( value );
+		out[1] = static_cast<uint8>( value >> 8 );
+		out[2] = static_cast<uint8>( value >> 16 );
+		out[3] = static_cast<uint8>( value >> 24 );
+	}
+
+	// One chunk header layout per instantiation, so the branches below fold away and encoding is a
+	// handful of stores. timestamp_field is the timestamp (fmt 0) or the delta (fmt 1-3).
+	template<uint8 FormatType, size_t BasicHeaderLength, bool ExtendedTimestamp>
+	uint8* encode_header( uint8* out, const rtmp_header& header, uint32 timestamp_field ) noexcept
+	{
+		// ---[ Basic header ]----------
+		const auto chunk_stream_id = header.chunk_stream_id;
+		if( BasicHeaderLength == 1 )
+		{
+			out[0] = static_cast<uint8>( FormatType << 6 | chunk_stream_id );
+		}
+		else if( BasicHeaderLength == 2 )
+		{
+			out[0] = static_cast<uint8>( FormatType << 6 );
+			out[1] = static_cast<uint8>( chunk_stream_id - 64 );
+		}
+		else
+		{
+			// 3-byte form carries ( id - 64 ) in little endian
+			out[0] = static_cast<uint8>( FormatType << 6 | 1 );
+			out[1] = static_cast<uint8>( chunk_stream_id - 64 );
+			out[2] = static_cast<uint8>( ( chunk_stream_id - 64 ) >> 8 );
+		}
+		out += BasicHeaderLength;
+
+		// ---[ Message header ]----------
+		if( FormatType <= 2 )
+		{
+			write_uint24( ExtendedTimestamp ? EXTENDED_TIMESTAMP : timestamp_field, out );
+			out += 3;
+		}
+		if( FormatType <= 1 )
+		{
+			write_uint24( header.length, out );
+			out[3] = static_cast<uint8>( header.type_id );
+			out += 4;
+		}
+		if( FormatType == 0 )
+		{
+			write_uint32_le( header.stream_id, out );
+			out += 4;
+		}
+
+		// Type 3 chunks repeat the extended timestamp of the header they continue
+		if( ExtendedTimestamp )
+		{
+			write_uint32( timestamp_field, out );
+			out += 4;
+		}
+		return out;
+	}
+
+	typedef uint8* ( *header_encoder )( uint8* out, const rtmp_header& header, uint32 timestamp_field );
+
+	// [format type][basic header length - 1][extended timestamp]
+	const header_encoder HEADER_ENCODERS[4][3][2] =
+	{
+		{
+			{ &encode_header<0, 1, false>, &encode_header<0, 1, true> },
+			{ &encode_header<0, 2, false>, &encode_header<0, 2, true> },
+			{ &encode_header<0, 3, false>, &encode_header<0, 3, true> },
+		},
+		{
+			{ &encode_header<1, 1, false>, &encode_header<1, 1, true> },
+			{ &encode_header<1, 2, false>, &encode_header<1, 2, true> },
+			{ &encode_header<1, 3, false>, &encode_header<1, 3, true> },
+		},
+		{
+			{ &encode_header<2, 1, false>, &encode_header<2, 1, true> },
+			{ &encode_header<2, 2, false>, &encode_header<2, 2, true> },
+			{ &encode_header<2, 3, false>, &encode_header<2, 3, true> },
+		},
+		{
+			{ &encode_header<3, 1, false>, &encode_header<3, 1, true> },
+			{ &encode_header<3, 2, false>, &encode_header<3, 2, true> },
+			{ &encode_header<3, 3, false>, &encode_header<3, 3, true> },
+		},
+	};
+
+	inline size_t basic_header_index( uint32 chunk_stream_id ) noexcept
+	{
+		return chunk_stream_id < 64 ? 0 : chunk_stream_id < 320 ? 1 : 2;
+	}
+
+	// Writes chunk headers in place at the end of a contiguous buffer
+	class vector_header_sink final
+	{
+	public:
+		explicit vector_header_sink( std::vector<uint8>& out )
+			: out_( out )
+			, offset_( 0 )
+		{ }
+
+		uint8* prepare( size_t max_length )
+		{
+			offset_ = out_.size();
+			out_.resize( offset_ + max_length );
+			return out_.data() + offset_;
+		}
+
+		void commit( size_t length ) { out_.resize( offset_ + length ); }
+
+	private:
+		std::vector<uint8>& out_;
+		size_t offset_;
+	};
+
+}
+
+chunk_muxer::chunk_muxer()
+	: chunk_size_( DEFAULT_CHUNK_SIZE )
+{ }
+
+void chunk_muxer::reset()
+{
+	chunk_size_ = DEFAULT_CHUNK_SIZE;
+	states_.clear();
+}
+
+chunk_layout chunk_muxer::write( rtmp_header header, const uint8* data, size_t length, std::vector<uint8>& out )
+{
+	out.reserve( out.size() + ( length / chunk_size_ + 1 ) * max_header_length + length );
+	vector_header_sink headers( out );
+	return encode( std::move( header ), length, headers,
+		[&out, data]( size_t offset, size_t body_length ) { out.insert( out.end(), data + offset, data + offset + body_length ); } );
+}
+
+chunk_layout chunk_muxer::write( rtmp_header header, const uint8* data, size_t length, gather_buffer& out )
+{
+	return encode( std::move( header ), length, out,
+		[&out, data]( size_t offset, size_t body_length ) { out.append( data + offset, body_length ); } );
+}
+
+chunk_layout chunk_muxer::write( rtmp_header header, byte_slice payload, gather_buffer& out )
+{
+	return write( std::move( header ), nullptr, 0, std::move( payload ), out );
+}
+
+chunk_layout chunk_muxer::write( rtmp_header header, const uint8* prefix, size_t prefix_length, byte_slice payload, gather_buffer& out )
+{
+	const auto length = prefix_length + payload.size();
+	const auto index = out.add_payload( std::move( payload ) );
+	return encode( std::move( header ), length, out,
+		[&out, prefix, prefix_length, index]( size_t offset, size_t body_length )
+		{
+			// The prefix lands in the owned segment right after the first chunk header
+			if( offset < prefix_length )
+			{
+				const auto piece = std::min( body_length, prefix_length - offset );
+				out.append( prefix + offset, piece );
+				offset += piece;
+				body_length -= piece;
+			}
+			out.append_payload( index, offset - prefix_length, body_length );
+		} );
+}
+
+template<typename HeaderSink, typename BodySink>
+chunk_layout chunk_muxer::encode( rtmp_header header, size_t length, HeaderSink& headers, const BodySink& write_body )
+{
+	if( header.chunk_stream_id < 2 || header.chunk_stream_id > decltype( states_ )::max_id )
+	{
+		throw std::invalid_argument( "chunk_stream_id" );
+	}
+	header.length = static_cast<uint32>( length );
+
+	auto& state = states_[header.chunk_stream_id];
+	const auto format_type = select_format_type( header, state );
+
+	const auto timestamp_field = static_cast<uint32>( format_type == 0 ? header.timestamp : header.timestamp_delta );
+	const auto& encoders = HEADER_ENCODERS[format_type][basic_header_index( header.chunk_stream_id )];
+	const auto extended_timestamp = timestamp_field >= EXTENDED_TIMESTAMP ? 1 : 0;
+
+	// ---[ First chunk header ]----------
+	auto begin = headers.prepare( max_header_length );
+	const auto first_header_length = static_cast<size_t>( encoders[extended_timestamp]( begin, header, timestamp_field ) - begin );
+	headers.commit( first_header_length );
+
+	// The type 3 header is the same for every continuation chunk
+	uint8 continuation[max_header_length];
+	const auto continuation_length = static_cast<size_t>( HEADER_ENCODERS[3][basic_header_index( header.chunk_stream_id )][extended_timestamp]( continuation, header, timestamp_field ) - continuation );
+
+	chunk_layout layout;
+	layout.first_header_length = static_cast<uint32>( first_header_length );
+	layout.continuation_header_length = static_cast<uint32>( continuation_length );
+	layout.chunk_size = chunk_size_;
+	layout.body_length = length;
+
+	// ---[ Body, continued by type 3 chunks ]----------
+	size_t written = 0;
+	for( ;; )
+	{
+		const auto body_length = std::min<size_t>( chunk_size_, length - written );
+		if( body_length != 0 )
+		{
+			write_body( written, body_length );
+		}
+		written += body_length;
+		if( written == length )
+		{
+			break;
+		}
+
+		std::memcpy( headers.prepare( continuation_length ), continuation, continuation_length );
+		headers.commit( continuation_length );
+	}
+
+	state.header = header;
+	state.format_type = format_type;
+	state.used = true;
+	return layout;
+}
+
+uint8 chunk_muxer::select_format_type( rtmp_header& header, const chunk_stream_state& before ) const noexcept
+{
+	header.timestamp_delta = 0;
+	if( !before.used )
+	{
+		return 0;
+	}
+
+	const auto& before_header = before.header;
+	if( header.stream_id != before_header.stream_id || header.timestamp < before_header.timestamp )
+	{
+		return 0;
+	}
+
+	header.timestamp_delta = header.timestamp - before_header.timestamp;
+	if( header.length != before_header.length || header.type_id != before_header.type_id )
+	{
+		return 1;
+	}
+
+	// A type 3 header for a new message repeats the delta, which only type 1 and 2 headers establish
+	if( before.format_type != 0 && header.timestamp_delta == before_header.timestamp_delta )
+	{
+		return 3;
+	}
+	return 2;
+}
\ No newline at end of file
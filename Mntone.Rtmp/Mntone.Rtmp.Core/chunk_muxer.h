@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include "rtmp_header.h"
+#include "chunk_stream_table.h"
+#include "gather_buffer.h"
+
+namespace mntone { namespace rtmp {
+
+	// Where the chunks of a written message begin, so a sender can interleave other chunk streams
+	// between them without ever cutting a chunk in two
+	struct chunk_layout
+	{
+		uint32 first_header_length, continuation_header_length;
+		uint32 chunk_size;
+		size_t body_length;
+
+		size_t chunk_count() const noexcept { return body_length == 0 ? 1 : ( body_length + chunk_size - 1 ) / chunk_size; }
+		size_t wire_length() const noexcept { return first_header_length + ( chunk_count() - 1 ) * continuation_header_length + body_length; }
+	};
+
+	// Outbound chunk stream encoder.
+	// Picks the smallest message header the previous message on the same chunk stream allows and
+	// splits the body into chunk_size() pieces, each continued by a type 3 header.
+	class chunk_muxer final
+	{
+	public:
+		chunk_muxer( const chunk_muxer& ) = delete;
+		chunk_muxer& operator=( const chunk_muxer& ) = delete;
+
+		chunk_muxer();
+
+		// Appends the whole chunked message to out
+		chunk_layout write( rtmp_header header, const uint8* data, size_t length, std::vector<uint8>& out );
+		chunk_layout write( rtmp_header header, const uint8* data, size_t length, gather_buffer& out );
+
+		// Appends the chunk headers interleaved with ranges of payload, which is referenced, not copied
+		chunk_layout write( rtmp_header header, byte_slice payload, gather_buffer& out );
+		// Same, with prefix_length bytes copied ahead of the payload as the start of the body
+		chunk_layout write( rtmp_header header, const uint8* prefix, size_t prefix_length, byte_slice payload, gather_buffer& out );
+
+		uint32 chunk_size() const noexcept { return chunk_size_; }
+		void set_chunk_size( uint32 value ) noexcept { chunk_size_ = value; }
+
+		// Forgets every previous header and the chunk size, for a new connection
+		void reset();
+
+	private:
+		struct chunk_stream_state
+		{
+			chunk_stream_state()
+				: header( 0 )
+				, format_type( 0 )
+				, used( false )
+			{ }
+
+			rtmp_header header;
+			uint8 format_type;
+			bool used;
+		};
+
+		// Encodes chunk headers in place through headers.prepare( max_length ) / headers.commit( length )
+		// and calls write_body( offset, length ) between them, in wire order
+		template<typename HeaderSink, typename BodySink>
+		chunk_layout encode( rtmp_header header, size_t length, HeaderSink& headers, const BodySink& write_body );
+		uint8 select_format_type( rtmp_header& header, const chunk_stream_state& before ) const noexcept;
+
+	public:
+		// Basic header (up to 3 bytes) + message header (up to 11 bytes) + extended timestamp (4 bytes)
+		static const size_t max_header_length = 18;
+
+	private:
+		uint32 chunk_size_;
+		chunk_stream_table<chunk_stream_state> states_;
+	};
+
+} }
\ No newline at end of file
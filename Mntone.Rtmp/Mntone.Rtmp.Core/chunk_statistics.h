@@ -0,0 +1,25 @@
+#pragma once
+
+namespace mntone { namespace rtmp {
+
+	// One direction of a chunk stream, split into chunk headers and message bodies
+	struct chunk_statistics
+	{
+		chunk_statistics()
+			: chunk_count( 0 )
+			, header_bytes( 0 )
+			, body_bytes( 0 )
+		{ }
+
+		uint64 chunk_count;
+		uint64 header_bytes, body_bytes;
+
+		// Share of the chunk stream spent on basic, message and extended timestamp headers
+		float64 header_overhead() const noexcept
+		{
+			const auto total = header_bytes + body_bytes;
+			return total != 0 ? static_cast<float64>( header_bytes ) / total : 0.0;
+		}
+	};
+
+} }
\ No newline at end of file
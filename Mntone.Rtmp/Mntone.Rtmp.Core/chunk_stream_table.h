@@ -0,0 +1,155 @@
+#pragma once
+#include <memory>
+
+namespace mntone { namespace rtmp {
+
+	// Per-chunk-stream state indexed by chunk stream id, without hashing on the common path.
+	// Ids below 64 (the one-byte basic header form every stream of a typical session uses) index an
+	// inline array; ids 64-65599 go to an open-addressed overflow table with linear probing.
+	// T must be default constructible and movable. References into the overflow table are
+	// invalidated when a new overflow id is inserted.
+	template<typename T>
+	class chunk_stream_table final
+	{
+	public:
+		static const uint32 direct_id_count = 64;
+		static const uint32 max_id = 65599;
+
+		chunk_stream_table( const chunk_stream_table& ) = delete;
+		chunk_stream_table& operator=( const chunk_stream_table& ) = delete;
+
+		chunk_stream_table()
+			: direct_()
+			, overflow_mask_( 0 )
+			, overflow_count_( 0 )
+		{ }
+
+		// Returns the state of chunk_stream_id, default-constructing it on first use
+		T& operator[]( uint32 chunk_stream_id )
+		{
+			if( chunk_stream_id < direct_id_count )
+			{
+				return direct_[chunk_stream_id];
+			}
+
+			// Grow at half load so probe sequences stay short
+			if( 2 * ( overflow_count_ + 1 ) > overflow_mask_ + 1 )
+			{
+				if( const auto slot = find_overflow( chunk_stream_id ) )
+				{
+					return slot->value;
+				}
+				rehash( overflow_mask_ != 0 ? 2 * ( overflow_mask_ + 1 ) : 8 );
+			}
+
+			auto index = chunk_stream_id & overflow_mask_;
+			for( ;; )
+			{
+				auto& slot = overflow_[index];
+				if( slot.id == chunk_stream_id )
+				{
+					return slot.value;
+				}
+				if( slot.id == 0 )
+				{
+					slot.id = chunk_stream_id;
+					++overflow_count_;
+					return slot.value;
+				}
+				index = ( index + 1 ) & overflow_mask_;
+			}
+		}
+
+		// Back to default-constructed state for every id, as a new table
+		void clear()
+		{
+			for( auto& value : direct_ )
+			{
+				value = T();
+			}
+			overflow_.reset();
+			overflow_mask_ = overflow_count_ = 0;
+		}
+
+		// Returns nullptr for an overflow id that has never been used
+		T* find( uint32 chunk_stream_id ) noexcept
+		{
+			if( chunk_stream_id < direct_id_count )
+			{
+				return &direct_[chunk_stream_id];
+			}
+
+			const auto slot = find_overflow( chunk_stream_id );
+			return slot != nullptr ? &slot->value : nullptr;
+		}
+
+	private:
+		struct slot
+		{
+			slot()
+				: id( 0 )
+				, value()
+			{ }
+
+			// 0 marks an empty slot; overflow ids are at least 64
+			uint32 id;
+			T value;
+		};
+
+		slot* find_overflow( uint32 chunk_stream_id ) noexcept
+		{
+			if( overflow_count_ == 0 )
+			{
+				return nullptr;
+			}
+
+			auto index = chunk_stream_id & overflow_mask_;
+			for( ;; )
+			{
+				auto& slot = overflow_[index];
+				if( slot.id == chunk_stream_id )
+				{
+					return &slot;
+				}
+				if( slot.id == 0 )
+				{
+					return nullptr;
+				}
+				index = ( index + 1 ) & overflow_mask_;
+			}
+		}
+
+		void rehash( uint32 capacity )
+		{
+			std::unique_ptr<slot[]> slots( new slot[capacity] );
+			const auto mask = capacity - 1;
+			if( overflow_ != nullptr )
+			{
+				for( auto i = 0u; i <= overflow_mask_; ++i )
+				{
+					auto& from = overflow_[i];
+					if( from.id == 0 )
+					{
+						continue;
+					}
+
+					auto index = from.id & mask;
+					while( slots[index].id != 0 )
+					{
+						index = ( index + 1 ) & mask;
+					}
+					slots[index].id = from.id;
+					slots[index].value = std::move( from.value );
+				}
+			}
+			overflow_ = std::move( slots );
+			overflow_mask_ = mask;
+		}
+
+	private:
+		T direct_[direct_id_count];
+		std::unique_ptr<slot[]> overflow_;
+		uint32 overflow_mask_, overflow_count_;
+	};
+
+} }
\ No newline at end of file
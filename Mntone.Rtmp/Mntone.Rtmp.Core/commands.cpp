@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "commands.h"
+#include "amf0_writer.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	const uint32 SUPPORT_SOUND_MP3 = 0x0004;
+	const uint32 SUPPORT_SOUND_AAC = 0x0400;
+	const uint32 SUPPORT_VIDEO_SORENSON = 0x04;
+	const uint32 SUPPORT_VIDEO_H264 = 0x80;
+	const uint32 SUPPORT_VIDEO_FUNCTION_SEEK = 0x1;
+
+	void patch_number( std::vector<uint8>& body, size_t offset, float64 value )
+	{
+		utility::convert_big_endian( &value, 8, &body[offset] );
+	}
+
+	// Command name, transaction id and a null command object; room for the arguments is reserved
+	amf0::writer begin_command( std::vector<uint8>& out, const char* name, float64 transaction_id, size_t arguments_length )
+	{
+		out.reserve( 3 + std::strlen( name ) + 9 + 1 + arguments_length );
+		amf0::writer writer( out );
+		writer.command( name, transaction_id ).null();
+		return writer;
+	}
+
+}
+
+commands::connect_parameters::connect_parameters( std::string app, std::string tc_url )
+	: app( std::move( app ) )
+	, flash_version( "WIN 9,0,262,0" )
+	, swf_url( "http://localhost/dummy.swf" )
+	, tc_url( std::move( tc_url ) )
+	, fpad( false )
+	, audio_codecs( SUPPORT_SOUND_MP3 | SUPPORT_SOUND_AAC )
+	, video_codecs( SUPPORT_VIDEO_SORENSON | SUPPORT_VIDEO_H264 )
+	, video_function( SUPPORT_VIDEO_FUNCTION_SEEK )
+	, page_url( "http://localhost/dummy.html" )
+	, encoding( object_encoding::amf0 )
+{ }
+
+std::vector<uint8> commands::connect( const connect_parameters& parameters )
+{
+	std::vector<uint8> out;
+	out.reserve( 256 + parameters.app.size() + parameters.tc_url.size() + parameters.arguments.size() );
+
+	amf0::writer writer( out );
+	writer.command( "connect", 1.0 );	// Transaction id: always set to 1.
+	writer.begin_object()
+		.property( "app" ).string( parameters.app )
+		.property( "flashVer" ).string( parameters.flash_version )
+		.property( "swfUrl" ).string( parameters.swf_url )
+		.property( "tcUrl" ).string( parameters.tc_url )
+		.property( "fpad" ).boolean( parameters.fpad )
+		.property( "audioCodecs" ).number( static_cast<float64>( parameters.audio_codecs ) )
+		.property( "videoCodecs" ).number( static_cast<float64>( parameters.video_codecs ) )
+		.property( "videoFunction" ).number( static_cast<float64>( parameters.video_function ) )
+		.property( "pageUrl" ).string( parameters.page_url )
+		.property( "objectEncoding" ).number( static_cast<float64>( parameters.encoding ) )
+		.end_object();
+
+	if( !parameters.arguments.empty() )
+	{
+		writer.raw( parameters.arguments.data(), parameters.arguments.size() );
+	}
+	else
+	{
+		writer.null();
+	}
+	return out;
+}
+
+std::vector<uint8> commands::publish( const std::string& stream_name, const std::string& type )
+{
+	std::vector<uint8> out;
+	begin_command( out, "publish", 0.0, 3 + stream_name.size() + 3 + type.size() ).string( stream_name ).string( type );
+	return out;
+}
+
+std::vector<uint8> commands::set_data_frame( const amf_value& metadata )
+{
+	std::vector<uint8> out;
+	amf0::writer( out ).string( "@setDataFrame" ).string( "onMetaData" ).value( metadata );
+	return out;
+}
+
+#pragma region Command templates
+
+commands::command_templates::command_templates()
+{
+	// createStream: the transaction id is patched
+	begin_command( create_stream_.body, "createStream", 0.0, 0 );
+	create_stream_.slot = create_stream_.body.size() - 1 - 8;
+
+	// closeStream: the stream id argument is patched
+	{
+		auto writer = begin_command( close_stream_.body, "closeStream", 0.0, 9 );
+		close_stream_.slot = close_stream_.body.size() + 1;
+		writer.number( 0.0 );
+	}
+
+	// play: only the fixed head; the stream name and numbers are appended
+	begin_command( play_.body, "play", 0.0, 0 );
+	play_.slot = play_.body.size();
+
+	// pause: the flag, then the position one boolean further on
+	{
+		auto writer = begin_command( pause_.body, "pause", 0.0, 2 + 9 );
+		pause_.slot = pause_.body.size() + 1;
+		writer.boolean( false ).number( 0.0 );
+	}
+
+	// seek: the offset is patched
+	{
+		auto writer = begin_command( seek_.body, "seek", 0.0, 9 );
+		seek_.slot = seek_.body.size() + 1;
+		writer.number( 0.0 );
+	}
+}
+
+std::vector<uint8> commands::command_templates::create_stream( uint32 transaction_id ) const
+{
+	auto out = create_stream_.body;
+	patch_number( out, create_stream_.slot, static_cast<float64>( transaction_id ) );
+	return out;
+}
+
+std::vector<uint8> commands::command_templates::close_stream( uint32 stream_id ) const
+{
+	auto out = close_stream_.body;
+	patch_number( out, close_stream_.slot, static_cast<float64>( stream_id ) );
+	return out;
+}
+
+std::vector<uint8> commands::command_templates::play( const std::string& stream_name, float64 start, float64 duration, int16 reset ) const
+{
+	std::vector<uint8> out;
+	out.reserve( play_.body.size() + 5 + stream_name.size() + 3 * 9 );
+	out.assign( play_.body.cbegin(), play_.body.cend() );
+
+	amf0::writer writer( out );
+	writer.string( stream_name );
+	if( start != -2.0 )
+	{
+		writer.number( start );
+		if( duration != -1.0 )
+		{
+			writer.number( duration );
+			if( reset != -1 )
+			{
+				writer.number( static_cast<float64>( reset ) );
+			}
+		}
+	}
+	return out;
+}
+
+std::vector<uint8> commands::command_templates::pause( bool pause, float64 position ) const
+{
+	auto out = pause_.body;
+	out[pause_.slot] = pause ? 1 : 0;
+	patch_number( out, pause_.slot + 2, position );
+	return out;
+}
+
+std::vector<uint8> commands::command_templates::seek( float64 offset ) const
+{
+	auto out = seek_.body;
+	patch_number( out, seek_.slot, offset );
+	return out;
+}
+
+#pragma endregion
\ No newline at end of file
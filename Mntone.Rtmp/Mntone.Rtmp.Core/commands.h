@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "amf_value.h"
+#include "object_encoding.h"
+
+namespace mntone { namespace rtmp { namespace commands {
+
+	// AMF0 bodies of the client commands, ready for net_connection::send_command.
+	// Each is written straight into its body with amf0::writer, sized up front.
+
+	struct connect_parameters
+	{
+		connect_parameters( std::string app, std::string tc_url );
+
+		std::string app;
+		std::string flash_version;
+		std::string swf_url;
+		std::string tc_url;
+		bool fpad;
+		uint32 audio_codecs;
+		uint32 video_codecs;
+		uint32 video_function;
+		std::string page_url;
+
+		// amf3 asks the server for AMF3; net_connection::object_encoding tells what it agreed to
+		object_encoding encoding;
+
+		// Optional user arguments, already in AMF0, sent after the command object; empty sends null
+		std::vector<uint8> arguments;
+	};
+
+	std::vector<uint8> connect( const connect_parameters& parameters );
+
+	// type: "live", "record" or "append"
+	std::vector<uint8> publish( const std::string& stream_name, const std::string& type = "live" );
+
+	// Data message body storing metadata on the server for later subscribers (@setDataFrame onMetaData)
+	std::vector<uint8> set_data_frame( const amf_value& metadata );
+
+	// The hot control commands, serialized once per connection. Rendering copies the template and
+	// patches the transaction id, stream id, flag or offset in place; play appends its stream name
+	// and optional numbers. Immutable after construction, so any thread may render.
+	class command_templates final
+	{
+	public:
+		command_templates();
+
+		std::vector<uint8> create_stream( uint32 transaction_id ) const;
+		std::vector<uint8> close_stream( uint32 stream_id ) const;
+
+		// start: -2 live or recorded, -1 live only, >= 0 recorded from the position (seconds)
+		std::vector<uint8> play( const std::string& stream_name, float64 start = -2.0, float64 duration = -1.0, int16 reset = -1 ) const;
+		std::vector<uint8> pause( bool pause, float64 position ) const;
+		std::vector<uint8> seek( float64 offset ) const;
+
+	private:
+		struct body_template
+		{
+			std::vector<uint8> body;
+
+			// Offset of the first patched value, just past its type marker
+			size_t slot;
+		};
+
+		body_template create_stream_, close_stream_, play_, pause_, seek_;
+	};
+
+} } }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "pch.h"
+#include "epoll_loop.h"
+#include <system_error>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	const int MAX_EVENTS = 256;
+
+	// Token of the wake eventfd; registrations start after it
+	const uint64 WAKE_TOKEN = 0;
+
+}
+
+epoll_loop::epoll_loop()
+	: epoll_fd_( epoll_create1( EPOLL_CLOEXEC ) )
+	, wake_fd_( eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) )
+	, thread_id_( std::this_thread::get_id() )
+	, stopped_( false )
+	, next_token_( WAKE_TOKEN + 1 )
+{
+	if( epoll_fd_ < 0 || wake_fd_ < 0 )
+	{
+		throw std::system_error( errno, std::system_category(), "epoll_loop" );
+	}
+
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.u64 = WAKE_TOKEN;
+	epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev );
+}
+
+epoll_loop::~epoll_loop()
+{
+	for( auto& registration : registrations_ )
+	{
+		::close( registration.second.fd );
+	}
+	::close( wake_fd_ );
+	::close( epoll_fd_ );
+}
+
+void epoll_loop::run()
+{
+	thread_id_ = std::this_thread::get_id();
+
+	epoll_event events[MAX_EVENTS];
+	for( ;; )
+	{
+		run_posted_tasks();
+		{
+			std::lock_guard<std::mutex> lock( task_mutex_ );
+			if( stopped_ )
+			{
+				break;
+			}
+		}
+
+		const auto count = epoll_wait( epoll_fd_, events, MAX_EVENTS, -1 );
+		if( count < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			throw std::system_error( errno, std::system_category(), "epoll_wait" );
+		}
+
+		for( auto i = 0; i < count; ++i )
+		{
+			const auto token = events[i].data.u64;
+			if( token == WAKE_TOKEN )
+			{
+				uint64 value;
+				while( ::read( wake_fd_, &value, sizeof( value ) ) > 0 );
+				continue;
+			}
+
+			const auto itr = registrations_.find( token );
+			if( itr != registrations_.end() )
+			{
+				// The handler may remove its own registration
+				const auto handler = itr->second.handler;
+				handler( events[i].events );
+			}
+		}
+	}
+}
+
+void epoll_loop::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock( task_mutex_ );
+		stopped_ = true;
+	}
+	const uint64 value = 1;
+	::write( wake_fd_, &value, sizeof( value ) );
+}
+
+void epoll_loop::post( task task )
+{
+	{
+		std::lock_guard<std::mutex> lock( task_mutex_ );
+		tasks_.push_back( std::move( task ) );
+	}
+	const uint64 value = 1;
+	::write( wake_fd_, &value, sizeof( value ) );
+}
+
+void epoll_loop::run_posted_tasks()
+{
+	std::vector<task> tasks;
+	{
+		std::lock_guard<std::mutex> lock( task_mutex_ );
+		tasks.swap( tasks_ );
+	}
+
+	for( auto& task : tasks )
+	{
+		task();
+	}
+}
+
+uint64 epoll_loop::add( int fd, uint32 events, event_handler handler )
+{
+	const auto token = next_token_++;
+
+	epoll_event ev = {};
+	ev.events = events;
+	ev.data.u64 = token;
+	if( epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, fd, &ev ) != 0 )
+	{
+		throw std::system_error( errno, std::system_category(), "epoll_ctl" );
+	}
+
+	registrations_.emplace( token, registration{ fd, std::move( handler ) } );
+	return token;
+}
+
+void epoll_loop::remove( uint64 token )
+{
+	const auto itr = registrations_.find( token );
+	if( itr == registrations_.end() )
+	{
+		return;
+	}
+
+	epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, itr->second.fd, nullptr );
+	::close( itr->second.fd );
+	registrations_.erase( itr );
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mntone { namespace rtmp {
+
+	// Edge-triggered epoll reactor shared by many epoll_transports.
+	// run() dispatches readiness events and posted tasks on the calling thread until stop().
+	// Registrations are only touched on that thread; post() is the way in from other threads.
+	class epoll_loop final
+	{
+	public:
+		typedef std::function<void( uint32 events )> event_handler;
+		typedef std::function<void()> task;
+
+		epoll_loop( const epoll_loop& ) = delete;
+		epoll_loop& operator=( const epoll_loop& ) = delete;
+
+		epoll_loop();
+		~epoll_loop();
+
+		void run();
+		void stop();
+
+		// Thread-safe. Tasks run on the loop thread in post order.
+		void post( task task );
+		bool in_loop_thread() const noexcept { return std::this_thread::get_id() == thread_id_; }
+
+		// Loop thread only. add takes ownership of fd; remove closes it.
+		// The returned token identifies the registration, so stale events for a descriptor that was
+		// removed and reused within one epoll_wait batch are dropped.
+		uint64 add( int fd, uint32 events, event_handler handler );
+		void remove( uint64 token );
+
+	private:
+		void run_posted_tasks();
+
+	private:
+		struct registration
+		{
+			int fd;
+			event_handler handler;
+		};
+
+		int epoll_fd_, wake_fd_;
+		std::thread::id thread_id_;
+		bool stopped_;
+
+		std::mutex task_mutex_;
+		std::vector<task> tasks_;
+
+		uint64 next_token_;
+		std::unordered_map<uint64, registration> registrations_;
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,460 @@
+#include "pch.h"
+#include "epoll_transport.h"
+#include <climits>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	// Segments handed to one sendmsg, across as many queued writes as fit
+	const size_t MAX_IOVECS = IOV_MAX;
+
+}
+
+struct epoll_transport::channel
+{
+	explicit channel( epoll_loop& loop )
+		: loop( loop )
+		, token( 0 )
+		, connecting( false )
+		, closed( false )
+		, paused( false )
+		, buffer( nullptr )
+		, fd( -1 )
+	{ }
+
+	epoll_loop& loop;
+
+	// Loop thread only
+	uint64 token;
+
+	// Held while a handler runs, so close() from another thread waits until the handler returns
+	// and the receive buffer is no longer touched afterwards
+	std::recursive_mutex handler_mutex;
+	std::atomic<bool> connecting, closed, paused;
+	connect_handler connected;
+	ring_buffer* buffer;
+	receive_handler received;
+	drained_handler drained;
+
+	// Also guards fd, which write() reads on the calling thread
+	std::mutex send_mutex;
+	int fd;
+	std::deque<gather_buffer> send_queue;
+};
+
+epoll_transport::epoll_transport( epoll_loop& loop )
+	: loop_( loop )
+	, channel_( std::make_shared<channel>( loop ) )
+{ }
+
+epoll_transport::~epoll_transport()
+{
+	close();
+}
+
+void epoll_transport::connect( const std::string& host, uint16 port, connect_handler handler )
+{
+	const auto ch = renew_channel();
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo* result = nullptr;
+	if( getaddrinfo( host.c_str(), std::to_string( port ).c_str(), &hints, &result ) != 0 )
+	{
+		loop_.post( [handler] { handler( false ); } );
+		return;
+	}
+
+	int fd = -1;
+	for( auto ai = result; ai != nullptr; ai = ai->ai_next )
+	{
+		fd = socket( ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol );
+		if( fd < 0 )
+		{
+			continue;
+		}
+
+		if( ::connect( fd, ai->ai_addr, ai->ai_addrlen ) == 0 || errno == EINPROGRESS )
+		{
+			break;
+		}
+		::close( fd );
+		fd = -1;
+	}
+	freeaddrinfo( result );
+
+	if( fd < 0 )
+	{
+		loop_.post( [handler] { handler( false ); } );
+		return;
+	}
+
+	// Chunks are already coalesced per message by the muxer
+	const int enable = 1;
+	setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof( enable ) );
+
+	{
+		std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+		ch->connected = std::move( handler );
+	}
+	{
+		std::lock_guard<std::mutex> lock( ch->send_mutex );
+		ch->connecting = true;
+		ch->fd = fd;
+	}
+	loop_.post( [ch]
+	{
+		if( ch->closed )
+		{
+			std::lock_guard<std::mutex> lock( ch->send_mutex );
+			::close( ch->fd );
+			ch->fd = -1;
+			return;
+		}
+		ch->token = ch->loop.add( ch->fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [ch]( uint32 events ) { on_event( ch, events ); } );
+	} );
+}
+
+void epoll_transport::start_receive( ring_buffer& buffer, receive_handler handler )
+{
+	const auto ch = std::atomic_load( &channel_ );
+	{
+		std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+		ch->buffer = &buffer;
+		ch->received = std::move( handler );
+	}
+
+	// Data that arrived before this call already consumed its edge
+	loop_.post( [ch]
+	{
+		std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+		if( !ch->closed && !ch->connecting )
+		{
+			on_readable( *ch );
+		}
+	} );
+}
+
+void epoll_transport::pause_receive()
+{
+	std::atomic_load( &channel_ )->paused = true;
+}
+
+void epoll_transport::resume_receive()
+{
+	const auto ch = std::atomic_load( &channel_ );
+	if( !ch->paused.exchange( false ) )
+	{
+		return;
+	}
+
+	// The readiness edge was consumed while paused; drain whatever queued up since
+	loop_.post( [ch]
+	{
+		std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+		if( !ch->closed && !ch->connecting )
+		{
+			on_readable( *ch );
+		}
+	} );
+}
+
+void epoll_transport::write( gather_buffer data )
+{
+	const auto ch = std::atomic_load( &channel_ );
+	std::lock_guard<std::mutex> lock( ch->send_mutex );
+	if( ch->closed || data.empty() )
+	{
+		return;
+	}
+
+	ch->send_queue.push_back( std::move( data ) );
+	if( ch->send_queue.size() == 1 && !ch->connecting && ch->fd >= 0 && flush( *ch ) )
+	{
+		// Sent in full on the calling thread; the handler still runs on the loop thread
+		loop_.post( [ch]
+		{
+			std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+			notify_drained( *ch );
+		} );
+	}
+}
+
+void epoll_transport::set_drained_handler( drained_handler handler )
+{
+	const auto ch = std::atomic_load( &channel_ );
+	std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+	ch->drained = std::move( handler );
+}
+
+void epoll_transport::close()
+{
+	const auto ch = std::atomic_load( &channel_ );
+	{
+		std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+		if( ch->closed.exchange( true ) )
+		{
+			return;
+		}
+
+		ch->connected = nullptr;
+		ch->buffer = nullptr;
+		ch->received = nullptr;
+		ch->drained = nullptr;
+	}
+	{
+		std::lock_guard<std::mutex> lock( ch->send_mutex );
+		ch->send_queue.clear();
+		if( ch->fd >= 0 )
+		{
+			::shutdown( ch->fd, SHUT_RDWR );
+		}
+	}
+
+	loop_.post( [ch]
+	{
+		if( ch->token != 0 )
+		{
+			ch->loop.remove( ch->token );
+			ch->token = 0;
+		}
+	} );
+}
+
+// Each connect() gets a channel of its own, so neither the latches of the previous connection
+// nor the tasks still queued for it reach the new one. Only the drained handler carries over.
+std::shared_ptr<epoll_transport::channel> epoll_transport::renew_channel()
+{
+	const auto previous = std::atomic_load( &channel_ );
+	drained_handler drained;
+	{
+		std::lock_guard<std::recursive_mutex> lock( previous->handler_mutex );
+		drained = previous->drained;
+	}
+	close();
+
+	const auto ch = std::make_shared<channel>( loop_ );
+	ch->drained = std::move( drained );
+	std::atomic_store( &channel_, ch );
+	return ch;
+}
+
+void epoll_transport::on_event( const std::shared_ptr<channel>& ch, uint32 events )
+{
+	std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+	if( ch->closed )
+	{
+		return;
+	}
+
+	if( ch->connecting )
+	{
+		on_connected( *ch );
+		return;
+	}
+
+	if( ( events & ( EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR ) ) != 0 )
+	{
+		on_readable( *ch );
+	}
+	if( ( events & EPOLLOUT ) != 0 && !ch->closed )
+	{
+		on_writable( *ch );
+	}
+}
+
+void epoll_transport::on_connected( channel& ch )
+{
+	int error = 0;
+	socklen_t length = sizeof( error );
+	getsockopt( ch.fd, SOL_SOCKET, SO_ERROR, &error, &length );
+
+	ch.connecting = false;
+	const auto handler = std::move( ch.connected );
+	ch.connected = nullptr;
+	if( error != 0 )
+	{
+		// Also closes the socket
+		ch.loop.remove( ch.token );
+		ch.token = 0;
+		{
+			std::lock_guard<std::mutex> lock( ch.send_mutex );
+			ch.fd = -1;
+		}
+		handler( false );
+		return;
+	}
+
+	bool drained;
+	{
+		// Writes issued before the connect completed
+		std::lock_guard<std::mutex> lock( ch.send_mutex );
+		drained = !ch.send_queue.empty() && flush( ch );
+	}
+	handler( true );
+	if( drained )
+	{
+		notify_drained( ch );
+	}
+
+	// The connect edge may already carry data
+	if( !ch.closed && ch.buffer != nullptr )
+	{
+		on_readable( ch );
+	}
+}
+
+void epoll_transport::on_readable( channel& ch )
+{
+	for( ;; )
+	{
+		// Leaving the data in the socket lets the kernel close the receive window
+		if( ch.buffer == nullptr || ch.paused )
+		{
+			return;
+		}
+
+		auto& buffer = *ch.buffer;
+		size_t length = 0;
+		bool drained = false, eof = false;
+		while( buffer.write_length() != 0 )
+		{
+			const auto result = ::recv( ch.fd, buffer.write_pointer(), buffer.write_length(), 0 );
+			if( result > 0 )
+			{
+				buffer.commit( static_cast<size_t>( result ) );
+				length += static_cast<size_t>( result );
+				continue;
+			}
+			if( result < 0 && errno == EINTR )
+			{
+				continue;
+			}
+			if( result < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+			{
+				drained = true;
+			}
+			else
+			{
+				eof = true;
+			}
+			break;
+		}
+
+		if( length != 0 )
+		{
+			ch.received( length );
+		}
+		if( eof )
+		{
+			fail( ch );
+			return;
+		}
+		if( drained || ch.closed )
+		{
+			return;
+		}
+
+		// The buffer filled up; the handler consumed what it could, so keep draining.
+		// A handler that consumes nothing would spin, so give up on a full buffer.
+		if( ch.buffer == nullptr || ch.buffer->write_length() == 0 )
+		{
+			return;
+		}
+	}
+}
+
+void epoll_transport::on_writable( channel& ch )
+{
+	bool drained;
+	{
+		// EPOLLOUT accompanies every edge while the socket is writable, queued data or not
+		std::lock_guard<std::mutex> lock( ch.send_mutex );
+		drained = !ch.send_queue.empty() && flush( ch );
+	}
+	if( drained )
+	{
+		notify_drained( ch );
+	}
+}
+
+bool epoll_transport::flush( channel& ch )
+{
+	iovec vectors[MAX_IOVECS];
+	while( !ch.send_queue.empty() )
+	{
+		size_t count = 0;
+		for( auto itr = ch.send_queue.begin(); itr != ch.send_queue.end() && count != MAX_IOVECS; ++itr )
+		{
+			for( size_t i = 0; i < itr->segment_count() && count != MAX_IOVECS; ++i )
+			{
+				vectors[count].iov_base = const_cast<uint8*>( itr->segment_data( i ) );
+				vectors[count].iov_len = itr->segment_length( i );
+				++count;
+			}
+		}
+
+		msghdr message = {};
+		message.msg_iov = vectors;
+		message.msg_iovlen = count;
+		const auto result = ::sendmsg( ch.fd, &message, MSG_NOSIGNAL );
+		if( result < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			if( errno != EAGAIN && errno != EWOULDBLOCK )
+			{
+				// Surfaces as a zero length read on the receive side
+				ch.send_queue.clear();
+				::shutdown( ch.fd, SHUT_RDWR );
+			}
+			return false;
+		}
+
+		auto sent = static_cast<size_t>( result );
+		while( sent != 0 )
+		{
+			auto& front = ch.send_queue.front();
+			const auto length = std::min( sent, front.size() );
+			front.consume( length );
+			sent -= length;
+			if( front.empty() )
+			{
+				ch.send_queue.pop_front();
+			}
+		}
+	}
+	return true;
+}
+
+void epoll_transport::notify_drained( channel& ch )
+{
+	if( !ch.closed && ch.drained )
+	{
+		const auto handler = ch.drained;
+		handler();
+	}
+}
+
+void epoll_transport::fail( channel& ch )
+{
+	const auto handler = ch.received;
+	ch.buffer = nullptr;
+	ch.received = nullptr;
+	if( handler )
+	{
+		handler( 0 );
+	}
+}
\ No newline at end of file
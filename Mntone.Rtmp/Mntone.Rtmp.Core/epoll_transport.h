@@ -0,0 +1,52 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include "transport.h"
+#include "epoll_loop.h"
+
+namespace mntone { namespace rtmp {
+
+	// Non-blocking socket transport driven by an epoll_loop.
+	// Every readiness event drains the socket into the receive buffer until EAGAIN. Writes go
+	// straight to the socket as one sendmsg over the segments of everything queued, and the
+	// remainder waits for the next EPOLLOUT.
+	// Handlers run on the loop thread.
+	class epoll_transport final
+		: public transport
+	{
+	public:
+		epoll_transport( const epoll_transport& ) = delete;
+		epoll_transport& operator=( const epoll_transport& ) = delete;
+
+		explicit epoll_transport( epoll_loop& loop );
+		virtual ~epoll_transport();
+
+		// Name resolution runs on the calling thread; the connect completes on the loop thread.
+		virtual void connect( const std::string& host, uint16 port, connect_handler handler ) override;
+		virtual void start_receive( ring_buffer& buffer, receive_handler handler ) override;
+		virtual void pause_receive() override;
+		virtual void resume_receive() override;
+		using transport::write;
+		virtual void write( gather_buffer data ) override;
+		virtual void set_drained_handler( drained_handler handler ) override;
+		virtual void close() override;
+
+	private:
+		struct channel;
+
+		std::shared_ptr<channel> renew_channel();
+
+		static void on_event( const std::shared_ptr<channel>& ch, uint32 events );
+		static void on_connected( channel& ch );
+		static void on_readable( channel& ch );
+		static void on_writable( channel& ch );
+		static bool flush( channel& ch );
+		static void notify_drained( channel& ch );
+		static void fail( channel& ch );
+
+	private:
+		epoll_loop& loop_;
+		std::shared_ptr<channel> channel_;
+	};
+
+} }
\ No newline at end of file
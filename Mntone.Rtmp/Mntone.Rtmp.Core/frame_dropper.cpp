@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "frame_dropper.h"
+
+using namespace mntone::rtmp;
+using namespace mntone::rtmp::media;
+
+namespace {
+
+	const uint8 NAL_UNIT_TYPE_MASK = 0x1f;
+	const uint8 NAL_SLICE = 1;
+	const uint8 NAL_IDR_SLICE = 5;
+
+}
+
+frame_dropper::frame_dropper()
+	: latency_budget_( 0 )
+	, dropping_gop_( false )
+	, length_size_( 0 )
+{ }
+
+bool frame_dropper::admit( video_format format, video_type type, bool sequence_header, const byte_slice& data, uint32 backlog_milliseconds )
+{
+	if( sequence_header )
+	{
+		// AVCDecoderConfigurationRecord: lengthSizeMinusOne in the low bits of byte 4
+		if( format == video_format::avc && data.size() >= 5 )
+		{
+			length_size_ = static_cast<uint8>( ( data[4] & 0x03 ) + 1 );
+		}
+		return true;
+	}
+	if( type == video_type::video_info_or_command_frame )
+	{
+		return true;
+	}
+
+	const auto keyframe = type == video_type::keyframe || type == video_type::generated_keyframe;
+	const auto gop_limit = 2 * static_cast<uint64>( latency_budget_ );
+	if( dropping_gop_ )
+	{
+		if( keyframe && ( latency_budget_ == 0 || backlog_milliseconds < gop_limit ) )
+		{
+			dropping_gop_ = false;
+			return true;
+		}
+		++counters_.gop_frames;
+		counters_.bytes += data.size();
+		return false;
+	}
+
+	if( latency_budget_ == 0 || backlog_milliseconds < latency_budget_ )
+	{
+		return true;
+	}
+
+	if( backlog_milliseconds < gop_limit )
+	{
+		if( keyframe || !non_reference( format, type, data ) )
+		{
+			return true;
+		}
+		++counters_.non_reference_frames;
+		counters_.bytes += data.size();
+		return false;
+	}
+
+	dropping_gop_ = true;
+	++counters_.gops;
+	++counters_.gop_frames;
+	counters_.bytes += data.size();
+	return false;
+}
+
+// Disposable inter frames by their FLV frame type, and AVC frames whose slices all have a
+// nal_ref_idc of 0
+bool frame_dropper::non_reference( video_format format, video_type type, const byte_slice& data ) const noexcept
+{
+	if( type == video_type::disposable_interframe )
+	{
+		return true;
+	}
+	if( format != video_format::avc || length_size_ == 0 )
+	{
+		return false;
+	}
+
+	auto slices = false;
+	size_t offset = 0;
+	while( offset + length_size_ < data.size() )
+	{
+		size_t length = 0;
+		for( auto i = 0u; i < length_size_; ++i )
+		{
+			length = length << 8 | data[offset + i];
+		}
+		offset += length_size_;
+		if( length == 0 || length > data.size() - offset )
+		{
+			return false;
+		}
+
+		const auto nal_header = data[offset];
+		const auto nal_unit_type = nal_header & NAL_UNIT_TYPE_MASK;
+		if( nal_unit_type >= NAL_SLICE && nal_unit_type <= NAL_IDR_SLICE )
+		{
+			if( ( nal_header & 0x60 ) != 0 )
+			{
+				return false;
+			}
+			slices = true;
+		}
+		offset += length;
+	}
+	return slices;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include "byte_slice.h"
+#include "pacing.h"
+#include "Media/video_format.h"
+#include "Media/video_type.h"
+
+namespace mntone { namespace rtmp {
+
+	// Picks the outgoing video frames a publishing stream leaves out to keep its send backlog
+	// within a latency budget. Audio and sequence headers never come here.
+	// Over the budget, frames no other frame refers to go first. Past twice the budget the rest of
+	// the GOP goes as well, and dropping goes on up to a key frame that finds the backlog back under
+	// twice the budget, so the decoder never gets a frame whose references are missing.
+	// Frames are dropped before they are chunked: a chunked message cannot be taken back without
+	// breaking the header compression of the ones after it.
+	class frame_dropper final
+	{
+	public:
+		frame_dropper();
+
+		// 0 never drops
+		void set_latency_budget( uint32 milliseconds ) noexcept { latency_budget_ = milliseconds; }
+		uint32 latency_budget() const noexcept { return latency_budget_; }
+
+		// backlog_milliseconds is how long queued media has been waiting (send_backlog).
+		// Returns false when the frame is to be dropped.
+		bool admit( media::video_format format, media::video_type type, bool sequence_header, const byte_slice& data, uint32 backlog_milliseconds );
+
+		const drop_counters& counters() const noexcept { return counters_; }
+
+	private:
+		bool non_reference( media::video_format format, media::video_type type, const byte_slice& data ) const noexcept;
+
+	private:
+		uint32 latency_budget_;
+		bool dropping_gop_;
+
+		// NAL unit length field size from the last AVC sequence header
+		uint8 length_size_;
+
+		drop_counters counters_;
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "gather_buffer.h"
+
+using namespace mntone::rtmp;
+
+gather_buffer::gather_buffer( std::vector<uint8> data )
+	: owned_( std::move( data ) )
+	, first_( 0 )
+	, size_( owned_.size() )
+	, prepared_( 0 )
+{
+	if( !owned_.empty() )
+	{
+		segments_.push_back( { 0, static_cast<uint32>( owned_.size() ), 0 } );
+	}
+}
+
+void gather_buffer::append( const uint8* data, size_t length )
+{
+	if( length == 0 )
+	{
+		return;
+	}
+
+	std::memcpy( prepare( length ), data, length );
+	commit( length );
+}
+
+uint8* gather_buffer::prepare( size_t max_length )
+{
+	prepared_ = owned_.size();
+	owned_.resize( prepared_ + max_length );
+	return owned_.data() + prepared_;
+}
+
+void gather_buffer::commit( size_t length )
+{
+	const auto offset = prepared_;
+	owned_.resize( offset + length );
+	if( length == 0 )
+	{
+		return;
+	}
+	size_ += length;
+
+	if( segments_.size() != first_ )
+	{
+		auto& last = segments_.back();
+		if( last.source == 0 && last.offset + last.length == offset )
+		{
+			last.length += static_cast<uint32>( length );
+			return;
+		}
+	}
+	segments_.push_back( { 0, static_cast<uint32>( length ), offset } );
+}
+
+uint32 gather_buffer::add_payload( byte_slice payload )
+{
+	payloads_.push_back( std::move( payload ) );
+	return static_cast<uint32>( payloads_.size() - 1 );
+}
+
+void gather_buffer::append_payload( uint32 index, size_t offset, size_t length )
+{
+	if( length == 0 )
+	{
+		return;
+	}
+
+	segments_.push_back( { index + 1, static_cast<uint32>( length ), offset } );
+	size_ += length;
+}
+
+void gather_buffer::append( gather_buffer&& other )
+{
+	if( other.empty() )
+	{
+		return;
+	}
+	if( empty() )
+	{
+		*this = std::move( other );
+		return;
+	}
+
+	const auto owned_base = owned_.size();
+	const auto payload_base = static_cast<uint32>( payloads_.size() );
+	owned_.insert( owned_.end(), other.owned_.begin(), other.owned_.end() );
+	payloads_.insert( payloads_.end(), std::make_move_iterator( other.payloads_.begin() ), std::make_move_iterator( other.payloads_.end() ) );
+	for( auto i = other.first_; i < other.segments_.size(); ++i )
+	{
+		auto segment = other.segments_[i];
+		if( segment.source == 0 )
+		{
+			segment.offset += owned_base;
+		}
+		else
+		{
+			segment.source += payload_base;
+		}
+		segments_.push_back( segment );
+	}
+	size_ += other.size_;
+	other = gather_buffer();
+}
+
+void gather_buffer::splice( gather_buffer& from, size_t length )
+{
+	length = std::min( length, from.size_ );
+	for( auto remaining = length; remaining != 0; )
+	{
+		const auto& segment = from.segments_[from.first_];
+		const auto piece = std::min<size_t>( remaining, segment.length );
+		if( segment.source == 0 )
+		{
+			append( from.owned_.data() + segment.offset, piece );
+		}
+		else
+		{
+			// Consecutive ranges of one payload share a single reference
+			const auto& payload = from.payloads_[segment.source - 1];
+			if( payloads_.empty() || payloads_.back().data() != payload.data() || payloads_.back().size() != payload.size() )
+			{
+				add_payload( payload );
+			}
+			append_payload( static_cast<uint32>( payloads_.size() - 1 ), segment.offset, piece );
+		}
+		from.consume( piece );
+		remaining -= piece;
+	}
+}
+
+const uint8* gather_buffer::segment_data( size_t index ) const noexcept
+{
+	const auto& segment = segments_[first_ + index];
+	const auto base = segment.source == 0 ? owned_.data() : payloads_[segment.source - 1].data();
+	return base + segment.offset;
+}
+
+void gather_buffer::consume( size_t length ) noexcept
+{
+	size_ -= std::min( length, size_ );
+	while( length != 0 && first_ != segments_.size() )
+	{
+		auto& segment = segments_[first_];
+		if( length < segment.length )
+		{
+			segment.offset += length;
+			segment.length -= static_cast<uint32>( length );
+			return;
+		}
+		length -= segment.length;
+		++first_;
+	}
+}
+
+std::vector<uint8> gather_buffer::flatten() const
+{
+	std::vector<uint8> data;
+	data.reserve( size_ );
+	for( size_t i = 0; i < segment_count(); ++i )
+	{
+		const auto segment = segment_data( i );
+		data.insert( data.end(), segment, segment + segment_length( i ) );
+	}
+	return data;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include "byte_slice.h"
+
+namespace mntone { namespace rtmp {
+
+	// Outgoing bytes laid out for one vectored write.
+	// Small pieces such as chunk headers are copied into storage the buffer owns; payload ranges only
+	// reference their byte_slice, so a chunked message is its headers interleaved with pointers into
+	// the unchanged body. Segments are read in order by the transport and dropped as they are sent.
+	class gather_buffer final
+	{
+	public:
+		gather_buffer( const gather_buffer& ) = delete;
+		gather_buffer& operator=( const gather_buffer& ) = delete;
+
+		gather_buffer() noexcept
+			: first_( 0 )
+			, size_( 0 )
+			, prepared_( 0 )
+		{ }
+
+		explicit gather_buffer( std::vector<uint8> data );
+
+		gather_buffer( gather_buffer&& ) = default;
+		gather_buffer& operator=( gather_buffer&& ) = default;
+
+		// Copies data into owned storage, extending the last segment when it is owned too
+		void append( const uint8* data, size_t length );
+
+		// Appends in place: prepare returns room for max_length owned bytes and commit keeps the
+		// first length of them. Nothing else may be appended in between.
+		uint8* prepare( size_t max_length );
+		void commit( size_t length );
+
+		// Registers a payload once; ranges of it are then appended by index without touching its refcount
+		uint32 add_payload( byte_slice payload );
+		void append_payload( uint32 index, size_t offset, size_t length );
+
+		// Moves every segment of other to the end of this buffer
+		void append( gather_buffer&& other );
+
+		// Moves the first length bytes of from to the end of this buffer; payload ranges stay references
+		void splice( gather_buffer& from, size_t length );
+
+		size_t size() const noexcept { return size_; }
+		bool empty() const noexcept { return size_ == 0; }
+
+		size_t segment_count() const noexcept { return segments_.size() - first_; }
+		const uint8* segment_data( size_t index ) const noexcept;
+		size_t segment_length( size_t index ) const noexcept { return segments_[first_ + index].length; }
+
+		// Drops length bytes from the front after a partial send
+		void consume( size_t length ) noexcept;
+
+		std::vector<uint8> flatten() const;
+
+	private:
+		struct segment
+		{
+			// 0 for owned storage, otherwise payload index + 1
+			uint32 source;
+			uint32 length;
+			size_t offset;
+		};
+
+		std::vector<uint8> owned_;
+		std::vector<byte_slice> payloads_;
+		std::vector<segment> segments_;
+		size_t first_, size_;
+
+		// Offset in owned_ handed out by the last prepare()
+		size_t prepared_;
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "handshake.h"
+#if NDEBUG
+#include <random>
+#endif
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	const uint8 PROTOCOL_VERSION = 0x03; // default: 0x03: plain (or 0x06, 0x08, 0x09: encrypted)
+	const size_t RANDOM_SIZE = 1528;
+
+}
+
+handshake::handshake()
+	: c1_time_( 0 )
+	, c1_random_( RANDOM_SIZE, 0xff )
+{ }
+
+void handshake::create_c0c1( uint32 time, std::vector<uint8>& out )
+{
+	// random_data
+#if NDEBUG
+	std::mt19937 engine( std::random_device{}() );
+	std::uniform_int_distribution<uint32> distribution( 0x00, 0xff );
+	for( auto& byte : c1_random_ )
+	{
+		byte = static_cast<uint8>( distribution( engine ) );
+	}
+#endif
+	c1_time_ = time;
+
+	out.resize( c0c1_size );
+
+	// C0 --- protcol_version: uint8
+	out[0] = PROTOCOL_VERSION;
+
+	// C1 --- time: uint32, zero: uint32, random_data: 1528 bytes
+	utility::convert_big_endian( &c1_time_, 4, &out[1] );	// time
+	std::fill_n( out.begin() + 5, 4, 0x00 );				// zero
+	std::copy( c1_random_.cbegin(), c1_random_.cend(), out.begin() + 9 );
+}
+
+bool handshake::read_s0s1( const uint8* data, std::vector<uint8>& c2 ) const
+{
+	// S0 --- protocol_version: uint8
+	if( data[0] != PROTOCOL_VERSION )
+	{
+		return false;
+	}
+
+	// S1 --- time: uint32, zero: uint32, random_data: 1528 bytes
+	uint32 s1_time;
+	utility::convert_big_endian( data + 1, 4, &s1_time );
+
+	// C2 --- time: uint32, time2: uint32, random_data: 1528 bytes
+	c2.resize( c2_size );
+	utility::convert_big_endian( &s1_time, 4, &c2[0] );		// c2_time
+	utility::convert_big_endian( &c1_time_, 4, &c2[4] );	// c2_time2
+	std::copy_n( data + 9, RANDOM_SIZE, c2.begin() + 8 );	// random_data
+	return true;
+}
+
+bool handshake::read_s2( const uint8* data ) const
+{
+	// S2 --- time: uint32, time2: uint32, random_data: 1528 bytes
+	uint32 s2_time;
+	utility::convert_big_endian( data, 4, &s2_time );
+
+	// check time and random_echo
+	return c1_time_ == s2_time && std::equal( c1_random_.cbegin(), c1_random_.cend(), data + 8 );
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+
+namespace mntone { namespace rtmp {
+
+	// Plain (version 3) handshake.
+	// C0+C1 -> S0+S1 -> C2 -> S2; the transport only has to deliver the byte counts below.
+	class handshake final
+	{
+	public:
+		handshake();
+
+		void create_c0c1( uint32 time, std::vector<uint8>& out );
+
+		// Validates S0 and S1 and creates C2 (the echo of S1)
+		bool read_s0s1( const uint8* data, std::vector<uint8>& c2 ) const;
+
+		// Validates that S2 echoes C1
+		bool read_s2( const uint8* data ) const;
+
+	public:
+		static const size_t c0c1_size = 1 + 1536;
+		static const size_t s0s1_size = 1 + 1536;
+		static const size_t c2_size = 1536;
+		static const size_t s2_size = 1536;
+
+	private:
+		uint32 c1_time_;
+		std::vector<uint8> c1_random_;
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,811 @@
+#include "pch.h"
+#include "net_connection.h"
+#include "net_stream.h"
+#include "amf0.h"
+#include "amf0_reader.h"
+#include "commands.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	const auto DEFAULT_WINDOW_SIZE = std::numeric_limits<uint32>::max();
+	const auto DEFAULT_LIMIT_TYPE = limit_type::hard;
+	const uint32 DEFAULT_BUFFER_MILLSECONDS = 5000;
+	const uint32 DEFAULT_CHUNK_SIZE = 128;
+
+	// Message lengths are 24-bit, so no chunk can carry more
+	const uint32 MAX_CHUNK_SIZE = 0xffffff;
+
+	const uint32 NETWORK_CHUNK_STREAM_ID = 2;
+	const uint32 ACTION_CHUNK_STREAM_ID = 3;
+
+	// Most bytes handed to the transport at once; an urgent message waits behind at most this much
+	const size_t SEND_BATCH_LENGTH = 64 * 1024;
+
+}
+
+net_connection::net_connection( std::unique_ptr<transport> transport )
+	: transport_( std::move( transport ) )
+	, state_( connection_state::closed )
+	, start_time_( 0 )
+	, latest_transaction_id_( 2 )
+	, encoding_( object_encoding::amf0 )
+	, send_in_flight_( false )
+	, chunk_size_( DEFAULT_CHUNK_SIZE )
+	, bytes_sent_( 0 ), peer_acknowledged_bytes_( 0 )
+	, peer_acknowledges_( false )
+	, in_flight_length_( 0 )
+	, window_stalled_( false )
+	, window_stall_count_( 0 )
+	, throttled_streams_( 0 )
+	, throttled_since_( 0 )
+	, bytes_received_( 0 ), acknowledgements_sent_( 0 )
+	, acknowledged_bytes_( 0 )
+	, rx_window_size_( DEFAULT_WINDOW_SIZE ), tx_window_size_( DEFAULT_WINDOW_SIZE )
+	, rx_limit_type_( DEFAULT_LIMIT_TYPE ), tx_limit_type_( DEFAULT_LIMIT_TYPE )
+{ }
+
+net_connection::~net_connection()
+{
+	close();
+}
+
+void net_connection::connect( const std::string& host, uint16 port, std::vector<uint8> command, connect_handler handler )
+{
+	start_time_ = utility::get_windows_time();
+	connect_command_ = std::move( command );
+	encoding_ = object_encoding::amf0;
+	bytes_received_ = 0;
+	acknowledgements_sent_ = 0;
+	acknowledged_bytes_ = 0;
+	rx_window_size_ = DEFAULT_WINDOW_SIZE;
+	{
+		std::lock_guard<std::mutex> lock( send_mutex_ );
+		send_queue_.clear();
+		send_in_flight_ = false;
+		muxer_.reset();
+		bytes_sent_ = peer_acknowledged_bytes_ = 0;
+		peer_acknowledges_ = false;
+		in_flight_length_ = 0;
+		window_stalled_ = false;
+		tx_window_size_ = DEFAULT_WINDOW_SIZE;
+		tx_limit_type_ = DEFAULT_LIMIT_TYPE;
+	}
+
+	// A retry must not continue chunk streams, or reassemble messages, of the previous peer
+	demuxer_.reset();
+
+	std::weak_ptr<net_connection> weak( shared_from_this() );
+	transport_->set_drained_handler( [weak]
+	{
+		if( const auto self = weak.lock() )
+		{
+			self->on_drained();
+		}
+	} );
+	transport_->connect( host, port, [weak, handler]( bool succeeded )
+	{
+		const auto self = weak.lock();
+		if( self == nullptr )
+		{
+			return;
+		}
+
+		if( !succeeded )
+		{
+			self->notify_status( net_status_code::net_connection_connect_failed );
+			handler( false );
+			return;
+		}
+
+		// ---[ Send C0+C1 packet ]----------
+		std::vector<uint8> c0c1;
+		self->handshake_.create_c0c1( self->timestamp() + 1, c0c1 );
+		self->state_ = connection_state::handshaking_s0s1;
+		self->transport_->write( std::move( c0c1 ) );
+
+		self->transport_->start_receive( self->demuxer_.buffer(), [weak]( size_t length )
+		{
+			if( const auto self = weak.lock() )
+			{
+				self->on_received( length );
+			}
+		} );
+		handler( true );
+	} );
+}
+
+void net_connection::close()
+{
+	if( state_ == connection_state::closed )
+	{
+		return;
+	}
+
+	state_ = connection_state::closed;
+	for( auto& stream : binding_net_stream_ )
+	{
+		stream.second->on_detached();
+	}
+	binding_net_stream_.clear();
+	net_stream_temporary_.clear();
+	transport_->close();
+	{
+		std::lock_guard<std::mutex> lock( send_mutex_ );
+		send_queue_.clear();
+		send_in_flight_ = false;
+	}
+
+	std::lock_guard<std::mutex> lock( throttle_mutex_ );
+	if( throttled_streams_ != 0 )
+	{
+		throttled_streams_ = 0;
+		receive_throttle_counters_.throttled_milliseconds += utility::hundred_nano_to_milli( utility::get_windows_time() - throttled_since_ );
+	}
+}
+
+void net_connection::attach( std::shared_ptr<net_stream> stream )
+{
+	const auto tid = next_transaction_id();
+	net_stream_temporary_.emplace( tid, std::move( stream ) );
+	send_command( 0, command_templates_.create_stream( tid ) );
+}
+
+void net_connection::detach( net_stream& stream )
+{
+	const auto itr = binding_net_stream_.find( stream.stream_id() );
+	if( itr != binding_net_stream_.end() && itr->second.get() == &stream )
+	{
+		send_command( 0, command_templates_.close_stream( stream.stream_id() ) );
+		binding_net_stream_.erase( itr );
+	}
+}
+
+throttle_counters net_connection::receive_throttle_statistics() const
+{
+	std::lock_guard<std::mutex> lock( throttle_mutex_ );
+	auto counters = receive_throttle_counters_;
+	if( throttled_streams_ != 0 )
+	{
+		counters.throttled_milliseconds += utility::hundred_nano_to_milli( utility::get_windows_time() - throttled_since_ );
+	}
+	return counters;
+}
+
+void net_connection::set_chunk_size( uint32 bytes )
+{
+	if( bytes == 0 || bytes > MAX_CHUNK_SIZE )
+	{
+		throw std::invalid_argument( "bytes" );
+	}
+	chunk_size_ = bytes;
+}
+
+chunk_statistics net_connection::outbound_chunk_statistics() const
+{
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	return outbound_statistics_;
+}
+
+void net_connection::set_interleave_policy( const interleave_policy& policy )
+{
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	send_queue_.set_policy( policy );
+}
+
+interleave_policy net_connection::get_interleave_policy() const
+{
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	return send_queue_.policy();
+}
+
+send_backlog net_connection::backlog() const
+{
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	send_backlog backlog;
+	backlog.queued_bytes = send_queue_.size();
+	backlog.in_flight_bytes = in_flight_length_;
+	backlog.unacknowledged_bytes = bytes_sent_ - peer_acknowledged_bytes_;
+	backlog.window_size = tx_window_size_;
+	backlog.window_stall_count = window_stall_count_;
+
+	const auto audio = send_queue_.queued_since( send_priority::audio );
+	const auto video = send_queue_.queued_since( send_priority::video );
+	const auto oldest = audio < 0 ? video : video < 0 ? audio : std::min( audio, video );
+	if( oldest >= 0 )
+	{
+		backlog.queue_delay_milliseconds = utility::hundred_nano_to_milli( utility::get_windows_time() - oldest );
+	}
+	return backlog;
+}
+
+// Called by a stream crossing its high watermark (true) or falling back under its low one (false),
+// from the transport thread or the consumer's
+void net_connection::on_stream_throttled( bool throttled )
+{
+	std::lock_guard<std::mutex> lock( throttle_mutex_ );
+	if( throttled )
+	{
+		if( throttled_streams_++ == 0 && state_ != connection_state::closed )
+		{
+			throttled_since_ = utility::get_windows_time();
+			++receive_throttle_counters_.throttle_count;
+			transport_->pause_receive();
+		}
+	}
+	else if( throttled_streams_ != 0 && --throttled_streams_ == 0 )
+	{
+		receive_throttle_counters_.throttled_milliseconds += utility::hundred_nano_to_milli( utility::get_windows_time() - throttled_since_ );
+		transport_->resume_receive();
+	}
+}
+
+uint32 net_connection::timestamp() const noexcept
+{
+	return utility::hundred_nano_to_milli( utility::get_windows_time() - start_time_ );
+}
+
+void net_connection::notify_status( net_status_code code )
+{
+	if( status_handler_ )
+	{
+		status_handler_( code );
+	}
+}
+
+#pragma region Network operation (Server to Client)
+
+void net_connection::on_received( size_t length )
+{
+	if( length == 0 )
+	{
+		// Closed by the remote peer
+		const auto was_connected = state_ != connection_state::closed;
+		close();
+		if( was_connected && closed_handler_ )
+		{
+			closed_handler_();
+		}
+		return;
+	}
+
+	bytes_received_.fetch_add( length, std::memory_order_relaxed );
+	if( state_ != connection_state::connected && !on_handshake() )
+	{
+		return;
+	}
+
+	demuxer_.parse( [this]( rtmp_header header, byte_slice data )
+	{
+		on_message( std::move( header ), std::move( data ) );
+	} );
+	acknowledge_received_bytes();
+}
+
+bool net_connection::on_handshake()
+{
+	auto& buffer = demuxer_.buffer();
+	if( state_ == connection_state::handshaking_s0s1 )
+	{
+		// ---[ Receive S0+S1 packet ]----------
+		if( buffer.size() < handshake::s0s1_size )
+		{
+			return false;
+		}
+
+		uint8 s0s1[handshake::s0s1_size];
+		buffer.read( s0s1, handshake::s0s1_size );
+
+		// ---[ Send C2 packet ]----------
+		std::vector<uint8> c2;
+		if( !handshake_.read_s0s1( s0s1, c2 ) )
+		{
+			close();
+			notify_status( net_status_code::net_connection_connect_failed );
+			return false;
+		}
+		transport_->write( std::move( c2 ) );
+		state_ = connection_state::handshaking_s2;
+	}
+
+	if( state_ == connection_state::handshaking_s2 )
+	{
+		// ---[ Receive S2 packet ]----------
+		if( buffer.size() < handshake::s2_size )
+		{
+			return false;
+		}
+
+		uint8 s2[handshake::s2_size];
+		buffer.read( s2, handshake::s2_size );
+		if( !handshake_.read_s2( s2 ) )
+		{
+			close();
+			notify_status( net_status_code::net_connection_connect_failed );
+			return false;
+		}
+		state_ = connection_state::connected;
+		if( chunk_size_ != DEFAULT_CHUNK_SIZE )
+		{
+			announce_chunk_size();
+		}
+		send_command( 0, connect_command_ );
+	}
+	return state_ == connection_state::connected;
+}
+
+void net_connection::on_message( rtmp_header header, byte_slice data )
+{
+	// Every handler, and the callback, reads AMF3 messages in the AMF0 form
+	if( ( header.type_id == type_id_type::command_message_amf3 || header.type_id == type_id_type::data_message_amf3 ) && !to_amf0_message( header, data ) )
+	{
+		return;
+	}
+
+	const auto& sid = header.stream_id;
+	if( sid != 0 )
+	{
+		const auto& itr = binding_net_stream_.find( sid );
+		if( itr != binding_net_stream_.cend() )
+		{
+			// Keep the stream alive while a handler detaches it
+			const auto stream = itr->second;
+			stream->on_message( std::move( header ), std::move( data ) );
+		}
+		return;
+	}
+
+	if( header.chunk_stream_id == NETWORK_CHUNK_STREAM_ID )
+	{
+		on_network_message( std::move( header ), std::move( data ) );
+		return;
+	}
+
+	switch( header.type_id )
+	{
+	case type_id_type::command_message_amf0:
+		on_command_message( std::move( header ), std::move( data ) );
+		break;
+	}
+}
+
+void net_connection::on_network_message( rtmp_header header, byte_slice data )
+{
+	switch( header.type_id )
+	{
+	case type_id_type::set_chunk_size:
+		on_set_chunk_size( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::abort_message:
+		on_abort_message( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::acknowledgement:
+		on_acknowledgement( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::user_control_message:
+		on_user_control_message( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::window_acknowledgement_size:
+		on_window_acknowledgement_size( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::set_peer_bandwidth:
+		on_set_peer_bandwidth_message( std::move( header ), std::move( data ) );
+		break;
+	}
+}
+
+void net_connection::on_set_chunk_size( rtmp_header /*header*/, byte_slice data )
+{
+	if( data.size() < 4 )
+	{
+		return;
+	}
+
+	uint32 chunk_size;
+	utility::convert_big_endian( &data[0], 4, &chunk_size );
+	chunk_size &= 0x7fffffff;
+	if( chunk_size == 0 )
+	{
+		return;
+	}
+
+	// Anything above the longest message is the same as the longest message
+	demuxer_.set_chunk_size( std::min( chunk_size, MAX_CHUNK_SIZE ) );
+}
+
+void net_connection::on_abort_message( rtmp_header /*header*/, byte_slice data )
+{
+	if( data.size() < 4 )
+	{
+		return;
+	}
+
+	uint32 chunk_stream_id;
+	utility::convert_big_endian( &data[0], 4, &chunk_stream_id );
+	demuxer_.abort( chunk_stream_id );
+}
+
+void net_connection::on_acknowledgement( rtmp_header /*header*/, byte_slice data )
+{
+	if( data.size() < 4 )
+	{
+		return;
+	}
+
+	uint32 sequence_number;
+	utility::convert_big_endian( &data[0], 4, &sequence_number );
+
+	// The sequence number wraps at 2^32. A peer counting the handshake runs a little ahead of
+	// bytes_sent_, which reads as everything acknowledged.
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	const auto unacknowledged = static_cast<uint32>( static_cast<uint32>( bytes_sent_ ) - sequence_number );
+	peer_acknowledged_bytes_ = unacknowledged < 0x80000000u && unacknowledged <= bytes_sent_ ? bytes_sent_ - unacknowledged : bytes_sent_;
+	peer_acknowledges_ = true;
+	if( !send_in_flight_ )
+	{
+		flush_send_queue();
+	}
+}
+
+void net_connection::on_user_control_message( rtmp_header /*header*/, byte_slice data )
+{
+	if( data.size() < 6 )
+	{
+		return;
+	}
+
+	uint16 buf;
+	utility::convert_big_endian( &data[0], 2, &buf );
+
+	const auto& message_type = static_cast<user_control_message_event_type>( buf );
+	switch( message_type )
+	{
+	case user_control_message_event_type::stream_begin:
+		{
+			uint32 stream_id;
+			utility::convert_big_endian( &data[2], 4, &stream_id );
+			if( stream_id == 0 )
+			{
+				set_buffer_length( 0, DEFAULT_BUFFER_MILLSECONDS );
+			}
+			break;
+		}
+
+	case user_control_message_event_type::stream_eof:
+	case user_control_message_event_type::stream_dry:
+	case user_control_message_event_type::stream_is_recorded:
+		break;
+
+	case user_control_message_event_type::ping_request:
+		{
+			uint32 timestamp;
+			utility::convert_big_endian( &data[2], 4, &timestamp );
+			ping_response( timestamp );
+			break;
+		}
+	}
+}
+
+void net_connection::on_window_acknowledgement_size( rtmp_header /*header*/, byte_slice data )
+{
+	if( data.size() < 4 )
+	{
+		return;
+	}
+
+	utility::convert_big_endian( &data[0], 4, &rx_window_size_ );
+}
+
+void net_connection::on_set_peer_bandwidth_message( rtmp_header /*header*/, byte_slice data )
+{
+	if( data.size() < 5 )
+	{
+		return;
+	}
+
+	uint32 buf;
+	utility::convert_big_endian( &data[0], 4, &buf );
+
+	const auto& limit = static_cast<limit_type>( data[4] );
+	{
+		std::lock_guard<std::mutex> lock( send_mutex_ );
+		switch( limit )
+		{
+		case limit_type::hard:
+			tx_window_size_ = buf;
+			tx_limit_type_ = limit;
+			break;
+
+		case limit_type::soft:
+			tx_window_size_ = std::min( tx_window_size_, buf );
+			tx_limit_type_ = limit;
+			break;
+
+		case limit_type::dynamic:
+			if( tx_limit_type_ == limit_type::hard )
+			{
+				tx_window_size_ = buf;
+				tx_limit_type_ = limit;
+			}
+			break;
+
+		default:
+			return;
+		}
+
+		// A wider window may let held back chunks go
+		if( !send_in_flight_ )
+		{
+			flush_send_queue();
+		}
+	}
+	window_acknowledgement_size( buf );
+}
+
+void net_connection::on_command_message( rtmp_header /*header*/, byte_slice data )
+{
+	// Command name, transaction id, command object, then the arguments
+	amf0::reader reader( data.data(), data.size() );
+	if( reader.next() != amf0::token::string )
+	{
+		return;
+	}
+	const auto name = reader.string();
+	if( reader.next() != amf0::token::number )
+	{
+		return;
+	}
+	const auto& tid = static_cast<uint32>( reader.number() );
+
+	// for connect result (tid = 1)
+	if( tid == 1 )
+	{
+		reader.next();
+		if( !reader.skip() || reader.next() != amf0::token::object_begin )
+		{
+			return;
+		}
+
+		// The information object echoes objectEncoding; servers without AMF3 leave it out or say 0
+		auto information = reader;
+		if( information.find( "objectEncoding" ) && information.current() == amf0::token::number && information.number() == 3.0 )
+		{
+			encoding_ = object_encoding::amf3;
+		}
+		if( reader.find( "code" ) && reader.current() == amf0::token::string )
+		{
+			notify_status( parse_net_connection_connect_code( reader.string() ) );
+		}
+		return;
+	}
+
+	// for createStream result
+	{
+		const auto& itr = net_stream_temporary_.find( tid );
+		if( itr != net_stream_temporary_.cend() )
+		{
+			auto stream = std::move( itr->second );
+			net_stream_temporary_.erase( itr );
+			reader.next();
+			if( name == "_result" && reader.skip() && reader.next() == amf0::token::number )
+			{
+				const auto& sid = static_cast<uint32>( reader.number() );
+				binding_net_stream_.emplace( sid, stream );
+				stream->on_attached( this, sid );
+				set_buffer_length( sid, DEFAULT_BUFFER_MILLSECONDS );
+			}
+			return;
+		}
+	}
+
+	// for call result (tid = 0 or choice)
+	if( callback_handler_ )
+	{
+		callback_handler_( name.to_string(), data );
+	}
+}
+
+bool net_connection::to_amf0_message( rtmp_header& header, byte_slice& data )
+{
+	// A format selector byte, then AMF0 values, any of which may switch to AMF3. Decoded into a
+	// tree and encoded again; see the header.
+	std::vector<amf_value> values;
+	if( data.empty() || !amf0::parse( data.data() + 1, data.size() - 1, values ) || values.empty() )
+	{
+		return false;
+	}
+
+	std::vector<uint8> body;
+	amf0::serialize( values, body );
+	auto buffer = pool().acquire( static_cast<uint32>( body.size() ) );
+	std::memcpy( buffer.data(), body.data(), body.size() );
+
+	header.type_id = header.type_id == type_id_type::command_message_amf3 ? type_id_type::command_message_amf0 : type_id_type::data_message_amf0;
+	header.length = static_cast<uint32>( body.size() );
+	data = byte_slice( std::move( buffer ) );
+	return true;
+}
+
+#pragma endregion
+
+#pragma region Network operation (Client to Server)
+
+void net_connection::acknowledge_received_bytes()
+{
+	const auto received = bytes_received_.load( std::memory_order_relaxed );
+	if( state_ != connection_state::connected || rx_window_size_ == 0 || received - acknowledged_bytes_ < rx_window_size_ )
+	{
+		return;
+	}
+
+	// The sequence number is the byte count modulo 2^32, so it wraps on long-running connections
+	const auto sequence_number = static_cast<uint32>( received );
+	acknowledged_bytes_ = received;
+
+	std::vector<uint8> buf( 4 );
+	utility::convert_big_endian( &sequence_number, 4, &buf[0] );
+	send_network( type_id_type::acknowledgement, buf );
+	acknowledgements_sent_.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void net_connection::announce_chunk_size()
+{
+	std::vector<uint8> buf( 4 );
+	utility::convert_big_endian( &chunk_size_, 4, &buf[0] );
+
+	rtmp_header header( NETWORK_CHUNK_STREAM_ID );
+	header.timestamp = timestamp();
+	header.type_id = type_id_type::set_chunk_size;
+	header.stream_id = 0;
+
+	// Everything muxed after the announcement uses the new size. Nothing is queued yet right after
+	// the handshake, so no chunk cut at the old size can be sent behind it.
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	gather_buffer message;
+	const auto layout = muxer_.write( std::move( header ), buf.data(), buf.size(), message );
+	enqueue( send_priority::control, std::move( message ), layout );
+	muxer_.set_chunk_size( chunk_size_ );
+	if( !send_in_flight_ )
+	{
+		flush_send_queue();
+	}
+}
+
+void net_connection::window_acknowledgement_size( uint32 acknowledgement_window_size )
+{
+	std::vector<uint8> buf( 4 );
+	utility::convert_big_endian( &acknowledgement_window_size, 4, &buf[0] );
+	send_network( type_id_type::window_acknowledgement_size, buf );
+}
+
+void net_connection::set_buffer_length( uint32 stream_id, uint32 buffer_length )
+{
+	std::vector<uint8> buf( 10 );
+	utility::convert_big_endian( &stream_id, 4, &buf[2] );
+	utility::convert_big_endian( &buffer_length, 4, &buf[6] );
+	user_control_message_event( user_control_message_event_type::set_buffer_length, std::move( buf ) );
+}
+
+void net_connection::ping_response( uint32 timestamp )
+{
+	std::vector<uint8> buf( 6 );
+	utility::convert_big_endian( &timestamp, 4, &buf[2] );
+	user_control_message_event( user_control_message_event_type::ping_response, std::move( buf ) );
+}
+
+void net_connection::user_control_message_event( user_control_message_event_type type, std::vector<uint8> data )
+{
+	const auto& c_type = static_cast<uint16>( type );
+	utility::convert_big_endian( &c_type, 2, &data[0] );
+	send_network( type_id_type::user_control_message, data );
+}
+
+void net_connection::send_network( type_id_type type, const std::vector<uint8>& data )
+{
+	rtmp_header header( NETWORK_CHUNK_STREAM_ID );
+	header.timestamp = timestamp();
+	header.type_id = type;
+	header.stream_id = 0;
+	send( send_priority::control, std::move( header ), data.data(), data.size() );
+}
+
+void net_connection::send_command( uint32 stream_id, const std::vector<uint8>& command )
+{
+	rtmp_header header( ACTION_CHUNK_STREAM_ID );
+	header.timestamp = timestamp();
+	header.type_id = type_id_type::command_message_amf0;
+	header.stream_id = stream_id;
+	send( send_priority::command, std::move( header ), command.data(), command.size() );
+}
+
+void net_connection::send( send_priority priority, rtmp_header header, const uint8* data, size_t length )
+{
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	gather_buffer message;
+	const auto layout = muxer_.write( std::move( header ), data, length, message );
+	enqueue( priority, std::move( message ), layout );
+	if( !send_in_flight_ )
+	{
+		flush_send_queue();
+	}
+}
+
+void net_connection::send( send_priority priority, rtmp_header header, const uint8* prefix, size_t prefix_length, byte_slice payload )
+{
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	gather_buffer message;
+	const auto layout = muxer_.write( std::move( header ), prefix, prefix_length, std::move( payload ), message );
+	enqueue( priority, std::move( message ), layout );
+	if( !send_in_flight_ )
+	{
+		flush_send_queue();
+	}
+}
+
+// Queues one chunked message. Called with send_mutex_ held.
+void net_connection::enqueue( send_priority priority, gather_buffer message, const chunk_layout& layout )
+{
+	outbound_statistics_.chunk_count += layout.chunk_count();
+	outbound_statistics_.header_bytes += layout.wire_length() - layout.body_length;
+	outbound_statistics_.body_bytes += layout.body_length;
+	send_queue_.push( priority, std::move( message ), layout, utility::get_windows_time() );
+}
+
+void net_connection::on_drained()
+{
+	std::lock_guard<std::mutex> lock( send_mutex_ );
+	send_in_flight_ = false;
+	in_flight_length_ = 0;
+	flush_send_queue();
+}
+
+// Hands the transport one batch of everything that is ready, most urgent chunks first.
+// Called with send_mutex_ held; the transport never calls back into on_drained from write().
+void net_connection::flush_send_queue()
+{
+	if( send_queue_.empty() )
+	{
+		return;
+	}
+
+	// Within the peer bandwidth window, the rest waits for its acknowledgement
+	auto max_length = SEND_BATCH_LENGTH;
+	auto lowest = send_priority::video;
+	if( peer_acknowledges_ && tx_window_size_ != 0 )
+	{
+		const auto unacknowledged = bytes_sent_ - peer_acknowledged_bytes_;
+		if( unacknowledged >= tx_window_size_ )
+		{
+			if( !window_stalled_ )
+			{
+				window_stalled_ = true;
+				++window_stall_count_;
+			}
+			if( send_queue_.size( send_priority::control ) == 0 )
+			{
+				return;
+			}
+			lowest = send_priority::control;
+		}
+		else
+		{
+			window_stalled_ = false;
+			max_length = std::min( max_length, static_cast<size_t>( tx_window_size_ - unacknowledged ) );
+		}
+	}
+
+	gather_buffer batch;
+	send_queue_.pop( max_length, batch, lowest );
+	bytes_sent_ += batch.size();
+	in_flight_length_ = batch.size();
+	send_in_flight_ = true;
+	transport_->write( std::move( batch ) );
+}
+
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,202 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "transport.h"
+#include "chunk_demuxer.h"
+#include "chunk_muxer.h"
+#include "send_queue.h"
+#include "handshake.h"
+#include "limit_type.h"
+#include "object_encoding.h"
+#include "net_status.h"
+#include "commands.h"
+#include "backpressure.h"
+#include "pacing.h"
+#include "user_control_message_event_type.h"
+
+namespace mntone { namespace rtmp {
+
+	class net_stream;
+
+	// Client side of one RTMP connection: handshake, protocol control messages and command dispatch.
+	// Everything below the public API runs on the transport's thread; sends may come from any thread.
+	class net_connection final
+		: public std::enable_shared_from_this<net_connection>
+	{
+	public:
+		typedef std::function<void( bool succeeded )> connect_handler;
+		typedef std::function<void( net_status_code code )> status_handler;
+		typedef std::function<void( const std::string& command_name, const byte_slice& command )> callback_handler;
+		typedef std::function<void()> closed_handler;
+
+		net_connection( const net_connection& ) = delete;
+		net_connection& operator=( const net_connection& ) = delete;
+
+		explicit net_connection( std::unique_ptr<transport> transport );
+		~net_connection();
+
+		// command is the AMF0 body of the connect command (see commands::connect).
+		// handler reports the transport connection; the connect result arrives as a status code.
+		void connect( const std::string& host, uint16 port, std::vector<uint8> command, connect_handler handler );
+		void close();
+
+		// Sends an AMF0 command message; stream id 0 addresses the connection itself.
+		void send_command( uint32 stream_id, const std::vector<uint8>& command );
+		uint32 next_transaction_id() noexcept { return latest_transaction_id_++; }
+
+		// AMF version the server answered connect with; amf0 until then. Thread-safe.
+		object_encoding encoding() const noexcept { return encoding_.load( std::memory_order_relaxed ); }
+
+		// Bodies of createStream, closeStream and the net_stream playback commands
+		const commands::command_templates& command_templates() const noexcept { return command_templates_; }
+
+		// Sends createStream; the stream is bound to the returned stream id when the result arrives.
+		void attach( std::shared_ptr<net_stream> stream );
+		void detach( net_stream& stream );
+
+		void set_status_handler( status_handler handler ) { status_handler_ = std::move( handler ); }
+		void set_callback_handler( callback_handler handler ) { callback_handler_ = std::move( handler ); }
+		void set_closed_handler( closed_handler handler ) { closed_handler_ = std::move( handler ); }
+
+		body_pool& pool() noexcept { return demuxer_.pool(); }
+
+		// Time socket reads were paused because some attached stream was over its high watermark
+		throttle_counters receive_throttle_statistics() const;
+
+		// Bytes read from the socket since connect(), handshake and chunk headers included,
+		// and Acknowledgement messages sent for them. Thread-safe.
+		uint64 bytes_received() const noexcept { return bytes_received_.load( std::memory_order_relaxed ); }
+		uint64 acknowledgements_sent() const noexcept { return acknowledgements_sent_.load( std::memory_order_relaxed ); }
+
+		// Cap on memory held by partially received messages (see chunk_demuxer::set_reassembly_limit)
+		void set_reassembly_limit( size_t bytes ) noexcept { demuxer_.set_reassembly_limit( bytes ); }
+		uint64 reassembly_limit_hits() const noexcept { return demuxer_.reassembly_limit_hits(); }
+
+		// Chunk size announced with Set Chunk Size right after the handshake, ahead of the connect
+		// command; the protocol default of 128 announces nothing. Takes effect at the next connect().
+		// Larger chunks cut header overhead, but the send queue never splits a chunk, so an urgent
+		// message may wait behind a whole one. Throws std::invalid_argument outside 1-0xffffff.
+		void set_chunk_size( uint32 bytes );
+		uint32 chunk_size() const noexcept { return chunk_size_; }
+
+		// Bound on the video a send batch may carry ahead of audio queued after it (see interleave_policy)
+		void set_interleave_policy( const interleave_policy& policy );
+		interleave_policy get_interleave_policy() const;
+
+		// Send queue depth and peer bandwidth window use. Thread-safe.
+		// Once the peer has acknowledged anything, no more than its Set Peer Bandwidth window goes
+		// out unacknowledged; protocol control messages alone are exempt. Before that the window is
+		// not enforced, since a peer that never acknowledges would stall the connection for good.
+		send_backlog backlog() const;
+
+		// Chunk header overhead of everything received and sent. Thread-safe.
+		chunk_statistics inbound_chunk_statistics() const noexcept { return demuxer_.statistics(); }
+		chunk_statistics outbound_chunk_statistics() const;
+
+		// Milliseconds since connect()
+		uint32 timestamp() const noexcept;
+
+	private:
+		friend class net_stream;
+
+		void on_received( size_t length );
+		void on_drained();
+		void on_stream_throttled( bool throttled );
+		bool on_handshake();
+
+		void on_message( rtmp_header header, byte_slice data );
+
+		void on_network_message( rtmp_header header, byte_slice data );
+		void on_set_chunk_size( rtmp_header header, byte_slice data );
+		void on_abort_message( rtmp_header header, byte_slice data );
+		void on_acknowledgement( rtmp_header header, byte_slice data );
+		void on_user_control_message( rtmp_header header, byte_slice data );
+		void on_window_acknowledgement_size( rtmp_header header, byte_slice data );
+		void on_set_peer_bandwidth_message( rtmp_header header, byte_slice data );
+
+		void on_command_message( rtmp_header header, byte_slice data );
+
+		// Rewrites an AMF3 command or data message (type 17 or 15) as its AMF0 counterpart.
+		// A known allocating slow path: the values are decoded into an amf_value tree and encoded
+		// again, since AMF3 references cannot be translated value by value. Only servers that agreed
+		// on AMF3 send these, and only for commands and data, never for media.
+		bool to_amf0_message( rtmp_header& header, byte_slice& data );
+
+		void acknowledge_received_bytes();
+		void announce_chunk_size();
+		void window_acknowledgement_size( uint32 acknowledgement_window_size );
+		void set_buffer_length( uint32 stream_id, uint32 buffer_length );
+		void ping_response( uint32 timestamp );
+		void user_control_message_event( user_control_message_event_type type, std::vector<uint8> data );
+
+		void send_network( type_id_type type, const std::vector<uint8>& data );
+		void send( send_priority priority, rtmp_header header, const uint8* data, size_t length );
+		// Media path: prefix is copied (the FLV tag header), payload is only referenced
+		void send( send_priority priority, rtmp_header header, const uint8* prefix, size_t prefix_length, byte_slice payload );
+		void enqueue( send_priority priority, gather_buffer message, const chunk_layout& layout );
+		void flush_send_queue();
+
+		void notify_status( net_status_code code );
+
+	private:
+		enum class connection_state: uint8
+		{
+			closed,
+			handshaking_s0s1,
+			handshaking_s2,
+			connected,
+		};
+
+		std::unique_ptr<transport> transport_;
+		connection_state state_;
+		int64 start_time_;
+
+		handshake handshake_;
+		std::vector<uint8> connect_command_;
+
+		uint32 latest_transaction_id_;
+		std::atomic<object_encoding> encoding_;
+		const commands::command_templates command_templates_;
+		std::unordered_map<uint32, std::shared_ptr<net_stream>> net_stream_temporary_;
+		std::unordered_map<uint32, std::shared_ptr<net_stream>> binding_net_stream_;
+
+		chunk_demuxer demuxer_;
+
+		// Guards the muxer and the send queue. Messages are chunked as they are sent and queued by
+		// priority; one batch at a time is handed to the transport, the next when it drains.
+		mutable std::mutex send_mutex_;
+		chunk_muxer muxer_;
+		send_queue send_queue_;
+		bool send_in_flight_;
+		chunk_statistics outbound_statistics_;
+		uint32 chunk_size_;
+
+		// Bytes handed to the transport since the handshake, and how many of them the peer has
+		// acknowledged; peer_acknowledges_ once it has
+		uint64 bytes_sent_, peer_acknowledged_bytes_;
+		bool peer_acknowledges_;
+		size_t in_flight_length_;
+		bool window_stalled_;
+		uint64 window_stall_count_;
+
+		// Streams over their high watermark; reads are paused while any is
+		mutable std::mutex throttle_mutex_;
+		uint32 throttled_streams_;
+		int64 throttled_since_;
+		throttle_counters receive_throttle_counters_;
+
+		// Received byte count at the last Acknowledgement; the peer's window is measured from here
+		std::atomic<uint64> bytes_received_, acknowledgements_sent_;
+		uint64 acknowledged_bytes_;
+
+		// tx_ is written under send_mutex_
+		uint32 rx_window_size_, tx_window_size_;
+		limit_type rx_limit_type_, tx_limit_type_;
+
+		status_handler status_handler_;
+		callback_handler callback_handler_;
+		closed_handler closed_handler_;
+	};
+
+} }
\ No newline at end of file
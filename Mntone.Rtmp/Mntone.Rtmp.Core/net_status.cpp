@@ -0,0 +1,271 @@
+#include "pch.h"
+#include "net_status.h"
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	struct vocabulary_entry
+	{
+		const char* name;
+		net_status_code code;
+
+		// A code prefix naming a category, whose *Other value unknown codes under it map to
+		bool category;
+	};
+
+	// Every code net_status_code names, and the categories above them
+	constexpr vocabulary_entry VOCABULARY[] =
+	{
+		{ "NetConnection.Connect.Success", net_status_code::net_connection_connect_success, false },
+		{ "NetConnection.Connect.Closed", net_status_code::net_connection_connect_closed, false },
+		{ "NetConnection.Connect.Failed", net_status_code::net_connection_connect_failed, false },
+		{ "NetConnection.Connect.Rejected", net_status_code::net_connection_connect_rejected, false },
+		{ "NetConnection.Connect.InvalidApp", net_status_code::net_connection_connect_invalid_app, false },
+		{ "NetConnection.Connect.AppShutdown", net_status_code::net_connection_connect_app_shutdown, false },
+		{ "NetConnection.Call.Failed", net_status_code::net_connection_call_failed, false },
+		{ "NetConnection.Call.Prohibited", net_status_code::net_connection_call_prohibited, false },
+		{ "NetConnection.Call.BadVersion", net_status_code::net_connection_call_bad_version, false },
+		{ "NetStream.Play.Start", net_status_code::net_stream_play_start, false },
+		{ "NetStream.Play.Stop", net_status_code::net_stream_play_stop, false },
+		{ "NetStream.Play.Reset", net_status_code::net_stream_play_reset, false },
+		{ "NetStream.Play.PublishNotify", net_status_code::net_stream_play_publish_notify, false },
+		{ "NetStream.Play.UnpublishNotify", net_status_code::net_stream_play_unpublish_notify, false },
+		{ "NetStream.Play.Transition", net_status_code::net_stream_play_transition, false },
+		{ "NetStream.Play.Switch", net_status_code::net_stream_play_switch, false },
+		{ "NetStream.Play.Complete", net_status_code::net_stream_play_complete, false },
+		{ "NetStream.Play.TransitionComplete", net_status_code::net_stream_play_transition_complete, false },
+		{ "NetStream.Play.InsufficientBW", net_status_code::net_stream_play_insufficient_bandwidth, false },
+		{ "NetStream.Play.Failed", net_status_code::net_stream_play_failed, false },
+		{ "NetStream.Play.StreamNotFound", net_status_code::net_stream_play_stream_not_found, false },
+		{ "NetStream.Play.FileStructureInvalid", net_status_code::net_stream_play_file_structure_invalid, false },
+		{ "NetStream.Play.NoSupportedTrackFound", net_status_code::net_stream_play_no_supported_track_found, false },
+		{ "NetStream.Pause.Notify", net_status_code::net_stream_pause_notify, false },
+		{ "NetStream.Unpause.Notify", net_status_code::net_stream_unpause_notify, false },
+		{ "NetStream.Seek.Notify", net_status_code::net_stream_seek_notify, false },
+		{ "NetStream.Seek.Failed", net_status_code::net_stream_seek_failed, false },
+		{ "NetStream.Seek.InvalidTime", net_status_code::net_stream_seek_invalid_time, false },
+		{ "NetStream.Publish.Start", net_status_code::net_stream_publish_start, false },
+		{ "NetStream.Publish.Idle", net_status_code::net_stream_publish_idle, false },
+		{ "NetStream.Publish.BadName", net_status_code::net_stream_publish_bad_name, false },
+		{ "NetStream.Unpublish.Success", net_status_code::net_stream_unpublish_success, false },
+		{ "NetStream.Record.Start", net_status_code::net_stream_record_start, false },
+		{ "NetStream.Record.Stop", net_status_code::net_stream_record_stop, false },
+		{ "NetStream.Record.NoAccess", net_status_code::net_stream_record_no_access, false },
+		{ "NetStream.Record.Failed", net_status_code::net_stream_record_failed, false },
+		{ "NetStream.Record.DiskQuotaExceeded", net_status_code::net_stream_record_disk_quota_exceeded, false },
+		{ "NetStream.Buffer.Empty", net_status_code::net_stream_buffer_empty, false },
+		{ "NetStream.Buffer.Full", net_status_code::net_stream_buffer_full, false },
+		{ "NetStream.Buffer.Flush", net_status_code::net_stream_buffer_flush, false },
+		{ "NetStream.MulticastStream.Reset", net_status_code::net_stream_multicast_stream_reset, false },
+		{ "NetStream.Failed", net_status_code::net_stream_failed, false },
+		{ "SharedObject.Flush.Success", net_status_code::shared_object_flush_success, false },
+		{ "SharedObject.Flush.Failed", net_status_code::shared_object_flush_failed, false },
+		{ "SharedObject.BadPersistence", net_status_code::shared_object_bad_persistence, false },
+		{ "SharedObject.UriMismatch", net_status_code::shared_object_uri_mismatch, false },
+
+		{ "NetConnection.Connect", net_status_code::net_connection_connect, true },
+		{ "NetConnection.Call", net_status_code::net_connection_call, true },
+		{ "NetStream.Play", net_status_code::net_stream_play, true },
+		{ "NetStream.Pause", net_status_code::net_stream_pause, true },
+		{ "NetStream.Unpause", net_status_code::net_stream_unpause, true },
+		{ "NetStream.Seek", net_status_code::net_stream_seek, true },
+		{ "NetStream.Publish", net_status_code::net_stream_publish, true },
+		{ "NetStream.Unpublish", net_status_code::net_stream_unpublish, true },
+		{ "NetStream.Record", net_status_code::net_stream_record, true },
+		{ "NetStream.Buffer", net_status_code::net_stream_buffer, true },
+		{ "NetStream.MulticastStream", net_status_code::net_stream_multicast_stream, true },
+		{ "SharedObject.Flush", net_status_code::shared_object_flush, true },
+		{ "NetConnection", net_status_code::net_connection, true },
+		{ "NetStream", net_status_code::net_stream, true },
+		{ "SharedObject", net_status_code::shared_object, true },
+	};
+
+	// Shortest name in the vocabulary ("NetStream"); the hash reads from the last three characters
+	const size_t MIN_NAME_LENGTH = 9;
+
+	// Perfect hash of the vocabulary: the length, the last and third to last characters, and the
+	// middle one, packed into 32 bits and multiplied. The top byte picks the slot. The multiplier
+	// was searched for this vocabulary; a new code colliding with an old one fails the build.
+	const uint32 HASH_MULTIPLIER = 0xed5b4657;
+
+	constexpr uint8 slot_of( size_t length, char last, char third_to_last, char middle ) noexcept
+	{
+		return static_cast<uint8>( ( static_cast<uint32>( length ) << 24
+			| static_cast<uint32>( static_cast<uint8>( last ) ) << 16
+			| static_cast<uint32>( static_cast<uint8>( third_to_last ) ) << 8
+			| static_cast<uint32>( static_cast<uint8>( middle ) ) ) * HASH_MULTIPLIER >> 24 );
+	}
+
+	inline uint8 slot_of( string_ref name ) noexcept
+	{
+		const auto length = name.size();
+		return slot_of( length, name[length - 1], name[length - 3], name[length / 2] );
+	}
+
+	constexpr size_t length_of( const char* name ) noexcept
+	{
+		size_t length = 0;
+		while( name[length] != '\0' )
+		{
+			++length;
+		}
+		return length;
+	}
+
+	constexpr uint8 slot_of( const vocabulary_entry& entry ) noexcept
+	{
+		const auto length = length_of( entry.name );
+		return slot_of( length, entry.name[length - 1], entry.name[length - 3], entry.name[length / 2] );
+	}
+
+	constexpr bool slots_distinct() noexcept
+	{
+		bool used[256] = {};
+		for( const auto& entry : VOCABULARY )
+		{
+			if( used[slot_of( entry )] )
+			{
+				return false;
+			}
+			used[slot_of( entry )] = true;
+		}
+		return true;
+	}
+
+	static_assert( slots_distinct(), "two vocabulary names share a slot; search HASH_MULTIPLIER again" );
+
+	// Equality of two names of the same length, at least 8 bytes: whole words, then the last word
+	// again, overlapping. Cheaper than a call into memcmp for strings this short.
+	inline bool same_name( const char* lhs, const char* rhs, size_t length ) noexcept
+	{
+		uint64 a, b;
+		for( size_t offset = 0; offset + 8 <= length; offset += 8 )
+		{
+			std::memcpy( &a, lhs + offset, 8 );
+			std::memcpy( &b, rhs + offset, 8 );
+			if( a != b )
+			{
+				return false;
+			}
+		}
+		std::memcpy( &a, lhs + length - 8, 8 );
+		std::memcpy( &b, rhs + length - 8, 8 );
+		return a == b;
+	}
+
+	// Each slot carries its entry inline, so a lookup is the hash, one load and the comparison.
+	// Empty slots have length 0, which no looked up name matches.
+	struct vocabulary_slot
+	{
+		const char* name;
+		size_t length;
+		net_status_code code;
+		bool category;
+	};
+
+	struct vocabulary_table
+	{
+		vocabulary_slot slots[256];
+	};
+
+	// The vocabulary laid out by slot, at compile time
+	constexpr vocabulary_table lay_out() noexcept
+	{
+		vocabulary_table table = {};
+		for( const auto& entry : VOCABULARY )
+		{
+			auto& target = table.slots[slot_of( entry )];
+			target.name = entry.name;
+			target.length = length_of( entry.name );
+			target.code = entry.code;
+			target.category = entry.category;
+		}
+		return table;
+	}
+
+	constexpr vocabulary_table TABLE = lay_out();
+
+	const vocabulary_slot* find_entry( string_ref name ) noexcept
+	{
+		if( name.size() < MIN_NAME_LENGTH )
+		{
+			return nullptr;
+		}
+
+		const auto& candidate = TABLE.slots[slot_of( name )];
+		return candidate.length == name.size() && same_name( candidate.name, name.data(), name.size() ) ? &candidate : nullptr;
+	}
+
+	// NetStream.Play -> NetStream.Play.Other, NetStream -> NetStream.Other
+	inline net_status_code other_of( net_status_code category ) noexcept
+	{
+		const auto value = static_cast<uint32>( category );
+		return static_cast<net_status_code>( ( value & 0x0fff0000 ) != 0 ? value | 0x00008000 : value | 0x08000000 );
+	}
+
+	// Codes missing from the vocabulary fall under the category named up to their second dot, or
+	// else under their root (the part up to root_end, the first dot)
+	net_status_code classify_below( string_ref code, size_t root_end, net_status_code root ) noexcept
+	{
+		const auto category_end = code.find( '.', root_end + 1 );
+		if( category_end != string_ref::npos )
+		{
+			const auto entry = find_entry( code.substr( 0, category_end ) );
+			if( entry != nullptr && entry->category )
+			{
+				return other_of( entry->code );
+			}
+		}
+		return other_of( root );
+	}
+
+	// The entry for a code in the vocabulary, categories excluded
+	inline const vocabulary_slot* find_code( string_ref code ) noexcept
+	{
+		const auto entry = find_entry( code );
+		return entry != nullptr && !entry->category ? entry : nullptr;
+	}
+
+}
+
+net_status_code mntone::rtmp::parse_net_status_code( string_ref code ) noexcept
+{
+	const auto entry = find_code( code );
+	if( entry != nullptr )
+	{
+		return entry->code;
+	}
+
+	const auto root_end = code.find( '.' );
+	if( root_end == string_ref::npos )
+	{
+		return net_status_code::other;
+	}
+	const auto root = find_entry( code.substr( 0, root_end ) );
+	return root != nullptr && root->category ? classify_below( code, root_end, root->code ) : net_status_code::other;
+}
+
+// The narrowed forms check the prefix first, which turns foreign codes away before hashing
+// anything and leaves less of an unknown code to classify
+net_status_code mntone::rtmp::parse_net_connection_connect_code( string_ref code ) noexcept
+{
+	if( !code.starts_with( "NetConnection.Connect." ) )
+	{
+		return net_status_code::net_connection_connect_other;
+	}
+
+	const auto entry = find_code( code );
+	return entry != nullptr ? entry->code : net_status_code::net_connection_connect_other;
+}
+
+net_status_code mntone::rtmp::parse_net_stream_code( string_ref code ) noexcept
+{
+	if( !code.starts_with( "NetStream." ) )
+	{
+		return net_status_code::net_stream_other;
+	}
+
+	const auto entry = find_code( code );
+	return entry != nullptr ? entry->code : classify_below( code, 9 /* NetStream */, net_status_code::net_stream );
+}
\ No newline at end of file
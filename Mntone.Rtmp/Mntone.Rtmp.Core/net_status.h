@@ -0,0 +1,141 @@
+#pragma once
+#include "string_ref.h"
+
+namespace mntone { namespace rtmp {
+
+	// Same values as Mntone::Rtmp::NetStatusCodeType, so the projection converts with a cast.
+	enum class net_status_code: uint32
+	{
+		// # NetConnection (0x1)
+		net_connection = 0x10000000,
+
+		// ## Connect (0x001)
+		net_connection_connect = 0x10010000,
+		net_connection_connect_success = 0x10010001,
+		net_connection_connect_closed = 0x10010002,
+		net_connection_connect_failed = 0x10010004,
+		net_connection_connect_rejected = 0x10010008,
+		net_connection_connect_invalid_app = 0x10010010,
+		net_connection_connect_app_shutdown = 0x10010020,
+		net_connection_connect_other = 0x10018000,
+
+		// ## Call (0x002)
+		net_connection_call = 0x10020000,
+		net_connection_call_failed = 0x10020001,
+		net_connection_call_prohibited = 0x10020002,
+		net_connection_call_bad_version = 0x10020004,
+		net_connection_call_other = 0x10028000,
+
+		// ## Other (0x800)
+		net_connection_other = 0x18000000,
+
+		// # NetStream (0x2)
+		net_stream = 0x20000000,
+
+		// ## Play (0x001)
+		net_stream_play = 0x20010000,
+		net_stream_play_start = 0x20010001,
+		net_stream_play_stop = 0x20010002,
+		net_stream_play_reset = 0x20010004,
+		net_stream_play_publish_notify = 0x20010008,
+		net_stream_play_unpublish_notify = 0x20010010,
+		net_stream_play_transition = 0x20010020,
+		net_stream_play_switch = 0x20010040,
+		net_stream_play_complete = 0x20010080,
+		net_stream_play_transition_complete = 0x20010100,
+		net_stream_play_insufficient_bandwidth = 0x20010200,
+		net_stream_play_failed = 0x20010400,
+		net_stream_play_stream_not_found = 0x20010800,
+		net_stream_play_file_structure_invalid = 0x20011000,
+		net_stream_play_no_supported_track_found = 0x20012000,
+		net_stream_play_other = 0x20018000,
+
+		// ## Pause (0x002)
+		net_stream_pause = 0x20020000,
+		net_stream_pause_notify = 0x20020001,
+		net_stream_pause_other = 0x20028000,
+
+		// ## Unpause (0x004)
+		net_stream_unpause = 0x20040000,
+		net_stream_unpause_notify = 0x20040001,
+		net_stream_unpause_other = 0x20048000,
+
+		// ## Seek (0x008)
+		net_stream_seek = 0x20080000,
+		net_stream_seek_notify = 0x20080001,
+		net_stream_seek_failed = 0x20080002,
+		net_stream_seek_invalid_time = 0x20080004,
+		net_stream_seek_other = 0x20088000,
+
+		// ## Publish (0x010)
+		net_stream_publish = 0x20100000,
+		net_stream_publish_start = 0x20100001,
+		net_stream_publish_idle = 0x20100002,
+		net_stream_publish_bad_name = 0x20100004,
+		net_stream_publish_other = 0x20108000,
+
+		// ## Unpublish (0x020)
+		net_stream_unpublish = 0x20200000,
+		net_stream_unpublish_success = 0x20200001,
+		net_stream_unpublish_other = 0x20208000,
+
+		// ## Record (0x040)
+		net_stream_record = 0x20400000,
+		net_stream_record_start = 0x20400001,
+		net_stream_record_stop = 0x20400002,
+		net_stream_record_no_access = 0x20400004,
+		net_stream_record_failed = 0x20400008,
+		net_stream_record_disk_quota_exceeded = 0x20400010,
+		net_stream_record_other = 0x20408000,
+
+		// ## Buffer (0x080)
+		net_stream_buffer = 0x20800000,
+		net_stream_buffer_empty = 0x20800001,
+		net_stream_buffer_full = 0x20800002,
+		net_stream_buffer_flush = 0x20800004,
+		net_stream_buffer_other = 0x20808000,
+
+		// ## MulticastStream (0x100)
+		net_stream_multicast_stream = 0x21000000,
+		net_stream_multicast_stream_reset = 0x21000001,
+		net_stream_multicast_stream_other = 0x21008000,
+
+		// ## Failed (0x200)
+		net_stream_failed = 0x22000000,
+
+		// ## Other (0x800)
+		net_stream_other = 0x28000000,
+
+		// # SharedObject (0x4)
+		shared_object = 0x40000000,
+		shared_object_flush = 0x40010000,
+		shared_object_flush_success = 0x40010001,
+		shared_object_flush_failed = 0x40010002,
+		shared_object_flush_other = 0x40018000,
+		shared_object_bad_persistence = 0x40020000,
+		shared_object_uri_mismatch = 0x40040000,
+		shared_object_other = 0x48000000,
+
+		// # Other (0x8)
+		other = 0x80000000,
+
+		// # Level Mask
+		level1_mask = 0xf0000000,
+		level2_mask = 0xffff0000,
+	};
+
+	inline net_status_code operator&( net_status_code lhs, net_status_code rhs ) noexcept
+	{
+		return static_cast<net_status_code>( static_cast<uint32>( lhs ) & static_cast<uint32>( rhs ) );
+	}
+
+	// Classifies the code of an onStatus or _result information object; a known code takes one
+	// table lookup, an unknown one up to two more. Unknown codes map to the Other value of the deepest category they name, e.g.
+	// NetStream.Play.Whatever to net_stream_play_other and Custom.Event to other.
+	net_status_code parse_net_status_code( string_ref code ) noexcept;
+
+	// As above, narrowed to NetConnection.Connect or NetStream; anything else is their Other
+	net_status_code parse_net_connection_connect_code( string_ref code ) noexcept;
+	net_status_code parse_net_stream_code( string_ref code ) noexcept;
+
+} }
\ No newline at end of file
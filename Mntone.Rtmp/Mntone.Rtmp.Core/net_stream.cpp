@@ -0,0 +1,738 @@
+#include "pch.h"
+#include "net_stream.h"
+#include "net_connection.h"
+#include "amf0.h"
+#include "amf0_reader.h"
+#include "amf0_writer.h"
+#include "commands.h"
+#include "Media/sound_info.h"
+#include "Media/adts_header.h"
+#include "Media/video_type.h"
+#include "Media/flv_tag.h"
+
+using namespace mntone::rtmp;
+using namespace mntone::rtmp::media;
+
+namespace {
+
+	const size_t FLV_TAG_HEADER_LENGTH = 11;
+	const size_t FLV_PREVIOUS_TAG_SIZE_LENGTH = 4;
+
+	// Outbound media chunk streams, apart from the connection's control (2) and command (3) streams.
+	// Each stays in one send_priority class.
+	const uint32 AUDIO_CHUNK_STREAM_ID = 4;
+	const uint32 DATA_CHUNK_STREAM_ID = 5;
+	const uint32 VIDEO_CHUNK_STREAM_ID = 6;
+
+	const uint8 AAC_SEQUENCE_HEADER = 0x00;
+	const uint8 AAC_RAW = 0x01;
+	const uint8 AVC_SEQUENCE_HEADER = 0x00;
+	const uint8 AVC_NALU = 0x01;
+
+	// Pool blocks reserved from onMetaData (see net_stream::reserve_buffers)
+	const float64 DEFAULT_FRAME_RATE = 30.0;
+	const uint32 DEFAULT_SAMPLE_RATE = 44100;
+	const float64 KEY_FRAME_SCALE = 8.0;
+	const float64 MAX_RESERVED_BYTES = 16.0 * 1024 * 1024;
+	const size_t RESERVED_FRAMES = 4;
+	const size_t RESERVED_KEY_FRAMES = 2;
+
+}
+
+net_stream::net_stream()
+	: parent_( nullptr )
+	, stream_id_( 0 )
+	, audio_enabled_( true ), audio_info_enabled_( false )
+	, video_enabled_( true ), video_info_enabled_( false )
+	, length_size_minus_one_( 0 )
+	, buffered_bytes_( 0 )
+	, delivered_timestamp_( 0 ), consumed_timestamp_( 0 )
+	, throttled_( false )
+	, throttled_since_( 0 )
+{ }
+
+net_stream::~net_stream()
+{ }
+
+void net_stream::on_attached( net_connection* parent, uint32 stream_id )
+{
+	{
+		std::lock_guard<std::mutex> publish_lock( publish_mutex_ );
+		std::lock_guard<std::mutex> lock( backpressure_mutex_ );
+		parent_ = parent;
+		stream_id_ = stream_id;
+	}
+	if( attached_handler_ )
+	{
+		attached_handler_();
+	}
+}
+
+void net_stream::on_detached() noexcept
+{
+	// Waits for a send in progress on another thread
+	std::lock_guard<std::mutex> publish_lock( publish_mutex_ );
+	std::lock_guard<std::mutex> lock( backpressure_mutex_ );
+
+	// The connection drops its own throttle state when it closes
+	end_throttle( false );
+	parent_ = nullptr;
+}
+
+void net_stream::close()
+{
+	net_connection* parent;
+	{
+		std::lock_guard<std::mutex> publish_lock( publish_mutex_ );
+		std::lock_guard<std::mutex> lock( backpressure_mutex_ );
+		end_throttle( true );
+		parent = parent_;
+		parent_ = nullptr;
+	}
+	if( parent != nullptr )
+	{
+		parent->detach( *this );
+	}
+}
+
+void net_stream::play( const std::string& stream_name, float64 start, float64 duration, int16 reset )
+{
+	const auto parent = parent_;
+	if( parent != nullptr )
+	{
+		parent->send_command( stream_id_, parent->command_templates().play( stream_name, start, duration, reset ) );
+	}
+}
+
+void net_stream::pause( float64 position )
+{
+	const auto parent = parent_;
+	if( parent != nullptr )
+	{
+		parent->send_command( stream_id_, parent->command_templates().pause( true, position ) );
+	}
+}
+
+void net_stream::resume( float64 position )
+{
+	const auto parent = parent_;
+	if( parent != nullptr )
+	{
+		parent->send_command( stream_id_, parent->command_templates().pause( false, position ) );
+	}
+}
+
+void net_stream::seek( float64 offset )
+{
+	const auto parent = parent_;
+	if( parent != nullptr )
+	{
+		parent->send_command( stream_id_, parent->command_templates().seek( offset ) );
+	}
+}
+
+#pragma region Publishing
+
+void net_stream::publish( const std::string& stream_name, const std::string& type )
+{
+	send_command( commands::publish( stream_name, type ) );
+}
+
+void net_stream::send_metadata( const amf_value& metadata )
+{
+	send_data( commands::set_data_frame( metadata ) );
+}
+
+void net_stream::send_data( const std::vector<uint8>& data )
+{
+	send_data( type_id_type::data_message_amf0, data );
+}
+
+void net_stream::send_data( const std::string& handler_name, const std::vector<amf_value>& arguments )
+{
+	object_encoding encoding;
+	{
+		std::lock_guard<std::mutex> lock( publish_mutex_ );
+		if( parent_ == nullptr )
+		{
+			return;
+		}
+		encoding = parent_->encoding();
+	}
+
+	std::vector<uint8> data;
+	amf0::writer writer( data );
+	if( encoding != object_encoding::amf3 )
+	{
+		writer.string( handler_name );
+		for( const auto& argument : arguments )
+		{
+			writer.value( argument );
+		}
+		send_data( type_id_type::data_message_amf0, data );
+		return;
+	}
+
+	// Format selector, the handler name in AMF0, then each argument switched to AMF3
+	data.push_back( 0 );
+	writer.string( handler_name );
+	for( const auto& argument : arguments )
+	{
+		writer.amf3( argument );
+	}
+	send_data( type_id_type::data_message_amf3, data );
+}
+
+void net_stream::send_data( type_id_type type, const std::vector<uint8>& data )
+{
+	std::lock_guard<std::mutex> lock( publish_mutex_ );
+	if( parent_ == nullptr )
+	{
+		return;
+	}
+
+	rtmp_header header( DATA_CHUNK_STREAM_ID );
+	header.timestamp = parent_->timestamp();
+	header.type_id = type;
+	header.stream_id = stream_id_;
+	parent_->send( send_priority::command, std::move( header ), data.data(), data.size() );
+}
+
+void net_stream::send_audio( const audio_frame& frame )
+{
+	// ---[ FLV audio tag header ]----------
+	const auto si = frame.info.get_info();
+	uint8 tag_header[2];
+	tag_header[0] = *reinterpret_cast<const uint8*>( &si );
+	size_t tag_header_length = 1;
+	if( si.format == sound_format::aac )
+	{
+		tag_header[1] = frame.sequence_header ? AAC_SEQUENCE_HEADER : AAC_RAW;
+		tag_header_length = 2;
+	}
+
+	std::lock_guard<std::mutex> lock( publish_mutex_ );
+	if( parent_ == nullptr )
+	{
+		return;
+	}
+
+	rtmp_header header( AUDIO_CHUNK_STREAM_ID );
+	header.timestamp = frame.timestamp;
+	header.type_id = type_id_type::audio_message;
+	header.stream_id = stream_id_;
+	parent_->send( send_priority::audio, std::move( header ), tag_header, tag_header_length, frame.data );
+}
+
+void net_stream::send_video( const video_frame& frame )
+{
+	// Held through the send, so the connection cannot detach the stream halfway
+	std::lock_guard<std::mutex> lock( publish_mutex_ );
+	if( parent_ == nullptr )
+	{
+		return;
+	}
+
+	const auto backlog = frame_dropper_.latency_budget() != 0 ? parent_->backlog().queue_delay_milliseconds : 0;
+	if( !frame_dropper_.admit( frame.format, frame.type, frame.sequence_header, frame.data, backlog ) )
+	{
+		return;
+	}
+
+	// ---[ FLV video tag header ]----------
+	uint8 tag_header[5];
+	tag_header[0] = static_cast<uint8>( static_cast<uint8>( frame.type ) << 4 | static_cast<uint8>( frame.format ) );
+	size_t tag_header_length = 1;
+	if( frame.format == video_format::avc )
+	{
+		// Composition time offset: signed 24 bit, big endian
+		const auto composition_time = static_cast<uint32>( frame.presentation_timestamp - frame.decode_timestamp );
+		tag_header[1] = frame.sequence_header ? AVC_SEQUENCE_HEADER : AVC_NALU;
+		tag_header[2] = static_cast<uint8>( composition_time >> 16 );
+		tag_header[3] = static_cast<uint8>( composition_time >> 8 );
+		tag_header[4] = static_cast<uint8>( composition_time );
+		tag_header_length = 5;
+	}
+
+	rtmp_header header( VIDEO_CHUNK_STREAM_ID );
+	header.timestamp = frame.decode_timestamp;
+	header.type_id = type_id_type::video_message;
+	header.stream_id = stream_id_;
+	parent_->send( send_priority::video, std::move( header ), tag_header, tag_header_length, frame.data );
+}
+
+void net_stream::set_latency_budget( uint32 milliseconds )
+{
+	std::lock_guard<std::mutex> lock( publish_mutex_ );
+	frame_dropper_.set_latency_budget( milliseconds );
+}
+
+drop_counters net_stream::drop_statistics() const
+{
+	std::lock_guard<std::mutex> lock( publish_mutex_ );
+	return frame_dropper_.counters();
+}
+
+#pragma endregion
+
+#pragma region Backpressure
+
+void net_stream::set_buffer_watermarks( const buffer_watermarks& watermarks )
+{
+	std::lock_guard<std::mutex> lock( backpressure_mutex_ );
+	watermarks_ = watermarks;
+	if( throttled_ && under_low_watermark() )
+	{
+		end_throttle( true );
+	}
+}
+
+void net_stream::consumed( size_t bytes, int64 timestamp )
+{
+	std::lock_guard<std::mutex> lock( backpressure_mutex_ );
+	buffered_bytes_ -= std::min( bytes, buffered_bytes_ );
+	consumed_timestamp_ = std::max( consumed_timestamp_, timestamp );
+	if( throttled_ && under_low_watermark() )
+	{
+		end_throttle( true );
+	}
+}
+
+throttle_counters net_stream::throttle_statistics() const
+{
+	std::lock_guard<std::mutex> lock( backpressure_mutex_ );
+	auto counters = throttle_counters_;
+	if( throttled_ )
+	{
+		counters.throttled_milliseconds += utility::hundred_nano_to_milli( utility::get_windows_time() - throttled_since_ );
+	}
+	return counters;
+}
+
+void net_stream::deliver( const audio_sample& sample )
+{
+	on_delivered( sample.data.size(), sample.timestamp );
+	audio_handler_( sample );
+}
+
+void net_stream::deliver( const video_sample& sample )
+{
+	on_delivered( sample.data.size(), sample.decode_timestamp );
+	video_handler_( sample );
+}
+
+// Counted before the handler runs, so a consumer that reports synchronously never underflows
+void net_stream::on_delivered( size_t bytes, int64 timestamp )
+{
+	std::lock_guard<std::mutex> lock( backpressure_mutex_ );
+	if( !watermarks_.enabled() )
+	{
+		return;
+	}
+
+	if( buffered_bytes_ == 0 )
+	{
+		consumed_timestamp_ = timestamp;
+	}
+	buffered_bytes_ += bytes;
+	delivered_timestamp_ = std::max( delivered_timestamp_, timestamp );
+
+	if( !throttled_ && over_high_watermark() && parent_ != nullptr )
+	{
+		throttled_ = true;
+		throttled_since_ = utility::get_windows_time();
+		++throttle_counters_.throttle_count;
+		parent_->on_stream_throttled( true );
+	}
+}
+
+bool net_stream::over_high_watermark() const noexcept
+{
+	const auto duration = delivered_timestamp_ - consumed_timestamp_;
+	return ( watermarks_.high_bytes != 0 && buffered_bytes_ >= watermarks_.high_bytes )
+		|| ( watermarks_.high_milliseconds != 0 && duration >= watermarks_.high_milliseconds );
+}
+
+bool net_stream::under_low_watermark() const noexcept
+{
+	const auto duration = buffered_bytes_ != 0 ? delivered_timestamp_ - consumed_timestamp_ : 0;
+	return ( watermarks_.high_bytes == 0 || buffered_bytes_ <= watermarks_.low_bytes )
+		&& ( watermarks_.high_milliseconds == 0 || duration <= watermarks_.low_milliseconds );
+}
+
+// backpressure_mutex_ must be held
+void net_stream::end_throttle( bool notify_parent )
+{
+	if( !throttled_ )
+	{
+		return;
+	}
+
+	throttled_ = false;
+	throttle_counters_.throttled_milliseconds += utility::hundred_nano_to_milli( utility::get_windows_time() - throttled_since_ );
+	if( notify_parent && parent_ != nullptr )
+	{
+		parent_->on_stream_throttled( false );
+	}
+}
+
+#pragma endregion
+
+void net_stream::send_command( const std::vector<uint8>& command )
+{
+	if( parent_ != nullptr )
+	{
+		parent_->send_command( stream_id_, command );
+	}
+}
+
+void net_stream::on_message( rtmp_header header, byte_slice data )
+{
+	switch( header.type_id )
+	{
+	case type_id_type::audio_message:
+		on_audio_message( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::video_message:
+		on_video_message( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::data_message_amf0:
+		on_data_message( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::command_message_amf0:
+		on_command_message( std::move( header ), std::move( data ) );
+		break;
+
+	case type_id_type::aggregate_message:
+		on_aggregate_message( std::move( header ), std::move( data ) );
+		break;
+	}
+}
+
+void net_stream::on_audio_message( rtmp_header header, byte_slice data )
+{
+	if( data.empty() )
+	{
+		return;
+	}
+
+	const auto& si = *reinterpret_cast<const sound_info*>( data.data() );
+
+	if( si.format == sound_format::aac )
+	{
+		if( data.size() < 3 )
+		{
+			return;
+		}
+
+		if( data[1] == 0x01 )
+		{
+			if( audio_handler_ )
+			{
+				audio_sample sample;
+				sample.info = audio_info_;
+				sample.timestamp = header.timestamp;
+				sample.data = data.slice( 2 );
+				deliver( sample );
+			}
+		}
+		else if( data[1] == 0x00 && !audio_info_enabled_ )
+		{
+			const auto& adts = *reinterpret_cast<const adts_header*>( data.data() );
+			audio_info_.format = audio_format::aac;
+			audio_info_.sample_rate = metadata_.audio_sample_rate != 0 ? metadata_.audio_sample_rate : adts.sampling_frequency();
+			audio_info_.channel_count = adts.channel_configuration();
+			audio_info_.bits_per_sample = si.size == sound_size::s16bit ? 16 : 8;
+			audio_info_.bitrate = static_cast<uint16>( metadata_.audio_data_rate );
+			audio_info_enabled_ = true;
+			if( audio_started_handler_ )
+			{
+				audio_started_handler_( !video_enabled_, audio_info_ );
+			}
+		}
+		return;
+	}
+
+	if( !audio_info_enabled_ )
+	{
+		audio_info_.set_info( si );
+		audio_info_.bitrate = static_cast<uint16>( metadata_.audio_data_rate );
+		audio_info_enabled_ = true;
+		if( audio_started_handler_ )
+		{
+			audio_started_handler_( !video_enabled_, audio_info_ );
+		}
+	}
+
+	if( audio_handler_ )
+	{
+		audio_sample sample;
+		sample.info = audio_info_;
+		sample.timestamp = header.timestamp;
+		sample.data = data.slice( 1 );
+		deliver( sample );
+	}
+}
+
+void net_stream::on_video_message( rtmp_header header, byte_slice data )
+{
+	if( data.empty() )
+	{
+		return;
+	}
+
+	const auto& vt = static_cast<video_type>( ( data[0] >> 4 ) & 0x0f );
+	const auto& vf = static_cast<video_format>( data[0] & 0x0f );
+
+	video_sample sample;
+	sample.keyframe = vt == video_type::keyframe;
+	sample.decode_timestamp = header.timestamp;
+
+	if( vf == video_format::avc )
+	{
+		// Need to convert NAL file stream to byte stream
+		analysis_avc( std::move( header ), std::move( data ), sample );
+		return;
+	}
+
+	if( !video_info_enabled_ )
+	{
+		video_info_.format = vf;
+		video_info_.bitrate = static_cast<uint16>( metadata_.video_data_rate );
+		video_info_.height = metadata_.height;
+		video_info_.width = metadata_.width;
+		video_info_enabled_ = true;
+		if( video_started_handler_ )
+		{
+			video_started_handler_( !audio_enabled_, video_info_ );
+		}
+	}
+
+	if( video_handler_ )
+	{
+		sample.info = video_info_;
+		sample.presentation_timestamp = header.timestamp;
+		sample.data = data.slice( 1 );
+		deliver( sample );
+	}
+}
+
+void net_stream::on_data_message( rtmp_header /*header*/, byte_slice data )
+{
+	amf0::reader reader( data.data(), data.size() );
+	if( reader.next() != amf0::token::string || reader.string() != "onMetaData" )
+	{
+		return;
+	}
+
+	const auto container = reader.next();
+	if( container != amf0::token::object_begin && container != amf0::token::ecma_array_begin )
+	{
+		return;
+	}
+
+	// One pass over the properties straight into the typed fields. Codec ids are numbers, or
+	// FourCC strings from some encoders; either way they declare the track.
+	media::stream_metadata metadata;
+	for( ;; )
+	{
+		const auto value = reader.next();
+		if( value == amf0::token::object_end || value == amf0::token::error )
+		{
+			break;
+		}
+
+		const auto name = reader.name();
+		if( name == "videocodecid" )
+		{
+			metadata.has_video = true;
+			if( value == amf0::token::number )
+				metadata.video_codec_id = static_cast<uint8>( reader.number() );
+		}
+		else if( name == "audiocodecid" )
+		{
+			metadata.has_audio = true;
+			if( value == amf0::token::number )
+				metadata.audio_codec_id = static_cast<uint8>( reader.number() );
+		}
+		else if( value == amf0::token::number )
+		{
+			const auto number = reader.number();
+			if( name == "duration" )
+				metadata.duration = number;
+			else if( name == "filesize" )
+				metadata.file_size = number;
+			else if( name == "width" )
+				metadata.width = static_cast<uint16>( number );
+			else if( name == "height" )
+				metadata.height = static_cast<uint16>( number );
+			else if( name == "videodatarate" )
+				metadata.video_data_rate = number;
+			else if( name == "framerate" )
+				metadata.frame_rate = number;
+			else if( name == "audiodatarate" )
+				metadata.audio_data_rate = number;
+			else if( name == "audiosamplerate" )
+				metadata.audio_sample_rate = static_cast<uint32>( number );
+			else if( name == "audiosamplesize" )
+				metadata.audio_sample_size = static_cast<uint16>( number );
+		}
+		else if( value == amf0::token::boolean && name == "stereo" )
+			metadata.stereo = reader.boolean();
+		else if( value == amf0::token::string && name == "encoder" )
+			metadata.encoder.assign( reader.string().data(), reader.string().size() );
+		else if( value == amf0::token::object_begin && name == "keyframes" )
+		{
+			// { times: [seconds...], filepositions: [bytes...] }
+			for( ;; )
+			{
+				const auto index = reader.next();
+				if( index == amf0::token::object_end || index == amf0::token::error )
+				{
+					break;
+				}
+
+				std::vector<float64>* column = nullptr;
+				if( index == amf0::token::strict_array_begin )
+				{
+					if( reader.name() == "times" )
+						column = &metadata.keyframe_times;
+					else if( reader.name() == "filepositions" )
+						column = &metadata.keyframe_positions;
+				}
+				if( column == nullptr )
+				{
+					if( !reader.skip() )
+					{
+						break;
+					}
+					continue;
+				}
+
+				for( ;; )
+				{
+					const auto element = reader.next();
+					if( element == amf0::token::array_end || element == amf0::token::error )
+					{
+						break;
+					}
+					if( element == amf0::token::number )
+						column->push_back( reader.number() );
+					else if( !reader.skip() )
+					{
+						break;
+					}
+				}
+			}
+			continue;
+		}
+
+		if( !reader.skip() )
+		{
+			break;
+		}
+	}
+
+	video_enabled_ = metadata.has_video;
+	audio_enabled_ = metadata.has_audio;
+	metadata_ = std::move( metadata );
+	reserve_buffers();
+
+	if( metadata_handler_ )
+	{
+		metadata_handler_( metadata_ );
+	}
+}
+
+// Warms the connection's pool for the bodies the declared rates imply: each frame is reassembled
+// into one block and, for AVC, rewritten into a second. Key frames are sized at several average
+// frames, since an encoder spends a good part of a GOP's bits on them.
+void net_stream::reserve_buffers()
+{
+	if( parent_ == nullptr )
+	{
+		return;
+	}
+
+	auto& pool = parent_->pool();
+	if( metadata_.has_video && metadata_.video_data_rate > 0.0 )
+	{
+		const auto frame_rate = metadata_.frame_rate > 0.0 ? metadata_.frame_rate : DEFAULT_FRAME_RATE;
+		const auto frame_bytes = std::min( metadata_.video_data_rate * 1000.0 / 8.0 / frame_rate, MAX_RESERVED_BYTES );
+		pool.reserve( static_cast<uint32>( frame_bytes ), RESERVED_FRAMES );
+		pool.reserve( static_cast<uint32>( std::min( frame_bytes * KEY_FRAME_SCALE, MAX_RESERVED_BYTES ) ), RESERVED_KEY_FRAMES );
+	}
+	if( metadata_.has_audio && metadata_.audio_data_rate > 0.0 )
+	{
+		// AAC frames: 1024 samples
+		const auto sample_rate = metadata_.audio_sample_rate != 0 ? metadata_.audio_sample_rate : DEFAULT_SAMPLE_RATE;
+		const auto frame_bytes = std::min( metadata_.audio_data_rate * 1000.0 / 8.0 * 1024.0 / sample_rate, MAX_RESERVED_BYTES );
+		pool.reserve( static_cast<uint32>( frame_bytes ), RESERVED_FRAMES );
+	}
+}
+
+void net_stream::on_command_message( rtmp_header /*header*/, byte_slice data )
+{
+	// onStatus, transaction id, null command object, then the information object
+	amf0::reader reader( data.data(), data.size() );
+	if( reader.next() != amf0::token::string || reader.string() != "onStatus" || reader.next() != amf0::token::number )
+	{
+		return;
+	}
+
+	reader.next();
+	if( !reader.skip() || reader.next() != amf0::token::object_begin || !reader.find( "code" ) || reader.current() != amf0::token::string )
+	{
+		return;
+	}
+
+	if( status_handler_ )
+	{
+		status_handler_( parse_net_stream_code( reader.string() ) );
+	}
+}
+
+void net_stream::on_aggregate_message( rtmp_header header, byte_slice data )
+{
+	if( data.size() < FLV_TAG_HEADER_LENGTH )
+	{
+		return;
+	}
+
+	size_t offset = 0;
+	do
+	{
+		const auto& tag = *reinterpret_cast<const flv_tag*>( data.data() + offset );
+		offset += FLV_TAG_HEADER_LENGTH;
+
+		auto clone_header = header;
+		clone_header.timestamp = tag.timestamp();
+		clone_header.type_id = static_cast<type_id_type>( tag.tag_type() );
+
+		const auto data_size = tag.data_size();
+		if( offset + data_size > data.size() )
+		{
+			break;
+		}
+
+		auto subset_data = data.slice( offset, data_size );
+		switch( tag.tag_type() )
+		{
+		case flv_tag_type::audio:
+			on_audio_message( std::move( clone_header ), std::move( subset_data ) );
+			break;
+
+		case flv_tag_type::video:
+			on_video_message( std::move( clone_header ), std::move( subset_data ) );
+			break;
+
+		case flv_tag_type::script_data:
+			on_data_message( std::move( clone_header ), std::move( subset_data ) );
+			break;
+		}
+		offset += data_size + FLV_PREVIOUS_TAG_SIZE_LENGTH;
+	} while( offset + FLV_TAG_HEADER_LENGTH <= data.size() );
+}
\ No newline at end of file
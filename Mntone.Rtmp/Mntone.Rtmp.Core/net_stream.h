@@ -0,0 +1,212 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <string>
+#include "backpressure.h"
+#include "frame_dropper.h"
+#include "byte_slice.h"
+#include "rtmp_header.h"
+#include "net_status.h"
+#include "Media/audio_info.h"
+#include "Media/video_info.h"
+#include "Media/video_type.h"
+#include "Media/stream_metadata.h"
+#include "amf_value.h"
+
+namespace mntone { namespace rtmp {
+
+	class net_connection;
+
+	struct audio_sample
+	{
+		media::audio_info info;
+		int64 timestamp;
+
+		// Codec payload without the FLV audio tag header
+		byte_slice data;
+	};
+
+	struct video_sample
+	{
+		media::video_info info;
+		bool keyframe;
+		int64 decode_timestamp, presentation_timestamp;
+
+		// Codec payload without the FLV video tag header (Annex B byte stream for AVC)
+		byte_slice data;
+	};
+
+	// Outgoing counterpart of audio_sample
+	struct audio_frame
+	{
+		audio_frame()
+			: sequence_header( false )
+			, timestamp( 0 )
+		{ }
+
+		media::audio_info info;
+
+		// AAC only: data is the AudioSpecificConfig rather than a raw frame
+		bool sequence_header;
+		int64 timestamp;
+
+		// Codec payload without the FLV audio tag header, usually filled from net_connection::pool().
+		// The send queue references it until it is written; the bytes are never copied.
+		byte_slice data;
+	};
+
+	// Outgoing counterpart of video_sample
+	struct video_frame
+	{
+		video_frame()
+			: format( media::video_format::avc )
+			, type( media::video_type::interframe )
+			, sequence_header( false )
+			, decode_timestamp( 0 ), presentation_timestamp( 0 )
+		{ }
+
+		media::video_format format;
+		media::video_type type;
+
+		// AVC only: data is the AVCDecoderConfigurationRecord rather than NAL units
+		bool sequence_header;
+		int64 decode_timestamp, presentation_timestamp;
+
+		// Codec payload without the FLV video tag header (length-prefixed NAL units for AVC), referenced like audio_frame::data
+		byte_slice data;
+	};
+
+	// One message stream of a net_connection: play control and media demultiplexing, or publishing.
+	class net_stream final
+	{
+	public:
+		typedef std::function<void()> attached_handler;
+		typedef std::function<void( net_status_code code )> status_handler;
+		typedef std::function<void( const media::stream_metadata& metadata )> metadata_handler;
+		typedef std::function<void( bool audio_only, const media::audio_info& info )> audio_started_handler;
+		typedef std::function<void( const audio_sample& sample )> audio_handler;
+		typedef std::function<void( bool video_only, const media::video_info& info )> video_started_handler;
+		typedef std::function<void( const video_sample& sample )> video_handler;
+
+		net_stream( const net_stream& ) = delete;
+		net_stream& operator=( const net_stream& ) = delete;
+
+		net_stream();
+		~net_stream();
+
+		void play( const std::string& stream_name, float64 start = -2.0, float64 duration = -1.0, int16 reset = -1 );
+		void pause( float64 position );
+		void resume( float64 position );
+		void seek( float64 offset );
+
+		// type: "live", "record" or "append". Media may follow right away; the server reports
+		// NetStream.Publish.Start through the status handler.
+		void publish( const std::string& stream_name, const std::string& type = "live" );
+
+		// Publishing sends; thread-safe. Audio, video and data use chunk streams of their own, so
+		// the connection interleaves them chunk by chunk instead of message by message.
+		void send_metadata( const amf_value& metadata );
+		void send_data( const std::vector<uint8>& data );
+
+		// Data message calling handler_name on subscribers (onCuePoint, |RtmpSampleAccess, ...). Once
+		// the connection has agreed on AMF3 it goes out as an AMF3 data message, whose string and
+		// trait references shrink repeated property names. Metadata stays AMF0 for ingest servers.
+		void send_data( const std::string& handler_name, const std::vector<amf_value>& arguments );
+		void send_audio( const audio_frame& frame );
+		void send_video( const video_frame& frame );
+
+		// Video frames are dropped while queued media is older than the budget (see frame_dropper);
+		// audio and sequence headers always go. 0, the default, sends everything. Thread-safe.
+		void set_latency_budget( uint32 milliseconds );
+		drop_counters drop_statistics() const;
+
+		// Sends closeStream and unbinds the stream from its connection
+		void close();
+
+		// Backpressure: the consumer reports each audio/video sample it is done with, giving the
+		// sample's data size and timestamp. Thread-safe.
+		void set_buffer_watermarks( const buffer_watermarks& watermarks );
+		void consumed( size_t bytes, int64 timestamp );
+		throttle_counters throttle_statistics() const;
+
+		bool attached() const noexcept { return parent_ != nullptr; }
+		uint32 stream_id() const noexcept { return stream_id_; }
+
+		void set_attached_handler( attached_handler handler ) { attached_handler_ = std::move( handler ); }
+		void set_status_handler( status_handler handler ) { status_handler_ = std::move( handler ); }
+
+		// onMetaData, read in one pass ahead of the media it describes. The declared bitrates also
+		// pre-allocate pool blocks for the frames to come, so the first key frame finds one ready.
+		void set_metadata_handler( metadata_handler handler ) { metadata_handler_ = std::move( handler ); }
+		void set_audio_started_handler( audio_started_handler handler ) { audio_started_handler_ = std::move( handler ); }
+		void set_audio_handler( audio_handler handler ) { audio_handler_ = std::move( handler ); }
+		void set_video_started_handler( video_started_handler handler ) { video_started_handler_ = std::move( handler ); }
+		void set_video_handler( video_handler handler ) { video_handler_ = std::move( handler ); }
+
+	private:
+		friend class net_connection;
+
+		void on_attached( net_connection* parent, uint32 stream_id );
+		void on_detached() noexcept;
+
+		void on_message( rtmp_header header, byte_slice data );
+		void on_audio_message( rtmp_header header, byte_slice data );
+		void on_video_message( rtmp_header header, byte_slice data );
+		void on_data_message( rtmp_header header, byte_slice data );
+		void on_command_message( rtmp_header header, byte_slice data );
+		void on_aggregate_message( rtmp_header header, byte_slice data );
+
+		void analysis_avc( rtmp_header header, byte_slice data, video_sample& sample );
+		void reserve_buffers();
+
+		void deliver( const audio_sample& sample );
+		void deliver( const video_sample& sample );
+		void on_delivered( size_t bytes, int64 timestamp );
+		bool over_high_watermark() const noexcept;
+		bool under_low_watermark() const noexcept;
+		void end_throttle( bool notify_parent );
+
+		void send_command( const std::vector<uint8>& command );
+		void send_data( type_id_type type, const std::vector<uint8>& data );
+
+	private:
+		// Written holding both publish_mutex_ and backpressure_mutex_, so either one is enough to
+		// read it from a thread other than the connection's
+		net_connection* parent_;
+		uint32 stream_id_;
+
+		bool audio_enabled_, audio_info_enabled_;
+		media::audio_info audio_info_;
+
+		bool video_enabled_, video_info_enabled_;
+		media::video_info video_info_;
+
+		// Latest onMetaData; fills in what the codec headers leave out
+		media::stream_metadata metadata_;
+
+		// for Avc
+		uint8 length_size_minus_one_;
+
+		// Publishing
+		mutable std::mutex publish_mutex_;
+		frame_dropper frame_dropper_;
+
+		// Media handed to the consumer and not reported back through consumed()
+		mutable std::mutex backpressure_mutex_;
+		buffer_watermarks watermarks_;
+		size_t buffered_bytes_;
+		int64 delivered_timestamp_, consumed_timestamp_;
+		bool throttled_;
+		int64 throttled_since_;
+		throttle_counters throttle_counters_;
+
+		attached_handler attached_handler_;
+		status_handler status_handler_;
+		metadata_handler metadata_handler_;
+		audio_started_handler audio_started_handler_;
+		audio_handler audio_handler_;
+		video_started_handler video_started_handler_;
+		video_handler video_handler_;
+	};
+
+} }
\ No newline at end of file
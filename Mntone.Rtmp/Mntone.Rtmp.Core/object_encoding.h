@@ -0,0 +1,12 @@
+#pragma once
+
+namespace mntone { namespace rtmp {
+
+	// objectEncoding of the connect command: the AMF version offered for commands and data
+	enum class object_encoding: uint8
+	{
+		amf0 = 0,
+		amf3 = 3,
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+namespace mntone { namespace rtmp {
+
+	// Outbound side of a connection as a publisher sees it
+	struct send_backlog
+	{
+		send_backlog()
+			: queued_bytes( 0 ), in_flight_bytes( 0 )
+			, unacknowledged_bytes( 0 ), window_size( 0 )
+			, queue_delay_milliseconds( 0 )
+			, window_stall_count( 0 )
+		{ }
+
+		// Chunked and waiting in the send queue / handed to the transport and not yet drained
+		size_t queued_bytes, in_flight_bytes;
+
+		// Sent and not yet acknowledged, against the peer's Set Peer Bandwidth window
+		uint64 unacknowledged_bytes;
+		uint32 window_size;
+
+		// Time the oldest queued audio or video message has been waiting
+		uint32 queue_delay_milliseconds;
+
+		// Number of times sending stopped at a full window
+		uint64 window_stall_count;
+	};
+
+	struct drop_counters
+	{
+		drop_counters()
+			: non_reference_frames( 0 )
+			, gops( 0 ), gop_frames( 0 )
+			, bytes( 0 )
+		{ }
+
+		// Frames no other frame refers to, dropped over the latency budget
+		uint64 non_reference_frames;
+
+		// GOP drops begun past twice the budget, and the frames they took, key frames included
+		uint64 gops, gop_frames;
+
+		// Payload bytes of every dropped frame
+		uint64 bytes;
+	};
+
+} }
\ No newline at end of file
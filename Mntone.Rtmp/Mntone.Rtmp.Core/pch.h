@@ -0,0 +1,31 @@
+#pragma once
+
+// STL Headers:
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Fixed width types (provided by the compiler under C++/CX)
+typedef std::int8_t int8;
+typedef std::uint8_t uint8;
+typedef std::int16_t int16;
+typedef std::uint16_t uint16;
+typedef std::int32_t int32;
+typedef std::uint32_t uint32;
+typedef std::int64_t int64;
+typedef std::uint64_t uint64;
+typedef float float32;
+typedef double float64;
+typedef char16_t char16;
+
+// This Project Headers:
+#include "utility.h"
\ No newline at end of file
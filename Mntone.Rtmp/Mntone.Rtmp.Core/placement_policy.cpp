@@ -0,0 +1,25 @@
+#include "pch.h"
+#include "placement_policy.h"
+
+using namespace mntone::rtmp;
+
+size_t round_robin_placement::place( const std::vector<shard_load>& loads )
+{
+	return next_++ % loads.size();
+}
+
+size_t least_loaded_placement::place( const std::vector<shard_load>& loads )
+{
+	size_t best = 0;
+	for( size_t i = 1; i < loads.size(); ++i )
+	{
+		const auto& load = loads[i];
+		const auto& best_load = loads[best];
+		if( load.bytes_per_second < best_load.bytes_per_second
+			|| ( load.bytes_per_second == best_load.bytes_per_second && load.connections < best_load.connections ) )
+		{
+			best = i;
+		}
+	}
+	return best;
+}
\ No newline at end of file
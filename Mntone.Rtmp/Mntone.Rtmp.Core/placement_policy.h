@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+namespace mntone { namespace rtmp {
+
+	// What a placement policy sees of one shard when a connection is placed.
+	struct shard_load
+	{
+		size_t connections;
+		float64 bytes_per_second;
+	};
+
+	// Picks the shard (index into loads) that owns the next connection.
+	// Called from whichever thread creates the connection.
+	class placement_policy
+	{
+	public:
+		virtual ~placement_policy() { }
+
+		virtual size_t place( const std::vector<shard_load>& loads ) = 0;
+	};
+
+	class round_robin_placement final
+		: public placement_policy
+	{
+	public:
+		round_robin_placement()
+			: next_( 0 )
+		{ }
+
+		virtual size_t place( const std::vector<shard_load>& loads ) override;
+
+	private:
+		std::atomic<size_t> next_;
+	};
+
+	// Lowest received bytes/sec wins; connection count breaks ties, so a burst of new, still idle
+	// connections spreads across the shards instead of piling onto one.
+	class least_loaded_placement final
+		: public placement_policy
+	{
+	public:
+		virtual size_t place( const std::vector<shard_load>& loads ) override;
+	};
+
+} }
\ No newline at end of file
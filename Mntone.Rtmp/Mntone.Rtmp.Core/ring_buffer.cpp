@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "ring_buffer.h"
+
+using namespace mntone::rtmp;
+
+ring_buffer::ring_buffer( size_t capacity )
+	: head_( 0 )
+	, tail_( 0 )
+{
+	size_t rounded_capacity = 1;
+	while( rounded_capacity < capacity )
+	{
+		rounded_capacity <<= 1;
+	}
+	buffer_.resize( rounded_capacity );
+	mask_ = rounded_capacity - 1;
+}
+
+size_t ring_buffer::write_length() const noexcept
+{
+	const auto position = tail_ & mask_;
+	const auto until_end = capacity() - position;
+	return std::min( until_end, space() );
+}
+
+void ring_buffer::commit( size_t length ) noexcept
+{
+	tail_ += length;
+}
+
+size_t ring_buffer::read_length() const noexcept
+{
+	const auto position = head_ & mask_;
+	const auto until_end = capacity() - position;
+	return std::min( until_end, size() );
+}
+
+void ring_buffer::peek( uint8* destination, size_t length ) const noexcept
+{
+	const auto position = head_ & mask_;
+	const auto first_length = std::min( length, capacity() - position );
+	memcpy( destination, buffer_.data() + position, first_length );
+	if( first_length != length )
+	{
+		memcpy( destination + first_length, buffer_.data(), length - first_length );
+	}
+}
+
+void ring_buffer::read( uint8* destination, size_t length ) noexcept
+{
+	peek( destination, length );
+	consume( length );
+}
+
+void ring_buffer::consume( size_t length ) noexcept
+{
+	head_ += length;
+
+	// Rewind when drained so the next write gets the whole buffer as one contiguous region
+	if( head_ == tail_ )
+	{
+		head_ = tail_ = 0;
+	}
+}
\ No newline at end of file
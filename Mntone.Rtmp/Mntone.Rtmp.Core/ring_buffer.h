@@ -0,0 +1,43 @@
+#pragma once
+
+namespace mntone { namespace rtmp {
+
+	// Fixed-capacity byte ring used as the receive buffer of a connection.
+	// The capacity is rounded up to a power of two so that positions can run freely and be masked.
+	class ring_buffer final
+	{
+	public:
+		ring_buffer() = delete;
+		ring_buffer( const ring_buffer& ) = delete;
+		ring_buffer& operator=( const ring_buffer& ) = delete;
+
+		explicit ring_buffer( size_t capacity );
+
+		size_t size() const noexcept { return tail_ - head_; }
+		size_t capacity() const noexcept { return buffer_.size(); }
+		size_t space() const noexcept { return capacity() - size(); }
+		bool empty() const noexcept { return head_ == tail_; }
+
+		// Contiguous free region at the tail. Fill it, then call commit.
+		uint8* write_pointer() noexcept { return buffer_.data() + ( tail_ & mask_ ); }
+		size_t write_length() const noexcept;
+		void commit( size_t length ) noexcept;
+
+		// Contiguous readable region at the head.
+		const uint8* read_pointer() const noexcept { return buffer_.data() + ( head_ & mask_ ); }
+		size_t read_length() const noexcept;
+
+		// Copy bytes from the head across the wrap point; peek leaves them in the buffer.
+		void peek( uint8* destination, size_t length ) const noexcept;
+		void read( uint8* destination, size_t length ) noexcept;
+		void consume( size_t length ) noexcept;
+
+		void clear() noexcept { head_ = tail_ = 0; }
+
+	private:
+		std::vector<uint8> buffer_;
+		size_t mask_;
+		size_t head_, tail_;
+	};
+
+} }
\ No newline at end of file
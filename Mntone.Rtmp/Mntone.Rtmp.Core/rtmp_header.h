@@ -6,7 +6,7 @@ namespace mntone { namespace rtmp {
 
 	struct rtmp_header
 	{
-		explicit rtmp_header( uint16 chunk_stream_id )
+		explicit rtmp_header( uint32 chunk_stream_id )
 			: chunk_stream_id( chunk_stream_id )
 			, timestamp( 0 )
 			, timestamp_delta( 0 )
@@ -14,11 +14,12 @@ namespace mntone { namespace rtmp {
 			, stream_id( 0 )
 		{ }
 
-		uint16 chunk_stream_id;
+		// 2-65599 on the wire
+		uint32 chunk_stream_id;
 		int64 timestamp, timestamp_delta;
 		uint32 length;
 		type_id_type type_id;
 		uint32 stream_id;
 	};
 
-} }
+} }
\ No newline at end of file
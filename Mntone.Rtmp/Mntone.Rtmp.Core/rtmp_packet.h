@@ -1,17 +1,24 @@
 #pragma once
 #include "rtmp_header.h"
+#include "body_pool.h"
 
 namespace mntone { namespace rtmp {
 
 	class rtmp_packet final
 	{
 	public:
-		rtmp_packet() = delete;
+		rtmp_packet()
+			: header_( 0 )
+			, temporary_length_( 0 )
+			, extended_timestamp_( false )
+		{ }
+
 		rtmp_packet( const rtmp_packet& ) = delete;
 		rtmp_packet( rtmp_packet&& rhs )
 			: header_( rhs.header_ )
 		{
 			temporary_length_ = std::move( rhs.temporary_length_ );
+			extended_timestamp_ = std::move( rhs.extended_timestamp_ );
 			body_ = std::move( rhs.body_ );
 		}
 
@@ -20,19 +27,22 @@ namespace mntone { namespace rtmp {
 		{
 			header_ = rhs.header_;
 			temporary_length_ = std::move( rhs.temporary_length_ );
+			extended_timestamp_ = std::move( rhs.extended_timestamp_ );
 			body_ = std::move( rhs.body_ );
 			return *this;
 		}
 
-		explicit rtmp_packet( uint16 chunk_stream_id )
+		explicit rtmp_packet( uint32 chunk_stream_id )
 			: header_( chunk_stream_id )
 			, temporary_length_( 0 )
+			, extended_timestamp_( false )
 		{ }
 
 	public:
 		rtmp_header header_;
 		uint32 temporary_length_;
-		std::unique_ptr<std::vector<uint8>> body_;
+		bool extended_timestamp_;
+		pooled_buffer body_;
 	};
 
-} }
+} }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "send_queue.h"
+
+using namespace mntone::rtmp;
+
+send_queue::send_queue()
+	: size_( 0 )
+{
+	std::fill_n( sizes_, priority_count, 0 );
+}
+
+void send_queue::push( send_priority priority, gather_buffer message, const chunk_layout& layout, int64 queued_at )
+{
+	const auto index = static_cast<size_t>( priority );
+	size_ += message.size();
+	sizes_[index] += message.size();
+	queues_[index].push_back( { std::move( message ), layout, 0, queued_at } );
+}
+
+void send_queue::pop( size_t max_length, gather_buffer& out, send_priority lowest )
+{
+	size_t popped = 0;
+	for( size_t index = 0; index <= static_cast<size_t>( lowest ); ++index )
+	{
+		auto& queue = queues_[index];
+		auto limit = max_length;
+		if( index == static_cast<size_t>( send_priority::video ) && policy_.max_video_bytes_before_yield != 0 )
+		{
+			limit = std::min( limit, popped + policy_.max_video_bytes_before_yield );
+		}
+
+		while( !queue.empty() )
+		{
+			auto& front = queue.front();
+			const auto room = limit - std::min( popped, limit );
+			const auto remaining = front.data.size();
+			if( remaining <= room )
+			{
+				out.append( std::move( front.data ) );
+				popped += remaining;
+				size_ -= remaining;
+				sizes_[index] -= remaining;
+				queue.pop_front();
+				continue;
+			}
+
+			// Whole chunks up to the room left
+			const auto& layout = front.layout;
+			auto body = front.body_popped;
+			size_t length = 0;
+			do
+			{
+				const auto header_length = length == 0 && remaining == layout.wire_length() ? layout.first_header_length : layout.continuation_header_length;
+				const auto chunk_length = header_length + std::min<size_t>( layout.chunk_size, layout.body_length - body );
+				if( length + chunk_length > room && popped + length != 0 )
+				{
+					break;
+				}
+				length += chunk_length;
+				body += std::min<size_t>( layout.chunk_size, layout.body_length - body );
+			} while( body != layout.body_length );
+
+			if( length == 0 )
+			{
+				return;
+			}
+			out.splice( front.data, length );
+			front.body_popped = body;
+			popped += length;
+			size_ -= length;
+			sizes_[index] -= length;
+			if( !front.data.empty() )
+			{
+				return;
+			}
+			queue.pop_front();
+		}
+	}
+}
+
+int64 send_queue::queued_since( send_priority priority ) const noexcept
+{
+	const auto& queue = queues_[static_cast<size_t>( priority )];
+	return !queue.empty() ? queue.front().queued_at : -1;
+}
+
+void send_queue::clear()
+{
+	for( auto& queue : queues_ )
+	{
+		queue.clear();
+	}
+	std::fill_n( sizes_, priority_count, 0 );
+	size_ = 0;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include <deque>
+#include "chunk_muxer.h"
+
+namespace mntone { namespace rtmp {
+
+	// Send order classes, most urgent first
+	enum class send_priority: uint8
+	{
+		// Protocol control messages and user control events
+		control = 0,
+		command = 1,
+		audio = 2,
+		video = 3,
+	};
+
+	// How far video may run ahead of audio on the wire. pop() hands out at most
+	// max_video_bytes_before_yield bytes of video chunks per batch, so audio queued while a batch is
+	// in flight waits behind that much video at most rather than a whole batch. Smaller values mean
+	// lower audio latency and more, smaller writes. 0 lets video fill the whole batch.
+	struct interleave_policy
+	{
+		interleave_policy()
+			: max_video_bytes_before_yield( 16 * 1024 )
+		{ }
+
+		size_t max_video_bytes_before_yield;
+	};
+
+	// Chunked messages waiting for the transport, one FIFO per priority class.
+	// pop() gathers whole chunks from the most urgent class first, so a ping response queued behind
+	// a large key frame leaves with the next batch instead of after the key frame's last chunk.
+	// Chunks of different chunk streams may interleave on the wire, but the chunks of one chunk
+	// stream must stay in order, so every chunk stream has to stick to one class.
+	class send_queue final
+	{
+	public:
+		static const size_t priority_count = 4;
+
+		send_queue( const send_queue& ) = delete;
+		send_queue& operator=( const send_queue& ) = delete;
+
+		send_queue();
+
+		// message is one chunked message as the muxer wrote it, with the layout it returned.
+		// queued_at is any caller clock reading, reported back by queued_since().
+		void push( send_priority priority, gather_buffer message, const chunk_layout& layout, int64 queued_at = 0 );
+
+		// Moves queued chunks to out until max_length bytes, and at least one chunk if any is queued.
+		// A message is taken whole when it fits and is otherwise cut between two of its chunks.
+		// Classes less urgent than lowest are left alone.
+		void pop( size_t max_length, gather_buffer& out, send_priority lowest = send_priority::video );
+
+		const interleave_policy& policy() const noexcept { return policy_; }
+		void set_policy( const interleave_policy& policy ) noexcept { policy_ = policy; }
+
+		// Queued bytes
+		size_t size() const noexcept { return size_; }
+		size_t size( send_priority priority ) const noexcept { return sizes_[static_cast<size_t>( priority )]; }
+		bool empty() const noexcept { return size_ == 0; }
+
+		// queued_at of the oldest message of the class, or -1 when the class is empty
+		int64 queued_since( send_priority priority ) const noexcept;
+
+		void clear();
+
+	private:
+		struct entry
+		{
+			gather_buffer data;
+			chunk_layout layout;
+
+			// Body bytes already popped
+			size_t body_popped;
+			int64 queued_at;
+		};
+
+		std::deque<entry> queues_[priority_count];
+		size_t sizes_[priority_count];
+		size_t size_;
+		interleave_policy policy_;
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "pch.h"
+#include "shard_pool.h"
+#include <pthread.h>
+#include <sched.h>
+
+using namespace mntone::rtmp;
+
+bool mntone::rtmp::pin_thread_to_cpu( std::thread& thread, size_t index )
+{
+	cpu_set_t allowed;
+	CPU_ZERO( &allowed );
+	if( sched_getaffinity( 0, sizeof( allowed ), &allowed ) != 0 )
+	{
+		return false;
+	}
+
+	const auto count = static_cast<size_t>( CPU_COUNT( &allowed ) );
+	if( count == 0 )
+	{
+		return false;
+	}
+
+	auto position = index % count;
+	for( auto cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+	{
+		if( !CPU_ISSET( cpu, &allowed ) || position-- != 0 )
+		{
+			continue;
+		}
+
+		cpu_set_t set;
+		CPU_ZERO( &set );
+		CPU_SET( cpu, &set );
+		return pthread_setaffinity_np( thread.native_handle(), sizeof( set ), &set ) == 0;
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "transport.h"
+#include "placement_policy.h"
+
+namespace mntone { namespace rtmp {
+
+	// Binds thread to the index-th CPU the process may run on (wrapping around). Returns false
+	// when the platform refuses.
+	bool pin_thread_to_cpu( std::thread& thread, size_t index );
+
+	// Thread-per-core reactor: N shards, each a Loop running on its own thread, optionally pinned
+	// to a CPU. A transport created here belongs to one shard for its whole life, so the
+	// connection's demux, dispatch and socket I/O run on that shard's thread only; post work to
+	// shard_of(...) to run next to it.
+	// Loop is epoll_loop or uring_loop, Transport the matching transport.
+	template<typename Loop, typename Transport>
+	class shard_pool final
+	{
+	public:
+		shard_pool( const shard_pool& ) = delete;
+		shard_pool& operator=( const shard_pool& ) = delete;
+
+		explicit shard_pool(
+			size_t shard_count = std::thread::hardware_concurrency(),
+			std::unique_ptr<placement_policy> policy = std::unique_ptr<placement_policy>( new round_robin_placement() ),
+			bool pin_threads = true )
+			: policy_( std::move( policy ) )
+			, sampled_at_( std::chrono::steady_clock::now() )
+		{
+			shard_count = std::max<size_t>( shard_count, 1 );
+			for( size_t i = 0; i < shard_count; ++i )
+			{
+				shards_.emplace_back( new shard() );
+			}
+			for( size_t i = 0; i < shard_count; ++i )
+			{
+				auto& s = *shards_[i];
+				s.thread = std::thread( [&s] { s.loop.run(); } );
+				if( pin_threads )
+				{
+					pin_thread_to_cpu( s.thread, i );
+				}
+			}
+		}
+
+		~shard_pool()
+		{
+			for( auto& s : shards_ )
+			{
+				s->loop.stop();
+			}
+			for( auto& s : shards_ )
+			{
+				s->thread.join();
+			}
+		}
+
+		// Places a new connection and returns its transport, to be handed to a net_connection.
+		std::unique_ptr<transport> create_transport()
+		{
+			const auto index = place();
+			return std::unique_ptr<transport>( new shard_transport( *shards_[index] ) );
+		}
+
+		size_t shard_count() const noexcept { return shards_.size(); }
+		Loop& shard_of( size_t index ) noexcept { return shards_[index]->loop; }
+
+		// Bytes/sec are averaged since the previous sample, taken at most once a second.
+		std::vector<shard_load> loads()
+		{
+			std::lock_guard<std::mutex> lock( placement_mutex_ );
+			sample();
+			return current_loads();
+		}
+
+	private:
+		struct shard
+		{
+			shard()
+				: bytes( 0 )
+				, connections( 0 )
+				, sampled_bytes( 0 )
+				, bytes_per_second( 0.0 )
+			{ }
+
+			Loop loop;
+			std::thread thread;
+			std::atomic<uint64> bytes;
+			std::atomic<size_t> connections;
+
+			// placement_mutex_
+			uint64 sampled_bytes;
+			float64 bytes_per_second;
+		};
+
+		// Counts received bytes and open connections for the owning shard.
+		class shard_transport final
+			: public transport
+		{
+		public:
+			explicit shard_transport( shard& owner )
+				: owner_( owner )
+				, transport_( owner.loop )
+			{
+				++owner_.connections;
+			}
+
+			virtual ~shard_transport()
+			{
+				transport_.close();
+				--owner_.connections;
+			}
+
+			virtual void connect( const std::string& host, uint16 port, connect_handler handler ) override
+			{
+				transport_.connect( host, port, std::move( handler ) );
+			}
+
+			virtual void start_receive( ring_buffer& buffer, receive_handler handler ) override
+			{
+				auto& bytes = owner_.bytes;
+				transport_.start_receive( buffer, [&bytes, handler]( size_t length )
+				{
+					bytes.fetch_add( length, std::memory_order_relaxed );
+					handler( length );
+				} );
+			}
+
+			virtual void pause_receive() override
+			{
+				transport_.pause_receive();
+			}
+
+			virtual void resume_receive() override
+			{
+				transport_.resume_receive();
+			}
+
+			using transport::write;
+			virtual void write( gather_buffer data ) override
+			{
+				transport_.write( std::move( data ) );
+			}
+
+			virtual void set_drained_handler( drained_handler handler ) override
+			{
+				transport_.set_drained_handler( std::move( handler ) );
+			}
+
+			virtual void close() override
+			{
+				transport_.close();
+			}
+
+		private:
+			shard& owner_;
+			Transport transport_;
+		};
+
+		size_t place()
+		{
+			std::lock_guard<std::mutex> lock( placement_mutex_ );
+			sample();
+
+			const auto loads = current_loads();
+			const auto index = policy_->place( loads );
+
+			// Until the next sample shows its real traffic, count the new connection at the average
+			// rate so a burst of placements does not all land on the same shard
+			float64 total_rate = 0.0;
+			size_t total_connections = 0;
+			for( const auto& load : loads )
+			{
+				total_rate += load.bytes_per_second;
+				total_connections += load.connections;
+			}
+			if( total_connections != 0 )
+			{
+				shards_[index]->bytes_per_second += total_rate / total_connections;
+			}
+			return index;
+		}
+
+		void sample()
+		{
+			const auto now = std::chrono::steady_clock::now();
+			const auto elapsed = std::chrono::duration<float64>( now - sampled_at_ ).count();
+			if( elapsed < 1.0 )
+			{
+				return;
+			}
+
+			for( auto& s : shards_ )
+			{
+				const uint64 bytes = s->bytes;
+				s->bytes_per_second = ( bytes - s->sampled_bytes ) / elapsed;
+				s->sampled_bytes = bytes;
+			}
+			sampled_at_ = now;
+		}
+
+		std::vector<shard_load> current_loads() const
+		{
+			std::vector<shard_load> loads;
+			loads.reserve( shards_.size() );
+			for( const auto& s : shards_ )
+			{
+				loads.push_back( { s->connections.load(), s->bytes_per_second } );
+			}
+			return loads;
+		}
+
+	private:
+		std::vector<std::unique_ptr<shard>> shards_;
+
+		std::mutex placement_mutex_;
+		std::unique_ptr<placement_policy> policy_;
+		std::chrono::steady_clock::time_point sampled_at_;
+	};
+
+} }
\ No newline at end of file
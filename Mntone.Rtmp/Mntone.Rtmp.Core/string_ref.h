@@ -0,0 +1,77 @@
+#pragma once
+#include <cstring>
+#include <string>
+
+namespace mntone { namespace rtmp {
+
+	// Non-owning view of characters inside a message body, valid for as long as the body.
+	// Lets the command handlers compare and classify strings without copying them out.
+	class string_ref final
+	{
+	public:
+		static const size_t npos = static_cast<size_t>( -1 );
+
+		string_ref() noexcept
+			: data_( nullptr )
+			, size_( 0 )
+		{ }
+
+		string_ref( const char* data, size_t size ) noexcept
+			: data_( data )
+			, size_( size )
+		{ }
+
+		string_ref( const char* value ) noexcept
+			: data_( value )
+			, size_( std::strlen( value ) )
+		{ }
+
+		string_ref( const std::string& value ) noexcept
+			: data_( value.data() )
+			, size_( value.size() )
+		{ }
+
+		const char* data() const noexcept { return data_; }
+		size_t size() const noexcept { return size_; }
+		bool empty() const noexcept { return size_ == 0; }
+		char operator[]( size_t index ) const noexcept { return data_[index]; }
+
+		// Out of range requests are clamped to the end
+		string_ref substr( size_t offset, size_t length = npos ) const noexcept
+		{
+			offset = std::min( offset, size_ );
+			return string_ref( data_ + offset, std::min( length, size_ - offset ) );
+		}
+
+		size_t find( char c, size_t offset = 0 ) const noexcept
+		{
+			for( auto i = offset; i < size_; ++i )
+			{
+				if( data_[i] == c )
+				{
+					return i;
+				}
+			}
+			return npos;
+		}
+
+		bool starts_with( string_ref prefix ) const noexcept
+		{
+			return prefix.size_ <= size_ && std::memcmp( data_, prefix.data_, prefix.size_ ) == 0;
+		}
+
+		std::string to_string() const { return std::string( data_, size_ ); }
+
+		friend bool operator==( string_ref lhs, string_ref rhs ) noexcept
+		{
+			return lhs.size_ == rhs.size_ && ( lhs.size_ == 0 || std::memcmp( lhs.data_, rhs.data_, lhs.size_ ) == 0 );
+		}
+
+		friend bool operator!=( string_ref lhs, string_ref rhs ) noexcept { return !( lhs == rhs ); }
+
+	private:
+		const char* data_;
+		size_t size_;
+	};
+
+} }
\ No newline at end of file
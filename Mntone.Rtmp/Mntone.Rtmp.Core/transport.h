@@ -0,0 +1,45 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "ring_buffer.h"
+#include "gather_buffer.h"
+
+namespace mntone { namespace rtmp {
+
+	// Byte stream under a net_connection (StreamSocket on Windows, sockets elsewhere).
+	// Handlers run on the transport's own thread; an implementation never runs two of them at once.
+	class transport
+	{
+	public:
+		typedef std::function<void( bool succeeded )> connect_handler;
+		typedef std::function<void( size_t length )> receive_handler;
+		typedef std::function<void()> drained_handler;
+
+		virtual ~transport() { }
+
+		virtual void connect( const std::string& host, uint16 port, connect_handler handler ) = 0;
+
+		// Reads into the free space of buffer until closed, committing before each handler call.
+		// A zero length means the peer closed the connection or the read failed.
+		virtual void start_receive( ring_buffer& buffer, receive_handler handler ) = 0;
+
+		// Stops issuing socket reads so the kernel receive window closes; data already read may
+		// still be delivered. resume_receive picks up where reading stopped. Both are thread-safe.
+		virtual void pause_receive() = 0;
+		virtual void resume_receive() = 0;
+
+		// Queues data for sending; writes reach the wire in call order. The segments of one
+		// gather_buffer go out in a single vectored write where the platform has one.
+		virtual void write( gather_buffer data ) = 0;
+		void write( std::vector<uint8> data ) { write( gather_buffer( std::move( data ) ) ); }
+
+		// Called on the transport's thread, never from inside write(), whenever everything written
+		// so far has been handed to the socket. A sender that keeps its own queue releases the next
+		// batch from here rather than piling data up behind the socket.
+		virtual void set_drained_handler( drained_handler handler ) = 0;
+
+		virtual void close() = 0;
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "pch.h"
+#include "uring_loop.h"
+#include <system_error>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	// user_data of submissions whose completions nobody waits for (cancellations)
+	const uint64 IGNORE_TOKEN = 0;
+
+	// user_data of the wake eventfd read; registrations start after it
+	const uint64 WAKE_TOKEN = 1;
+
+	int io_uring_setup( uint32 entries, io_uring_params* params )
+	{
+		return static_cast<int>( syscall( __NR_io_uring_setup, entries, params ) );
+	}
+
+	int io_uring_enter( int fd, uint32 submit_count, uint32 wait_count, uint32 flags )
+	{
+		return static_cast<int>( syscall( __NR_io_uring_enter, fd, submit_count, wait_count, flags, nullptr, 0 ) );
+	}
+
+	int io_uring_register( int fd, uint32 opcode, void* arg, uint32 arg_count )
+	{
+		return static_cast<int>( syscall( __NR_io_uring_register, fd, opcode, arg, arg_count ) );
+	}
+
+	template<typename T>
+	T load_acquire( const T* pointer ) noexcept
+	{
+		return __atomic_load_n( pointer, __ATOMIC_ACQUIRE );
+	}
+
+	template<typename T>
+	void store_release( T* pointer, T value ) noexcept
+	{
+		__atomic_store_n( pointer, value, __ATOMIC_RELEASE );
+	}
+
+	void* map( size_t size, int fd, off_t offset )
+	{
+		const auto pointer = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset );
+		if( pointer == MAP_FAILED )
+		{
+			throw std::system_error( errno, std::system_category(), "uring_loop" );
+		}
+		return pointer;
+	}
+
+}
+
+uring_loop::uring_loop( uint32 entries, uint16 buffer_count, uint32 buffer_size )
+	: ring_fd_( -1 )
+	, wake_fd_( -1 )
+	, thread_id_( std::this_thread::get_id() )
+	, stopped_( false )
+	, sq_ring_( nullptr )
+	, sq_ring_size_( 0 )
+	, cq_ring_( nullptr )
+	, cq_ring_size_( 0 )
+	, sqes_( nullptr )
+	, sqes_size_( 0 )
+	, sqe_tail_( 0 )
+	, unsubmitted_( 0 )
+	, buffer_ring_( nullptr )
+	, buffer_ring_size_( 0 )
+	, buffers_( static_cast<size_t>( buffer_count ) * buffer_size )
+	, buffer_count_( buffer_count )
+	, buffer_tail_( 0 )
+	, buffer_size_( buffer_size )
+	, wake_value_( 0 )
+	, next_token_( WAKE_TOKEN + 1 )
+	, stats_()
+{
+	if( buffer_count == 0 || ( buffer_count & ( buffer_count - 1 ) ) != 0 )
+	{
+		throw std::invalid_argument( "buffer_count" );
+	}
+
+	io_uring_params params = {};
+	ring_fd_ = io_uring_setup( entries, &params );
+	wake_fd_ = eventfd( 0, EFD_CLOEXEC );
+	if( ring_fd_ < 0 || wake_fd_ < 0 )
+	{
+		const auto error = errno;
+		release();
+		throw std::system_error( error, std::system_category(), "uring_loop" );
+	}
+
+	try
+	{
+		sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof( uint32 );
+		cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+		if( ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0 )
+		{
+			sq_ring_size_ = cq_ring_size_ = std::max( sq_ring_size_, cq_ring_size_ );
+			sq_ring_ = cq_ring_ = map( sq_ring_size_, ring_fd_, IORING_OFF_SQ_RING );
+		}
+		else
+		{
+			sq_ring_ = map( sq_ring_size_, ring_fd_, IORING_OFF_SQ_RING );
+			cq_ring_ = map( cq_ring_size_, ring_fd_, IORING_OFF_CQ_RING );
+		}
+		sqes_size_ = params.sq_entries * sizeof( io_uring_sqe );
+		sqes_ = static_cast<io_uring_sqe*>( map( sqes_size_, ring_fd_, IORING_OFF_SQES ) );
+
+		const auto sq = static_cast<uint8*>( sq_ring_ );
+		sq_head_ = reinterpret_cast<uint32*>( sq + params.sq_off.head );
+		sq_tail_ = reinterpret_cast<uint32*>( sq + params.sq_off.tail );
+		sq_array_ = reinterpret_cast<uint32*>( sq + params.sq_off.array );
+		sq_mask_ = *reinterpret_cast<uint32*>( sq + params.sq_off.ring_mask );
+		sq_entries_ = params.sq_entries;
+		sqe_tail_ = *sq_tail_;
+
+		const auto cq = static_cast<uint8*>( cq_ring_ );
+		cq_head_ = reinterpret_cast<uint32*>( cq + params.cq_off.head );
+		cq_tail_ = reinterpret_cast<uint32*>( cq + params.cq_off.tail );
+		cqes_ = reinterpret_cast<io_uring_cqe*>( cq + params.cq_off.cqes );
+		cq_mask_ = *reinterpret_cast<uint32*>( cq + params.cq_off.ring_mask );
+
+		// Provided buffer ring; the kernel picks a buffer per received completion
+		buffer_ring_size_ = buffer_count * sizeof( io_uring_buf );
+		const auto ring = mmap( nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+		if( ring == MAP_FAILED )
+		{
+			throw std::system_error( errno, std::system_category(), "uring_loop" );
+		}
+		buffer_ring_ = static_cast<io_uring_buf_ring*>( ring );
+
+		io_uring_buf_reg registration = {};
+		registration.ring_addr = reinterpret_cast<uint64>( buffer_ring_ );
+		registration.ring_entries = buffer_count;
+		registration.bgid = buffer_group();
+		if( io_uring_register( ring_fd_, IORING_REGISTER_PBUF_RING, &registration, 1 ) != 0 )
+		{
+			throw std::system_error( errno, std::system_category(), "uring_loop" );
+		}
+		for( uint16 i = 0; i < buffer_count; ++i )
+		{
+			recycle( i );
+		}
+	}
+	catch( ... )
+	{
+		release();
+		throw;
+	}
+}
+
+uring_loop::~uring_loop()
+{
+	release();
+}
+
+void uring_loop::release() noexcept
+{
+	if( buffer_ring_ != nullptr )
+	{
+		munmap( buffer_ring_, buffer_ring_size_ );
+		buffer_ring_ = nullptr;
+	}
+	if( sqes_ != nullptr )
+	{
+		munmap( sqes_, sqes_size_ );
+		sqes_ = nullptr;
+	}
+	if( cq_ring_ != nullptr && cq_ring_ != sq_ring_ )
+	{
+		munmap( cq_ring_, cq_ring_size_ );
+	}
+	cq_ring_ = nullptr;
+	if( sq_ring_ != nullptr )
+	{
+		munmap( sq_ring_, sq_ring_size_ );
+		sq_ring_ = nullptr;
+	}
+	if( wake_fd_ >= 0 )
+	{
+		::close( wake_fd_ );
+		wake_fd_ = -1;
+	}
+	if( ring_fd_ >= 0 )
+	{
+		::close( ring_fd_ );
+		ring_fd_ = -1;
+	}
+}
+
+void uring_loop::run()
+{
+	thread_id_ = std::this_thread::get_id();
+
+	arm_wake();
+	for( ;; )
+	{
+		run_posted_tasks();
+		{
+			std::lock_guard<std::mutex> lock( task_mutex_ );
+			if( stopped_ )
+			{
+				break;
+			}
+		}
+
+		submit( 1 );
+		reap();
+	}
+}
+
+void uring_loop::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock( task_mutex_ );
+		stopped_ = true;
+	}
+	const uint64 value = 1;
+	::write( wake_fd_, &value, sizeof( value ) );
+}
+
+void uring_loop::post( task task )
+{
+	{
+		std::lock_guard<std::mutex> lock( task_mutex_ );
+		tasks_.push_back( std::move( task ) );
+	}
+	const uint64 value = 1;
+	::write( wake_fd_, &value, sizeof( value ) );
+}
+
+void uring_loop::run_posted_tasks()
+{
+	std::vector<task> tasks;
+	{
+		std::lock_guard<std::mutex> lock( task_mutex_ );
+		tasks.swap( tasks_ );
+	}
+
+	for( auto& task : tasks )
+	{
+		task();
+	}
+}
+
+uint64 uring_loop::add( completion_handler handler )
+{
+	const auto token = next_token_++;
+	registrations_.emplace( token, std::move( handler ) );
+	return token;
+}
+
+void uring_loop::remove( uint64 token )
+{
+	registrations_.erase( token );
+}
+
+io_uring_sqe* uring_loop::prepare( uint8 opcode, int fd, uint64 token )
+{
+	reserve( 1 );
+
+	const auto index = sqe_tail_ & sq_mask_;
+	const auto sqe = &sqes_[index];
+	std::memset( sqe, 0, sizeof( io_uring_sqe ) );
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->user_data = token;
+	sq_array_[index] = index;
+	++sqe_tail_;
+	++unsubmitted_;
+	return sqe;
+}
+
+void uring_loop::reserve( uint32 count )
+{
+	while( sqe_tail_ - load_acquire( sq_head_ ) + count > sq_entries_ )
+	{
+		const auto unsubmitted = unsubmitted_;
+		submit( 0 );
+		if( unsubmitted_ == unsubmitted )
+		{
+			reap();
+		}
+	}
+}
+
+void uring_loop::recycle( uint16 id ) noexcept
+{
+	// Indexed by hand: older uapi headers declare bufs through an empty struct, which C++ gives a
+	// nonzero size and shifts off the ring start
+	auto& entry = reinterpret_cast<io_uring_buf*>( buffer_ring_ )[buffer_tail_ & ( buffer_count_ - 1 )];
+	entry.addr = reinterpret_cast<uint64>( buffers_.data() + static_cast<size_t>( id ) * buffer_size_ );
+	entry.len = buffer_size_;
+	entry.bid = id;
+	++buffer_tail_;
+	store_release( &buffer_ring_->tail, buffer_tail_ );
+}
+
+void uring_loop::submit( uint32 wait_count )
+{
+	store_release( sq_tail_, sqe_tail_ );
+	for( ;; )
+	{
+		const auto result = io_uring_enter( ring_fd_, unsubmitted_, wait_count, wait_count != 0 ? IORING_ENTER_GETEVENTS : 0 );
+		if( result < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			if( errno == EBUSY || errno == EAGAIN )
+			{
+				// Completion queue is backed up; the caller reaps before submitting more
+				return;
+			}
+			throw std::system_error( errno, std::system_category(), "io_uring_enter" );
+		}
+
+		++stats_.enters;
+		stats_.submissions += static_cast<uint32>( result );
+		unsubmitted_ -= static_cast<uint32>( result );
+		return;
+	}
+}
+
+void uring_loop::reap()
+{
+	auto head = *cq_head_;
+	for( ;; )
+	{
+		if( head == load_acquire( cq_tail_ ) )
+		{
+			break;
+		}
+
+		const auto& cqe = cqes_[head & cq_mask_];
+		const auto token = cqe.user_data;
+		const auto result = cqe.res;
+		const auto flags = cqe.flags;
+		store_release( cq_head_, ++head );
+		++stats_.completions;
+
+		if( token == IGNORE_TOKEN )
+		{
+			continue;
+		}
+		if( token == WAKE_TOKEN )
+		{
+			arm_wake();
+			continue;
+		}
+
+		const auto itr = registrations_.find( token );
+		if( itr != registrations_.end() )
+		{
+			// The handler may remove its own registration
+			const auto handler = itr->second;
+			handler( result, flags );
+		}
+	}
+}
+
+void uring_loop::arm_wake()
+{
+	const auto sqe = prepare( IORING_OP_READ, wake_fd_, WAKE_TOKEN );
+	sqe->addr = reinterpret_cast<uint64>( &wake_value_ );
+	sqe->len = sizeof( wake_value_ );
+}
\ No newline at end of file
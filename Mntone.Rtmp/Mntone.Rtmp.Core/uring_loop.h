@@ -0,0 +1,107 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+namespace mntone { namespace rtmp {
+
+	// io_uring reactor shared by many uring_transports.
+	// Submissions from every connection on the ring accumulate and go to the kernel in one
+	// io_uring_enter per loop iteration, together with the wait for the next completions.
+	// Receives draw from a provided buffer ring registered with the kernel, so a multishot recv
+	// needs no per-read buffer setup.
+	class uring_loop final
+	{
+	public:
+		typedef std::function<void( int32 result, uint32 flags )> completion_handler;
+		typedef std::function<void()> task;
+
+		struct statistics
+		{
+			uint64 submissions;
+			uint64 enters;
+			uint64 completions;
+		};
+
+		uring_loop( const uring_loop& ) = delete;
+		uring_loop& operator=( const uring_loop& ) = delete;
+
+		// buffer_count must be a power of two.
+		explicit uring_loop( uint32 entries = 1024, uint16 buffer_count = 1024, uint32 buffer_size = 16384 );
+		~uring_loop();
+
+		void run();
+		void stop();
+
+		// Thread-safe. Tasks run on the loop thread in post order.
+		void post( task task );
+		bool in_loop_thread() const noexcept { return std::this_thread::get_id() == thread_id_; }
+
+		// Loop thread only.
+		// A token is the user_data of the submissions whose completions go to handler.
+		uint64 add( completion_handler handler );
+		void remove( uint64 token );
+
+		// Returns a zeroed entry with opcode, fd and token filled in. Entries are submitted with the
+		// next wait; reserve first when a linked chain must not be split across two submissions.
+		io_uring_sqe* prepare( uint8 opcode, int fd, uint64 token );
+		void reserve( uint32 count );
+
+		uint16 buffer_group() const noexcept { return 0; }
+		const uint8* buffer( uint16 id ) const noexcept { return buffers_.data() + static_cast<size_t>( id ) * buffer_size_; }
+		void recycle( uint16 id ) noexcept;
+
+		// Loop thread, or after run() returned
+		const statistics& stats() const noexcept { return stats_; }
+
+	private:
+		void release() noexcept;
+		void submit( uint32 wait_count );
+		void reap();
+		void arm_wake();
+		void run_posted_tasks();
+
+	private:
+		int ring_fd_, wake_fd_;
+		std::thread::id thread_id_;
+		bool stopped_;
+
+		void* sq_ring_;
+		size_t sq_ring_size_;
+		void* cq_ring_;
+		size_t cq_ring_size_;
+		io_uring_sqe* sqes_;
+		size_t sqes_size_;
+
+		uint32* sq_head_;
+		uint32* sq_tail_;
+		uint32* sq_array_;
+		uint32 sq_mask_, sq_entries_, sqe_tail_, unsubmitted_;
+
+		uint32* cq_head_;
+		uint32* cq_tail_;
+		io_uring_cqe* cqes_;
+		uint32 cq_mask_;
+
+		io_uring_buf_ring* buffer_ring_;
+		size_t buffer_ring_size_;
+		std::vector<uint8> buffers_;
+		uint16 buffer_count_, buffer_tail_;
+		uint32 buffer_size_;
+
+		uint64 wake_value_;
+		std::mutex task_mutex_;
+		std::vector<task> tasks_;
+
+		uint64 next_token_;
+		std::unordered_map<uint64, completion_handler> registrations_;
+		statistics stats_;
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,561 @@
+#include "pch.h"
+#include "uring_transport.h"
+#include <climits>
+#include <linux/io_uring.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace mntone::rtmp;
+
+namespace {
+
+	// Sends linked into one chain; the chain is reserved in one piece so it is never split
+	// across two submissions
+	const size_t MAX_LINKED_SENDS = 32;
+
+	// Segments per sendmsg; a longer message continues in the next send of the chain
+	const size_t MAX_IOVECS = IOV_MAX;
+
+}
+
+struct uring_transport::channel
+{
+	explicit channel( uring_loop& loop )
+		: loop( loop )
+		, fd( -1 )
+		, address()
+		, address_length( 0 )
+		, connect_token( 0 )
+		, receive_token( 0 )
+		, send_token( 0 )
+		, operations( 0 )
+		, ready( false )
+		, receiving( false )
+		, released( false )
+		, send_completions( 0 )
+		, closed( false )
+		, paused( false )
+		, buffer( nullptr )
+		, flush_posted( false )
+	{ }
+
+	uring_loop& loop;
+	int fd;
+	sockaddr_storage address;
+	socklen_t address_length;
+
+	// Loop thread only
+	uint64 connect_token, receive_token, send_token;
+	uint32 operations;
+	bool ready, receiving, released;
+	std::vector<gather_buffer> sending;
+	std::vector<msghdr> send_messages;
+	std::vector<iovec> send_vectors;
+	std::vector<size_t> send_lengths;
+	std::vector<int32> send_results;
+	size_t send_completions;
+
+	// Held while a handler runs, so close() from another thread waits until the handler returns
+	// and the receive buffer is no longer touched afterwards
+	std::recursive_mutex handler_mutex;
+	std::atomic<bool> closed, paused;
+	connect_handler connected;
+	ring_buffer* buffer;
+	receive_handler received;
+	drained_handler drained;
+
+	std::mutex send_mutex;
+	std::deque<gather_buffer> send_queue;
+	bool flush_posted;
+};
+
+uring_transport::uring_transport( uring_loop& loop )
+	: loop_( loop )
+	, channel_( std::make_shared<channel>( loop ) )
+{ }
+
+uring_transport::~uring_transport()
+{
+	close();
+}
+
+void uring_transport::connect( const std::string& host, uint16 port, connect_handler handler )
+{
+	const auto ch = renew_channel();
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo* result = nullptr;
+	if( getaddrinfo( host.c_str(), std::to_string( port ).c_str(), &hints, &result ) != 0 )
+	{
+		loop_.post( [handler] { handler( false ); } );
+		return;
+	}
+
+	// The first address only; the connect itself is asynchronous
+	const auto fd = socket( result->ai_family, result->ai_socktype | SOCK_CLOEXEC, result->ai_protocol );
+	if( fd >= 0 )
+	{
+		std::memcpy( &ch->address, result->ai_addr, result->ai_addrlen );
+		ch->address_length = result->ai_addrlen;
+	}
+	freeaddrinfo( result );
+
+	if( fd < 0 )
+	{
+		loop_.post( [handler] { handler( false ); } );
+		return;
+	}
+
+	// Chunks are already coalesced per message by the muxer
+	const int enable = 1;
+	setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof( enable ) );
+
+	{
+		std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+		ch->fd = fd;
+		ch->connected = std::move( handler );
+	}
+	loop_.post( [ch]
+	{
+		if( ch->closed )
+		{
+			release( *ch );
+			return;
+		}
+
+		ch->connect_token = ch->loop.add( [ch]( int32 result, uint32 ) { on_connected( ch, result ); } );
+		ch->receive_token = ch->loop.add( [ch]( int32 result, uint32 flags ) { on_received( ch, result, flags ); } );
+		ch->send_token = ch->loop.add( [ch]( int32 result, uint32 ) { on_sent( ch, result ); } );
+
+		const auto sqe = ch->loop.prepare( IORING_OP_CONNECT, ch->fd, ch->connect_token );
+		sqe->addr = reinterpret_cast<uint64>( &ch->address );
+		sqe->off = ch->address_length;
+		++ch->operations;
+	} );
+}
+
+void uring_transport::start_receive( ring_buffer& buffer, receive_handler handler )
+{
+	const auto ch = std::atomic_load( &channel_ );
+	{
+		std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+		ch->buffer = &buffer;
+		ch->received = std::move( handler );
+	}
+
+	loop_.post( [ch]
+	{
+		if( !ch->closed && ch->ready && !ch->receiving && !ch->paused )
+		{
+			arm_receive( *ch );
+		}
+	} );
+}
+
+void uring_transport::pause_receive()
+{
+	const auto ch = std::atomic_load( &channel_ );
+	if( ch->paused.exchange( true ) )
+	{
+		return;
+	}
+
+	// Ends the multishot recv; completions already queued are still delivered
+	loop_.post( [ch]
+	{
+		if( ch->paused && ch->receiving )
+		{
+			const auto sqe = ch->loop.prepare( IORING_OP_ASYNC_CANCEL, -1, 0 );
+			sqe->addr = ch->receive_token;
+		}
+	} );
+}
+
+void uring_transport::resume_receive()
+{
+	const auto ch = std::atomic_load( &channel_ );
+	if( !ch->paused.exchange( false ) )
+	{
+		return;
+	}
+
+	loop_.post( [ch]
+	{
+		if( !ch->closed && ch->ready && !ch->receiving && !ch->paused && ch->buffer != nullptr )
+		{
+			arm_receive( *ch );
+		}
+	} );
+}
+
+void uring_transport::write( gather_buffer data )
+{
+	const auto ch = std::atomic_load( &channel_ );
+	std::lock_guard<std::mutex> lock( ch->send_mutex );
+	if( ch->closed || data.empty() )
+	{
+		return;
+	}
+
+	ch->send_queue.push_back( std::move( data ) );
+	if( !ch->flush_posted )
+	{
+		// Everything written until the task runs goes out in the same chain
+		ch->flush_posted = true;
+		loop_.post( [ch] { send_queued( *ch ); } );
+	}
+}
+
+void uring_transport::set_drained_handler( drained_handler handler )
+{
+	const auto ch = std::atomic_load( &channel_ );
+	std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+	ch->drained = std::move( handler );
+}
+
+void uring_transport::close()
+{
+	const auto ch = std::atomic_load( &channel_ );
+	{
+		std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+		if( ch->closed.exchange( true ) )
+		{
+			return;
+		}
+
+		ch->connected = nullptr;
+		ch->buffer = nullptr;
+		ch->received = nullptr;
+		ch->drained = nullptr;
+		if( ch->fd >= 0 )
+		{
+			// Completes the multishot recv and fails the sends in flight
+			::shutdown( ch->fd, SHUT_RDWR );
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock( ch->send_mutex );
+		ch->send_queue.clear();
+	}
+
+	loop_.post( [ch]
+	{
+		if( ch->operations != 0 && ch->fd >= 0 )
+		{
+			// A connect in progress does not notice the shutdown
+			const auto sqe = ch->loop.prepare( IORING_OP_ASYNC_CANCEL, ch->fd, 0 );
+			sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+		}
+		release( *ch );
+	} );
+}
+
+// Each connect() gets a channel of its own, so neither the latches and tokens of the previous
+// connection nor the tasks still queued for it reach the new one. Only the drained handler carries over.
+std::shared_ptr<uring_transport::channel> uring_transport::renew_channel()
+{
+	const auto previous = std::atomic_load( &channel_ );
+	drained_handler drained;
+	{
+		std::lock_guard<std::recursive_mutex> lock( previous->handler_mutex );
+		drained = previous->drained;
+	}
+	close();
+
+	const auto ch = std::make_shared<channel>( loop_ );
+	ch->drained = std::move( drained );
+	std::atomic_store( &channel_, ch );
+	return ch;
+}
+
+void uring_transport::on_connected( const std::shared_ptr<channel>& ch, int32 result )
+{
+	--ch->operations;
+
+	std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+	if( ch->closed )
+	{
+		release( *ch );
+		return;
+	}
+
+	const auto handler = std::move( ch->connected );
+	ch->connected = nullptr;
+	if( result < 0 )
+	{
+		release( *ch );
+		handler( false );
+		return;
+	}
+
+	// Writes issued before the connect completed
+	ch->ready = true;
+	send_queued( *ch );
+	handler( true );
+
+	if( !ch->closed && ch->buffer != nullptr && !ch->receiving && !ch->paused )
+	{
+		arm_receive( *ch );
+	}
+}
+
+void uring_transport::on_received( const std::shared_ptr<channel>& ch, int32 result, uint32 flags )
+{
+	if( ( flags & IORING_CQE_F_MORE ) == 0 )
+	{
+		ch->receiving = false;
+		--ch->operations;
+	}
+
+	std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+	auto delivered = true;
+	if( ( flags & IORING_CQE_F_BUFFER ) != 0 )
+	{
+		const auto id = static_cast<uint16>( flags >> IORING_CQE_BUFFER_SHIFT );
+		if( result > 0 && !ch->closed )
+		{
+			delivered = deliver( *ch, ch->loop.buffer( id ), static_cast<size_t>( result ) );
+		}
+		ch->loop.recycle( id );
+	}
+
+	if( ch->closed )
+	{
+		release( *ch );
+		return;
+	}
+
+	// -ENOBUFS: the buffer ring ran dry and the kernel ended the multishot; rearm.
+	// -ECANCELED: pause_receive ended it.
+	if( !delivered || result == 0 || ( result < 0 && result != -ENOBUFS && result != -ECANCELED ) )
+	{
+		fail( *ch );
+		return;
+	}
+	if( !ch->receiving && !ch->paused )
+	{
+		arm_receive( *ch );
+	}
+}
+
+void uring_transport::on_sent( const std::shared_ptr<channel>& ch, int32 result )
+{
+	--ch->operations;
+	ch->send_results[ch->send_completions++] = result;
+	if( ch->send_completions != ch->send_results.size() )
+	{
+		return;
+	}
+
+	// A short or failed send cancels the rest of its chain; requeue what did not go out
+	size_t sent = 0;
+	auto broken = false;
+	for( size_t i = 0; i < ch->send_results.size(); ++i )
+	{
+		const auto result = ch->send_results[i];
+		if( result > 0 )
+		{
+			sent += static_cast<size_t>( result );
+		}
+		else if( result < 0 && result != -ECANCELED && result != -EINTR )
+		{
+			broken = true;
+		}
+		if( result != static_cast<int32>( ch->send_lengths[i] ) )
+		{
+			break;
+		}
+	}
+
+	std::vector<gather_buffer> unsent;
+	for( auto& data : ch->sending )
+	{
+		const auto length = std::min( sent, data.size() );
+		data.consume( length );
+		sent -= length;
+		if( !data.empty() )
+		{
+			unsent.push_back( std::move( data ) );
+		}
+	}
+	ch->sending.clear();
+	ch->send_messages.clear();
+	ch->send_vectors.clear();
+
+	if( ch->closed )
+	{
+		release( *ch );
+		return;
+	}
+	if( broken )
+	{
+		// Surfaces as a zero length read on the receive side
+		::shutdown( ch->fd, SHUT_RDWR );
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( ch->send_mutex );
+		ch->send_queue.insert( ch->send_queue.begin(), std::make_move_iterator( unsent.begin() ), std::make_move_iterator( unsent.end() ) );
+		if( !ch->send_queue.empty() )
+		{
+			if( !ch->flush_posted )
+			{
+				ch->flush_posted = true;
+				ch->loop.post( [ch] { send_queued( *ch ); } );
+			}
+			return;
+		}
+	}
+
+	std::lock_guard<std::recursive_mutex> lock( ch->handler_mutex );
+	if( !ch->closed && ch->drained )
+	{
+		const auto handler = ch->drained;
+		handler();
+	}
+}
+
+void uring_transport::arm_receive( channel& ch )
+{
+	const auto sqe = ch.loop.prepare( IORING_OP_RECV, ch.fd, ch.receive_token );
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = ch.loop.buffer_group();
+	ch.receiving = true;
+	++ch.operations;
+}
+
+void uring_transport::send_queued( channel& ch )
+{
+	std::lock_guard<std::mutex> lock( ch.send_mutex );
+	ch.flush_posted = false;
+
+	// One chain in flight at a time; its completion sends whatever queued up meanwhile
+	if( ch.closed || !ch.ready || !ch.sending.empty() || ch.send_queue.empty() )
+	{
+		return;
+	}
+
+	// Segments of the queued writes, MAX_IOVECS per sendmsg; a write that does not fit in the
+	// chain is still taken, and its tail is requeued on completion like a short send
+	size_t vector_count = 0;
+	while( !ch.send_queue.empty() && vector_count < MAX_LINKED_SENDS * MAX_IOVECS )
+	{
+		vector_count += ch.send_queue.front().segment_count();
+		ch.sending.push_back( std::move( ch.send_queue.front() ) );
+		ch.send_queue.pop_front();
+	}
+	vector_count = std::min( vector_count, MAX_LINKED_SENDS * MAX_IOVECS );
+
+	ch.send_vectors.resize( vector_count );
+	size_t filled = 0;
+	for( const auto& data : ch.sending )
+	{
+		for( size_t i = 0; i < data.segment_count() && filled != vector_count; ++i, ++filled )
+		{
+			ch.send_vectors[filled].iov_base = const_cast<uint8*>( data.segment_data( i ) );
+			ch.send_vectors[filled].iov_len = data.segment_length( i );
+		}
+	}
+
+	const auto count = ( vector_count + MAX_IOVECS - 1 ) / MAX_IOVECS;
+	ch.send_messages.assign( count, msghdr() );
+	ch.send_lengths.assign( count, 0 );
+	ch.send_results.assign( count, 0 );
+	ch.send_completions = 0;
+
+	ch.loop.reserve( static_cast<uint32>( count ) );
+	for( size_t i = 0; i < count; ++i )
+	{
+		auto& message = ch.send_messages[i];
+		message.msg_iov = ch.send_vectors.data() + i * MAX_IOVECS;
+		message.msg_iovlen = std::min( MAX_IOVECS, vector_count - i * MAX_IOVECS );
+		for( size_t j = 0; j < message.msg_iovlen; ++j )
+		{
+			ch.send_lengths[i] += message.msg_iov[j].iov_len;
+		}
+
+		const auto sqe = ch.loop.prepare( IORING_OP_SENDMSG, ch.fd, ch.send_token );
+		sqe->addr = reinterpret_cast<uint64>( &message );
+		sqe->len = 1;
+		sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+		if( i + 1 != count )
+		{
+			sqe->flags = IOSQE_IO_LINK;
+		}
+	}
+	ch.operations += static_cast<uint32>( count );
+}
+
+bool uring_transport::deliver( channel& ch, const uint8* data, size_t length )
+{
+	while( length != 0 )
+	{
+		if( ch.buffer == nullptr )
+		{
+			return true;
+		}
+
+		auto& buffer = *ch.buffer;
+		size_t copied = 0;
+		while( copied != length && buffer.write_length() != 0 )
+		{
+			const auto size = std::min( length - copied, buffer.write_length() );
+			std::memcpy( buffer.write_pointer(), data + copied, size );
+			buffer.commit( size );
+			copied += size;
+		}
+
+		// A handler that consumes nothing from a full buffer would never make room
+		if( copied == 0 )
+		{
+			return false;
+		}
+
+		ch.received( copied );
+		data += copied;
+		length -= copied;
+		if( ch.closed )
+		{
+			return true;
+		}
+	}
+	return true;
+}
+
+void uring_transport::fail( channel& ch )
+{
+	const auto handler = ch.received;
+	ch.buffer = nullptr;
+	ch.received = nullptr;
+	if( handler )
+	{
+		handler( 0 );
+	}
+}
+
+void uring_transport::release( channel& ch )
+{
+	if( ch.released || ch.operations != 0 )
+	{
+		return;
+	}
+
+	ch.released = true;
+	ch.loop.remove( ch.connect_token );
+	ch.loop.remove( ch.receive_token );
+	ch.loop.remove( ch.send_token );
+	if( ch.fd >= 0 )
+	{
+		::close( ch.fd );
+		ch.fd = -1;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include "transport.h"
+#include "uring_loop.h"
+
+namespace mntone { namespace rtmp {
+
+	// Socket transport driven by a uring_loop.
+	// A single multishot recv stays armed for the life of the connection and fills buffers from
+	// the loop's provided buffer ring. Writes are gathered on the loop thread and go out as one
+	// chain of linked sendmsg operations over their segments per iteration, so they reach the
+	// wire in call order.
+	// Handlers run on the loop thread.
+	class uring_transport final
+		: public transport
+	{
+	public:
+		uring_transport( const uring_transport& ) = delete;
+		uring_transport& operator=( const uring_transport& ) = delete;
+
+		explicit uring_transport( uring_loop& loop );
+		virtual ~uring_transport();
+
+		// Name resolution runs on the calling thread; the connect completes on the loop thread.
+		virtual void connect( const std::string& host, uint16 port, connect_handler handler ) override;
+		virtual void start_receive( ring_buffer& buffer, receive_handler handler ) override;
+		virtual void pause_receive() override;
+		virtual void resume_receive() override;
+		using transport::write;
+		virtual void write( gather_buffer data ) override;
+		virtual void set_drained_handler( drained_handler handler ) override;
+		virtual void close() override;
+
+	private:
+		struct channel;
+
+		std::shared_ptr<channel> renew_channel();
+
+		static void on_connected( const std::shared_ptr<channel>& ch, int32 result );
+		static void on_received( const std::shared_ptr<channel>& ch, int32 result, uint32 flags );
+		static void on_sent( const std::shared_ptr<channel>& ch, int32 result );
+		static void arm_receive( channel& ch );
+		static void send_queued( channel& ch );
+		static bool deliver( channel& ch, const uint8* data, size_t length );
+		static void fail( channel& ch );
+		static void release( channel& ch );
+
+	private:
+		uring_loop& loop_;
+		std::shared_ptr<channel> channel_;
+	};
+
+} }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+namespace mntone { namespace rtmp {
+
+	enum class user_control_message_event_type: uint16
+	{
+		stream_begin = 0,
+		stream_eof = 1,
+		stream_dry = 2,
+		set_buffer_length = 3,
+		stream_is_recorded = 4,
+		ping_request = 6,
+		ping_response = 7,
+	};
+
+} }
\ No newline at end of file
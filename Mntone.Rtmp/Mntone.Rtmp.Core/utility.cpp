@@ -1,4 +1,5 @@
 #include "pch.h"
+#include <chrono>
 #include "utility.h"
 
 using namespace mntone::rtmp;
@@ -29,22 +30,16 @@ int64 utility::unix_time_to_windows_time( const uint64 unix_time )
 	return 10000000ll * unix_time + 116444736000000000ll;
 }
 
-Windows::Foundation::DateTime utility::get_date_time()
-{
-	Windows::Foundation::DateTime dt;
-	dt.UniversalTime = get_windows_time();
-	return dt;
-}
-
 int64 utility::get_windows_time()
 {
-	FILETIME ft;
-	GetSystemTimeAsFileTime( &ft );
-	const auto& li = *reinterpret_cast<LARGE_INTEGER*>( &ft );
-	return li.QuadPart;
+	using namespace std::chrono;
+
+	// 100-nanosecond intervals since 1601-01-01 (UTC)
+	const auto since_epoch = duration_cast<microseconds>( system_clock::now().time_since_epoch() ).count();
+	return unix_time_to_windows_time( 0 ) + 10 * since_epoch;
 }
 
 uint32 utility::hundred_nano_to_milli( int64 hundred_nano )
 {
-	return static_cast<uint32>( hundred_nano / 10000000ll );
+	return static_cast<uint32>( hundred_nano / 10000ll );
 }
\ No newline at end of file
@@ -8,7 +8,6 @@ namespace mntone { namespace rtmp { namespace utility {
 	uint64 windows_time_to_unix_time( const int64 windows_time );
 	int64 unix_time_to_windows_time( const uint64 unix_time );
 
-	Windows::Foundation::DateTime get_date_time();
 	int64 get_windows_time();
 
 	uint32 hundred_nano_to_milli( int64 hundred_nano );
@@ -56,6 +56,10 @@ IAsyncOperation<MediaStreamSample^>^ BufferingHelper::GetAudioAsync()
 
 		auto data = audioBuffer_.front();
 		audioBuffer_.pop();
+		if( stream_ != nullptr )
+		{
+			stream_->NotifyConsumed( data->Buffer->Length, data->Timestamp.Duration / 10000 );
+		}
 		return data;
 	} );
 }
@@ -73,6 +77,10 @@ IAsyncOperation<MediaStreamSample^>^ BufferingHelper::GetVideoAsync()
 
 		auto data = videoBuffer_.front();
 		videoBuffer_.pop();
+		if( stream_ != nullptr )
+		{
+			stream_->NotifyConsumed( data->Buffer->Length, data->DecodeTimestamp.Duration / 10000 );
+		}
 		return data;
 	} );
 }
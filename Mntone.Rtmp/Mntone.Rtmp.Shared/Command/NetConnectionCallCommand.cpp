@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "NetConnectionCallCommand.h"
+#include "RtmpHelper.h"
 
 using namespace Mntone::Rtmp::Command;
 
@@ -32,6 +33,26 @@ Mntone::Data::Amf::AmfArray^ NetConnectionCallCommand::Commandify()
 	return ary;
 }
 
+std::vector<uint8> NetConnectionCallCommand::Serialize()
+{
+	std::vector<uint8> out;
+	mntone::rtmp::amf0::writer writer( out );
+	writer.command( RtmpHelper::ToUtf8String( CommandName_ ), static_cast<float64>( TransactionId_ ) );
+	RtmpHelper::WriteAmf( writer, CommandObject_ );
+	if( OptionalArguments_->Size != 0 )
+	{
+		for( auto&& optionalArgument : OptionalArguments_ )
+		{
+			RtmpHelper::WriteAmf( writer, optionalArgument );
+		}
+	}
+	else
+	{
+		writer.null();
+	}
+	return out;
+}
+
 Platform::String^ NetConnectionCallCommand::ToString()
 {
 	return CommandName_;
@@ -36,6 +36,9 @@ namespace Mntone { namespace Rtmp { namespace Command {
 		}
 
 	internal:
+		// The AMF0 command body, written directly rather than through Commandify's value tree
+		std::vector<uint8> Serialize();
+
 		property uint32 TransactionId
 		{
 			uint32 get() { return TransactionId_; }
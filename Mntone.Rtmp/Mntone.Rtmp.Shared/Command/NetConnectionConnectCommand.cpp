@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "NetConnectionConnectCommand.h"
+#include "RtmpHelper.h"
+#include "commands.h"
 
 using namespace Mntone::Rtmp::Command;
 
@@ -41,6 +43,32 @@ Mntone::Data::Amf::AmfArray^ NetConnectionConnectCommand::Commandify()
 	return ary;
 }
 
+std::vector<uint8> NetConnectionConnectCommand::Serialize()
+{
+	if( !Body_.empty() )
+	{
+		return Body_;
+	}
+
+	mntone::rtmp::commands::connect_parameters parameters( RtmpHelper::ToUtf8String( App_ ), RtmpHelper::ToUtf8String( TcUrl_ ) );
+	parameters.flash_version = RtmpHelper::ToUtf8String( FlashVersion_ );
+	parameters.swf_url = RtmpHelper::ToUtf8String( SwfUrl_ );
+	parameters.fpad = Fpad_;
+	parameters.audio_codecs = static_cast<uint32>( AudioCodecs_ );
+	parameters.video_codecs = static_cast<uint32>( VideoCodecs_ );
+	parameters.video_function = static_cast<uint32>( VideoFunction_ );
+	parameters.page_url = RtmpHelper::ToUtf8String( PageUrl_ );
+	parameters.encoding = ObjectEncoding_ == Mntone::Data::Amf::AmfEncodingType::Amf3 ? mntone::rtmp::object_encoding::amf3 : mntone::rtmp::object_encoding::amf0;
+	if( OptionalUserArguments_ != nullptr )
+	{
+		mntone::rtmp::amf0::writer writer( parameters.arguments );
+		RtmpHelper::WriteAmf( writer, OptionalUserArguments_ );
+		return mntone::rtmp::commands::connect( parameters );
+	}
+	Body_ = mntone::rtmp::commands::connect( parameters );
+	return Body_;
+}
+
 Platform::String^ NetConnectionConnectCommand::ToString()
 {
 	return "connect (" + App_ + ")";
@@ -26,59 +26,65 @@ namespace Mntone { namespace Rtmp { namespace Command {
 		property Platform::String^ App
 		{
 			Platform::String^ get() { return App_; }
-			void set( Platform::String^ value ) { App_ = value; }
+			void set( Platform::String^ value ) { App_ = value; Body_.clear(); }
 		}
 		property Platform::String^ FlashVersion
 		{
 			Platform::String^ get() { return FlashVersion_; }
-			void set( Platform::String^ value ) { FlashVersion_ = value; }
+			void set( Platform::String^ value ) { FlashVersion_ = value; Body_.clear(); }
 		}
 		property Platform::String^ SwfUrl
 		{
 			Platform::String^ get() { return SwfUrl_; }
-			void set( Platform::String^ value ) { SwfUrl_ = value; }
+			void set( Platform::String^ value ) { SwfUrl_ = value; Body_.clear(); }
 		}
 		property Platform::String^ TcUrl
 		{
 			Platform::String^ get() { return TcUrl_; }
-			void set( Platform::String^ value ) { TcUrl_ = value; }
+			void set( Platform::String^ value ) { TcUrl_ = value; Body_.clear(); }
 		}
 		property bool Fpad
 		{
 			bool get() { return Fpad_; }
-			void set( bool value ) { Fpad_ = value; }
+			void set( bool value ) { Fpad_ = value; Body_.clear(); }
 		}
 		property SupportSoundType AudioCodecs
 		{
 			SupportSoundType get() { return AudioCodecs_; }
-			void set( SupportSoundType value ) { AudioCodecs_ = value; }
+			void set( SupportSoundType value ) { AudioCodecs_ = value; Body_.clear(); }
 		}
 		property SupportVideoType VideoCodecs
 		{
 			SupportVideoType get() { return VideoCodecs_; }
-			void set( SupportVideoType value ) { VideoCodecs_ = value; }
+			void set( SupportVideoType value ) { VideoCodecs_ = value; Body_.clear(); }
 		}
 		property SupportVideoFunctionType VideoFunction
 		{
 			SupportVideoFunctionType get() { return VideoFunction_; }
-			void set( SupportVideoFunctionType value ) { VideoFunction_ = value; }
+			void set( SupportVideoFunctionType value ) { VideoFunction_ = value; Body_.clear(); }
 		}
 		property Platform::String^ PageUrl
 		{
 			Platform::String^ get() { return PageUrl_; }
-			void set( Platform::String^ value ) { PageUrl_ = value; }
+			void set( Platform::String^ value ) { PageUrl_ = value; Body_.clear(); }
 		}
 		property Mntone::Data::Amf::AmfEncodingType ObjectEncoding
 		{
 			Mntone::Data::Amf::AmfEncodingType get() { return ObjectEncoding_; }
-			//void set( Mntone::Data::Amf::AmfEncodingType value ) { ObjectEncoding_ = value; }
+			void set( Mntone::Data::Amf::AmfEncodingType value ) { ObjectEncoding_ = value; Body_.clear(); }
 		}
 		property Mntone::Data::Amf::IAmfValue^ OptionalUserArguments
 		{
 			Mntone::Data::Amf::IAmfValue^ get() { return OptionalUserArguments_; }
-			void set( Mntone::Data::Amf::IAmfValue^ value ) { OptionalUserArguments_ = value; }
+			void set( Mntone::Data::Amf::IAmfValue^ value ) { OptionalUserArguments_ = value; Body_.clear(); }
 		}
 
+	internal:
+		// The AMF0 command body, written directly rather than through Commandify's value tree.
+		// Kept until a property is set again, so reconnecting with the same command reuses it; never
+		// kept with OptionalUserArguments, which the caller may change in place between connects.
+		std::vector<uint8> Serialize();
+
 	private:
 		Platform::String^ App_;
 		Platform::String^ FlashVersion_;
@@ -91,6 +97,7 @@ namespace Mntone { namespace Rtmp { namespace Command {
 		Platform::String^ PageUrl_;
 		Mntone::Data::Amf::AmfEncodingType ObjectEncoding_;
 		Mntone::Data::Amf::IAmfValue^ OptionalUserArguments_;
+		std::vector<uint8> Body_;
 	};
 
 } } }
\ No newline at end of file
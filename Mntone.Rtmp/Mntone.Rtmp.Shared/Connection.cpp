@@ -1,107 +1,214 @@
 #include "pch.h"
 #include "Connection.h"
+#include "RtmpHelper.h"
 
 using namespace Concurrency;
 using namespace Windows::Foundation;
+using namespace Windows::Storage::Streams;
+using namespace mntone::rtmp;
 using namespace Mntone::Rtmp;
 
+const uint32 RECEIVE_BLOCK_SIZE = 64 * 1024;
+
 Connection::Connection()
-	: IsInitialized_( false )
-	, streamSocket_( nullptr )
+	: streamSocket_( nullptr )
 	, dataWriter_( nullptr )
+	, receiveBuffer_( nullptr )
+	, receiveOperation_( nullptr )
+	, buffer_( nullptr )
+	, receivePaused_( false )
+	, receiving_( false )
+	, writeTask_( task_from_result() )
+	, pendingWrites_( 0 )
 { }
 
 Connection::~Connection()
 {
-	if( dataWriter_ != nullptr )
-	{
-		dataWriter_->DetachStream();
-		delete dataWriter_;
-		dataWriter_ = nullptr;
-	}
+	CloseImpl();
 }
 
-task<void> Connection::ConnectAsync( Platform::String^ host, Platform::String^ port )
+void Connection::connect( const std::string& host, uint16 port, connect_handler handler )
 {
 	using namespace Windows::Networking;
 	using namespace Windows::Networking::Sockets;
 
 	streamSocket_ = ref new StreamSocket();
-	auto task = streamSocket_->ConnectAsync( ref new HostName( host ), port, SocketProtectionLevel::PlainSocket );
-	return create_task( task ).then( [=]
+	auto task = streamSocket_->ConnectAsync( ref new HostName( RtmpHelper::ToPlatformString( host ) ), ref new Platform::String( std::to_wstring( port ).c_str() ), SocketProtectionLevel::PlainSocket );
+	create_task( task ).then( [this, handler]( Concurrency::task<void> prevTask )
 	{
-		dataWriter_ = ref new Windows::Storage::Streams::DataWriter( streamSocket_->OutputStream );
+		try
+		{
+			prevTask.get();
+		}
+		catch( Platform::Exception^ )
+		{
+			handler( false );
+			return;
+		}
 
-		IsInitialized_ = true;
-	} );
+		dataWriter_ = ref new DataWriter( streamSocket_->OutputStream );
+		handler( true );
+	}, task_continuation_context::use_arbitrary() );
 }
 
-void Connection::Read( const uint32 length, ConnectionCallbackHandler^ callbackFunction )
+void Connection::start_receive( ring_buffer& buffer, receive_handler handler )
 {
-	using namespace Windows::Storage::Streams;
+	buffer_ = &buffer;
+	receiveHandler_ = std::move( handler );
+	{
+		std::lock_guard<std::mutex> lock( receiveMutex_ );
+		if( receivePaused_ )
+		{
+			return;
+		}
+		receiving_ = true;
+	}
+	Receive();
+}
 
-	auto buffer = ref new Buffer( length );
-	auto read_operation = streamSocket_->InputStream->ReadAsync( buffer, length, InputStreamOptions::Partial );
-	read_operation->Completed = ref new AsyncOperationWithProgressCompletedHandler<IBuffer^, uint32>(
-	[this, length, callbackFunction]( IAsyncOperationWithProgress<IBuffer^, uint32>^ operation, AsyncStatus status )
+void Connection::pause_receive()
+{
+	std::lock_guard<std::mutex> lock( receiveMutex_ );
+	receivePaused_ = true;
+}
+
+void Connection::resume_receive()
+{
+	{
+		std::lock_guard<std::mutex> lock( receiveMutex_ );
+		receivePaused_ = false;
+		if( receiving_ || buffer_ == nullptr || streamSocket_ == nullptr )
+		{
+			return;
+		}
+		receiving_ = true;
+	}
+	Receive();
+}
+
+void Connection::Receive()
+{
+	const auto& length = static_cast<uint32>( std::min<size_t>( buffer_->write_length(), RECEIVE_BLOCK_SIZE ) );
+
+	// Reuse one block for every partial read; only one read is outstanding at a time
+	if( receiveBuffer_ == nullptr || receiveBuffer_->Capacity < length )
 	{
+		receiveBuffer_ = ref new Buffer( length );
+	}
+
+	receiveOperation_ = streamSocket_->InputStream->ReadAsync( receiveBuffer_, length, InputStreamOptions::Partial );
+	receiveOperation_->Completed = ref new AsyncOperationWithProgressCompletedHandler<IBuffer^, uint32>(
+		[this]( IAsyncOperationWithProgress<IBuffer^, uint32>^ operation, AsyncStatus status )
+	{
+		if( status == AsyncStatus::Canceled )
+		{
+			return;
+		}
+
+		uint32 length = 0;
 		if( status == AsyncStatus::Completed )
 		{
-			auto buffer = operation->GetResults();
-			if( buffer->Length != length )
+			const auto& result = operation->GetResults();
+			length = result->Length;
+			if( length != 0 )
 			{
-				ContinuousRead( buffer, length - buffer->Length, callbackFunction );
+				auto reader = DataReader::FromBuffer( result );
+				reader->ReadBytes( Platform::ArrayReference<uint8>( buffer_->write_pointer(), length ) );
+				buffer_->commit( length );
 			}
-			else
+		}
+
+		receiveHandler_( length );
+		if( length == 0 || streamSocket_ == nullptr )
+		{
+			return;
+		}
+
+		{
+			// Leaving the data in the socket lets the receive window close
+			std::lock_guard<std::mutex> lock( receiveMutex_ );
+			if( receivePaused_ )
 			{
-				callbackFunction( buffer );
+				receiving_ = false;
+				return;
 			}
 		}
+		Receive();
 	} );
-	ReadOperationChanged( this, read_operation );
 }
 
-void Connection::ContinuousRead( Windows::Storage::Streams::IBuffer^ data, const uint32 length, ConnectionCallbackHandler^ callbackFunction )
+void Connection::write( gather_buffer data )
 {
-	using namespace Windows::Storage::Streams;
+	std::lock_guard<std::mutex> lock( writeMutex_ );
+	const auto writer = dataWriter_;
+	if( writer == nullptr )
+	{
+		return;
+	}
 
-	auto buffer = ref new Buffer( length );
-	auto read_operation = streamSocket_->InputStream->ReadAsync( buffer, length, InputStreamOptions::Partial );
-	read_operation->Completed = ref new AsyncOperationWithProgressCompletedHandler<IBuffer^, uint32>(
-		[this, data, length, callbackFunction]( IAsyncOperationWithProgress<IBuffer^, uint32>^ operation, AsyncStatus status )
+	// Every segment is staged in the writer and the whole message goes out with one StoreAsync
+	auto buffer = std::make_shared<gather_buffer>( std::move( data ) );
+	++pendingWrites_;
+	writeTask_ = writeTask_.then( [writer, buffer]
 	{
-		if( status == AsyncStatus::Completed )
+		for( size_t i = 0; i < buffer->segment_count(); ++i )
 		{
-			auto writer = ref new DataWriter();
-			writer->WriteBuffer( data );
+			writer->WriteBytes( Platform::ArrayReference<uint8>( const_cast<uint8*>( buffer->segment_data( i ) ), static_cast<uint32>( buffer->segment_length( i ) ) ) );
+		}
+		return create_task( writer->StoreAsync() );
+	} ).then( [this]( Concurrency::task<uint32> prevTask )
+	{
+		try
+		{
+			prevTask.get();
+		}
+		catch( Platform::Exception^ )
+		{
+			// A failed write surfaces as a failed read on the receive side
+		}
 
-			auto buffer = operation->GetResults();
-			writer->WriteBuffer( buffer );
-			if( buffer->Length != length )
-			{
-				ContinuousRead( writer->DetachBuffer(), length - buffer->Length, callbackFunction );
-			}
-			else
+		drained_handler handler;
+		{
+			std::lock_guard<std::mutex> lock( writeMutex_ );
+			if( --pendingWrites_ != 0 || dataWriter_ == nullptr )
 			{
-				callbackFunction( writer->DetachBuffer() );
+				return;
 			}
+			handler = drainedHandler_;
+		}
+		if( handler )
+		{
+			handler();
 		}
 	} );
-	ReadOperationChanged( this, read_operation );
 }
 
-task<void> Connection::Write( const uint8* const data, const size_t length )
+void Connection::set_drained_handler( drained_handler handler )
 {
-	dataWriter_->WriteBytes( Platform::ArrayReference<uint8>( const_cast<uint8_t*>( data ), static_cast<uint32>( length ) ) );
-	return create_task( dataWriter_->StoreAsync() ).then( [] ( const uint32 ) { } );
+	std::lock_guard<std::mutex> lock( writeMutex_ );
+	drainedHandler_ = std::move( handler );
+}
+
+void Connection::close()
+{
+	CloseImpl();
 }
 
 void Connection::CloseImpl()
 {
-	if( dataWriter_ != nullptr )
+	if( receiveOperation_ != nullptr )
 	{
-		delete dataWriter_;
-		dataWriter_ = nullptr;
+		receiveOperation_->Cancel();
+		receiveOperation_ = nullptr;
+	}
+	{
+		std::lock_guard<std::mutex> lock( writeMutex_ );
+		if( dataWriter_ != nullptr )
+		{
+			dataWriter_->DetachStream();
+			delete dataWriter_;
+			dataWriter_ = nullptr;
+		}
 	}
 	if( streamSocket_ != nullptr )
 	{
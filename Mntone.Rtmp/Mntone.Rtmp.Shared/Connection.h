@@ -1,41 +1,48 @@
 #pragma once
+#include "transport.h"
 
 namespace Mntone { namespace Rtmp {
 
-	delegate void ConnectionCallbackHandler( Windows::Storage::Streams::IBuffer^ result );
-
-	ref class Connection sealed
+	// StreamSocket implementation of the core transport.
+	class Connection final
+		: public mntone::rtmp::transport
 	{
-	internal:
-		Connection();
-
 	public:
+		Connection();
 		virtual ~Connection();
 
-	internal:
-		Concurrency::task<void> ConnectAsync( Platform::String^ host, Platform::String^ port );
-
-		void Read( const uint32 length, ConnectionCallbackHandler^ callbackFunction );
-
-		Concurrency::task<void> Write( const uint8* const data, const size_t length );
+		virtual void connect( const std::string& host, uint16 port, connect_handler handler ) override;
+		virtual void start_receive( mntone::rtmp::ring_buffer& buffer, receive_handler handler ) override;
+		virtual void pause_receive() override;
+		virtual void resume_receive() override;
+		using mntone::rtmp::transport::write;
+		virtual void write( mntone::rtmp::gather_buffer data ) override;
+		virtual void set_drained_handler( drained_handler handler ) override;
+		virtual void close() override;
 
 	private:
+		void Receive();
 		void CloseImpl();
-		void ContinuousRead( Windows::Storage::Streams::IBuffer^ data, const uint32 length, ConnectionCallbackHandler^ callbackFunction );
-
-	internal:
-		event Windows::Foundation::TypedEventHandler<Connection^, Windows::Foundation::IAsyncOperationWithProgress<Windows::Storage::Streams::IBuffer^, uint32>^>^ ReadOperationChanged;
-
-	internal:
-		property bool IsInitialized
-		{
-			bool get() { return IsInitialized_; }
-		}
 
 	private:
-		bool IsInitialized_;
 		Windows::Networking::Sockets::StreamSocket^ streamSocket_;
 		Windows::Storage::Streams::DataWriter^ dataWriter_;
+		Windows::Storage::Streams::Buffer^ receiveBuffer_;
+		Windows::Foundation::IAsyncOperationWithProgress<Windows::Storage::Streams::IBuffer^, uint32>^ receiveOperation_;
+
+		mntone::rtmp::ring_buffer* buffer_;
+		receive_handler receiveHandler_;
+
+		// A read is issued only while not paused; resume_receive restarts the loop if it stopped
+		std::mutex receiveMutex_;
+		bool receivePaused_, receiving_;
+
+		// Every write is chained to the previous one so that StoreAsync calls never overlap;
+		// the drained handler runs when the last chained write completes
+		std::mutex writeMutex_;
+		Concurrency::task<void> writeTask_;
+		size_t pendingWrites_;
+		drained_handler drainedHandler_;
 	};
 
-} }
+} }
\ No newline at end of file
@@ -1,5 +1,5 @@
 #pragma once
-#include "sound_info.h"
+#include "Media/audio_info.h"
 #include "AudioFormat.h"
 
 namespace Mntone { namespace Rtmp { namespace Media {
@@ -10,7 +10,7 @@ namespace Mntone { namespace Rtmp { namespace Media {
 	internal:
 		AudioInfo() { }
 
-		void SetInfo( const mntone::rtmp::media::sound_info& soundInfo );
+		void SetInfo( const mntone::rtmp::media::audio_info& info );
 
 	public:
 		property AudioFormat Format
@@ -1,6 +1,7 @@
 #pragma once
 #include "VideoFormat.h"
 #include "AvcProfileIndication.h"
+#include "Media/video_info.h"
 
 namespace Mntone { namespace Rtmp { namespace Media {
 
@@ -10,6 +11,15 @@ namespace Mntone { namespace Rtmp { namespace Media {
 	internal:
 		VideoInfo() { }
 
+		void SetInfo( const mntone::rtmp::media::video_info& info )
+		{
+			Format_ = static_cast<VideoFormat>( info.format );
+			ProfileIndication_ = static_cast<AvcProfileIndication>( info.profile_indication );
+			Bitrate_ = info.bitrate;
+			Height_ = info.height;
+			Width_ = info.width;
+		}
+
 	public:
 		property VideoFormat Format
 		{
@@ -1,19 +1,14 @@
 #pragma once
 #include "Command/NetConnectionConnectCommand.h"
 #include "Command/NetConnectionCallCommand.h"
-#include "limit_type.h"
-#include "rtmp_packet.h"
+#include "net_connection.h"
 #include "RtmpUri.h"
-#include "Connection.h"
 #include "NetStatusUpdatedEventArgs.h"
 #include "NetConnectionClosedEventArgs.h"
 #include "NetConnectionCallbackEventArgs.h"
-#include "UserControlMessageEventType.h"
 
 namespace Mntone { namespace Rtmp {
 
-	delegate void HandshakeCallbackHandler();
-
 	ref class NetStream;
 
 	[Windows::Foundation::Metadata::WebHostHidden]
@@ -40,13 +35,18 @@ namespace Mntone { namespace Rtmp {
 		// Call
 		Windows::Foundation::IAsyncAction^ CallAsync( Command::NetConnectionCallCommand^ command );
 
-	internal:
-		// Send
-		Concurrency::task<void> SendActionAsync( uint32 streamId, Mntone::Data::Amf::AmfArray^ amf );
+		// Caps the memory held by partially received messages; 0 removes the cap
+		void SetReassemblyLimit( uint64 bytes );
+
+		// Outbound chunk size announced right after the handshake of the next connect (128-16777215)
+		void SetChunkSize( uint32 bytes );
 
+		// Video a send batch may carry before queued audio gets its turn; 0 removes the bound
+		void SetMaxVideoBytesBeforeYield( uint32 bytes );
+
+	internal:
 		// Utilites
 		Concurrency::task<void> AttachNetStreamAsync( NetStream^ stream );
-		void UnattachNetStream( NetStream^ stream );
 
 	private:
 		~NetConnection();
@@ -54,46 +54,10 @@ namespace Mntone { namespace Rtmp {
 		// Close
 		void CloseImpl();
 
-		// Handshake
-		void Handshake( HandshakeCallbackHandler^ callbackFunction );
-
-		// Receive
-		void OnReadOperationChanged( Connection^ sender, Windows::Foundation::IAsyncOperationWithProgress<Windows::Storage::Streams::IBuffer^, uint32>^ operation );
-		void Receive();
-		void ReceiveContinueImpl( Windows::Foundation::IAsyncOperationWithProgress<Windows::Storage::Streams::IBuffer^, uint32>^ operation );
-		void ReceiveHeader1Impl( Windows::Storage::Streams::IBuffer^ result );
-		void ReceiveHeader2Impl( const uint8 format_type, const uint16 chunk_stream_id );
-		void ReceiveBodyImpl( std::shared_ptr<mntone::rtmp::rtmp_packet> packet );
-		void ReceiveCallbackImpl( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-
-		void OnMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-
-		void OnNetworkMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnSetChunkSize( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnAbortMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnAcknowledgement( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnUserControlMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnWindowAcknowledgementSize( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnSetPeerBandwidthMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-
-		void OnCommandMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-
-		// Send
-		Concurrency::task<void> SetChunkSizeAsync( const int32 chunkSize );
-		Concurrency::task<void> AbortMessageAsync( const uint32 chunkStreamId );
-		Concurrency::task<void> AcknowledgementAsync( const uint32 sequenceNumber );
-		Concurrency::task<void> WindowAcknowledgementSizeAsync( const uint32 acknowledgementWindowSize );
-		Concurrency::task<void> SetPeerBandWidthAsync( const uint32 windowSize, const mntone::rtmp::limit_type type );
-
-		Concurrency::task<void> SetBufferLengthAsync( const uint32 streamId, const uint32 bufferLength );
-		Concurrency::task<void> PingResponseAsync( const uint32 timestamp );
-		Concurrency::task<void> UserControlMessageEventAsync( UserControlMessageEventType type, std::vector<uint8> data );
-
-		Concurrency::task<void> SendNetworkAsync( const mntone::rtmp::type_id_type type, std::vector<uint8> data );
-		Concurrency::task<void> SendActionAsync( Mntone::Data::Amf::AmfArray^ amf );
-
-		Concurrency::task<void> SendAsync( mntone::rtmp::rtmp_header header, std::vector<uint8> data, const uint8 forceFormatType = 255, size_t temporary_length = 0 );
-		std::vector<uint8> CreateHeader( mntone::rtmp::rtmp_header header, uint8_t forceFormatType );
+		// Core callbacks
+		void OnStatus( mntone::rtmp::net_status_code code );
+		void OnCallback( const std::string& commandName, const mntone::rtmp::byte_slice& command );
+		void OnClosed();
 
 	public:
 		event Windows::Foundation::EventHandler<NetStatusUpdatedEventArgs^>^ StatusUpdated;
@@ -105,25 +69,73 @@ namespace Mntone { namespace Rtmp {
 		{
 			RtmpUri^ get() { return Uri_; }
 		}
+		property uint64 BytesReceived
+		{
+			uint64 get() { return connection_ != nullptr ? connection_->bytes_received() : 0; }
+		}
+		property uint64 AcknowledgementsSent
+		{
+			uint64 get() { return connection_ != nullptr ? connection_->acknowledgements_sent() : 0; }
+		}
+		// AMF version the server accepted in its connect result; Amf0 until then
+		property Mntone::Data::Amf::AmfEncodingType ObjectEncoding
+		{
+			Mntone::Data::Amf::AmfEncodingType get()
+			{
+				return connection_ != nullptr && connection_->encoding() == mntone::rtmp::object_encoding::amf3 ? Mntone::Data::Amf::AmfEncodingType::Amf3 : Mntone::Data::Amf::AmfEncodingType::Amf0;
+			}
+		}
+		property uint64 ReassemblyLimitHits
+		{
+			uint64 get() { return connection_ != nullptr ? connection_->reassembly_limit_hits() : 0; }
+		}
 
-	private:
-		int64 startTime_;
-		RtmpUri^ Uri_;
-		Connection^ connection_;
-		Windows::Foundation::EventRegistrationToken readOperationEventToken_;
-		Windows::Foundation::IAsyncOperationWithProgress<Windows::Storage::Streams::IBuffer^, uint32>^ receiveOperation_;
-
-		uint32 latestTransactionId_;
-		std::unordered_map<uint32, NetStream^> netStreamTemporary_;
-		std::unordered_map<uint32, NetStream^> bindingNetStream_;
+		// Share of the received and sent chunk streams spent on chunk headers
+		property float64 InboundChunkHeaderOverhead
+		{
+			float64 get() { return connection_ != nullptr ? connection_->inbound_chunk_statistics().header_overhead() : 0.0; }
+		}
+		property float64 OutboundChunkHeaderOverhead
+		{
+			float64 get() { return connection_ != nullptr ? connection_->outbound_chunk_statistics().header_overhead() : 0.0; }
+		}
+		property uint64 InboundChunkHeaderBytes
+		{
+			uint64 get() { return connection_ != nullptr ? connection_->inbound_chunk_statistics().header_bytes : 0; }
+		}
+		property uint64 OutboundChunkHeaderBytes
+		{
+			uint64 get() { return connection_ != nullptr ? connection_->outbound_chunk_statistics().header_bytes : 0; }
+		}
 
-		std::vector<uint8> rxHeaderBuffer_;
-		std::unordered_map<uint16, std::shared_ptr<mntone::rtmp::rtmp_packet>> rxBakPackets_;
-		std::unordered_map<uint16, std::shared_ptr<mntone::rtmp::rtmp_header>> txBakHeaders_;
+		// Outbound backlog: queued bytes, bytes awaiting the peer's acknowledgement, age of the oldest
+		// queued media message and the number of stops at a full peer bandwidth window
+		property uint64 SendQueueBytes
+		{
+			uint64 get() { return connection_ != nullptr ? connection_->backlog().queued_bytes : 0; }
+		}
+		property uint64 UnacknowledgedBytes
+		{
+			uint64 get() { return connection_ != nullptr ? connection_->backlog().unacknowledged_bytes : 0; }
+		}
+		property Windows::Foundation::TimeSpan SendQueueDelay
+		{
+			Windows::Foundation::TimeSpan get()
+			{
+				Windows::Foundation::TimeSpan delay;
+				delay.Duration = connection_ != nullptr ? static_cast<int64>( connection_->backlog().queue_delay_milliseconds ) * 10000ll : 0;
+				return delay;
+			}
+		}
+		property uint64 WindowStallCount
+		{
+			uint64 get() { return connection_ != nullptr ? connection_->backlog().window_stall_count : 0; }
+		}
 
-		int32 rxChunkSize_, txChunkSize_;
-		uint32 rxWindowSize_, txWindowSize_;
-		mntone::rtmp::limit_type rxLimitType_, txLimitType_;
+	private:
+		RtmpUri^ Uri_;
+		Command::NetConnectionConnectCommand^ defaultConnect_;
+		std::shared_ptr<mntone::rtmp::net_connection> connection_;
 	};
 
 } }
\ No newline at end of file
@@ -2,31 +2,40 @@
 #include "NetStream.h"
 #include "NetConnection.h"
 #include "RtmpHelper.h"
-#include "Media/sound_info.h"
-#include "Media/adts_header.h"
-#include "Media/video_type.h"
-#include "Media/VideoFormat.h"
-#include "Media/flv_tag.h"
 
 using namespace Concurrency;
 using namespace Windows::Foundation;
 using namespace mntone::rtmp;
-using namespace mntone::rtmp::media;
 using namespace Mntone::Rtmp;
 using namespace Mntone::Rtmp::Media;
 
 NetStream::NetStream()
-	: streamId_( 0 )
-	, audioEnabled_( true ), audioInfoEnabled_( false ), audioInfo_( ref new AudioInfo() )
-	, videoEnabled_( true ), videoInfoEnabled_( false ), videoInfo_( ref new VideoInfo() )
-	, videoDataRate_( 0 ), videoHeight_( 0 ), videoWidth_( 0 )
-	, lengthSizeMinusOne_( 0 )
-	, samplingRate_( 0 )
-{ }
+	: parent_( nullptr )
+	, stream_( std::make_shared<net_stream>() )
+	, audioInfo_( ref new AudioInfo() )
+	, videoInfo_( ref new VideoInfo() )
+	, sendPool_( std::make_shared<body_pool>() )
+{
+	stream_->set_attached_handler( [this] { OnAttached(); } );
+	stream_->set_status_handler( [this]( net_status_code code ) { OnStatus( code ); } );
+	stream_->set_metadata_handler( [this]( const media::stream_metadata& metadata ) { OnMetadata( metadata ); } );
+	stream_->set_audio_started_handler( [this]( bool audioOnly, const media::audio_info& info ) { OnAudioStarted( audioOnly, info ); } );
+	stream_->set_audio_handler( [this]( const audio_sample& sample ) { OnAudio( sample ); } );
+	stream_->set_video_started_handler( [this]( bool videoOnly, const media::video_info& info ) { OnVideoStarted( videoOnly, info ); } );
+	stream_->set_video_handler( [this]( const video_sample& sample ) { OnVideo( sample ); } );
+}
 
 NetStream::~NetStream()
 {
-	DetachedImpl();
+	stream_->set_attached_handler( nullptr );
+	stream_->set_status_handler( nullptr );
+	stream_->set_metadata_handler( nullptr );
+	stream_->set_audio_started_handler( nullptr );
+	stream_->set_audio_handler( nullptr );
+	stream_->set_video_started_handler( nullptr );
+	stream_->set_video_handler( nullptr );
+	stream_->close();
+	parent_ = nullptr;
 }
 
 IAsyncAction^ NetStream::AttachAsync( NetConnection^ connection )
@@ -37,29 +46,6 @@ IAsyncAction^ NetStream::AttachAsync( NetConnection^ connection )
 	} );
 }
 
-void NetStream::AttachedImpl()
-{
-	Attached( this, ref new NetStreamAttachedEventArgs() );
-}
-
-void NetStream::DetachedImpl()
-{
-	if( parent_ != nullptr )
-	{
-		using namespace Mntone::Data::Amf;
-
-		auto cmd = ref new AmfArray();
-		cmd->Append( AmfValue::CreateStringValue( "closeStream" ) );	// Command name
-		cmd->Append( AmfValue::CreateNumberValue( 0.0 ) );				// Transaction id
-		cmd->Append( ref new AmfValue() );								// Command object: set to null type
-		cmd->Append( AmfValue::CreateNumberValue( streamId_ ) );
-		SendActionAsync( cmd );
-
-		parent_->UnattachNetStream( this );
-		parent_ = nullptr;
-	}
-}
-
 IAsyncAction^ NetStream::PlayAsync( Platform::String^ streamName )
 {
 	return PlayAsync( streamName, -2 );
@@ -79,26 +65,7 @@ IAsyncAction^ NetStream::PlayAsync( Platform::String^ streamName, float64 start,
 {
 	return create_async( [=]
 	{
-		using namespace Mntone::Data::Amf;
-
-		auto cmd = ref new AmfArray();
-		cmd->Append( AmfValue::CreateStringValue( "play" ) );	// Command name
-		cmd->Append( AmfValue::CreateNumberValue( 0.0 ) );		// Transaction id
-		cmd->Append( ref new AmfValue() );						// Command object: set to null type
-		cmd->Append( AmfValue::CreateStringValue( streamName ) );
-		if( start != -2.0 )
-		{
-			cmd->Append( AmfValue::CreateNumberValue( start ) );
-			if( duration != -1.0 )
-			{
-				cmd->Append( AmfValue::CreateNumberValue( duration ) );
-				if( reset != -1 )
-				{
-					cmd->Append( AmfValue::CreateNumberValue( static_cast<float64>( reset ) ) );
-				}
-			}
-		}
-		return SendActionAsync( cmd );
+		stream_->play( RtmpHelper::ToUtf8String( streamName ), start, duration, reset );
 	} );
 }
 
@@ -106,15 +73,7 @@ IAsyncAction^ NetStream::PauseAsync( float64 position )
 {
 	return create_async( [=]
 	{
-		using namespace Mntone::Data::Amf;
-
-		auto cmd = ref new AmfArray();
-		cmd->Append( AmfValue::CreateStringValue( "pause" ) );	// Command name
-		cmd->Append( AmfValue::CreateNumberValue( 0.0 ) );		// Transaction id
-		cmd->Append( ref new AmfValue() );						// Command object: set to null type
-		cmd->Append( AmfValue::CreateBooleanValue( true ) );
-		cmd->Append( AmfValue::CreateNumberValue( position ) );
-		return SendActionAsync( cmd );
+		stream_->pause( position );
 	} );
 }
 
@@ -122,15 +81,7 @@ IAsyncAction^ NetStream::ResumeAsync( float64 position )
 {
 	return create_async( [=]
 	{
-		using namespace Mntone::Data::Amf;
-
-		auto cmd = ref new AmfArray();
-		cmd->Append( AmfValue::CreateStringValue( "pause" ) );	// Command name
-		cmd->Append( AmfValue::CreateNumberValue( 0.0 ) );		// Transaction id
-		cmd->Append( ref new AmfValue() );						// Command object: set to null type
-		cmd->Append( AmfValue::CreateBooleanValue( false ) );
-		cmd->Append( AmfValue::CreateNumberValue( position ) );
-		return SendActionAsync( cmd );
+		stream_->resume( position );
 	} );
 }
 
@@ -138,228 +89,137 @@ IAsyncAction^ NetStream::SeekAsync( float64 offset )
 {
 	return create_async( [=]
 	{
-		using namespace Mntone::Data::Amf;
-
-		auto cmd = ref new AmfArray();
-		cmd->Append( AmfValue::CreateStringValue( "seek" ) );	// Command name
-		cmd->Append( AmfValue::CreateNumberValue( 0.0 ) );		// Transaction id
-		cmd->Append( ref new AmfValue() );						// Command object: set to null type
-		cmd->Append( AmfValue::CreateNumberValue( offset ) );
-		return SendActionAsync( cmd );
+		stream_->seek( offset );
 	} );
 }
 
-void NetStream::OnMessage( rtmp_header header, std::vector<uint8> data )
+IAsyncAction^ NetStream::PublishAsync( Platform::String^ streamName )
 {
-	switch( header.type_id )
-	{
-	case type_id_type::audio_message:
-		OnAudioMessage( std::move( header ), std::move( data ) );
-		break;
-
-	case type_id_type::video_message:
-		OnVideoMessage( std::move( header ), std::move( data ) );
-		break;
-
-	case type_id_type::data_message_amf3:
-	case type_id_type::data_message_amf0:
-		OnDataMessage( std::move( header ), std::move( data ) );
-		break;
-
-	case type_id_type::command_message_amf3:
-	case type_id_type::command_message_amf0:
-		OnCommandMessage( std::move( header ), std::move( data ) );
-		break;
-
-	case type_id_type::aggregate_message:
-		OnAggregateMessage( std::move( header ), std::move( data ) );
-		break;
-	}
+	return PublishAsync( streamName, "live" );
 }
 
-void NetStream::OnAudioMessage( rtmp_header header, std::vector<uint8> data )
+IAsyncAction^ NetStream::PublishAsync( Platform::String^ streamName, Platform::String^ type )
 {
-	const auto& si = *reinterpret_cast<const sound_info*>( data.data() );
-
-	if( si.format == sound_format::aac )
-	{
-		if( data.size() < 3 )
-		{
-			return;
-		}
-
-		if( data[1] == 0x01 )
-		{
-			auto args = ref new NetStreamAudioReceivedEventArgs();
-			args->Info = audioInfo_;
-			args->SetTimestamp( header.timestamp );
-			args->SetData( std::move( data ), 2 );
-			AudioReceived( this, args );
-		}
-		else if( data[1] == 0x00 && !audioInfoEnabled_ )
-		{
-			const auto& adts = *reinterpret_cast<const adts_header*>( data.data() );
-			audioInfo_->Format = AudioFormat::Aac;
-			audioInfo_->SampleRate = samplingRate_ != 0 ? samplingRate_ : adts.sampling_frequency();
-			audioInfo_->ChannelCount = adts.channel_configuration();
-			audioInfo_->BitsPerSample = si.size == sound_size::s16bit ? 16 : 8;
-			audioInfoEnabled_ = true;
-			AudioStarted( this, ref new NetStreamAudioStartedEventArgs( !videoEnabled_, audioInfo_ ) );
-		}
-		return;
-	}
-
-	if( !audioInfoEnabled_ )
+	return create_async( [=]
 	{
-		audioInfo_->SetInfo( si );
-		audioInfoEnabled_ = true;
-		AudioStarted( this, ref new NetStreamAudioStartedEventArgs( !videoEnabled_, audioInfo_ ) );
-	}
-
-	auto args = ref new NetStreamAudioReceivedEventArgs();
-	args->Info = audioInfo_;
-	args->SetTimestamp( header.timestamp );
-	args->SetData( std::move( data ), 1 );
-	AudioReceived( this, args );
+		stream_->publish( RtmpHelper::ToUtf8String( streamName ), RtmpHelper::ToUtf8String( type ) );
+	} );
 }
 
-void NetStream::OnVideoMessage( rtmp_header header, std::vector<uint8> data )
+IAsyncAction^ NetStream::SendMetadataAsync( Mntone::Data::Amf::AmfObject^ metadata )
 {
-	const auto& vt = static_cast<video_type>( ( data[0] >> 4 ) & 0x0f );
-	const auto& vf = static_cast<VideoFormat>( data[0] & 0x0f );
-
-	auto args = ref new NetStreamVideoReceivedEventArgs();
-	args->IsKeyframe = vt == video_type::keyframe;
-	args->SetDecodeTimestamp( header.timestamp );
-
-	if( vf == VideoFormat::Avc )
-	{
-		// Need to convert NAL file stream to byte stream
-		AnalysisAvc( std::move( header ), std::move( data ), args );
-		return;
-	}
-
-	if( !videoInfoEnabled_ )
+	return create_async( [=]
 	{
-		videoInfo_->Format = vf;
-		videoInfo_->Bitrate = videoDataRate_;
-		videoInfo_->Height = videoHeight_;
-		videoInfo_->Width = videoWidth_;
-		videoInfoEnabled_ = true;
-		VideoStarted( this, ref new NetStreamVideoStartedEventArgs( !audioEnabled_, videoInfo_ ) );
-	}
-
-	args->Info = videoInfo_;
-	args->SetPresentationTimestamp( header.timestamp );
-	args->SetData( std::move( data ), 1 );
-	VideoReceived( this, args );
+		std::vector<uint8> data;
+		amf0::writer writer( data );
+		writer.string( "@setDataFrame" ).string( "onMetaData" );
+		RtmpHelper::WriteAmf( writer, metadata );
+		stream_->send_data( data );
+	} );
 }
 
-void NetStream::OnDataMessage( rtmp_header /*header*/, std::vector<uint8> data )
+void NetStream::SendAudio( AudioFormat format, uint32 sampleRate, uint16 channelCount, uint16 bitsPerSample, bool sequenceHeader, TimeSpan timestamp, Windows::Storage::Streams::IBuffer^ data )
 {
-	const auto& amf = RtmpHelper::ParseAmf( std::move( data ) );
-	const auto& name = amf->GetStringAt( 0 );
-	if( name != "onMetaData" )
-	{
-		return;
-	}
-
-	const auto& object = amf->GetObjectAt( 1 );
-
-	if( object->HasKey( "videocodecid" ) )
-	{
-		videoEnabled_ = true;
-		if( object->HasKey( "videodatarate" ) )
-		{
-			videoDataRate_ = static_cast<uint16>( object->GetNamedNumber( "videodatarate" ) );
-		}
-		if( object->HasKey( "height" ) )
-		{
-			videoHeight_ = static_cast<uint16>( object->GetNamedNumber( "height" ) );
-		}
-		if( object->HasKey( "width" ) )
-		{
-			videoWidth_ = static_cast<uint16>( object->GetNamedNumber( "width" ) );
-		}
-	}
-	else
-	{
-		videoEnabled_ = false;
-	}
+	audio_frame frame;
+	frame.info.format = static_cast<media::audio_format>( format );
+	frame.info.sample_rate = sampleRate;
+	frame.info.channel_count = channelCount;
+	frame.info.bits_per_sample = bitsPerSample;
+	frame.sequence_header = sequenceHeader;
+	frame.timestamp = timestamp.Duration / 10000;
+	frame.data = ToSlice( data );
+	stream_->send_audio( frame );
+}
 
-	if( object->HasKey( "audiocodecid" ) )
-	{
-		audioEnabled_ = true;
-		if( object->HasKey( "audiosamplerate" ) )
-		{
-			samplingRate_ = static_cast<uint32>( object->GetNamedNumber( "audiosamplerate" ) );
-		}
-	}
-	else
-	{
-		audioEnabled_ = false;
-	}
+void NetStream::SendVideo( VideoFormat format, bool keyframe, bool sequenceHeader, TimeSpan decodeTimestamp, TimeSpan presentationTimestamp, Windows::Storage::Streams::IBuffer^ data )
+{
+	video_frame frame;
+	frame.format = static_cast<media::video_format>( format );
+	frame.type = keyframe ? media::video_type::keyframe : media::video_type::interframe;
+	frame.sequence_header = sequenceHeader;
+	frame.decode_timestamp = decodeTimestamp.Duration / 10000;
+	frame.presentation_timestamp = presentationTimestamp.Duration / 10000;
+	frame.data = ToSlice( data );
+	stream_->send_video( frame );
 }
 
-void NetStream::OnCommandMessage( rtmp_header /*header*/, std::vector<uint8> data )
+// The one copy on the send path: out of the caller's IBuffer, which may be reused as soon as this
+// returns, into a pooled block the send queue references until the chunks are written
+byte_slice NetStream::ToSlice( Windows::Storage::Streams::IBuffer^ data )
 {
-	const auto& amf = RtmpHelper::ParseAmf( std::move( data ) );
-	const auto& name = amf->GetStringAt( 0 );
-	if( name != "onStatus" )
+	const auto length = data->Length;
+	auto buffer = sendPool_->acquire( length );
+	if( length != 0 )
 	{
-		return;
+		auto reader = Windows::Storage::Streams::DataReader::FromBuffer( data );
+		reader->ReadBytes( Platform::ArrayReference<uint8>( buffer.data(), length ) );
 	}
+	return byte_slice( std::move( buffer ) );
+}
 
-	const auto& information = amf->GetObjectAt( 3 );
-	const auto& code = information->GetNamedString( "code" );
-	const auto& nsc = RtmpHelper::ParseNetStreamCode( code->Data() );
-	StatusUpdated( this, ref new NetStatusUpdatedEventArgs( nsc ) );
+void NetStream::SetBufferWatermarks( uint64 highBytes, uint64 lowBytes, TimeSpan highDuration, TimeSpan lowDuration )
+{
+	buffer_watermarks watermarks;
+	watermarks.high_bytes = static_cast<size_t>( highBytes );
+	watermarks.low_bytes = static_cast<size_t>( lowBytes );
+	watermarks.high_milliseconds = static_cast<uint32>( highDuration.Duration / 10000 );
+	watermarks.low_milliseconds = static_cast<uint32>( lowDuration.Duration / 10000 );
+	stream_->set_buffer_watermarks( watermarks );
 }
 
-void NetStream::OnAggregateMessage( rtmp_header header, std::vector<uint8> data )
+void NetStream::SetLatencyBudget( TimeSpan budget )
 {
-	if( data.size() < 11 )
-	{
-		return;
-	}
+	stream_->set_latency_budget( static_cast<uint32>( budget.Duration / 10000 ) );
+}
 
-	auto itr = data.cbegin();
-	do
-	{
-		const auto& tag = *reinterpret_cast<const flv_tag*>( &itr[0] );
-		itr += 11;
+void NetStream::NotifyConsumed( size_t bytes, int64 timestamp )
+{
+	stream_->consumed( bytes, timestamp );
+}
 
-		auto clone_header = header;
-		clone_header.timestamp = tag.timestamp();
-		clone_header.type_id = static_cast<type_id_type>( tag.tag_type() );
+void NetStream::OnAttached()
+{
+	Attached( this, ref new NetStreamAttachedEventArgs() );
+}
 
-		auto end_of_sequence = itr + tag.data_size();
+void NetStream::OnStatus( net_status_code code )
+{
+	StatusUpdated( this, ref new NetStatusUpdatedEventArgs( static_cast<NetStatusCodeType>( code ) ) );
+}
 
-		std::vector<uint8> subset_data( itr, end_of_sequence );
-		switch( tag.tag_type() )
-		{
-		case flv_tag_type::audio:
-			OnAudioMessage( std::move( clone_header ), std::move( subset_data ) );
-			break;
+void NetStream::OnMetadata( const media::stream_metadata& metadata )
+{
+	MetadataReceived( this, ref new NetStreamMetadataReceivedEventArgs( metadata ) );
+}
 
-		case flv_tag_type::video:
-			OnVideoMessage( std::move( clone_header ), std::move( subset_data ) );
-			break;
+void NetStream::OnAudioStarted( bool audioOnly, const media::audio_info& info )
+{
+	audioInfo_->SetInfo( info );
+	AudioStarted( this, ref new NetStreamAudioStartedEventArgs( audioOnly, audioInfo_ ) );
+}
 
-		case flv_tag_type::script_data:
-			OnDataMessage( std::move( clone_header ), std::move( subset_data ) );
-			break;
-		}
-		itr = end_of_sequence + 4;
-	} while( itr < data.cend() );
+void NetStream::OnAudio( const audio_sample& sample )
+{
+	auto args = ref new NetStreamAudioReceivedEventArgs();
+	args->Info = audioInfo_;
+	args->SetTimestamp( sample.timestamp );
+	args->SetData( sample.data );
+	AudioReceived( this, args );
 }
 
-task<void> NetStream::SendActionAsync( Mntone::Data::Amf::AmfArray^ amf )
+void NetStream::OnVideoStarted( bool videoOnly, const media::video_info& info )
 {
-	if( parent_ != nullptr )
-	{
-		return parent_->SendActionAsync( streamId_, amf );
-	}
+	videoInfo_->SetInfo( info );
+	VideoStarted( this, ref new NetStreamVideoStartedEventArgs( videoOnly, videoInfo_ ) );
+}
 
-	return create_task( [] { } );
+void NetStream::OnVideo( const video_sample& sample )
+{
+	auto args = ref new NetStreamVideoReceivedEventArgs();
+	args->Info = videoInfo_;
+	args->IsKeyframe = sample.keyframe;
+	args->SetDecodeTimestamp( sample.decode_timestamp );
+	args->SetPresentationTimestamp( sample.presentation_timestamp );
+	args->SetData( sample.data );
+	VideoReceived( this, args );
 }
\ No newline at end of file
@@ -1,13 +1,13 @@
 #pragma once
-#include "rtmp_packet.h"
+#include "net_stream.h"
 #include "NetConnection.h"
 #include "NetStreamAttachedEventArgs.h"
 #include "NetStatusUpdatedEventArgs.h"
+#include "NetStreamMetadataReceivedEventArgs.h"
 #include "NetStreamAudioStartedEventArgs.h"
 #include "NetStreamAudioReceivedEventArgs.h"
 #include "NetStreamVideoStartedEventArgs.h"
 #include "NetStreamVideoReceivedEventArgs.h"
-#include "Media/avc_decoder_configuration_record.h"
 
 namespace Mntone { namespace Rtmp {
 
@@ -28,49 +28,95 @@ namespace Mntone { namespace Rtmp {
 		Windows::Foundation::IAsyncAction^ ResumeAsync( float64 position );
 		Windows::Foundation::IAsyncAction^ SeekAsync( float64 offset );
 
-	internal:
-		void AttachedImpl();
-		void DetachedImpl();
+		// type: "live" (default), "record" or "append"
+		Windows::Foundation::IAsyncAction^ PublishAsync( Platform::String^ streamName );
+		Windows::Foundation::IAsyncAction^ PublishAsync( Platform::String^ streamName, Platform::String^ type );
+
+		// Sent as @setDataFrame onMetaData, which the server keeps for later subscribers
+		Windows::Foundation::IAsyncAction^ SendMetadataAsync( Mntone::Data::Amf::AmfObject^ metadata );
+
+		// Queue one frame for sending. data is the codec payload without the FLV tag header
+		// (length-prefixed NAL units for AVC); timestamps are on the stream's clock.
+		void SendAudio( Media::AudioFormat format, uint32 sampleRate, uint16 channelCount, uint16 bitsPerSample, bool sequenceHeader, Windows::Foundation::TimeSpan timestamp, Windows::Storage::Streams::IBuffer^ data );
+		void SendVideo( Media::VideoFormat format, bool keyframe, bool sequenceHeader, Windows::Foundation::TimeSpan decodeTimestamp, Windows::Foundation::TimeSpan presentationTimestamp, Windows::Storage::Streams::IBuffer^ data );
+
+		// Stops reading from the connection while more than the high marks of received media are
+		// waiting to be consumed, until it is back under the low marks. Zero high marks disable it.
+		void SetBufferWatermarks( uint64 highBytes, uint64 lowBytes, Windows::Foundation::TimeSpan highDuration, Windows::Foundation::TimeSpan lowDuration );
+
+		// Publishing: drops video frames, never audio or sequence headers, while queued media is
+		// older than the budget, non-reference frames first and whole GOPs past twice the budget.
+		// Zero disables dropping.
+		void SetLatencyBudget( Windows::Foundation::TimeSpan budget );
 
-		void OnMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnAudioMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnVideoMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnDataMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnCommandMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
-		void OnAggregateMessage( mntone::rtmp::rtmp_header header, std::vector<uint8> data );
+	internal:
+		// Reports a received sample as consumed (timestamp in milliseconds)
+		void NotifyConsumed( size_t bytes, int64 timestamp );
 
 	private:
 		~NetStream();
 
-		Concurrency::task<void> SendActionAsync( Mntone::Data::Amf::AmfArray^ amf );
+		// Core callbacks
+		void OnAttached();
+		void OnStatus( mntone::rtmp::net_status_code code );
+		void OnMetadata( const mntone::rtmp::media::stream_metadata& metadata );
+		void OnAudioStarted( bool audioOnly, const mntone::rtmp::media::audio_info& info );
+		void OnAudio( const mntone::rtmp::audio_sample& sample );
+		void OnVideoStarted( bool videoOnly, const mntone::rtmp::media::video_info& info );
+		void OnVideo( const mntone::rtmp::video_sample& sample );
+
+		mntone::rtmp::byte_slice ToSlice( Windows::Storage::Streams::IBuffer^ data );
 
-		void AnalysisAvc( mntone::rtmp::rtmp_header header, std::vector<uint8> data, NetStreamVideoReceivedEventArgs^& args );
-			
 	public:
 		event Windows::Foundation::EventHandler<NetStreamAttachedEventArgs^>^ Attached;
 		event Windows::Foundation::EventHandler<NetStatusUpdatedEventArgs^>^ StatusUpdated;
+		event Windows::Foundation::EventHandler<NetStreamMetadataReceivedEventArgs^>^ MetadataReceived;
 		event Windows::Foundation::EventHandler<NetStreamAudioStartedEventArgs^>^ AudioStarted;
 		event Windows::Foundation::EventHandler<NetStreamAudioReceivedEventArgs^>^ AudioReceived;
 		event Windows::Foundation::EventHandler<NetStreamVideoStartedEventArgs^>^ VideoStarted;
 		event Windows::Foundation::EventHandler<NetStreamVideoReceivedEventArgs^>^ VideoReceived;
 
+		property uint64 ThrottleCount
+		{
+			uint64 get() { return stream_->throttle_statistics().throttle_count; }
+		}
+		property Windows::Foundation::TimeSpan ThrottledDuration
+		{
+			Windows::Foundation::TimeSpan get()
+			{
+				Windows::Foundation::TimeSpan duration;
+				duration.Duration = static_cast<int64>( stream_->throttle_statistics().throttled_milliseconds ) * 10000ll;
+				return duration;
+			}
+		}
+
+		property uint64 DroppedFrameCount
+		{
+			uint64 get()
+			{
+				const auto counters = stream_->drop_statistics();
+				return counters.non_reference_frames + counters.gop_frames;
+			}
+		}
+		property uint64 DroppedGopCount
+		{
+			uint64 get() { return stream_->drop_statistics().gops; }
+		}
+		property uint64 DroppedBytes
+		{
+			uint64 get() { return stream_->drop_statistics().bytes; }
+		}
+
 	internal:
 		NetConnection^ parent_;
-		uint32 streamId_;
+		std::shared_ptr<mntone::rtmp::net_stream> stream_;
 
 	private:
-		bool audioEnabled_, audioInfoEnabled_;
 		Media::AudioInfo^ audioInfo_;
-
-		bool videoEnabled_, videoInfoEnabled_;
 		Media::VideoInfo^ videoInfo_;
-		uint16 videoDataRate_, videoHeight_, videoWidth_;
-
-		// for Avc
-		uint8 lengthSizeMinusOne_;
 
-		// for AAC
-		uint32 samplingRate_;
+		// Frame payloads handed to the core while they wait in the send queue
+		std::shared_ptr<mntone::rtmp::body_pool> sendPool_;
 	};
 
 } }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "NetStreamAudioReceivedEventArgs.h"
+#include "slice_buffer.h"
 
+using namespace mntone::rtmp;
 using namespace Mntone::Rtmp;
 
 NetStreamAudioReceivedEventArgs::NetStreamAudioReceivedEventArgs()
@@ -11,11 +13,9 @@ void NetStreamAudioReceivedEventArgs::SetTimestamp( int64 timestamp )
 	Timestamp_.Duration = timestamp * 10000ll;
 }
 
-void NetStreamAudioReceivedEventArgs::SetData( std::vector<uint8> data, const size_t offset )
+void NetStreamAudioReceivedEventArgs::SetData( byte_slice data )
 {
-	auto buf = ref new Windows::Storage::Streams::DataWriter();
-	buf->WriteBytes( Platform::ArrayReference<uint8>( data.data() + offset, static_cast<uint32>( data.size() - offset ) ) );
-	Data_ = buf->DetachBuffer();
+	Data_ = slice_buffer::create( std::move( data ) );
 }
 
 Windows::Media::Core::MediaStreamSample^ NetStreamAudioReceivedEventArgs::CreateSample()
@@ -1,5 +1,6 @@
 #pragma once
 #include "Media/AudioInfo.h"
+#include "byte_slice.h"
 
 namespace Mntone { namespace Rtmp {
 
@@ -10,7 +11,7 @@ namespace Mntone { namespace Rtmp {
 		NetStreamAudioReceivedEventArgs();
 
 		void SetTimestamp( int64 timestamp );
-		void SetData( std::vector<uint8> data, const size_t offset = 0 );
+		void SetData( mntone::rtmp::byte_slice data );
 
 		Windows::Media::Core::MediaStreamSample^ CreateSample();
 
@@ -0,0 +1,34 @@
+#include "pch.h"
+#include "NetStreamMetadataReceivedEventArgs.h"
+#include "RtmpHelper.h"
+
+using namespace Mntone::Rtmp;
+
+NetStreamMetadataReceivedEventArgs::NetStreamMetadataReceivedEventArgs( const mntone::rtmp::media::stream_metadata& metadata )
+	: FileSize_( static_cast<uint64>( metadata.file_size ) )
+	, HasVideo_( metadata.has_video )
+	, VideoCodecId_( metadata.video_codec_id )
+	, Width_( metadata.width )
+	, Height_( metadata.height )
+	, VideoDataRate_( metadata.video_data_rate )
+	, FrameRate_( metadata.frame_rate )
+	, HasAudio_( metadata.has_audio )
+	, AudioCodecId_( metadata.audio_codec_id )
+	, AudioDataRate_( metadata.audio_data_rate )
+	, AudioSampleRate_( metadata.audio_sample_rate )
+	, AudioSampleSize_( metadata.audio_sample_size )
+	, IsStereo_( metadata.stereo )
+	, Encoder_( RtmpHelper::ToPlatformString( metadata.encoder ) )
+{
+	Duration_.Duration = static_cast<int64>( metadata.duration * 10000000.0 );
+
+	KeyframeTimes_ = ref new Platform::Collections::VectorView<float64>( metadata.keyframe_times );
+
+	std::vector<uint64> positions;
+	positions.reserve( metadata.keyframe_positions.size() );
+	for( const auto position : metadata.keyframe_positions )
+	{
+		positions.push_back( static_cast<uint64>( position ) );
+	}
+	KeyframePositions_ = ref new Platform::Collections::VectorView<uint64>( std::move( positions ) );
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#include "Media/stream_metadata.h"
+
+namespace Mntone { namespace Rtmp {
+
+	// onMetaData as the encoder declared it; values it left out are 0
+	[Windows::Foundation::Metadata::WebHostHidden]
+	public ref class NetStreamMetadataReceivedEventArgs sealed
+	{
+	internal:
+		NetStreamMetadataReceivedEventArgs( const mntone::rtmp::media::stream_metadata& metadata );
+
+	public:
+		// Zero for live streams
+		property Windows::Foundation::TimeSpan Duration
+		{
+			Windows::Foundation::TimeSpan get() { return Duration_; }
+		}
+		property uint64 FileSize
+		{
+			uint64 get() { return FileSize_; }
+		}
+
+		property bool HasVideo
+		{
+			bool get() { return HasVideo_; }
+		}
+		property uint8 VideoCodecId
+		{
+			uint8 get() { return VideoCodecId_; }
+		}
+		property uint16 Width
+		{
+			uint16 get() { return Width_; }
+		}
+		property uint16 Height
+		{
+			uint16 get() { return Height_; }
+		}
+		// kbit/s
+		property float64 VideoDataRate
+		{
+			float64 get() { return VideoDataRate_; }
+		}
+		property float64 FrameRate
+		{
+			float64 get() { return FrameRate_; }
+		}
+
+		property bool HasAudio
+		{
+			bool get() { return HasAudio_; }
+		}
+		property uint8 AudioCodecId
+		{
+			uint8 get() { return AudioCodecId_; }
+		}
+		// kbit/s
+		property float64 AudioDataRate
+		{
+			float64 get() { return AudioDataRate_; }
+		}
+		property uint32 AudioSampleRate
+		{
+			uint32 get() { return AudioSampleRate_; }
+		}
+		property uint16 AudioSampleSize
+		{
+			uint16 get() { return AudioSampleSize_; }
+		}
+		property bool IsStereo
+		{
+			bool get() { return IsStereo_; }
+		}
+
+		property Platform::String^ Encoder
+		{
+			Platform::String^ get() { return Encoder_; }
+		}
+
+		// Seek index of recorded files: key frame times in seconds and their byte offsets, pairwise
+		property Windows::Foundation::Collections::IVectorView<float64>^ KeyframeTimes
+		{
+			Windows::Foundation::Collections::IVectorView<float64>^ get() { return KeyframeTimes_; }
+		}
+		property Windows::Foundation::Collections::IVectorView<uint64>^ KeyframePositions
+		{
+			Windows::Foundation::Collections::IVectorView<uint64>^ get() { return KeyframePositions_; }
+		}
+
+	private:
+		Windows::Foundation::TimeSpan Duration_;
+		uint64 FileSize_;
+		bool HasVideo_;
+		uint8 VideoCodecId_;
+		uint16 Width_, Height_;
+		float64 VideoDataRate_, FrameRate_;
+		bool HasAudio_;
+		uint8 AudioCodecId_;
+		float64 AudioDataRate_;
+		uint32 AudioSampleRate_;
+		uint16 AudioSampleSize_;
+		bool IsStereo_;
+		Platform::String^ Encoder_;
+		Windows::Foundation::Collections::IVectorView<float64>^ KeyframeTimes_;
+		Windows::Foundation::Collections::IVectorView<uint64>^ KeyframePositions_;
+	};
+
+} }
\ No newline at end of file
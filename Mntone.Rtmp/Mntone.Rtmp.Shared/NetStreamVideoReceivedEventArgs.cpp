@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "NetStreamVideoReceivedEventArgs.h"
+#include "slice_buffer.h"
 
+using namespace mntone::rtmp;
 using namespace Mntone::Rtmp;
 
 NetStreamVideoReceivedEventArgs::NetStreamVideoReceivedEventArgs()
@@ -16,11 +18,9 @@ void NetStreamVideoReceivedEventArgs::SetPresentationTimestamp( int64 presentati
 	PresentationTimestamp_.Duration = presentationTimestamp * 10000ll;
 }
 
-void NetStreamVideoReceivedEventArgs::SetData( std::vector<uint8> data, const size_t offset )
+void NetStreamVideoReceivedEventArgs::SetData( byte_slice data )
 {
-	auto buf = ref new Windows::Storage::Streams::DataWriter();
-	buf->WriteBytes( Platform::ArrayReference<uint8>( data.data() + offset, static_cast<uint32>( data.size() - offset ) ) );
-	Data_ = buf->DetachBuffer();
+	Data_ = slice_buffer::create( std::move( data ) );
 }
 
 Windows::Media::Core::MediaStreamSample^ NetStreamVideoReceivedEventArgs::CreateSample()
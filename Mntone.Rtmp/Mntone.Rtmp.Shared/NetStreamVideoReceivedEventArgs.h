@@ -1,5 +1,6 @@
 #pragma once
 #include "Media/VideoInfo.h"
+#include "byte_slice.h"
 
 namespace Mntone { namespace Rtmp {
 
@@ -11,7 +12,7 @@ namespace Mntone { namespace Rtmp {
 
 		void SetDecodeTimestamp( int64 decodeTimestamp );
 		void SetPresentationTimestamp( int64 presentationTimestamp );
-		void SetData( std::vector<uint8> data, const size_t offset = 0 );
+		void SetData( mntone::rtmp::byte_slice data );
 
 		Windows::Media::Core::MediaStreamSample^ CreateSample();
 
@@ -1,17 +1,17 @@
 #pragma once
-#include "NetStatusCodeType.h"
+#include "amf0_writer.h"
 
 namespace Mntone { namespace Rtmp {
 
 	ref class RtmpHelper sealed
 	{
 	internal:
-		static Mntone::Data::Amf::AmfArray^ ParseAmf( std::vector<uint8> data );
+		static Mntone::Data::Amf::AmfArray^ ParseAmf( const uint8* data, const size_t length );
+		// Appends a user supplied value; the fixed parts of a command go through the writer directly
+		static void WriteAmf( mntone::rtmp::amf0::writer& writer, Mntone::Data::Amf::IAmfValue^ value );
 
-		static NetStatusCodeType ParseNetConnectionConnectCode( const std::wstring code );
-		static NetStatusCodeType ParseNetStreamCode( const std::wstring code );
-
-		static uint32 ReadUint24( Windows::Storage::Streams::DataReader^ reader );
+		static std::string ToUtf8String( Platform::String^ value );
+		static Platform::String^ ToPlatformString( const std::string& value );
 	};
 
 } }
\ No newline at end of file
@@ -1,7 +1,12 @@
 ﻿#pragma once
 
 // STL Headers:
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <stdexcept>
 #include <queue>
 #include <vector>
 #include <sstream>
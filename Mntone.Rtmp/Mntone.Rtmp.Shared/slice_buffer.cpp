@@ -0,0 +1,59 @@
+#include "pch.h"
+#include "slice_buffer.h"
+
+using namespace mntone::rtmp;
+
+slice_buffer::slice_buffer( byte_slice data )
+	: data_( std::move( data ) )
+	, length_( static_cast<UINT32>( data_.size() ) )
+{ }
+
+Windows::Storage::Streams::IBuffer^ slice_buffer::create( byte_slice data )
+{
+	const auto buffer = Microsoft::WRL::Make<slice_buffer>( std::move( data ) );
+	if( buffer == nullptr )
+	{
+		throw ref new Platform::OutOfMemoryException();
+	}
+	return reinterpret_cast<Windows::Storage::Streams::IBuffer^>( static_cast<ABI::Windows::Storage::Streams::IBuffer*>( buffer.Get() ) );
+}
+
+IFACEMETHODIMP slice_buffer::get_Capacity( UINT32* value )
+{
+	if( value == nullptr )
+	{
+		return E_POINTER;
+	}
+	*value = static_cast<UINT32>( data_.size() );
+	return S_OK;
+}
+
+IFACEMETHODIMP slice_buffer::get_Length( UINT32* value )
+{
+	if( value == nullptr )
+	{
+		return E_POINTER;
+	}
+	*value = length_;
+	return S_OK;
+}
+
+IFACEMETHODIMP slice_buffer::put_Length( UINT32 value )
+{
+	if( value > data_.size() )
+	{
+		return E_INVALIDARG;
+	}
+	length_ = value;
+	return S_OK;
+}
+
+IFACEMETHODIMP slice_buffer::Buffer( byte** value )
+{
+	if( value == nullptr )
+	{
+		return E_POINTER;
+	}
+	*value = const_cast<byte*>( data_.data() );
+	return S_OK;
+}
\ No newline at end of file
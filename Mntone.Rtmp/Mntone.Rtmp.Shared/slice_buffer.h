@@ -0,0 +1,37 @@
+#pragma once
+#include <wrl.h>
+#include <robuffer.h>
+#include <windows.storage.streams.h>
+#include "byte_slice.h"
+
+namespace mntone { namespace rtmp {
+
+	// Read-only IBuffer over a byte_slice. The slice keeps the pooled block alive for as long as
+	// the consumer (e.g. MediaStreamSample) holds the buffer, so no payload bytes are copied.
+	class slice_buffer final
+		: public Microsoft::WRL::RuntimeClass<
+			Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::WinRtClassicComMix>,
+			ABI::Windows::Storage::Streams::IBuffer,
+			Windows::Storage::Streams::IBufferByteAccess>
+	{
+		InspectableClass( L"Mntone.Rtmp.SliceBuffer", BaseTrust )
+
+	public:
+		explicit slice_buffer( byte_slice data );
+
+		static Windows::Storage::Streams::IBuffer^ create( byte_slice data );
+
+		// IBuffer
+		IFACEMETHOD( get_Capacity )( UINT32* value ) override;
+		IFACEMETHOD( get_Length )( UINT32* value ) override;
+		IFACEMETHOD( put_Length )( UINT32 value ) override;
+
+		// IBufferByteAccess
+		IFACEMETHOD( Buffer )( byte** value ) override;
+
+	private:
+		byte_slice data_;
+		UINT32 length_;
+	};
+
+} }
\ No newline at end of file